@@ -1,8 +1,21 @@
 #include "DHT22.h"
+#include "us_ticker_api.h"
 
+// start pulse: the host holds the line low for at least 1 ms (18 ms is the
+// figure for the older DHT11, and works for both)
+#define DHT22_START_MS      18
+// whole reply: 80 + 80 us response, 40 bits of at most 120 us, 50 us stop
+// bit, with margin for slow parts and the 1 ms kernel tick
+#define DHT22_FRAME_MS      10
+// a bit is 50 us low and then 26-28 us (0) or 70 us (1) high, so the
+// spacing of falling edges is ~78 us for a 0 and ~120 us for a 1
+#define DHT22_BIT_MIN_US    60
+#define DHT22_BIT_SPLIT_US  100
+#define DHT22_BIT_MAX_US    160
 
-DHT22::DHT22(PinName pin) {
-    _data_pin = pin;
+DHT22::DHT22(PinName pin) :
+    _temperature(0), _humidity(0), _error(ERROR_NONE), _data(pin), _irq(pin),
+    _frame(0) {
 }
 
 int DHT22::getTemperature() {
@@ -13,37 +26,61 @@ int DHT22::getHumidity() {
     return _humidity;
 }
 
+DHT22::Error DHT22::getError() {
+    return _error;
+}
+
+void DHT22::edge() {
+    if (_edges.push(us_ticker_read()) && _edges.size() == EDGES)
+        _frame.release();
+}
+
 bool DHT22::sample() {
-    DigitalInOut DHT22(_data_pin);
-    int dht22_dat [5];
-    DHT22.output();
-    DHT22.write(0);
-    wait_ms(18);
-    DHT22.write(1);
-    DHT22.input();
-    wait_us(40);
-    wait_us(80);
-    int i,j,result=0;
-    for (i=0; i<5; i++) {
-        result=0;
-        for (j=0; j<8; j++) {
-            while (DHT22);
-            while (!DHT22);
-            wait_us(50);
-            int p;
-            p=DHT22;
-            p=p <<(7-j);
-            result=result|p;
-        }
-        dht22_dat[i] = result;
-    }
-    int dht22_check_sum;
-    dht22_check_sum=dht22_dat[0]+dht22_dat[1]+dht22_dat[2]+dht22_dat[3];
-    dht22_check_sum= dht22_check_sum%256;
-    if (dht22_check_sum==dht22_dat[4]) {
-        _humidity=dht22_dat[0]*256+dht22_dat[1];
-        _temperature=dht22_dat[2]*256+dht22_dat[3];
-        return true;
+    while (_frame.wait(0) > 0)
+        ;   // a frame that completed after the last sample timed out
+
+    // start pulse; the thread blocks rather than spinning through it
+    _data.output();
+    _data.write(0);
+    Thread::wait(DHT22_START_MS);
+
+    // release the line and block until the reply is in or the frame time
+    // has passed
+    _edges.clear();
+    _irq.fall(this, &DHT22::edge);
+    _data.input();
+    _frame.wait(DHT22_FRAME_MS);
+    _irq.fall(NULL);
+
+    _error = decode();
+    return _error == ERROR_NONE;
+}
+
+DHT22::Error DHT22::decode() {
+    if (_edges.size() < EDGES)
+        return ERROR_TIMEOUT;
+
+    // the start of the response, then the start of the first bit
+    uint32_t last = 0, next = 0;
+    _edges.pop(last);
+    _edges.pop(last);
+    uint8_t data[5] = { 0, 0, 0, 0, 0 };
+    for (int bit = 0; bit < 40; bit++) {
+        _edges.pop(next);
+        uint32_t width = next - last;
+        last = next;
+        if (width < DHT22_BIT_MIN_US || width > DHT22_BIT_MAX_US)
+            return ERROR_BIT_TIMING;
+        if (width > DHT22_BIT_SPLIT_US)
+            data[bit / 8] |= 0x80 >> (bit % 8);
     }
-    return false;
+    if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4])
+        return ERROR_CHECKSUM;
+
+    _humidity = data[0] * 256 + data[1];
+    // temperature is sign and magnitude, tenths of a degree
+    _temperature = (data[2] & 0x7F) * 256 + data[3];
+    if (data[2] & 0x80)
+        _temperature = -_temperature;
+    return ERROR_NONE;
 }
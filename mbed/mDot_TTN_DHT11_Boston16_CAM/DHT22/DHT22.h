@@ -2,16 +2,49 @@
 #define MBED_DHT22_H
 
 #include "mbed.h"
+#include "rtos.h"
+#include "SpscRing.h"
 
+/** DHT22 / AM2302 single-wire temperature and humidity sensor.
+ *
+ * sample() sends the start pulse and then timestamps the falling edges of
+ * the sensor's reply from a pin interrupt; the bits are decoded from the
+ * edge spacing once the frame is in. The calling thread blocks while
+ * waiting, so other threads run, and a missing or stuck sensor ends the
+ * sample with ERROR_TIMEOUT instead of hanging. sample() has to be called
+ * from a thread.
+ */
 class DHT22 {
-private:
-    int _temperature,_humidity;
-    PinName _data_pin;
 public:
+    enum Error {
+        ERROR_NONE = 0,
+        ERROR_TIMEOUT,      /**< sensor did not answer, or the frame was cut short */
+        ERROR_BIT_TIMING,   /**< an edge interval fits neither a 0 nor a 1 */
+        ERROR_CHECKSUM      /**< frame complete but the checksum does not match */
+    };
+
     DHT22(PinName);
     bool sample();
     int getTemperature();
     int getHumidity();
+    Error getError();
+
+private:
+    // falling edges: start of the response, start of each of the 40 bits,
+    // end of the last bit
+    enum { EDGES = 42 };
+
+    void edge();
+    Error decode();
+
+    int _temperature,_humidity;
+    Error _error;
+    DigitalInOut _data;
+    InterruptIn _irq;
+    // timestamps from the pin interrupt, decoded as they are taken out
+    SpscRing<uint32_t, 64> _edges;
+    // released by the pin interrupt once the frame is in
+    Semaphore _frame;
 };
 
-#endif
\ No newline at end of file
+#endif
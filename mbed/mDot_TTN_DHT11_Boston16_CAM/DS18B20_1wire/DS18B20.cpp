@@ -1,7 +1,8 @@
 #include "DS18B20.h"
+#include <string.h>
 
 DS18B20::DS18B20(PinName pin, unsigned resolution) :
-    _pin(pin) {
+    _pin(pin), _resolution(resolution), _converting(false) {
     SetResolution(resolution);
 }
 
@@ -77,6 +78,7 @@ unsigned DS18B20::SetResolution(unsigned resolution) {
         WriteByte(0x80);                // Alarm TL
         WriteByte(resolution);          // 0xx11111 xx=resolution (9-12 bits)
     }
+    _resolution = resolution;
     return 0;
 }
 
@@ -87,10 +89,8 @@ unsigned DS18B20::DoConversion() {
     else {
         WriteByte(SKIP_ROM);            // Skip ROM
         WriteByte(CONVERT);             // Convert
-        while (ReadBit() == 0)
-            ; // wait for conversion to complete
+        return PollConversion();        // wait for conversion to complete
     }
-    return 0;
 }
 
 // Do Conversion and get temperature as s8.4 sign-extended to 16-bits.
@@ -98,18 +98,40 @@ int DS18B20::RawTemperature() {
     // Perform the temperature conversion.
     if (DoConversion() != 0)
         return INVALID_TEMPERATURE;
-    // Read the temperature back.
+    return ReadScratchpadTemperature();
+}
+
+// Address one device by its ROM, or all of them if ROM_Code is NULL.
+void DS18B20::Select(const DS18B20::ROM_Code_t *ROM_Code) {
+    if (ROM_Code == NULL) {
+        WriteByte(SKIP_ROM);    // Skip ROM
+        return;
+    }
+    WriteByte(MATCH_ROM);       // Match ROM
+    for (unsigned i = 0; i < 8; ++i)
+        WriteByte(ROM_Code->rom[i]);
+}
+
+// Read the temperature of the last conversion back from the scratchpad.
+int DS18B20::ReadScratchpadTemperature(const DS18B20::ROM_Code_t *ROM_Code) {
     if (Reset() != 0)
         return INVALID_TEMPERATURE;
     else {
-        WriteByte(SKIP_ROM);    // Skip ROM
+        Select(ROM_Code);
         WriteByte(READ_SCRATCHPAD);    // Read Scrachpad
-        unsigned LSB = ReadByte();
-        unsigned MSB = ReadByte();
-        // Terminate read as we only want temperature
-        Reset();
+        uint8_t scratch[9];
+        uint8_t all_and = 0xFF, all_or = 0x00;
+        for (unsigned i = 0; i < 9; ++i) {
+            scratch[i] = ReadByte();
+            all_and &= scratch[i];
+            all_or |= scratch[i];
+        }
+        // A device that is not there leaves the bus high (all 0xFF) and a
+        // bus held low reads all zeros, which the CRC alone would pass.
+        if (all_and == 0xFF || all_or == 0x00 || CRC8(scratch, 8) != scratch[8])
+            return INVALID_TEMPERATURE;
         // Ensure correct sign-extension.
-        return (int)((int16_t)((MSB << 8) | LSB));
+        return (int)((int16_t)((scratch[1] << 8) | scratch[0]));
     }
 }
 
@@ -119,6 +141,86 @@ float DS18B20::GetTemperature() {
     return ((float)temperature) / 16.0;
 }
 
+// Trigger a conversion and let a Timeout mark its end.
+unsigned DS18B20::StartConversion() {
+    _done.attach((void (*)(void))NULL);
+    return Start();
+}
+
+unsigned DS18B20::StartConversion(void (*fptr)(void)) {
+    _done.attach(fptr);
+    return Start();
+}
+
+unsigned DS18B20::Start() {
+    _timeout.detach();
+    _converting = false;
+    if (Reset() != 0)
+        return 1;
+    WriteByte(SKIP_ROM);            // Skip ROM
+    WriteByte(CONVERT);             // Convert
+    _converting = true;
+    // 93.75ms at 9 bits, doubling with every extra bit (config bits 6:5)
+    _timeout.attach_us(this, &DS18B20::ConversionDone, 93750 << ((_resolution >> 5) & 0x03));
+    return 0;
+}
+
+void DS18B20::ConversionDone() {
+    _converting = false;
+    _done.call();
+}
+
+bool DS18B20::IsReady() const {
+    return !_converting;
+}
+
+// The devices hold the bus low until they are all done; a bus that stays
+// low for longer than the slowest conversion is stuck. Returns 0 when the
+// conversion ended, 1 on timeout.
+unsigned DS18B20::PollConversion() {
+    Timer timer;
+    timer.start();
+    while (ReadBit() == 0) {
+        if (timer.read_us() > MAX_CONVERSION_US)
+            return 1;
+    }
+    return 0;
+}
+
+unsigned DS18B20::WaitConversion() {
+    unsigned result = 0;
+    if (_converting) {
+        result = PollConversion();
+        _timeout.detach();
+        ConversionDone();
+    }
+    return result;
+}
+
+// Collect the result of StartConversion().
+float DS18B20::ReadResult(const DS18B20::ROM_Code_t *ROM_Code) {
+    if (WaitConversion() != 0)
+        return ((float)INVALID_TEMPERATURE) / 16.0;
+    return ((float)ReadScratchpadTemperature(ROM_Code)) / 16.0;
+}
+
+// Collect the result of a broadcast StartConversion() from every device.
+unsigned DS18B20::ReadResults(const DS18B20::ROM_Code_t *ROM_Codes, float *temperatures, unsigned count) {
+    unsigned read = 0;
+    if (WaitConversion() != 0) {
+        for (unsigned i = 0; i < count; ++i)
+            temperatures[i] = ((float)INVALID_TEMPERATURE) / 16.0;
+        return 0;
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        int temperature = ReadScratchpadTemperature(&ROM_Codes[i]);
+        if (temperature != INVALID_TEMPERATURE)
+            ++read;
+        temperatures[i] = ((float)temperature) / 16.0;
+    }
+    return read;
+}
+
 // Read back DS18B20 ROM.
 int DS18B20::ReadROM(DS18B20::ROM_Code_t *ROM_Code) {
     if (Reset() != 0)
@@ -131,3 +233,75 @@ int DS18B20::ReadROM(DS18B20::ROM_Code_t *ROM_Code) {
     }
     return 0;
 }
+
+// Enumerate the bus (Maxim application note 187). Every device sends its
+// next ROM bit and its complement; both 0 means devices disagree there, and
+// the master picks the branch to follow, remembering the last fork where it
+// went 0 so the next pass takes the 1 branch instead.
+unsigned DS18B20::SearchROM(DS18B20::ROM_Code_t *ROM_Codes, unsigned max) {
+    ROM_Code_t rom;
+    unsigned found = 0;
+    unsigned last_discrepancy = 0;
+    bool last_device = false;
+
+    memset(&rom, 0, sizeof(rom));
+    while (!last_device && found < max) {
+        if (Reset() != 0)
+            break;
+        WriteByte(SEARCH_ROM);  // Search ROM
+
+        unsigned last_zero = 0;
+        bool failed = false;
+        for (unsigned bit = 1; bit <= 64; ++bit) {
+            unsigned id_bit = ReadBit();
+            unsigned cmp_id_bit = ReadBit();
+            uint8_t &byte = rom.rom[(bit - 1) / 8];
+            uint8_t mask = 1 << ((bit - 1) % 8);
+            unsigned direction;
+
+            if (id_bit && cmp_id_bit) {
+                failed = true;  // nobody answered
+                break;
+            } else if (id_bit != cmp_id_bit) {
+                direction = id_bit;
+            } else {
+                if (bit < last_discrepancy)
+                    direction = (byte & mask) ? 1 : 0;
+                else
+                    direction = (bit == last_discrepancy);
+                if (direction == 0)
+                    last_zero = bit;
+            }
+            if (direction)
+                byte |= mask;
+            else
+                byte &= ~mask;
+            WriteBit(direction);
+        }
+        // A bus held low reads 0 and 0 on every bit, which follows the 0
+        // branch to an all-zero ROM whose CRC is 0 too; no device has
+        // family code 0.
+        if (failed || rom.BYTES.familyCode == 0 || CRC8(rom.rom, 7) != rom.BYTES.VTV)
+            break;
+
+        ROM_Codes[found++] = rom;
+        last_discrepancy = last_zero;
+        last_device = (last_discrepancy == 0);
+    }
+    return found;
+}
+
+uint8_t DS18B20::CRC8(const uint8_t *data, unsigned len) {
+    uint8_t crc = 0;
+    while (len--) {
+        uint8_t byte = *data++;
+        for (unsigned bit = 0; bit < 8; ++bit) {
+            uint8_t mix = (crc ^ byte) & 0x01;
+            crc >>= 1;
+            if (mix)
+                crc ^= 0x8C;
+            byte >>= 1;
+        }
+    }
+    return crc;
+}
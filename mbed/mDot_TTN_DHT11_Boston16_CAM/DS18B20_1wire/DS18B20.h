@@ -46,6 +46,9 @@ class DS18B20
 public:
     /** Value to return when Reset() fails */
     enum {INVALID_TEMPERATURE = -10000};
+
+    /** Longest conversion time (12 bits) in us, after which the bus is taken to be stuck */
+    enum {MAX_CONVERSION_US = 750000};
     
     /** Temperature conversion dit width resolutions */
     enum RESOLUTION { RES_9_BIT=0x1f,    /**< 93.75ms */
@@ -94,7 +97,9 @@ public:
     float GetTemperature();
 
     /** Performs conversion but does not read back temperature. Not needed if
-     *  GetTemperature() is used as this calls DoConversion() itself. */
+     *  GetTemperature() is used as this calls DoConversion() itself.
+     *  Returns 1 if no device answered or the conversion did not end within
+     *  MAX_CONVERSION_US. */
     unsigned DoConversion();
     
     /** The method that GetTemperature() calls to do all the conversion and reading
@@ -102,19 +107,67 @@ public:
      *  fractional LSBs. Sometimes referred to as s28.4 format. */
     int RawTemperature();
     
-    /** Reads and returns the 8-byte internal ROM */
+    /** Reads and returns the 8-byte internal ROM. Only valid with a single
+     *  device on the bus; use SearchROM() when there may be more. */
     int ReadROM(ROM_Code_t *ROM_Code);
+
+    /** Enumerates the devices on the bus with the SEARCH ROM algorithm.
+     *
+     * @param ROM_Codes  Array receiving the ROM of every device found
+     * @param max        Size of the array
+     * @returns number of devices found (at most max)
+     */
+    unsigned SearchROM(ROM_Code_t *ROM_Codes, unsigned max);
     
     /** Sets the conversion resolution with RESOLUTION enum (9-12 bits signed) */
     unsigned SetResolution(unsigned resolution);
 
+    /** Starts a conversion and returns straight away. The bus is free for
+     *  the conversion time of the current resolution; IsReady() turns true
+     *  (and the callback, if any, runs in interrupt context) once it is over.
+     *  Returns 0 on success, 1 if no device answered the reset. */
+    unsigned StartConversion();
+
+    /** As StartConversion(), calling fptr when the result can be read. */
+    unsigned StartConversion(void (*fptr)(void));
+
+    /** As StartConversion(), calling a member function when the result can be read. */
+    template<typename T>
+    unsigned StartConversion(T *tptr, void (T::*mptr)(void)) {
+        _done.attach(tptr, mptr);
+        return Start();
+    }
+
+    /** True once the conversion started by StartConversion() has finished. */
+    bool IsReady() const;
+
+    /** Reads the temperature of the last conversion, waiting for it to end
+     *  if it is still running. Returns INVALID_TEMPERATURE / 16 on failure
+     *  (no answer, a bad scratchpad CRC or a conversion that does not end
+     *  within MAX_CONVERSION_US), like GetTemperature(). With ROM_Code set, reads that device only
+     *  (MATCH ROM); without, the bus must hold a single device. */
+    float ReadResult(const ROM_Code_t *ROM_Code = NULL);
+
+    /** Reads the result of a broadcast StartConversion() from each device
+     *  in ROM_Codes, as found by SearchROM(). All devices convert at once, so
+     *  the bus waits for one conversion time however many there are.
+     *
+     * @returns number of devices that answered with a good scratchpad CRC;
+     *          the others read INVALID_TEMPERATURE / 16
+     */
+    unsigned ReadResults(const ROM_Code_t *ROM_Codes, float *temperatures, unsigned count);
+
+    /** Dallas/Maxim CRC-8 (x^8 + x^5 + x^4 + 1) as used for the ROM and scratchpad */
+    static uint8_t CRC8(const uint8_t *data, unsigned len);
+
 protected:
 
     // Timing delay for 1-wire serial standard option
     enum DELAY { A = 6, B = 64, C = 60, D = 10, E = 9, F = 55, G = 0, H = 480, I = 70, J = 410 };
 
     // Device byte commands over 1-wire serial
-    enum COMMANDS { READ_ROM = 0x33, CONVERT = 0x44, READ_SCRATCHPAD = 0xBE,  WRITE_SCRATCHPAD = 0x4E, SKIP_ROM = 0xCC };
+    enum COMMANDS { READ_ROM = 0x33, CONVERT = 0x44, READ_SCRATCHPAD = 0xBE,  WRITE_SCRATCHPAD = 0x4E, SKIP_ROM = 0xCC,
+                    MATCH_ROM = 0x55, SEARCH_ROM = 0xF0 };
     
     // Methods from DS1Wire.h
     unsigned Reset();
@@ -123,8 +176,21 @@ protected:
     void WriteByte(unsigned byte);
     unsigned ReadByte();
 
+    void Select(const ROM_Code_t *ROM_Code);
+    unsigned Start();
+    unsigned PollConversion();
+    unsigned WaitConversion();
+    void ConversionDone();
+    int ReadScratchpadTemperature(const ROM_Code_t *ROM_Code = NULL);
+
     // The pin used for the Dallas 1-wire interface
     DigitalInOut _pin;
+
+    // Conversion in the background
+    unsigned _resolution;
+    Timeout _timeout;
+    FunctionPointer _done;
+    volatile bool _converting;
 };
 
 #endif
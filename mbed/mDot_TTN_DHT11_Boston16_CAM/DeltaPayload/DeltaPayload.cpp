@@ -0,0 +1,312 @@
+#include "DeltaPayload.h"
+
+#include <string.h>
+
+/* varints */
+
+uint32_t DeltaPayload::zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+int32_t DeltaPayload::unzigzag(uint32_t u) {
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+uint8_t *DeltaPayload::putVarint(uint8_t *p, const uint8_t *end, uint32_t v) {
+    do {
+        if (p >= end)
+            return NULL;
+        uint8_t c = v & 0x7F;
+        v >>= 7;
+        *p++ = v ? (c | 0x80) : c;
+    } while (v);
+    return p;
+}
+
+const uint8_t *DeltaPayload::getVarint(const uint8_t *p, const uint8_t *end, uint32_t *v) {
+    uint32_t u = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        if (p >= end)
+            return NULL;
+        uint8_t c = *p++;
+        u |= (uint32_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            *v = u;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/* encoder */
+
+DeltaEncoder::DeltaEncoder(State &state, unsigned fields, unsigned keyframe_interval) :
+    _state(state), _fields(fields > (unsigned)MAX_FIELDS ? (unsigned)MAX_FIELDS : fields),
+    _interval(keyframe_interval == 0 ? 1 :
+              keyframe_interval > (SeqMask + 1u) / 2 ? (SeqMask + 1u) / 2 : keyframe_interval),
+    _pending_seq(0), _pending_key(false), _have_pending(false) {
+}
+
+size_t DeltaEncoder::encode(const int32_t *fields, uint8_t *buf, size_t size) {
+    uint8_t seq = _state.seq & SeqMask;
+    // deltas only go against a reference less than a keyframe interval
+    // back: the decoder has had at most one keyframe since, so it still
+    // has the reference, and cannot take it for a later frame
+    if (((seq - _state.ref_seq) & SeqMask) >= _interval)
+        _state.valid = 0;
+    bool key = !_state.valid || _state.since_key + 1u >= _interval;
+    uint8_t *p = buf;
+    const uint8_t *end = buf + size;
+
+    if (size < (key ? 3u : 4u))
+        return 0;
+    *p++ = FORMAT;
+    *p++ = seq | (key ? CtlKeyframe : 0);
+    if (!key)
+        *p++ = _state.ref_seq & SeqMask;
+    uint8_t *presence = p++;
+    *presence = 0;
+
+    for (unsigned i = 0; i < _fields; i++) {
+        // wrap-around arithmetic: the decoder adds it back the same way
+        int32_t d = (int32_t)((uint32_t)fields[i] - (uint32_t)(key ? 0 : _state.ref[i]));
+        if (d == 0)
+            continue;
+        *presence |= 1 << i;
+        if ((p = putVarint(p, end, zigzag(d))) == NULL)
+            return 0;
+    }
+
+    memcpy(_pending, fields, _fields * sizeof(int32_t));
+    _pending_seq = seq;
+    _pending_key = key;
+    _have_pending = true;
+
+    _state.seq = (seq + 1) & SeqMask;
+    _state.since_key = key ? 0 : _state.since_key + 1;
+    return p - buf;
+}
+
+void DeltaEncoder::delivered() {
+    if (!_have_pending)
+        return;
+    memcpy(_state.ref, _pending, _fields * sizeof(int32_t));
+    _state.ref_seq = _pending_seq;
+    _state.valid = 1;
+    _have_pending = false;
+}
+
+void DeltaEncoder::forceKeyframe() {
+    _state.valid = 0;
+}
+
+bool DeltaEncoder::wasKeyframe() const {
+    return _pending_key;
+}
+
+unsigned DeltaEncoder::getFields() const {
+    return _fields;
+}
+
+/* decoder */
+
+DeltaDecoder::DeltaDecoder(unsigned fields) :
+    _fields(fields > (unsigned)MAX_FIELDS ? (unsigned)MAX_FIELDS : fields) {
+    memset(_history, 0, sizeof(_history));
+    memset(&_keyframe, 0, sizeof(_keyframe));
+    memset(&_reference, 0, sizeof(_reference));
+}
+
+void DeltaDecoder::remember(Frame &slot, uint8_t seq, const int32_t *fields) {
+    slot.valid = true;
+    slot.seq = seq;
+    memcpy(slot.fields, fields, _fields * sizeof(int32_t));
+}
+
+DeltaDecoder::Result DeltaDecoder::decode(const uint8_t *buf, size_t len, int32_t *fields, uint8_t *seq) {
+    const uint8_t *p = buf;
+    const uint8_t *end = buf + len;
+
+    if (len < 3 || *p++ != FORMAT)
+        return MALFORMED;
+    uint8_t ctl = *p++;
+    bool key = (ctl & CtlKeyframe) != 0;
+    uint8_t this_seq = ctl & SeqMask;
+
+    const Frame *ref = NULL;
+    if (!key) {
+        uint8_t ref_seq = *p++ & SeqMask;
+        if (p >= end)
+            return MALFORMED;
+        for (unsigned h = 0; h < HISTORY; h++) {
+            if (_history[h].valid && _history[h].seq == ref_seq) {
+                ref = &_history[h];
+                break;
+            }
+        }
+        if (!ref && _keyframe.valid && _keyframe.seq == ref_seq)
+            ref = &_keyframe;
+        if (!ref && _reference.valid && _reference.seq == ref_seq)
+            ref = &_reference;
+    }
+    uint8_t presence = *p++;
+    if (presence >> _fields)
+        return MALFORMED;
+
+    int32_t out[MAX_FIELDS];
+    for (unsigned i = 0; i < _fields; i++) {
+        uint32_t u = 0;
+        if (presence & (1 << i)) {
+            if ((p = getVarint(p, end, &u)) == NULL)
+                return MALFORMED;
+        }
+        out[i] = (int32_t)((uint32_t)(ref ? ref->fields[i] : 0) + (uint32_t)unzigzag(u));
+    }
+    if (p != end)
+        return MALFORMED;
+    if (!key && !ref)
+        return NO_REFERENCE;
+    // an acknowledged frame stays the encoder's reference until the next
+    // acknowledgement, however many frames that takes
+    if (ref && ref != &_reference)
+        _reference = *ref;
+
+    // newest first; frames far behind this one would only alias a
+    // sequence number that has since come round again
+    for (unsigned h = 0; h < HISTORY; h++) {
+        if (((this_seq - _history[h].seq) & SeqMask) > SeqMask / 2)
+            _history[h].valid = false;
+    }
+    if (((this_seq - _keyframe.seq) & SeqMask) > SeqMask / 2)
+        _keyframe.valid = false;
+    if (((this_seq - _reference.seq) & SeqMask) > SeqMask / 2)
+        _reference.valid = false;
+    memmove(&_history[1], &_history[0], (HISTORY - 1) * sizeof(Frame));
+    remember(_history[0], this_seq, out);
+    if (key)
+        remember(_keyframe, this_seq, out);
+
+    memcpy(fields, out, _fields * sizeof(int32_t));
+    if (seq)
+        *seq = this_seq;
+    return DECODED;
+}
+
+/* batches */
+
+BatchEncoder::BatchEncoder(State &state, unsigned fields) :
+    _state(state), _fields(fields > (unsigned)MAX_FIELDS ? (unsigned)MAX_FIELDS : fields) {
+}
+
+uint32_t BatchEncoder::seconds(uint32_t ms) {
+    return (ms + 500) / 1000;
+}
+
+bool BatchEncoder::add(uint32_t now_ms, const int32_t *fields, size_t max_frame) {
+    if (_state.count >= MAX_RECORDS || max_frame <= (size_t)BATCH_HEADER)
+        return false;
+    size_t room = max_frame - BATCH_HEADER;
+    if (room > sizeof(_state.body))
+        room = sizeof(_state.body);
+    if (_state.len >= room)
+        return false;
+
+    bool first = _state.count == 0;
+    uint32_t dt = first ? 0 : seconds(now_ms - _state.last_ms);
+    uint8_t *p = _state.body + _state.len;
+    const uint8_t *end = _state.body + room;
+
+    if ((p = putVarint(p, end, dt)) == NULL || p >= end)
+        return false;
+    uint8_t *presence = p++;
+    *presence = 0;
+    for (unsigned i = 0; i < _fields; i++) {
+        int32_t d = (int32_t)((uint32_t)fields[i] - (uint32_t)(first ? 0 : _state.last[i]));
+        if (d == 0)
+            continue;
+        *presence |= 1 << i;
+        if ((p = putVarint(p, end, zigzag(d))) == NULL)
+            return false;
+    }
+
+    // only now that it fitted
+    if (first)
+        _state.first_ms = _state.last_ms = now_ms;
+    else
+        _state.last_ms += dt * 1000;
+    memcpy(_state.last, fields, _fields * sizeof(int32_t));
+    _state.len = p - _state.body;
+    _state.count++;
+    return true;
+}
+
+size_t BatchEncoder::finish(uint32_t now_ms, uint8_t *buf, size_t size) const {
+    if (_state.count == 0 || size < 2)
+        return 0;
+    uint8_t *p = buf;
+    const uint8_t *end = buf + size;
+    *p++ = FORMAT_BATCH;
+    *p++ = _state.count;
+    if ((p = putVarint(p, end, seconds(now_ms - _state.first_ms))) == NULL ||
+        (size_t)(end - p) < _state.len)
+        return 0;
+    memcpy(p, _state.body, _state.len);
+    return p + _state.len - buf;
+}
+
+void BatchEncoder::clear() {
+    _state.len = 0;
+    _state.count = 0;
+}
+
+unsigned BatchEncoder::getCount() const {
+    return _state.count;
+}
+
+unsigned BatchEncoder::getFields() const {
+    return _fields;
+}
+
+BatchDecoder::BatchDecoder(unsigned fields) :
+    _fields(fields > (unsigned)MAX_FIELDS ? (unsigned)MAX_FIELDS : fields) {
+}
+
+BatchDecoder::Result BatchDecoder::decode(const uint8_t *buf, size_t len, int32_t (*records)[MAX_FIELDS],
+                                          uint32_t *ages, unsigned max, unsigned *count) const {
+    const uint8_t *p = buf;
+    const uint8_t *end = buf + len;
+
+    if (len < 2 || *p++ != FORMAT_BATCH)
+        return MALFORMED;
+    unsigned n = *p++;
+    if (n > max)
+        return TOO_MANY;
+    uint32_t age;
+    if ((p = getVarint(p, end, &age)) == NULL)
+        return MALFORMED;
+
+    for (unsigned r = 0; r < n; r++) {
+        uint32_t dt;
+        if ((p = getVarint(p, end, &dt)) == NULL || p >= end)
+            return MALFORMED;
+        if (dt > age || (r == 0 && dt != 0))
+            return MALFORMED;
+        age -= dt;
+        uint8_t presence = *p++;
+        if (presence >> _fields)
+            return MALFORMED;
+        for (unsigned i = 0; i < _fields; i++) {
+            uint32_t u = 0;
+            if (presence & (1 << i)) {
+                if ((p = getVarint(p, end, &u)) == NULL)
+                    return MALFORMED;
+            }
+            records[r][i] = (int32_t)((uint32_t)(r ? records[r - 1][i] : 0) + (uint32_t)unzigzag(u));
+        }
+        ages[r] = age;
+    }
+    if (p != end)
+        return MALFORMED;
+    *count = n;
+    return DECODED;
+}
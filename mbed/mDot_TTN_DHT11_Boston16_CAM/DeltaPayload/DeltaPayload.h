@@ -0,0 +1,253 @@
+#ifndef DELTA_PAYLOAD_H
+#define DELTA_PAYLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Delta-encoded uplink frames (format 0x12).
+ *
+ * A frame carries up to MAX_FIELDS integer fields, already scaled the way
+ * the fixed-layout format does it, as differences against a reference
+ * frame the network is known to have:
+ *
+ *   0x12 | ctl | [ref] | presence | varint...
+ *
+ * ctl bit 7 marks a keyframe and bits 6-0 hold the frame's sequence
+ * number. A delta frame follows it with the sequence number of its
+ * reference frame; a keyframe has no reference and is encoded against
+ * all zeros. Bit i of the presence byte is set when field i differs from
+ * the reference, and then its difference follows as a zig-zag varint
+ * (7 bits a byte, least significant first, top bit set on all but the
+ * last byte). Fields that did not change cost nothing.
+ *
+ * The encoder only moves its reference forward when told the frame got
+ * through, i.e. it was acknowledged: a frame that was only sent may be
+ * lost, keyframe or not. It sends a keyframe every so often, so that a
+ * decoder that lost track can pick up again, and in place of a delta
+ * against a reference that old: until the next frame gets through, every
+ * frame is a keyframe. DeltaDecoder's history is then always deep enough
+ * for the reference.
+ *
+ * BatchEncoder packs several measurement epochs into one frame instead
+ * (format 0x13), each against the one before it in the same frame:
+ *
+ *   0x13 | count | age | { dt | presence | varint... } * count
+ *
+ * age is the time in seconds from the first record to the frame being
+ * sent, and dt, for every record, the time since the previous one (0 for
+ * the first), both as plain varints; a record's presence byte and fields
+ * are those of a keyframe, but against the record before it. A batch
+ * frame needs no other frame to decode.
+ *
+ * None of these classes use mbed, so the decoders build on any host.
+ *
+ * @code
+ * DeltaEncoder::State state;      // keep across deep sleep
+ * DeltaEncoder enc(state, 3, 16);
+ *
+ * int32_t fields[3] = { t, rh, lux };
+ * uint8_t buf[DeltaEncoder::MAX_FRAME];
+ * size_t n = enc.encode(fields, buf, sizeof(buf));
+ * if (send(buf, n) == OK && acknowledged)
+ *     enc.delivered();
+ * @endcode
+ */
+class DeltaPayload {
+public:
+    enum {
+        FORMAT = 0x12,
+        FORMAT_BATCH = 0x13,
+        MAX_FIELDS = 8,
+        // format, ctl, ref, presence and a 5-byte varint per field
+        MAX_FRAME = 4 + 5 * MAX_FIELDS
+    };
+
+    enum {
+        CtlKeyframe = 1 << 7,
+        SeqMask = 0x7F
+    };
+
+    /** @returns zig-zag encoding of v: 0, -1, 1, -2... map to 0, 1, 2, 3... */
+    static uint32_t zigzag(int32_t v);
+    static int32_t unzigzag(uint32_t u);
+
+    /** Append a varint at p, at most end - p bytes.
+     *
+     * @returns the byte after it, or NULL if it did not fit
+     */
+    static uint8_t *putVarint(uint8_t *p, const uint8_t *end, uint32_t v);
+
+    /** Read a varint at p, at most end - p bytes.
+     *
+     * @returns the byte after it, or NULL if it is truncated or too long
+     */
+    static const uint8_t *getVarint(const uint8_t *p, const uint8_t *end, uint32_t *v);
+};
+
+class DeltaEncoder : public DeltaPayload {
+public:
+    /** What has to outlive the encoder: plain data, fit for a user file. */
+    struct State {
+        int32_t ref[MAX_FIELDS];    // fields of the reference frame
+        uint8_t seq;                // sequence number of the next frame
+        uint8_t ref_seq;            // sequence number of the reference
+        uint8_t since_key;          // frames since the last keyframe
+        uint8_t valid;              // ref holds a delivered frame
+    };
+
+    /** Create an encoder working on state, which must be zeroed before
+     * the first use.
+     *
+     * @param fields             number of fields per frame, up to MAX_FIELDS
+     * @param keyframe_interval  a keyframe at least this often, and deltas
+     *                           against references fewer than this many
+     *                           frames back, up to 64
+     */
+    DeltaEncoder(State &state, unsigned fields, unsigned keyframe_interval);
+
+    /** Encode one frame of getFields() values.
+     *
+     * @returns the frame length, or 0 if it does not fit in size bytes
+     */
+    size_t encode(const int32_t *fields, uint8_t *buf, size_t size);
+
+    /** The last encoded frame is known to have reached the network, e.g.
+     * it was acknowledged: use it as the reference. */
+    void delivered();
+
+    /** Send a keyframe next, e.g. after the network lost track. */
+    void forceKeyframe();
+
+    /** @returns true if the last encoded frame was a keyframe */
+    bool wasKeyframe() const;
+
+    unsigned getFields() const;
+
+private:
+    State &_state;
+    unsigned _fields;
+    unsigned _interval;
+    int32_t _pending[MAX_FIELDS];
+    uint8_t _pending_seq;
+    bool _pending_key;
+    bool _have_pending;
+};
+
+class DeltaDecoder : public DeltaPayload {
+public:
+    enum Result {
+        DECODED = 0,        // fields hold the frame
+        NO_REFERENCE,       // delta against a frame we do not have
+        MALFORMED           // not a 0x12 frame of this many fields
+    };
+
+    enum {
+        // recent frames remembered as references, besides the last keyframe
+        HISTORY = 4
+    };
+
+    /** @param fields number of fields per frame, up to MAX_FIELDS */
+    DeltaDecoder(unsigned fields);
+
+    /** Decode one frame; a decoded frame becomes a possible reference.
+     *
+     * @param seq if not NULL, receives the frame's sequence number
+     */
+    Result decode(const uint8_t *buf, size_t len, int32_t *fields, uint8_t *seq = NULL);
+
+private:
+    struct Frame {
+        bool valid;
+        uint8_t seq;
+        int32_t fields[MAX_FIELDS];
+    };
+
+    void remember(Frame &slot, uint8_t seq, const int32_t *fields);
+
+    unsigned _fields;
+    Frame _history[HISTORY];    // newest first
+    Frame _keyframe;            // the last keyframe, kept past the history
+    Frame _reference;           // the one the last delta was against
+};
+
+class BatchEncoder : public DeltaPayload {
+public:
+    enum {
+        // the largest LoRaWAN payload at any data rate
+        MAX_BATCH_FRAME = 242,
+        // format, count and the longest age
+        BATCH_HEADER = 2 + 5,
+        MAX_RECORDS = 255
+    };
+
+    /** What has to outlive the encoder between epochs: plain data. */
+    struct State {
+        uint8_t body[MAX_BATCH_FRAME - BATCH_HEADER];  // encoded records
+        uint8_t len;                // bytes used in body
+        uint8_t count;              // records in body
+        uint32_t first_ms;          // clock of the first record
+        uint32_t last_ms;           // clock of the last one, whole seconds after first_ms
+        int32_t last[MAX_FIELDS];   // fields of the last record
+    };
+
+    /** Create an encoder working on state, which must be zeroed before
+     * the first use.
+     *
+     * @param fields number of fields per record, up to MAX_FIELDS
+     */
+    BatchEncoder(State &state, unsigned fields);
+
+    /** Add a record taken at clock time now_ms, unless the frame could
+     * then be longer than max_frame bytes, counting the header at its
+     * longest.
+     *
+     * @returns true if the record was added
+     */
+    bool add(uint32_t now_ms, const int32_t *fields, size_t max_frame);
+
+    /** Build the frame as if sent at clock time now_ms.
+     *
+     * @returns the frame length, or 0 if it does not fit in size bytes or
+     *          there are no records
+     */
+    size_t finish(uint32_t now_ms, uint8_t *buf, size_t size) const;
+
+    /** Forget the records, e.g. once they are sent. */
+    void clear();
+
+    unsigned getCount() const;
+
+    unsigned getFields() const;
+
+private:
+    static uint32_t seconds(uint32_t ms);
+
+    State &_state;
+    unsigned _fields;
+};
+
+class BatchDecoder : public DeltaPayload {
+public:
+    enum Result {
+        DECODED = 0,        // records and ages hold the frame's records
+        TOO_MANY,           // more records than there is room for
+        MALFORMED           // not a 0x13 frame of this many fields
+    };
+
+    /** @param fields number of fields per record, up to MAX_FIELDS */
+    BatchDecoder(unsigned fields);
+
+    /** Decode one frame of up to max records.
+     *
+     * @param records receives each record's fields
+     * @param ages    receives each record's age when the frame was sent, in seconds
+     * @param count   receives the number of records
+     */
+    Result decode(const uint8_t *buf, size_t len, int32_t (*records)[MAX_FIELDS],
+                  uint32_t *ages, unsigned max, unsigned *count) const;
+
+private:
+    unsigned _fields;
+};
+
+#endif
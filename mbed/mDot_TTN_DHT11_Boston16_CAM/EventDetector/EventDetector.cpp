@@ -0,0 +1,55 @@
+#include "EventDetector.h"
+
+EventDetector::EventDetector(State &state, const Rule *rules, unsigned count) :
+    _state(state), _rules(rules), _count(count > (unsigned)MAX_RULES ? (unsigned)MAX_RULES : count) {
+}
+
+unsigned EventDetector::update(uint32_t now_ms, const int32_t *fields, unsigned valid) {
+    unsigned onset = 0;
+    for (unsigned r = 0; r < _count; r++) {
+        const Rule &rule = _rules[r];
+        if (!(valid & (1 << rule.field)))
+            continue;
+        int32_t x = fields[rule.field];
+        unsigned bit = 1 << r;
+
+        // how far the reading is past where the rule looks, positive
+        // towards the event
+        int32_t over;
+        if (rule.kind == Above || rule.kind == Below) {
+            over = rule.kind == Above ? x - rule.threshold : rule.threshold - x;
+        } else {
+            int32_t &b = _state.baseline[r];
+            if (!(_state.primed & bit)) {
+                b = x * 256;
+                _state.last_ms[r] = now_ms;
+                _state.primed |= bit;
+                continue;
+            }
+            int32_t d = (x * 256 - b) / 256;
+            over = (rule.kind == Rise ? d : -d) - rule.threshold;
+            // the baseline moves towards the reading by dt / (tau + dt), in
+            // milliseconds so that readings less than a second apart move it
+            // too; with no time constant it is the reading, however soon it
+            // came
+            int64_t dt_ms = now_ms - _state.last_ms[r];
+            if (rule.tau_s == 0)
+                b = x * 256;
+            else
+                b += (int32_t)((int64_t)(x * 256 - b) * dt_ms / (rule.tau_s * 1000 + dt_ms));
+            _state.last_ms[r] = now_ms;
+        }
+
+        if (!(_state.active & bit) && over > 0) {
+            _state.active |= bit;
+            onset |= bit;
+        } else if ((_state.active & bit) && over < -rule.hysteresis) {
+            _state.active &= ~bit;
+        }
+    }
+    return onset;
+}
+
+unsigned EventDetector::getActive() const {
+    return _state.active;
+}
@@ -0,0 +1,83 @@
+#ifndef EVENT_DETECTOR_H
+#define EVENT_DETECTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Watches the readings for events worth an uplink of their own.
+ *
+ * Each rule looks at one field, in the integer scale the payload sends
+ * it in. Above and Below compare the reading with a threshold. Rise and
+ * Fall compare it with a baseline that follows the reading with time
+ * constant tau_s, so that a steady slope of threshold / tau_s per second
+ * is what sets them off, and a slow drift or a single noisy reading is
+ * not. A rule that came on stays on until the reading has come back past
+ * the threshold by the hysteresis.
+ *
+ * A reading missing from a sample leaves its rules as they were.
+ *
+ * @code
+ * static const EventDetector::Rule rules[] = {
+ *     { FieldSoilRH, EventDetector::Rise, 8, 3, 120 },
+ * };
+ * EventDetector::State state;         // keep across deep sleep, zeroed at first
+ * EventDetector events(state, rules, 1);
+ *
+ * if (events.update(now_ms, fields) || events.getActive())
+ *     send_now = true;
+ * @endcode
+ */
+class EventDetector {
+public:
+    enum Kind {
+        Above,      // reading over threshold
+        Below,      // reading under threshold
+        Rise,       // reading over its baseline by threshold
+        Fall        // reading under its baseline by threshold
+    };
+
+    enum {
+        MAX_RULES = 8
+    };
+
+    struct Rule {
+        uint8_t field;      // index into the fields
+        uint8_t kind;       // Kind
+        int32_t threshold;  // in the field's scale
+        int32_t hysteresis; // how far back past threshold to go off again
+        uint16_t tau_s;     // Rise, Fall: time constant of the baseline; 0 for
+                            // the last reading, so any step of threshold counts
+    };
+
+    /** What has to outlive the detector between samples: plain data. */
+    struct State {
+        uint8_t active;                 // bit r: rule r is on
+        uint8_t primed;                 // bit r: rule r has a baseline
+        uint32_t last_ms[MAX_RULES];    // clock of rule r's last reading
+        int32_t baseline[MAX_RULES];    // rule r's baseline, times 256
+    };
+
+    /** Create a detector working on state, which must be zeroed before the
+     * first use.
+     *
+     * @param rules up to MAX_RULES rules; must outlive the detector
+     */
+    EventDetector(State &state, const Rule *rules, unsigned count);
+
+    /** Evaluate the readings taken at clock time now_ms.
+     *
+     * @param valid bit i set if field i was read
+     * @returns the rules that came on, bit r for rule r
+     */
+    unsigned update(uint32_t now_ms, const int32_t *fields, unsigned valid = ~0u);
+
+    /** @returns the rules that are on, bit r for rule r */
+    unsigned getActive() const;
+
+private:
+    State &_state;
+    const Rule *_rules;
+    unsigned _count;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "FrameQueue.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+FrameQueue::FrameQueue(State &state, mDot *dot, const char *file, unsigned slots,
+                       unsigned writes_per_hour) :
+    _state(state), _dot(dot), _file(file), _slots(slots ? slots : 1),
+    _interval_ms(writes_per_hour ? 3600000 / writes_per_hour : 0) {
+    if (_state.head - _state.tail > _slots)
+        _state.tail = _state.head - _slots;
+}
+
+// over the header before it and the frame after it
+uint8_t FrameQueue::check(const uint8_t *slot, size_t len) {
+    uint8_t c = 0;
+    for (size_t i = 0; i < SLOT_HEADER - 1 + len; i++) {
+        const uint8_t *p = i < SLOT_HEADER - 1 ? &slot[i] : &slot[i + 1];
+        c = ((c << 1) | (c >> 7)) ^ *p;
+    }
+    return c;
+}
+
+bool FrameQueue::push(uint32_t now_ms, const uint8_t *frame, size_t len) {
+    if (len == 0 || len > MAX_FRAME) {
+        _state.dropped++;
+        return false;
+    }
+    if (_interval_ms) {
+        // a frame's worth of budget comes back every _interval_ms, up to
+        // a ring's worth; a budget further ahead than that was spent so
+        // long ago that the clock has wrapped past it, or never was
+        int32_t ahead = (int32_t)(_state.budget_ms - now_ms);
+        if (ahead < 0 || (uint32_t)ahead > _slots * _interval_ms)
+            _state.budget_ms = now_ms;
+        else if ((uint32_t)ahead > (_slots - 1) * _interval_ms) {
+            _state.dropped++;
+            return false;
+        }
+    }
+
+    uint8_t slot[SLOT_SIZE];
+    memset(slot, 0, sizeof(slot));
+    put32(&slot[0], _state.head);
+    put32(&slot[4], now_ms);
+    slot[8] = len;
+    memcpy(&slot[SLOT_HEADER], frame, len);
+    slot[9] = check(slot, len);
+
+    mDot::mdot_file f = _dot->openUserFile(_file, mDot::FM_RDWR | mDot::FM_CREAT);
+    if (f.fd < 0)
+        return false;
+    // the ring fills in order, so a slot is either there already, and
+    // only what it holds is rewritten, or next at the end of the file
+    size_t offset = (_state.head % _slots) * SLOT_SIZE;
+    size_t n = f.size >= offset + SLOT_SIZE ? (size_t)SLOT_HEADER + len : (size_t)SLOT_SIZE;
+    bool ok = _dot->seekUserFile(f, offset, SEEK_SET) &&
+              _dot->writeUserFile(f, slot, n) == (int)n;
+    _dot->closeUserFile(f);
+    if (!ok)
+        return false;
+
+    _state.head++;
+    if (_state.head - _state.tail > _slots) {
+        _state.tail++;
+        _state.dropped++;
+    }
+    if (_interval_ms)
+        _state.budget_ms += _interval_ms;
+    return true;
+}
+
+int FrameQueue::peek(uint8_t *buf, size_t size, uint32_t *time_ms) {
+    while (_state.tail != _state.head) {
+        uint8_t slot[SLOT_SIZE];
+        mDot::mdot_file f = _dot->openUserFile(_file, mDot::FM_RDONLY);
+        if (f.fd < 0)
+            return -1;
+        int n = -1;
+        if (_dot->seekUserFile(f, (_state.tail % _slots) * SLOT_SIZE, SEEK_SET))
+            n = _dot->readUserFile(f, slot, SLOT_SIZE);
+        _dot->closeUserFile(f);
+
+        size_t len = n >= SLOT_HEADER ? slot[8] : 0;
+        if (len > 0 && len <= MAX_FRAME && (size_t)n >= SLOT_HEADER + len &&
+            get32(&slot[0]) == _state.tail && slot[9] == check(slot, len)) {
+            if (len > size)
+                return -1;
+            memcpy(buf, &slot[SLOT_HEADER], len);
+            *time_ms = get32(&slot[4]);
+            return len;
+        }
+        // not what was written there, or not all of it
+        _state.tail++;
+        _state.dropped++;
+    }
+    return 0;
+}
+
+void FrameQueue::pop() {
+    if (_state.tail != _state.head)
+        _state.tail++;
+}
+
+unsigned FrameQueue::getCount() const {
+    return _state.head - _state.tail;
+}
+
+uint32_t FrameQueue::getDropped() const {
+    return _state.dropped;
+}
@@ -0,0 +1,96 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include "mDot.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Uplink frames that did not get through, kept in a user file until they
+ * can be sent again.
+ *
+ * The file is a ring of SLOT_SIZE slots, one flash page each, so that
+ * queueing a frame programs a single page and every page of the ring is
+ * written as often as the others. A slot holds the frame with the time it
+ * was queued and its position in the queue, which must match for the
+ * slot to be read back; a slot left over from another ring or a write cut
+ * short by a reset is skipped.
+ *
+ * Where the queue starts and ends is kept in State, which the application
+ * saves with the rest of its state anyway, so taking a frame off the queue
+ * writes nothing. When the ring is full the oldest frame makes room; when
+ * more than writes_per_hour frames (with a burst of as many as there are
+ * slots) have been queued in the last hour, the new frame is dropped
+ * instead, to bound the flash wear of a long outage.
+ *
+ * @code
+ * FrameQueue::State state;            // keep across deep sleep, zeroed at first
+ * FrameQueue queue(state, dot, "uplink.queue", 16, 60);
+ *
+ * if (dot->send(frame) != mDot::MDOT_OK)
+ *     queue.push(clock_ms, &frame[0], frame.size());
+ * else if (queue.getCount() && (n = queue.peek(buf, sizeof(buf), &t)) > 0 &&
+ *          dot->send(resend(buf, n, clock_ms - t)) == mDot::MDOT_OK)
+ *     queue.pop();
+ * @endcode
+ */
+class FrameQueue {
+public:
+    enum {
+        SLOT_SIZE = 256,
+        // position, time, length and check byte
+        SLOT_HEADER = 4 + 4 + 1 + 1,
+        MAX_FRAME = SLOT_SIZE - SLOT_HEADER
+    };
+
+    /** What has to outlive the queue: plain data, fit for a user file. */
+    struct State {
+        uint32_t head;          // position of the next frame queued
+        uint32_t tail;          // position of the oldest frame
+        uint32_t budget_ms;     // clock time the write budget is spent up to
+        uint32_t dropped;       // frames lost to a full ring or the budget
+    };
+
+    /** Create a queue working on state, which must be zeroed before the
+     * first use.
+     *
+     * @param file            user file holding the ring
+     * @param slots           frames the ring holds
+     * @param writes_per_hour most frames queued per hour, 0 for no limit
+     */
+    FrameQueue(State &state, mDot *dot, const char *file, unsigned slots,
+               unsigned writes_per_hour);
+
+    /** Queue a frame at clock time now_ms.
+     *
+     * @returns false if it was dropped
+     */
+    bool push(uint32_t now_ms, const uint8_t *frame, size_t len);
+
+    /** Read the oldest frame, skipping slots that do not read back.
+     *
+     * @param time_ms receives the clock time it was queued at
+     * @returns its length, 0 if the queue is empty or -1 on a flash error
+     */
+    int peek(uint8_t *buf, size_t size, uint32_t *time_ms);
+
+    /** Take the oldest frame off the queue. */
+    void pop();
+
+    /** @returns frames queued */
+    unsigned getCount() const;
+
+    /** @returns frames dropped since the state was zeroed */
+    uint32_t getDropped() const;
+
+private:
+    static uint8_t check(const uint8_t *slot, size_t len);
+
+    State &_state;
+    mDot *_dot;
+    const char *_file;
+    unsigned _slots;
+    uint32_t _interval_ms;
+};
+
+#endif
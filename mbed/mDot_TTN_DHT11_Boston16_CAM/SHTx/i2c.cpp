@@ -28,14 +28,15 @@
 
 namespace SHTx {
 	I2C::I2C(PinName sda, PinName scl) :
-	scl_pin(scl), sda_pin(sda), frequency(10) {
-		this->sda_pin.output();
-		this->scl_pin.output();
+	Transport(sda, scl), frequency(10) {
 	}
 
 	void
 	I2C::setFrequency(uint32_t hz) {
-		this->frequency = (1000000 / hz);
+		this->frequency = hz ? (500000 / hz) : 0;
+		if (!this->frequency) {
+			this->frequency = 1;
+		}
 	}
 
 	void
@@ -58,19 +59,6 @@ namespace SHTx {
 		this->sda(1);
 	}
 
-	bool
-	I2C::wait(void) {
-		bool ack = false;
-	
-		this->input();
-		for (uint8_t i = 0; i < 500 && !ack; i++) {
-			wait_ms(1);
-			ack = !this->sda_pin;
-		}
-	
-		return ack;
-	}
-	
 	void
 	I2C::reset(void) {
 		this->output();
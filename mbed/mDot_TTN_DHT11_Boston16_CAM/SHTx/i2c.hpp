@@ -28,18 +28,21 @@
 #define _I2C_HPP_
 
 #include "mbed.h"
+#include "transport.hpp"
 
 namespace SHTx {
     /**
      * Class: I2C
      *  Humidity and Temperature Sensor - SHT15
      *  I2C Bit-bang master driver.
+     *
+     *  Times the clock with wait_us, so a transfer holds the
+     *  CPU throughout, but it is the fastest transport and
+     *  the only one that works from interrupt context.
      */
-    class I2C {
+    class I2C : public Transport {
     private:
-        DigitalInOut scl_pin;
-        DigitalInOut sda_pin;
-    
+        // SCK half period in microseconds
         uint32_t frequency;
     
     public:    
@@ -57,41 +60,34 @@ namespace SHTx {
     
         /**
          * Function: setFrequency
-         *  Set the frequency of the SHTx::I2C interface
+         *  Set the frequency of the SHTx::I2C interface.
+         *  The half period is whole microseconds, so the
+         *  fastest clock is 500kHz; the SHT1x allows 1MHz
+         *  below 4.5V. Default 50kHz.
          *
          * Variables:
          *  hz - The bus frequency in hertz
          */
-        void setFrequency(uint32_t hz);
+        virtual void setFrequency(uint32_t hz);
 
         /**
          * Function: start
          *  Issue start condition on the SHTx::I2C bus
          */
-        void start(void);
+        virtual void start(void);
     
         /**
          * Function: stop
          *  Issue stop condition on the SHTx::I2C bus
          */
-        void stop(void);
-    
-        /**
-         * Function: wait
-         *  Wait for SHT15 to complete measurement.
-         *  Max timeout 500ms.
-         *
-         * Variables:
-         *  returns - true if an ACK was received, false otherwise
-         */
-        bool wait(void);
+        virtual void stop(void);
 
 		/**
 		 * Function: reset
 		 *  If communication with the device is lost
 		 *  the command will reset the serial interface
 		 */
-		void reset(void);
+		virtual void reset(void);
     
         /**
          * Function: write
@@ -101,7 +97,7 @@ namespace SHTx {
          *  data     - data to write out on bus
          *  returns - true if an ACK was received, false otherwise
          */
-        bool write(uint8_t data);
+        virtual bool write(uint8_t data);
     
         /**
          * Function: write
@@ -111,7 +107,7 @@ namespace SHTx {
          *  ack     - indicates if the byte is to be acknowledged
          *  returns - the read byte
          */
-        uint8_t read(bool ack);
+        virtual uint8_t read(bool ack);
 
     private:
         /**
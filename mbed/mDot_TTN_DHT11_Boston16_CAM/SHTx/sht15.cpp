@@ -27,11 +27,29 @@
 #include "sht15.hpp"
 
 namespace SHTx {    
-    SHT15::SHT15(PinName sda, PinName scl): i2c(sda, scl) {        
+    SHT15::SHT15(PinName sda, PinName scl): i2c(*new I2C(sda, scl)), owns_transport(true) {        
         this->ready = true;
+        this->worker = NULL;
+        this->updating = false;
+        this->update_ok = false;
         wait_ms(11);
     }
 
+    SHT15::SHT15(Transport &transport): i2c(transport), owns_transport(false) {
+        this->ready = true;
+        this->worker = NULL;
+        this->updating = false;
+        this->update_ok = false;
+        wait_ms(11);
+    }
+
+    SHT15::~SHT15(void) {
+        delete this->worker;
+        if (this->owns_transport) {
+            delete &this->i2c;
+        }
+    }
+
     float
     SHT15::getTemperature(void) {
         return this->convertTemperature(
@@ -90,6 +108,51 @@ namespace SHTx {
         return true;
     }
 
+    bool
+    SHT15::update(void (*fptr)(void)) {
+        this->done.attach(fptr);
+        return this->startUpdate();
+    }
+
+    bool
+    SHT15::isUpdating(void) {
+        return this->updating;
+    }
+
+    bool
+    SHT15::updateSucceeded(void) {
+        return this->update_ok;
+    }
+
+    bool
+    SHT15::startUpdate(void) {
+        if ((this->ready == false) || this->updating) {
+            return false;
+        }
+
+        this->updating = true;
+        this->update_ok = false;
+        // the readout clocks the bus and waits out the measurements, so
+        // it runs on a thread, not in the data line interrupt
+        if (this->worker == NULL) {
+            this->worker = new Thread(&SHT15::work, this, osPriorityBelowNormal);
+        }
+        this->worker->signal_set(signal_update);
+        return true;
+    }
+
+    void
+    SHT15::work(void const *argument) {
+        SHT15 *sht = (SHT15 *)argument;
+
+        while (true) {
+            Thread::signal_wait(signal_update);
+            sht->update_ok = sht->update();
+            sht->updating = false;
+            sht->done.call();
+        }
+    }
+
     bool
     SHT15::reset(void) {
         while (this->ready == false) {
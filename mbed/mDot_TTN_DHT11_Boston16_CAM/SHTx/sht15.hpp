@@ -28,6 +28,7 @@
 #define _SHT15_HPP_
 
 #include "mbed.h"
+#include "transport.hpp"
 #include "i2c.hpp"
 
 namespace SHTx {    
@@ -38,7 +39,8 @@ namespace SHTx {
      */
     class SHT15 {
     public: // CM private
-        I2C i2c;
+        Transport &i2c;
+        bool owns_transport;
         
         bool ready;
         bool scale;
@@ -86,6 +88,14 @@ namespace SHTx {
             flag_heater     = 0x04,
             flag_battery    = 0x40
         };
+
+        // Asynchronous update state
+        enum { signal_update = 0x1 };
+
+        FunctionPointer done;
+        Thread *worker;
+        volatile bool updating;
+        volatile bool update_ok;
     
     public:
         /*
@@ -94,6 +104,14 @@ namespace SHTx {
          */
         SHT15(PinName sda, PinName scl);
 
+        /*
+         * Same, over a transport set up by the caller,
+         * e.g. a SHTx::TimedI2C. It must outlive the SHT15.
+         */
+        SHT15(Transport &transport);
+
+        ~SHT15(void);
+
         /**
          * Function: getTemperature
          *  Returns the current temperature.
@@ -179,6 +197,41 @@ namespace SHTx {
          *  return - operation result
          */
         bool update(void);
+
+        /**
+         * Function: update
+         *  Starts a humidity and temperature readout and
+         *  returns at once. The readout is update(void), run
+         *  on a thread of the SHT15's own below normal
+         *  priority, started by the first call; it sleeps
+         *  while the sensor measures, and fptr is called on
+         *  it when both measurements are in. Call from a
+         *  thread, not from interrupt context.
+         *
+         * Values:
+         *  fptr   - completion callback, may be NULL
+         *  return - false if the sensor is busy; whether the
+         *           readout worked is updateSucceeded()
+         */
+        bool update(void (*fptr)(void));
+
+        template<typename T>
+        bool update(T *tptr, void (T::*mptr)(void)) {
+            this->done.attach(tptr, mptr);
+            return this->startUpdate();
+        }
+
+        /**
+         * Function: isUpdating
+         *  Returns true while an asynchronous update runs.
+         */
+        bool isUpdating(void);
+
+        /**
+         * Function: updateSucceeded
+         *  Result of the last asynchronous update.
+         */
+        bool updateSucceeded(void);
     
         /**
          * Function: reset
@@ -199,6 +252,19 @@ namespace SHTx {
 		void connectionReset(void);
     
     private:
+
+        /**
+         * Function: startUpdate
+         *  Hand an asynchronous update to the worker thread.
+         */
+        bool startUpdate(void);
+
+        /**
+         * Function: work
+         *  Worker thread: run each update it is handed and
+         *  call back.
+         */
+        static void work(void const *argument);
     
         /**
          * Function: convertTemperature
@@ -0,0 +1,181 @@
+/**
+ * Copyright (c) 2010 Roy van Dam <roy@negative-black.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include "timed_i2c.hpp"
+
+namespace SHTx {
+	TimedI2C::TimedI2C(PinName sda, PinName scl) :
+	Transport(sda, scl), count(0), next(0), received(0), period(10), finished(0) {
+	}
+
+	void
+	TimedI2C::setFrequency(uint32_t hz) {
+		this->period = hz ? (500000 / hz) : 0;
+		if (this->period < 10) {
+			this->period = 10;
+		}
+	}
+
+	void
+	TimedI2C::start(void) {
+		this->push(step_sda_high);
+		this->push(step_scl_high);
+		this->push(step_sda_low);
+		this->push(step_scl_low);
+		this->push(step_scl_high);
+		this->push(step_sda_high);
+		this->push(step_scl_low);
+		this->run();
+	}
+
+	void
+	TimedI2C::stop(void) {
+		this->push(step_sda_low);
+		this->push(step_scl_high);
+		this->push(step_sda_high);
+		this->run();
+	}
+
+	void
+	TimedI2C::reset(void) {
+		for (uint8_t i = 9; i; i--) {
+			this->shift_out(1);
+		}
+		this->start();
+		this->push(step_scl_high);
+		this->run();
+	}
+
+	bool
+	TimedI2C::write(uint8_t data) {
+		for (uint8_t i = 8; i; i--) {
+			this->shift_out(data & 0x80);
+			data <<= 1;
+		}
+
+		// Ninth clock: the sensor pulls data low to acknowledge
+		this->push(step_sda_release);
+		this->push(step_scl_high);
+		this->push(step_sample);
+		this->run();
+
+		return !(this->received & 1);
+	}
+
+	uint8_t
+	TimedI2C::read(bool ack) {
+		this->push(step_sda_release);
+		for (uint8_t i = 8; i; i--) {
+			this->push(step_idle);
+			this->push(step_scl_high);
+			this->push(step_sample);
+		}
+		this->shift_out(!ack);
+		this->run();
+
+		return this->received;
+	}
+
+	void
+	TimedI2C::push(step_list step) {
+		if (this->count < max_steps) {
+			this->steps[this->count++] = step;
+		}
+	}
+
+	void
+	TimedI2C::shift_out(bool bit) {
+		this->push(bit ? step_sda_high : step_sda_low);
+		this->push(step_scl_high);
+		this->push(step_scl_low);
+	}
+
+	void
+	TimedI2C::run(void) {
+		this->received = 0;
+		
+		if (__get_IPSR() != 0) {
+			for (uint8_t i = 0; i < this->count; i++) {
+				this->apply(this->steps[i]);
+				wait_us(this->period);
+			}
+		} else if (this->count) {
+			while (this->finished.wait(0) > 0)
+				;	// a sequence that ended after its wait gave up
+			// First edge now, the rest one per tick; the thread
+			// blocks until the last one, with a tick of slack
+			this->apply(this->steps[0]);
+			this->next = 1;
+			this->ticker.attach_us(this, &TimedI2C::tick, this->period);
+			this->finished.wait(this->count * this->period / 1000 + 2);
+			this->ticker.detach();
+		}
+		
+		this->count = 0;
+	}
+
+	void
+	TimedI2C::tick(void) {
+		if (this->next < this->count) {
+			this->apply(this->steps[this->next]);
+		} else {
+			// The last step has had its half period
+			this->ticker.detach();
+			this->finished.release();
+		}
+		this->next++;
+	}
+
+	void
+	TimedI2C::apply(uint8_t step) {
+		switch (step) {
+			case step_sda_low:
+				this->sda_pin.output();
+				this->sda_pin = 0;
+				break;
+			case step_sda_high:
+				this->sda_pin.output();
+				this->sda_pin = 1;
+				break;
+			case step_sda_release:
+				this->sda_pin.input();
+				break;
+			case step_scl_low:
+				this->scl_pin = 0;
+				break;
+			case step_scl_high:
+				this->scl_pin = 1;
+				break;
+			case step_sample:
+				this->received = (this->received << 1) | this->sda_pin.read();
+				this->scl_pin = 0;
+				break;
+			default:
+				break;
+		}
+	}
+}
@@ -0,0 +1,147 @@
+/**
+ * Copyright (c) 2010 Roy van Dam <roy@negative-black.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#ifndef _TIMED_I2C_HPP_
+#define _TIMED_I2C_HPP_
+
+#include "mbed.h"
+#include "transport.hpp"
+
+namespace SHTx {
+    /**
+     * Class: TimedI2C
+     *  Humidity and Temperature Sensor - SHT15
+     *  Timer-driven master driver.
+     *
+     *  Produces the same waveform as the bit-bang driver,
+     *  but each half clock period is one Ticker interrupt,
+     *  and the calling thread blocks on a semaphore until
+     *  the last one. Other threads and interrupts run during
+     *  a transfer, at the cost of an interrupt per edge.
+     *
+     *  Called from interrupt context the Ticker cannot run,
+     *  so there it falls back to timing the edges with
+     *  wait_us, like SHTx::I2C.
+     */
+    class TimedI2C : public Transport {
+    private:
+        enum step_list {
+            step_sda_low,
+            step_sda_high,
+            step_sda_release,
+            step_scl_low,
+            step_scl_high,
+            step_sample,            // read data, then scl low
+            step_idle
+        };
+
+        // Longest sequence is reset: 9 clocks and a start
+        enum { max_steps = 40 };
+
+        Ticker ticker;
+
+        uint8_t steps[max_steps];
+        uint8_t count;
+        volatile uint8_t next;
+        volatile uint8_t received;
+
+        // SCK half period in microseconds
+        uint32_t period;
+
+        // released by the last tick of a sequence
+        Semaphore finished;
+
+    public:
+        /**
+         * Constructor: SHTx::TimedI2C
+         *  Create a timer-driven master on the specified pins.
+         *
+         * Variables:
+         *  sda - data line pin
+         *  scl - clock line pin
+         */
+        TimedI2C(PinName sda, PinName scl);
+
+        /**
+         * Function: setFrequency
+         *  Set the SCK frequency. The half period does not go
+         *  below 10us (50kHz, which is also the default):
+         *  every edge is a Ticker interrupt, which re-queues
+         *  itself on the us_ticker event list and costs the
+         *  core a few microseconds, so shorter half periods
+         *  would hand most of the core back to the transfer.
+         *  The clock rate matters little for the SHT: a
+         *  measurement's readout is under 1ms of bus time at
+         *  50kHz, against an 80-320ms conversion. SHTx::I2C
+         *  clocks up to the sensor's limit, holding the core.
+         *
+         * Variables:
+         *  hz - The bus frequency in hertz
+         */
+        virtual void setFrequency(uint32_t hz);
+
+        virtual void start(void);
+        virtual void stop(void);
+        virtual void reset(void);
+        virtual bool write(uint8_t data);
+        virtual uint8_t read(bool ack);
+
+    private:
+        /**
+         * Function: push
+         *  Append one half period to the sequence.
+         */
+        void push(step_list step);
+
+        /**
+         * Function: shift_out
+         *  Append one bit written to the sequence.
+         */
+        void shift_out(bool bit);
+
+        /**
+         * Function: run
+         *  Play the sequence back and clear it.
+         */
+        void run(void);
+
+        /**
+         * Function: tick
+         *  Ticker handler: perform the next step.
+         */
+        void tick(void);
+
+        /**
+         * Function: apply
+         *  Drive the pins for a single step.
+         */
+        void apply(uint8_t step);
+    };
+}
+
+/* !_TIMED_I2C_HPP_ */
+#endif
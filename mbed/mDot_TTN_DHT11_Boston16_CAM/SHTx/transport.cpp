@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2010 Roy van Dam <roy@negative-black.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include "transport.hpp"
+
+namespace SHTx {
+	Transport::Transport(PinName sda, PinName scl) :
+	scl_pin(scl), sda_pin(sda), sda_irq(sda), ready(0) {
+		this->sda_pin.output();
+		this->scl_pin.output();
+	}
+
+	Transport::~Transport(void) {
+	}
+
+	bool
+	Transport::wait(void) {
+		while (this->ready.wait(0) > 0)
+			;	// an edge from a wait that had already timed out
+		this->notify(this, &Transport::wake);
+		// the sensor may have signalled before the interrupt was armed
+		if (this->sda_pin) {
+			this->ready.wait(500);
+		}
+		this->cancel();
+	
+		return !this->sda_pin;
+	}
+
+	void
+	Transport::cancel(void) {
+		this->sda_irq.fall(NULL);
+	}
+
+	void
+	Transport::wake(void) {
+		this->ready.release();
+	}
+}
@@ -0,0 +1,160 @@
+/**
+ * Copyright (c) 2010 Roy van Dam <roy@negative-black.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#ifndef _TRANSPORT_HPP_
+#define _TRANSPORT_HPP_
+
+#include "mbed.h"
+#include "rtos.h"
+
+namespace SHTx {
+    /**
+     * Class: Transport
+     *  Humidity and Temperature Sensor - SHT15
+     *  Sensirion 2-wire bus master interface.
+     *
+     *  The bus is not I2C: the transmission start and the
+     *  data-ready signal have no I2C equivalent, so every
+     *  implementation drives the two pins itself. What they
+     *  differ in is who times the clock. The data-ready
+     *  handling is the same for all of them and lives here.
+     */
+    class Transport {
+    protected:
+        DigitalInOut scl_pin;
+        DigitalInOut sda_pin;
+        InterruptIn  sda_irq;
+        Semaphore    ready;
+
+    public:
+        /**
+         * Constructor: SHTx::Transport
+         *  Claim the bus pins, both driven as outputs.
+         *
+         * Variables:
+         *  sda - data line pin
+         *  scl - clock line pin
+         */
+        Transport(PinName sda, PinName scl);
+
+        virtual ~Transport(void);
+
+        /**
+         * Function: setFrequency
+         *  Set the SCK frequency. Implementations round down
+         *  to what they can time.
+         *
+         * Variables:
+         *  hz - The bus frequency in hertz
+         */
+        virtual void setFrequency(uint32_t hz) = 0;
+
+        /**
+         * Function: start
+         *  Issue transmission start on the bus
+         */
+        virtual void start(void) = 0;
+
+        /**
+         * Function: stop
+         *  Leave the bus idle, data line high
+         */
+        virtual void stop(void) = 0;
+
+        /**
+         * Function: reset
+         *  If communication with the device is lost
+         *  the command will reset the serial interface
+         */
+        virtual void reset(void) = 0;
+
+        /**
+         * Function: write
+         *  Write single byte out on the bus
+         *
+         * Variables:
+         *  data    - data to write out on bus
+         *  returns - true if an ACK was received, false otherwise
+         */
+        virtual bool write(uint8_t data) = 0;
+
+        /**
+         * Function: read
+         *  Read single byte from the bus
+         *
+         * Variables:
+         *  ack     - indicates if the byte is to be acknowledged
+         *  returns - the read byte
+         */
+        virtual uint8_t read(bool ack) = 0;
+
+        /**
+         * Function: wait
+         *  Wait for SHT15 to complete measurement.
+         *  The calling thread blocks until the sensor pulls
+         *  the data line low, so other threads run during the
+         *  conversion. Max timeout 500ms. Call from a thread.
+         *
+         * Variables:
+         *  returns - true if the sensor signalled, false otherwise
+         */
+        bool wait(void);
+
+        /**
+         * Function: notify
+         *  Release the data line and call the handler from
+         *  interrupt context when the sensor pulls it low to
+         *  signal the end of a measurement.
+         *
+         * Variables:
+         *  tptr - object to call the handler on
+         *  mptr - handler
+         */
+        template<typename T>
+        void notify(T *tptr, void (T::*mptr)(void)) {
+            this->sda_pin.input();
+            this->sda_irq.fall(tptr, mptr);
+        }
+
+        /**
+         * Function: cancel
+         *  Stop watching the data line set up by notify.
+         */
+        void cancel(void);
+
+    private:
+        /**
+         * Function: wake
+         *  Data line interrupt during wait; releases the
+         *  waiting thread.
+         */
+        void wake(void);
+    };
+}
+
+/* !_TRANSPORT_HPP_ */
+#endif
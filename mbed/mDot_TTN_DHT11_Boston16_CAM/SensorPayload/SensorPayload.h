@@ -0,0 +1,247 @@
+#ifndef SENSOR_PAYLOAD_H
+#define SENSOR_PAYLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** The readings an uplink carries, described once for the encoder and the
+ * decoders.
+ *
+ * On the wire every field is an integer: the reading times its scale,
+ * rounded to nearest, clamped to what the field's bytes hold and sent most
+ * significant byte first. A FormatSensor1 frame (0x11) is
+ *
+ *   0x11 | flags | field...
+ *
+ * where a field is there if its flag is set; fields that share a flag go
+ * together. The delta and batch formats (DeltaPayload.h) carry the same
+ * integers, all of them, in the same order.
+ *
+ * The description is templates: encoding comes down to a run of scaled
+ * stores with no table to look through, and a decoder built from the same
+ * header, on any host, cannot disagree on a scale, a width or the order.
+ *
+ * @code
+ * int32_t fields[PayloadFields];
+ * fields[FieldAirT] = SensorPayload::quantize<FieldAirT>(21.5);
+ * ...
+ * uint8_t buf[SensorPayload::MAX_FRAME];
+ * size_t n = SensorPayload::encode(fields, FlagTPH | ..., buf, sizeof(buf));
+ * @endcode
+ */
+
+/** A reading sent as round(value * Num / Den), in Bytes bytes. */
+template <int Num, int Den, int Bytes, bool Signed>
+struct ScaledField {
+    enum {
+        SIZE = Bytes,
+        MIN = Signed ? -(1 << (8 * Bytes - 1)) : 0,
+        MAX = Signed ? (1 << (8 * Bytes - 1)) - 1 : (1 << (8 * Bytes)) - 1
+    };
+    typedef char one_to_three_bytes[Bytes >= 1 && Bytes <= 3 ? 1 : -1];
+
+    /** @returns v as sent; NaN goes to MIN */
+    static int32_t quantize(float v) {
+        float x = v * ((float)Num / (float)Den);
+        // compares that pick a value, which the FPU does without branching
+        x = x >= (float)MIN ? x : (float)MIN;
+        x = x <= (float)MAX ? x : (float)MAX;
+        return (int32_t)(x + (x < 0 ? -0.5f : 0.5f));
+    }
+
+    /** @returns the reading a quantized value stands for */
+    static float value(int32_t q) {
+        return (float)q * ((float)Den / (float)Num);
+    }
+
+    static uint8_t *put(uint8_t *p, int32_t q) {
+        for (int i = Bytes - 1; i >= 0; i--)
+            *p++ = (uint8_t)(q >> (8 * i));
+        return p;
+    }
+
+    static const uint8_t *get(const uint8_t *p, int32_t *q) {
+        int32_t v = 0;
+        for (int i = 0; i < Bytes; i++)
+            v = (v << 8) | *p++;
+        if (Signed && v > MAX)
+            v -= 1 << (8 * Bytes);
+        *q = v;
+        return p;
+    }
+};
+
+// the scales of the Catena 4410 sensor1 format this one comes from
+typedef ScaledField<256, 1, 2, true> Temperature;   // 1/256 C
+typedef ScaledField<64, 25, 1, false> Humidity;     // 0.390625 %
+typedef ScaledField<4096, 1, 2, true> Voltage;      // 1/4096 V
+typedef ScaledField<1, 4, 2, false> Pressure;       // 4 hPa
+typedef ScaledField<100, 1, 2, false> Light;        // 0.01 lux
+
+/* the fields, in frame order */
+enum    {
+        FieldVbat, FieldAirT, FieldAirP, FieldAirRH, FieldLux,
+        FieldWaterT, FieldSoilT, FieldSoilRH,
+        PayloadFields
+        };
+
+/* the flags for the second byte of a FormatSensor1 frame */
+enum    {
+        FlagVbat = 1 << 0,
+        FlagVcc = 1 << 1,
+        FlagTPH = 1 << 2,
+        FlagLux = 1 << 3,
+        FlagWater = 1 << 4,
+        FlagSoilTH = 1 << 5,
+        };
+
+/** Field I: how it is scaled, the flag it comes under and its name, named
+ * after the host simulator's scenario channels where there is one. */
+template <int I> struct SensorField;
+
+template <> struct SensorField<FieldVbat> : Voltage {
+    enum { FLAG = FlagVbat };
+    static const char *name() { return "vbat"; }
+};
+
+template <> struct SensorField<FieldAirT> : Temperature {
+    enum { FLAG = FlagTPH };
+    static const char *name() { return "air.temp"; }
+};
+
+template <> struct SensorField<FieldAirP> : Pressure {
+    enum { FLAG = FlagTPH };
+    static const char *name() { return "air.p"; }
+};
+
+template <> struct SensorField<FieldAirRH> : Humidity {
+    enum { FLAG = FlagTPH };
+    static const char *name() { return "air.rh"; }
+};
+
+template <> struct SensorField<FieldLux> : Light {
+    enum { FLAG = FlagLux };
+    static const char *name() { return "light"; }
+};
+
+template <> struct SensorField<FieldWaterT> : Temperature {
+    enum { FLAG = FlagWater };
+    static const char *name() { return "water.temp"; }
+};
+
+template <> struct SensorField<FieldSoilT> : Temperature {
+    enum { FLAG = FlagSoilTH };
+    static const char *name() { return "soil.temp"; }
+};
+
+template <> struct SensorField<FieldSoilRH> : Humidity {
+    enum { FLAG = FlagSoilTH };
+    static const char *name() { return "soil.rh"; }
+};
+
+/** Fields I to N - 1, one after the other. */
+template <int I, int N = PayloadFields>
+struct SensorFields {
+    typedef SensorField<I> F;
+    typedef SensorFields<I + 1, N> Rest;
+
+    enum {
+        SIZE = F::SIZE + Rest::SIZE,
+        FLAGS = F::FLAG | Rest::FLAGS
+    };
+
+    static size_t size(unsigned flags) {
+        return ((flags & F::FLAG) ? F::SIZE : 0) + Rest::size(flags);
+    }
+
+    static uint8_t *put(uint8_t *p, const int32_t *fields, unsigned flags) {
+        if (flags & F::FLAG)
+            p = F::put(p, fields[I]);
+        return Rest::put(p, fields, flags);
+    }
+
+    static const uint8_t *get(const uint8_t *p, int32_t *fields, unsigned flags) {
+        fields[I] = 0;
+        if (flags & F::FLAG)
+            p = F::get(p, &fields[I]);
+        return Rest::get(p, fields, flags);
+    }
+
+    static float value(unsigned i, int32_t q) {
+        return i == I ? F::value(q) : Rest::value(i, q);
+    }
+
+    static const char *name(unsigned i) {
+        return i == I ? F::name() : Rest::name(i);
+    }
+};
+
+template <int N>
+struct SensorFields<N, N> {
+    enum { SIZE = 0, FLAGS = 0 };
+    static size_t size(unsigned) { return 0; }
+    static uint8_t *put(uint8_t *p, const int32_t *, unsigned) { return p; }
+    static const uint8_t *get(const uint8_t *p, int32_t *, unsigned) { return p; }
+    static float value(unsigned, int32_t) { return 0; }
+    static const char *name(unsigned) { return ""; }
+};
+
+class SensorPayload {
+public:
+    enum {
+        FORMAT = 0x11,
+        FIELDS = PayloadFields,
+        ALL_FLAGS = SensorFields<0>::FLAGS,
+        // format, flags and every field
+        MAX_FRAME = 2 + SensorFields<0>::SIZE
+    };
+
+    /** @returns reading v of field I as sent */
+    template <int I>
+    static int32_t quantize(float v) {
+        return SensorField<I>::quantize(v);
+    }
+
+    /** @returns the reading quantized value q of field i stands for */
+    static float value(unsigned i, int32_t q) {
+        return SensorFields<0>::value(i, q);
+    }
+
+    /** @returns the name of field i */
+    static const char *name(unsigned i) {
+        return SensorFields<0>::name(i);
+    }
+
+    /** Build a FormatSensor1 frame of the fields under flags.
+     *
+     * @returns the frame length, or 0 if it does not fit in size bytes
+     */
+    static size_t encode(const int32_t *fields, unsigned flags, uint8_t *buf, size_t size) {
+        flags &= ALL_FLAGS;
+        size_t n = 2 + SensorFields<0>::size(flags);
+        if (n > size)
+            return 0;
+        buf[0] = FORMAT;
+        buf[1] = (uint8_t)flags;
+        SensorFields<0>::put(buf + 2, fields, flags);
+        return n;
+    }
+
+    /** Read a FormatSensor1 frame; a field that is not in it reads 0.
+     *
+     * @param flags if not NULL, receives the frame's flags
+     * @returns false if buf does not hold one such frame
+     */
+    static bool decode(const uint8_t *buf, size_t len, int32_t *fields, unsigned *flags = NULL) {
+        if (len < 2 || buf[0] != FORMAT || (buf[1] & ~ALL_FLAGS))
+            return false;
+        if (len != 2 + SensorFields<0>::size(buf[1]))
+            return false;
+        SensorFields<0>::get(buf + 2, fields, buf[1]);
+        if (flags)
+            *flags = buf[1];
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include "SensorScheduler.h"
+#include "us_ticker_api.h"
+
+// thread signal that starts an acquisition
+#define SIGNAL_START    0x1
+
+SensorTask::SensorTask(const char *name, osPriority priority, uint32_t deadline_ms,
+                       uint32_t stack_size, unsigned char *stack) :
+    _name(name), _deadline(deadline_ms), _elapsed(0), _busy(false),
+    _owner(NULL), _sample(NULL),
+    _thread(&SensorTask::run, this, priority, stack_size, stack) {
+}
+
+SensorTask::~SensorTask() {
+}
+
+const char *SensorTask::getName() const {
+    return _name;
+}
+
+uint32_t SensorTask::getDeadline() const {
+    return _deadline;
+}
+
+uint32_t SensorTask::getElapsed() const {
+    return _elapsed;
+}
+
+bool SensorTask::isBusy() const {
+    return _busy;
+}
+
+uint64_t SensorTask::getCycles() {
+    return _thread.cpu_cycles();
+}
+
+uint32_t SensorTask::getMaxStack() {
+    return _thread.max_stack();
+}
+
+void SensorTask::lockTiming() {
+    _owner->_timing.lock();
+}
+
+void SensorTask::unlockTiming() {
+    _owner->_timing.unlock();
+}
+
+void SensorTask::start(SensorScheduler *owner, SensorSample *sample) {
+    _owner = owner;
+    _sample = sample;
+    _busy = true;
+    _thread.signal_set(SIGNAL_START);
+}
+
+void SensorTask::run(void const *argument) {
+    SensorTask *task = (SensorTask *)argument;
+    Timer timer;
+
+    while (true) {
+        Thread::signal_wait(SIGNAL_START);
+        timer.reset();
+        timer.start();
+        SensorSample *sample = task->_sample;
+        sample->ok = task->acquire(*sample);
+        timer.stop();
+        task->_elapsed = timer.read_ms();
+        // free to be started again before the record goes out
+        sample->posted_us = us_ticker_read();
+        task->_busy = false;
+        task->_owner->post(sample);
+    }
+}
+
+SensorScheduler::SensorScheduler() :
+    _count(0), _round(0), _completed(0), _latency(0), _starved(0), _late(0) {
+    for (unsigned i = 0; i < MAX_TASKS; i++)
+        _taken[i] = NULL;
+}
+
+bool SensorScheduler::add(SensorTask &task) {
+    if (_count >= MAX_TASKS)
+        return false;
+    _tasks[_count++] = &task;
+    return true;
+}
+
+void SensorScheduler::post(SensorSample *sample) {
+    _samples.put(sample);
+}
+
+uint32_t SensorScheduler::acquire() {
+    Timer timer;
+    uint32_t started = 0, good = 0;
+    uint32_t deadline = 0;
+
+    _round++;
+    _completed = 0;
+    timer.start();
+
+    // the last cycle's records go back to the pool
+    for (unsigned i = 0; i < _count; i++) {
+        if (_taken[i] != NULL) {
+            _samples.free(_taken[i]);
+            _taken[i] = NULL;
+        }
+    }
+
+    // a task overrunning from the last cycle sits this one out
+    for (unsigned i = 0; i < _count; i++) {
+        if (_tasks[i]->isBusy())
+            continue;
+        SensorSample *s = _samples.alloc();
+        if (s == NULL) {
+            _starved++;
+            continue;
+        }
+        s->task = i;
+        s->ok = false;
+        s->count = 0;
+        s->round = _round;
+        s->started_us = us_ticker_read();
+        started |= 1 << i;
+        if (_tasks[i]->getDeadline() > deadline)
+            deadline = _tasks[i]->getDeadline();
+        _tasks[i]->start(this, s);
+    }
+
+    while (_completed != started) {
+        int left = (int)deadline - timer.read_ms();
+        if (left <= 0)
+            break;
+        osEvent evt = _samples.get(left);
+        if (evt.status != osEventMail)
+            break;
+        SensorSample *s = (SensorSample *)evt.value.p;
+        s->taken_us = us_ticker_read();
+        // records from an earlier cycle's stragglers are dropped
+        if (s->round != _round) {
+            _late++;
+            _samples.free(s);
+            continue;
+        }
+        _completed |= 1 << s->task;
+        _taken[s->task] = s;
+        if (s->ok && _tasks[s->task]->getElapsed() <= _tasks[s->task]->getDeadline())
+            good |= 1 << s->task;
+    }
+
+    _latency = timer.read_ms();
+    return good;
+}
+
+uint32_t SensorScheduler::getCompleted() const {
+    return _completed;
+}
+
+uint32_t SensorScheduler::getLatency() const {
+    return _latency;
+}
+
+const SensorSample *SensorScheduler::getSample(unsigned index) const {
+    return index < _count ? _taken[index] : NULL;
+}
+
+uint32_t SensorScheduler::getStarved() const {
+    return _starved;
+}
+
+uint32_t SensorScheduler::getLate() const {
+    return _late;
+}
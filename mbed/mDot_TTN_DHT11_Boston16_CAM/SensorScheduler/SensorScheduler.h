@@ -0,0 +1,218 @@
+#ifndef SENSOR_SCHEDULER_H
+#define SENSOR_SCHEDULER_H
+
+#include "mbed.h"
+#include "rtos.h"
+
+class SensorScheduler;
+
+/** One sensor's readings from one cycle.
+ *
+ * The scheduler takes a record from its pool when it starts a task, the
+ * task fills it in place and posts it back, and the application reads it
+ * where it lies until the next cycle returns it to the pool. Each side
+ * has the record to itself in turn, so a task that overruns its deadline
+ * cannot change readings the application is using.
+ *
+ * A value is tagged with a field number of the application's choosing.
+ */
+struct SensorSample {
+    enum {
+        MAX_VALUES = 4
+    };
+
+    uint8_t task;               // index in the scheduler
+    bool ok;                    // what acquire() returned
+    uint8_t count;              // values put
+    uint8_t field[MAX_VALUES];
+    float value[MAX_VALUES];
+    uint32_t round;             // the cycle it was taken for
+    // us_ticker_read() as it moves along: started by the scheduler,
+    // posted by the task, taken by the scheduler
+    uint32_t started_us;
+    uint32_t posted_us;
+    uint32_t taken_us;
+
+    /** Add a value; past MAX_VALUES it is not kept. */
+    void put(uint8_t f, float v) {
+        if (count < MAX_VALUES) {
+            field[count] = f;
+            value[count++] = v;
+        }
+    }
+
+    /** @returns the first value of field f, or otherwise if there is none */
+    float get(uint8_t f, float otherwise) const {
+        for (unsigned i = 0; i < count; i++)
+            if (field[i] == f)
+                return value[i];
+        return otherwise;
+    }
+};
+
+/** One sensor's acquisition, run on a thread of its own.
+ *
+ * Subclasses implement acquire(), which the task's thread calls each
+ * time the scheduler starts a cycle, and put their readings in the
+ * SensorSample it is given rather than in members of their own; the
+ * application gets the record from SensorScheduler::getSample() once the
+ * task has reported.
+ *
+ * Tasks that bit-bang time-critical waveforms (1-wire, DHT single-wire)
+ * should hold lockTiming() around them, so that they do not preempt or
+ * disturb each other; buses clocked by the master (SHT, I2C) are safe
+ * to preempt.
+ *
+ * @code
+ * class AirTask : public SensorTask {
+ * public:
+ *     AirTask() : SensorTask("air", osPriorityAboveNormal, 100) {}
+ * protected:
+ *     virtual bool acquire(SensorSample &sample) {
+ *         lockTiming();
+ *         bool ok = dht.sample();
+ *         unlockTiming();
+ *         sample.put(FieldAirT, dht.getTemperature() / 10.0);
+ *         return ok;
+ *     }
+ * };
+ *
+ * SensorScheduler scheduler;
+ * AirTask air;
+ *
+ * int main() {
+ *     scheduler.add(air);
+ *     while (1) {
+ *         if (scheduler.acquire() & (1 << 0))
+ *             printf("%.1f\r\n", scheduler.getSample(0)->get(FieldAirT, 0));
+ *         wait(10);
+ *     }
+ * }
+ * @endcode
+ */
+class SensorTask {
+public:
+    /** Create a task; its thread starts at once and waits for the scheduler.
+     *
+     * @param name        name, for logs
+     * @param priority    thread priority
+     * @param deadline_ms a result arriving later than this is not used
+     * @param stack_size  thread stack size in bytes
+     * @param stack       stack_size bytes for the thread, 8-byte aligned;
+     *                    NULL to allocate it from the heap
+     */
+    SensorTask(const char *name, osPriority priority, uint32_t deadline_ms,
+               uint32_t stack_size = DEFAULT_STACK_SIZE, unsigned char *stack = NULL);
+    virtual ~SensorTask();
+
+    /** @returns the task name */
+    const char *getName() const;
+
+    /** @returns the deadline in ms */
+    uint32_t getDeadline() const;
+
+    /** @returns the duration of the last completed acquisition in ms */
+    uint32_t getElapsed() const;
+
+    /** @returns true while an acquisition runs */
+    bool isBusy() const;
+
+    /** @returns the processor cycles the task's thread has run */
+    uint64_t getCycles();
+
+    /** @returns the most stack the task's thread has used, in bytes */
+    uint32_t getMaxStack();
+
+protected:
+    /** Take a reading. Runs on the task's thread.
+     *
+     * @param sample record to put the readings in, empty
+     * @returns true if the reading is good
+     */
+    virtual bool acquire(SensorSample &sample) = 0;
+
+    /** Hold off the other tasks' time-critical bus phases. */
+    void lockTiming();
+    void unlockTiming();
+
+private:
+    friend class SensorScheduler;
+
+    static void run(void const *argument);
+    void start(SensorScheduler *owner, SensorSample *sample);
+
+    const char *_name;
+    uint32_t _deadline;
+    volatile uint32_t _elapsed;
+    volatile bool _busy;
+    SensorScheduler *_owner;
+    SensorSample *_sample;
+    Thread _thread;
+};
+
+/** Runs a set of SensorTasks concurrently, once per acquire().
+ *
+ * Every task is started together and acquire() returns when all of them
+ * have reported or the longest deadline has passed, so one cycle takes
+ * as long as the slowest sensor rather than the sum of them all.
+ *
+ * The records go round through a Mail: the pool holds one for each task
+ * the application is reading and one for each task at work, which is as
+ * many as can be out at once. A task is not started when there is no
+ * record for it, and a record posted after its cycle has ended goes
+ * straight back; both are counted.
+ */
+class SensorScheduler {
+public:
+    enum {
+        MAX_TASKS = 8
+    };
+
+    SensorScheduler();
+
+    /** Add a task; the first one added is bit 0 of the acquire() result.
+     *
+     * @returns true if there was room for it
+     */
+    bool add(SensorTask &task);
+
+    /** Run one acquisition cycle.
+     *
+     * @returns a bit mask of the tasks that completed in time with a good reading
+     */
+    uint32_t acquire();
+
+    /** @returns a bit mask of the tasks that completed in the last cycle, good or not */
+    uint32_t getCompleted() const;
+
+    /** @returns the duration of the last acquire() in ms */
+    uint32_t getLatency() const;
+
+    /** @returns the record a task filled in the last cycle, NULL if it did
+     * not complete; it stays valid until the next acquire() */
+    const SensorSample *getSample(unsigned index) const;
+
+    /** @returns the times a task was not started for want of a record */
+    uint32_t getStarved() const;
+
+    /** @returns the records that came back after their cycle had ended */
+    uint32_t getLate() const;
+
+private:
+    friend class SensorTask;
+
+    void post(SensorSample *sample);
+
+    SensorTask *_tasks[MAX_TASKS];
+    unsigned _count;
+    uint32_t _round;
+    uint32_t _completed;
+    uint32_t _latency;
+    uint32_t _starved;
+    uint32_t _late;
+    SensorSample *_taken[MAX_TASKS];
+    Mail<SensorSample, 2 * MAX_TASKS> _samples;
+    Mutex _timing;
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "SensorStats.h"
+
+#include <string.h>
+
+/* accumulator */
+
+StatsAccumulator::StatsAccumulator(State &state, unsigned fields, const uint8_t *select) :
+    _state(state), _fields(fields > (unsigned)MAX_FIELDS ? (unsigned)MAX_FIELDS : fields),
+    _select(select) {
+}
+
+bool StatsAccumulator::add(uint32_t now_ms, const int32_t *fields, unsigned valid) {
+    if (_state.epochs >= MAX_EPOCHS)
+        return false;
+    if (_state.epochs++ == 0)
+        _state.first_ms = now_ms;
+    for (unsigned i = 0; i < _fields; i++) {
+        if (!(valid & (1 << i)))
+            continue;
+        State::Field &f = _state.field[i];
+        int32_t x = fields[i];
+        if (f.count++ == 0) {
+            f.min = f.max = x;
+            f.sum = f.sumsq = 0;
+        }
+        f.min = x < f.min ? x : f.min;
+        f.max = x > f.max ? x : f.max;
+        f.sum += x;
+        f.sumsq += (int64_t)x * x;
+    }
+    return true;
+}
+
+// floor of the square root
+static uint64_t isqrt(uint64_t v) {
+    uint64_t r = 0;
+    for (uint64_t bit = (uint64_t)1 << 62; bit; bit >>= 2) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+    }
+    return r;
+}
+
+SensorStats::Summary StatsAccumulator::summarize(unsigned i) const {
+    Summary s;
+    memset(&s, 0, sizeof(s));
+    if (i >= _fields || _state.field[i].count == 0)
+        return s;
+    const State::Field &f = _state.field[i];
+    int64_t n = f.count;
+    s.select = StatAll;
+    s.count = f.count;
+    s.mean = (int32_t)((f.sum + (f.sum < 0 ? -n / 2 : n / 2)) / n);
+    s.min = f.min;
+    s.max = f.max;
+    // n^2 times the variance, exactly; sqrt(var) / n rounds the same as
+    // sqrt(4 var) / 2n, whose floor can be taken first, where 4 var fits
+    uint64_t var = (uint64_t)(n * f.sumsq - f.sum * f.sum);
+    if (var < (uint64_t)1 << 62)
+        s.sd = (uint32_t)((isqrt(4 * var) + n) / (2 * n));
+    else
+        s.sd = (uint32_t)((isqrt(var) + n / 2) / n);
+    return s;
+}
+
+size_t StatsAccumulator::finish(uint32_t now_ms, uint8_t *buf, size_t size, unsigned stats) const {
+    if (_state.epochs == 0 || size < 8)
+        return 0;
+    uint8_t *p = buf;
+    const uint8_t *end = buf + size;
+    *p++ = FORMAT;
+    *p++ = _state.epochs;
+    if ((p = DeltaPayload::putVarint(p, end, (now_ms - _state.first_ms + 500) / 1000)) == NULL ||
+        end - p < 5)
+        return 0;
+    uint8_t *masks = p;
+    memset(masks, 0, 5);
+    p += 5;
+
+    for (unsigned i = 0; i < _fields; i++) {
+        Summary s = summarize(i);
+        unsigned select = _select[i] & stats & StatAll;
+        if (!select)
+            continue;
+        if (s.count != _state.epochs) {
+            masks[4] |= 1 << i;
+            if ((p = DeltaPayload::putVarint(p, end, s.count)) == NULL)
+                return 0;
+        }
+        if (s.count == 0)
+            continue;
+        for (unsigned k = 0; k < 4; k++)
+            if (select & (1 << k))
+                masks[k] |= 1 << i;
+        bool mean = (select & StatMean) != 0;
+        if (mean)
+            p = DeltaPayload::putVarint(p, end, DeltaPayload::zigzag(s.mean));
+        if (p && (select & StatMin))
+            p = DeltaPayload::putVarint(p, end, mean ? (uint32_t)(s.mean - s.min) : DeltaPayload::zigzag(s.min));
+        if (p && (select & StatMax))
+            p = DeltaPayload::putVarint(p, end, mean ? (uint32_t)(s.max - s.mean) : DeltaPayload::zigzag(s.max));
+        if (p && (select & StatSD))
+            p = DeltaPayload::putVarint(p, end, s.sd);
+        if (p == NULL)
+            return 0;
+    }
+    return p - buf;
+}
+
+void StatsAccumulator::clear() {
+    _state.epochs = 0;
+    for (unsigned i = 0; i < _fields; i++)
+        _state.field[i].count = 0;
+}
+
+unsigned StatsAccumulator::getCount() const {
+    return _state.epochs;
+}
+
+/* decoder */
+
+StatsDecoder::StatsDecoder(unsigned fields) :
+    _fields(fields > (unsigned)MAX_FIELDS ? (unsigned)MAX_FIELDS : fields) {
+}
+
+StatsDecoder::Result StatsDecoder::decode(const uint8_t *buf, size_t len, Summary *fields,
+                                          unsigned *epochs, uint32_t *age) const {
+    const uint8_t *p = buf;
+    const uint8_t *end = buf + len;
+
+    if (len < 2 || *p++ != FORMAT)
+        return MALFORMED;
+    unsigned n = *p++;
+    if ((p = DeltaPayload::getVarint(p, end, age)) == NULL || end - p < 5)
+        return MALFORMED;
+    const uint8_t *masks = p;
+    p += 5;
+    for (unsigned k = 0; k < 5; k++)
+        if (masks[k] >> _fields)
+            return MALFORMED;
+
+    for (unsigned i = 0; i < _fields; i++) {
+        Summary &s = fields[i];
+        memset(&s, 0, sizeof(s));
+        for (unsigned k = 0; k < 4; k++)
+            if (masks[k] & (1 << i))
+                s.select |= 1 << k;
+        // read every epoch unless short, or not at all if left out
+        uint32_t u = s.select ? n : 0;
+        if ((masks[4] & (1 << i)) && (p = DeltaPayload::getVarint(p, end, &u)) == NULL)
+            return MALFORMED;
+        if (u > n || (u == 0 && s.select))
+            return MALFORMED;
+        s.count = u;
+
+        bool mean = (s.select & StatMean) != 0;
+        if (mean) {
+            if ((p = DeltaPayload::getVarint(p, end, &u)) == NULL)
+                return MALFORMED;
+            s.mean = DeltaPayload::unzigzag(u);
+        }
+        if (s.select & StatMin) {
+            if ((p = DeltaPayload::getVarint(p, end, &u)) == NULL)
+                return MALFORMED;
+            s.min = mean ? (int32_t)((uint32_t)s.mean - u) : DeltaPayload::unzigzag(u);
+        }
+        if (s.select & StatMax) {
+            if ((p = DeltaPayload::getVarint(p, end, &u)) == NULL)
+                return MALFORMED;
+            s.max = mean ? (int32_t)((uint32_t)s.mean + u) : DeltaPayload::unzigzag(u);
+        }
+        if (s.select & StatSD) {
+            if ((p = DeltaPayload::getVarint(p, end, &u)) == NULL)
+                return MALFORMED;
+            s.sd = u;
+        }
+    }
+    if (p != end)
+        return MALFORMED;
+    *epochs = n;
+    return DECODED;
+}
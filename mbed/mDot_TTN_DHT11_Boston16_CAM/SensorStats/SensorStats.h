@@ -0,0 +1,154 @@
+#ifndef SENSOR_STATS_H
+#define SENSOR_STATS_H
+
+#include "DeltaPayload.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Statistics of the readings between uplinks (format 0x15).
+ *
+ * Every epoch's readings, integers scaled the way the fixed-layout format
+ * does it, go into a running count, minimum, maximum, sum and sum of
+ * squares per field. The sums are exact 64-bit integers, so the variance
+ * they give has no rounding to guard against and memory stays the same
+ * however many epochs go in. A frame summarises the epochs since the last
+ * one:
+ *
+ *   0x15 | epochs | age | mean | min | max | sd | short | field...
+ *
+ * epochs is the number of epochs and age the time in seconds from the
+ * first of them to the frame being sent, as a varint. The next five bytes
+ * are masks, bit i for field i: which fields send their mean, minimum,
+ * maximum and standard deviation, and which were read fewer times than
+ * there were epochs. Then for each field in turn, as varints: its count if
+ * it is short, the mean (zig-zag), the minimum and maximum as distances
+ * below and above the mean if it is sent or zig-zag values if not, and the
+ * standard deviation. Means and deviations are rounded to the field's
+ * scale. A field that was never read sends nothing but its count.
+ *
+ * Which statistics a field sends is set per field; a field that sends
+ * none is left out.
+ *
+ * @code
+ * static const uint8_t select[3] = { StatsAccumulator::StatMean, StatsAccumulator::StatAll, 0 };
+ * StatsAccumulator::State state;      // keep across deep sleep, zeroed at first
+ * StatsAccumulator stats(state, 3, select);
+ *
+ * stats.add(now_ms, fields);
+ * if (stats.getCount() >= 6) {
+ *     uint8_t buf[StatsAccumulator::MAX_FRAME];
+ *     size_t n = stats.finish(now_ms, buf, sizeof(buf));
+ *     if (send(buf, n) == OK)
+ *         stats.clear();
+ * }
+ * @endcode
+ */
+class SensorStats {
+public:
+    enum {
+        FORMAT = 0x15,
+        MAX_FIELDS = DeltaPayload::MAX_FIELDS,
+        MAX_EPOCHS = 255,
+        // format, epochs, age, the masks and per field a count and four varints
+        MAX_FRAME = 2 + 5 + 5 + MAX_FIELDS * (5 + 4 * 5)
+    };
+
+    enum {
+        StatMean = 1 << 0,
+        StatMin = 1 << 1,
+        StatMax = 1 << 2,
+        StatSD = 1 << 3,
+        StatAll = StatMean | StatMin | StatMax | StatSD
+    };
+
+    /** One field's statistics, in the field's scale. */
+    struct Summary {
+        uint8_t select;     // which of the others are known
+        uint8_t count;      // times the field was read
+        int32_t mean;
+        int32_t min;
+        int32_t max;
+        uint32_t sd;        // population standard deviation
+    };
+};
+
+class StatsAccumulator : public SensorStats {
+public:
+    /** What has to outlive the accumulator between epochs: plain data. */
+    struct State {
+        uint8_t epochs;             // epochs added
+        uint32_t first_ms;          // clock of the first
+        struct Field {
+            uint8_t count;
+            int32_t min;
+            int32_t max;
+            int64_t sum;
+            int64_t sumsq;
+        } field[MAX_FIELDS];
+    };
+
+    /** Create an accumulator working on state, which must be zeroed before
+     * the first use.
+     *
+     * @param fields number of fields per epoch, up to MAX_FIELDS
+     * @param select for each field, the statistics to send (Stat*); must
+     *               outlive the accumulator
+     */
+    StatsAccumulator(State &state, unsigned fields, const uint8_t *select);
+
+    /** Add an epoch's readings taken at clock time now_ms.
+     *
+     * @param valid bit i set if field i was read; the others are skipped
+     * @returns false if there are MAX_EPOCHS already
+     */
+    bool add(uint32_t now_ms, const int32_t *fields, unsigned valid = ~0u);
+
+    /** Build the frame as if sent at clock time now_ms.
+     *
+     * @param stats the statistics to send at most, e.g. StatMean for a
+     *              frame that has to be smaller
+     * @returns the frame length, or 0 if it does not fit in size bytes or
+     *          there are no epochs
+     */
+    size_t finish(uint32_t now_ms, uint8_t *buf, size_t size, unsigned stats = StatAll) const;
+
+    /** @returns the statistics of field i so far, all of them */
+    Summary summarize(unsigned i) const;
+
+    /** Start over, e.g. once a frame is sent. */
+    void clear();
+
+    unsigned getCount() const;
+
+private:
+    State &_state;
+    unsigned _fields;
+    const uint8_t *_select;
+};
+
+class StatsDecoder : public SensorStats {
+public:
+    enum Result {
+        DECODED = 0,        // fields hold the frame's statistics
+        MALFORMED           // not a 0x15 frame of this many fields
+    };
+
+    /** @param fields number of fields per frame, up to MAX_FIELDS */
+    StatsDecoder(unsigned fields);
+
+    /** Decode one frame.
+     *
+     * @param fields receives each field's statistics, with a count of 0
+     *               for a field the frame leaves out
+     * @param epochs receives the number of epochs
+     * @param age    receives the age of the first epoch when the frame was sent, in seconds
+     */
+    Result decode(const uint8_t *buf, size_t len, Summary *fields,
+                  unsigned *epochs, uint32_t *age) const;
+
+private:
+    unsigned _fields;
+};
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+
+/** A ring of N items from one producer to one consumer, neither of which
+ * ever waits for the other: made for handing data from an interrupt to a
+ * thread, such as edge timestamps or received bytes.
+ *
+ * Each side owns one index and only reads the other's, so there is nothing
+ * to lock and no interrupt is masked. The indices run freely and are
+ * reduced modulo N when used, which is why N has to be a power of two; all
+ * N slots hold items, with head - tail telling full from empty. An index
+ * is published with release order after the slot it covers is written,
+ * and read with acquire order before the slot is, so on a multi-core host
+ * as on the board an item is complete by the time the other side sees it.
+ *
+ * push() and pop() move one item; write() and read() move a run of them,
+ * and writeSpan()/commit() and readSpan()/consume() give direct access to
+ * the contiguous part of the free or filled slots, for filling or draining
+ * them in place. A push to a full ring fails and is counted in
+ * getDropped(); the producer can check full() first where losing the
+ * oldest item would be better.
+ *
+ * @code
+ * SpscRing<uint32_t, 64> edges;
+ *
+ * void edge() {                       // interrupt: the producer
+ *     edges.push(us_ticker_read());
+ * }
+ *
+ * uint32_t t;                         // thread: the consumer
+ * while (edges.pop(t))
+ *     ...
+ * @endcode
+ */
+template <typename T, uint32_t N>
+class SpscRing {
+public:
+    enum { CAPACITY = N };
+    typedef char power_of_two[N >= 2 && (N & (N - 1)) == 0 ? 1 : -1];
+
+    SpscRing() : _head(0), _tail(0), _dropped(0) {
+    }
+
+    /** Producer: add v.
+     *
+     * @returns false, and counts a drop, if the ring is full
+     */
+    bool push(const T &v) {
+        uint32_t head = _head;
+        if (head - acquire(_tail) == N) {
+            _dropped++;
+            return false;
+        }
+        _pool[head & (N - 1)] = v;
+        release(_head, head + 1);
+        return true;
+    }
+
+    /** Producer: add up to n items from src, as many as there is room for.
+     *
+     * @returns the number added; the rest are counted as dropped
+     */
+    uint32_t write(const T *src, uint32_t n) {
+        uint32_t done = 0;
+        uint32_t len;
+        while (done < n) {
+            T *p = writeSpan(&len);
+            if (len == 0)
+                break;
+            if (len > n - done)
+                len = n - done;
+            for (uint32_t i = 0; i < len; i++)
+                p[i] = src[done + i];
+            commit(len);
+            done += len;
+        }
+        _dropped += n - done;
+        return done;
+    }
+
+    /** Producer: the free slots that follow one another from the next one
+     * written, for filling in place before commit().
+     *
+     * @param len set to the number of slots, 0 if the ring is full
+     */
+    T *writeSpan(uint32_t *len) {
+        uint32_t head = _head;
+        uint32_t room = N - (head - acquire(_tail));
+        uint32_t i = head & (N - 1);
+        *len = room < N - i ? room : N - i;
+        return &_pool[i];
+    }
+
+    /** Producer: publish the first n slots of the last writeSpan(). */
+    void commit(uint32_t n) {
+        release(_head, _head + n);
+    }
+
+    /** Consumer: take the oldest item into v.
+     *
+     * @returns false if the ring is empty
+     */
+    bool pop(T &v) {
+        uint32_t tail = _tail;
+        if (acquire(_head) == tail)
+            return false;
+        v = _pool[tail & (N - 1)];
+        release(_tail, tail + 1);
+        return true;
+    }
+
+    /** Consumer: take up to n of the oldest items into dst.
+     *
+     * @returns the number taken
+     */
+    uint32_t read(T *dst, uint32_t n) {
+        uint32_t done = 0;
+        uint32_t len;
+        while (done < n) {
+            const T *p = readSpan(&len);
+            if (len == 0)
+                break;
+            if (len > n - done)
+                len = n - done;
+            for (uint32_t i = 0; i < len; i++)
+                dst[done + i] = p[i];
+            consume(len);
+            done += len;
+        }
+        return done;
+    }
+
+    /** Consumer: the filled slots that follow one another from the oldest,
+     * for reading in place before consume().
+     *
+     * @param len set to the number of items, 0 if the ring is empty
+     */
+    const T *readSpan(uint32_t *len) {
+        uint32_t tail = _tail;
+        uint32_t used = acquire(_head) - tail;
+        uint32_t i = tail & (N - 1);
+        *len = used < N - i ? used : N - i;
+        return &_pool[i];
+    }
+
+    /** Consumer: release the first n items of the last readSpan(). */
+    void consume(uint32_t n) {
+        release(_tail, _tail + n);
+    }
+
+    /** Consumer: drop everything the producer has added so far. */
+    void clear() {
+        release(_tail, acquire(_head));
+    }
+
+    /** Either side: the number of items in the ring, which may only grow
+     * for the consumer and only shrink for the producer while it looks. */
+    uint32_t size() const {
+        uint32_t tail = acquire(_tail);
+        return acquire(_head) - tail;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    bool full() const {
+        return size() == N;
+    }
+
+    /** Items the producer could not add since the ring was made. */
+    uint32_t getDropped() const {
+        return _dropped;
+    }
+
+private:
+#if defined(__GNUC__)
+    static uint32_t acquire(const uint32_t &index) {
+        return __atomic_load_n(&index, __ATOMIC_ACQUIRE);
+    }
+
+    static void release(uint32_t &index, uint32_t value) {
+        __atomic_store_n(&index, value, __ATOMIC_RELEASE);
+    }
+#else
+    // single core: keeping the compiler from moving the accesses is enough
+    static uint32_t acquire(const uint32_t &index) {
+        uint32_t value = *(const volatile uint32_t *)&index;
+        __schedule_barrier();
+        return value;
+    }
+
+    static void release(uint32_t &index, uint32_t value) {
+        __schedule_barrier();
+        *(volatile uint32_t *)&index = value;
+    }
+#endif
+
+    T _pool[N];
+    uint32_t _head;         // next slot written; only the producer stores it
+    uint32_t _tail;         // next slot read; only the consumer stores it
+    uint32_t _dropped;      // producer's
+};
+
+#endif
@@ -1,17 +1,76 @@
 #include "TSL2561_I2C.h"
 
-TSL2561_I2C::TSL2561_I2C( PinName sda, PinName scl ) : i2c( sda, scl ){   
+// Auto-ranging steps, shortest integration first, 1x before 16x
+static const char range_timing[] = { 0x00, 0x10, 0x01, 0x11, 0x02, 0x12 };
+static const int range_count = sizeof( range_timing ) / sizeof( range_timing[0] );
+
+// Switch to a range only if it would read at least this many counts,
+// stay in one until it reads fewer than this (or is near full scale)
+static const int range_enter_low = 1000;
+static const int range_keep_low = 250;
+
+static int gainOf( char timing ){
+    return ( timing & 16 ) ? 16 : 1;
+}
+
+static float integrationTimeOf( char timing ){
+    switch ( timing & 3 ) {
+        case 0:
+            return 13.7;
+        case 1:
+            return 101;
+        case 2:
+            return 402;
+        default:
+            return 0;
+    }
+}
+
+// ADC full scale; the short integrations stop counting early
+static int maxCountOf( char timing ){
+    switch ( timing & 3 ) {
+        case 0:
+            return 5047;
+        case 1:
+            return 37177;
+        default:
+            return 65535;
+    }
+}
+
+// Counts per unit light relative to 1x / 402 ms (datasheet scale factors)
+static float sensitivityOf( char timing ){
+    float s;
+    switch ( timing & 3 ) {
+        case 0:
+            s = 11.0 / 322.0;
+            break;
+        case 1:
+            s = 81.0 / 322.0;
+            break;
+        default:
+            s = 1.0;
+            break;
+    }
+    return s * gainOf( timing );
+}
+
+TSL2561_I2C::TSL2561_I2C( PinName sda, PinName scl ) : i2c( sda, scl ), timing( 2 ), control( 0 ), transactions( 0 ),
+    auto_range( false ), last_timing( 2 ), settling( false ), settle_ms( 0 ){   
     i2c.frequency(100000);
     enablePower();
+    syncConfiguration();
 }
 
 int TSL2561_I2C::writeSingleRegister( char address, char data ){
+    transactions++;
     char tx[2] = { address | 160, data }; //0d160 = 0b10100000
     int ack = i2c.write( TSL_SLAVE_ADDRESS << 1, tx, 2 );
     return ack;
 }
 
 int TSL2561_I2C::writeMultipleRegisters( char address, char* data, int quantity ){
+    transactions++;
     char tx[ quantity + 1 ];
     tx[0] = address | 160;
     for ( int i = 1; i <= quantity; i++ ){
@@ -22,6 +81,7 @@ int TSL2561_I2C::writeMultipleRegisters( char address, char* data, int quantity
 }
 
 char TSL2561_I2C::readSingleRegister( char address ){
+    transactions++;
     char output = 255;
     char command = address | 160; //0d160 = 0b10100000
     i2c.write( TSL_SLAVE_ADDRESS << 1, &command, 1, true );
@@ -30,6 +90,7 @@ char TSL2561_I2C::readSingleRegister( char address ){
 }
 
 int TSL2561_I2C::readMultipleRegisters( char address, char* output, int quantity ){
+    transactions++;
     char command = address | 160; //0d160 = 0b10100000
     i2c.write( TSL_SLAVE_ADDRESS << 1, &command, 1, true );
     int ack = i2c.read( TSL_SLAVE_ADDRESS << 1, output, quantity );
@@ -50,17 +111,216 @@ int TSL2561_I2C::getIROnly(){
     return reading;
 }
 
+int TSL2561_I2C::syncConfiguration(){
+    char buffer[2];
+    int ack = readMultipleRegisters( TSL_CONTROL, buffer, 2 ); // CONTROL, TIMING
+    if ( ack == 0 ){
+        control = buffer[0];
+        timing = buffer[1];
+    }
+    return ack;
+}
+
+unsigned int TSL2561_I2C::getTransactionCount(){
+    return transactions;
+}
+
+void TSL2561_I2C::resetTransactionCount(){
+    transactions = 0;
+}
+
+void TSL2561_I2C::setAutoRange( bool enable ){
+    auto_range = enable;
+}
+
+bool TSL2561_I2C::isAutoRange(){
+    return auto_range;
+}
+
+int TSL2561_I2C::getLastGain(){
+    return gainOf( last_timing );
+}
+
+float TSL2561_I2C::getLastIntegrationTime(){
+    return integrationTimeOf( last_timing );
+}
+
+char TSL2561_I2C::getTiming(){
+    return timing;
+}
+
+int TSL2561_I2C::setTiming( const char timing_new ){
+    return setRange( timing_new );
+}
+
+int TSL2561_I2C::getSettleTime(){
+    if ( !settling ){
+        return 0;
+    }
+    int left = settle_ms - settle.read_ms();
+    return left > 0 ? left : 0;
+}
+
+void TSL2561_I2C::readChannels( int& ch0, int& ch1 ){
+    if ( settling ){
+        // The first integration at a new range is not complete yet
+        int left = settle_ms - settle.read_ms();
+        if ( left > 0 ){
+            wait_ms( left );
+        }
+        settle.stop();
+        settling = false;
+    }
+    
+    // DATA0LOW..DATA1HIGH in one go
+    char buffer[4] = { 0 };
+    readMultipleRegisters( TSL_DATA0LOW, buffer, 4 );
+    ch0 = (int)buffer[1] << 8 | (int)buffer[0];
+    ch1 = (int)buffer[3] << 8 | (int)buffer[2];
+}
+
+bool TSL2561_I2C::isSaturated( int ch0, int ch1 ){
+    int max = maxCountOf( timing );
+    return ( ch0 >= max ) || ( ch1 >= max );
+}
+
+int TSL2561_I2C::setRange( char timing_new ){
+    int ack = writeSingleRegister( TSL_TIMING, timing_new );
+    if ( ack == 0 ){
+        timing = timing_new;
+        // Power cycle so the next integration starts now, at the new range
+        disablePower();
+        enablePower();
+    }
+    return ack;
+}
+
+char TSL2561_I2C::chooseRange( int ch0 ){
+    float s = sensitivityOf( timing );
+    int best = -1;
+    int last_fit = 0;
+    
+    for ( int k = 0; k < range_count; k++ ){
+        float counts = ch0 * sensitivityOf( range_timing[k] ) / s;
+        if ( counts <= maxCountOf( range_timing[k] ) / 2 ){
+            last_fit = k;
+            if ( best < 0 && counts >= range_enter_low ){
+                best = k;
+            }
+        }
+    }
+    if ( best < 0 ){
+        // Too dark for every range: take the most sensitive that fits
+        best = last_fit;
+    }
+    
+    // Hysteresis: stay put while the reading is usable, unless a
+    // shorter integration would do
+    if ( ch0 >= range_keep_low && ch0 <= maxCountOf( timing ) * 9 / 10 &&
+         integrationTimeOf( range_timing[best] ) >= integrationTimeOf( timing ) ){
+        return timing;
+    }
+    return range_timing[best];
+}
+
 float TSL2561_I2C::getLux(){
-    float lux = 0;
-    int ch0 = getVisibleAndIR();
-    int ch1 = getIROnly();
+    int ch0, ch1;
     
-    // Determine if either sensor saturated (0xFFFF)
+    readChannels( ch0, ch1 );
+    if ( auto_range && isSaturated( ch0, ch1 ) && timing != range_timing[0] ){
+        // Too bright: measure again at once at the least sensitive range
+        setRange( range_timing[0] );
+        readChannels( ch0, ch1 );
+    }
+    last_timing = timing;
+    
+    // Determine if either sensor saturated
     // If so, abandon ship (calculation will not be accurate)
-    if( (ch0 == 0xFFFF) || (ch1 == 0xFFFF) ){
+    if( isSaturated( ch0, ch1 ) ){
         return -1;
     }
     
+    if ( auto_range ){
+        char next = chooseRange( ch0 > ch1 ? ch0 : ch1 );
+        if ( next != timing ){
+            setRange( next );
+        }
+    }
+    
+    return calculateLux( ch0, ch1, last_timing );
+}
+
+#ifndef TSL2561_FLOAT_LUX
+
+// Fixed-point scales and the piecewise-linear coefficients for the T, FN
+// and CL packages, from the CalculateLux example in the datasheet
+#define LUX_SCALE       14      // lux scale by 2^14
+#define RATIO_SCALE     9       // ch1/ch0 ratio scale by 2^9
+#define CH_SCALE        10      // channel scaling by 2^10
+#define CHSCALE_TINT0   0x7517  // 322/11 * 2^CH_SCALE
+#define CHSCALE_TINT1   0x0fe7  // 322/81 * 2^CH_SCALE
+
+static const struct {
+    unsigned int k, b, m;       // ratio upper bound, ch0 and ch1 coefficients
+} lux_segments[] = {
+    { 0x0040, 0x01f2, 0x01be },
+    { 0x0080, 0x0214, 0x02d1 },
+    { 0x00c0, 0x023f, 0x037b },
+    { 0x0100, 0x0270, 0x03fe },
+    { 0x0138, 0x016f, 0x01fc },
+    { 0x019a, 0x00d2, 0x00fb },
+    { 0x029a, 0x0018, 0x0012 },
+};
+
+float TSL2561_I2C::calculateLux( int ch0, int ch1, char timing ){
+    // Normalize to 402 ms, 16x gain
+    unsigned long chScale;
+    switch ( timing & 3 ) {
+        case 0:
+            chScale = CHSCALE_TINT0;
+            break;
+        case 1:
+            chScale = CHSCALE_TINT1;
+            break;
+        default:
+            chScale = 1 << CH_SCALE;
+            break;
+    }
+    if ( !( timing & 16 ) ){
+        chScale <<= 4;
+    }
+    unsigned long channel0 = ( (unsigned long)ch0 * chScale ) >> CH_SCALE;
+    unsigned long channel1 = ( (unsigned long)ch1 * chScale ) >> CH_SCALE;
+    
+    unsigned long ratio = 0;
+    if ( channel0 != 0 ){
+        ratio = ( ( channel1 << ( RATIO_SCALE + 1 ) ) / channel0 + 1 ) >> 1;
+    }
+    
+    unsigned long b = 0, m = 0;     // ratio above 1.30: no light to speak of
+    for ( unsigned int i = 0; i < sizeof( lux_segments ) / sizeof( lux_segments[0] ); i++ ){
+        if ( ratio <= lux_segments[i].k ){
+            b = lux_segments[i].b;
+            m = lux_segments[i].m;
+            break;
+        }
+    }
+    
+    unsigned long c0 = channel0 * b;
+    unsigned long c1 = channel1 * m;
+    unsigned long temp = ( c0 > c1 ) ? c0 - c1 : 0;
+    
+    // temp is lux at 16x times 2^LUX_SCALE; the float formulas normalize
+    // to 1x, so keep their scale: divide by a further 16, in 1/100 lux
+    unsigned long centilux = ( ( temp >> 8 ) * 100 + ( 1 << 9 ) ) >> ( LUX_SCALE + 4 - 8 );
+    return centilux / 100.0f;
+}
+
+#else
+
+float TSL2561_I2C::calculateLux( int ch0, int ch1, char timing ){
+    float lux = 0;
+    
     // Convert from unsigned integer to floating point
     float d0 = ch0;
     float d1 = ch1;
@@ -69,12 +329,12 @@ float TSL2561_I2C::getLux(){
     double ratio = d1 / d0;
     
     // Normalize for integration time
-    int itime = readIntegrationTime();
+    float itime = integrationTimeOf( timing );
     d0 *= (402.0/itime);
     d1 *= (402.0/itime);
     
     // Normalize for gain
-    int gain = readGain();
+    int gain = gainOf( timing );
         d0 /= gain;
         d1 /= gain;
     
@@ -100,18 +360,33 @@ float TSL2561_I2C::getLux(){
     return lux;
 }
 
+#endif
+
 int TSL2561_I2C::enablePower(){
+    bool was_off = ( control != 3 );
     int ack = writeSingleRegister( TSL_CONTROL, 3 );
+    if ( ack == 0 ){
+        control = 3;
+        if ( was_off ){
+            // The data registers hold nothing until the first integration completes
+            settle_ms = (int)integrationTimeOf( timing ) + 2;
+            settle.reset();
+            settle.start();
+            settling = true;
+        }
+    }
     return ack;
 }
 
 int TSL2561_I2C::disablePower(){
     int ack = writeSingleRegister( TSL_CONTROL, 0 );
+    if ( ack == 0 ){
+        control = 0;
+    }
     return ack;
 }
 
 bool TSL2561_I2C::isPowerEnabled(){
-    char control = readSingleRegister( TSL_CONTROL );
     bool power = 0;
     if( control == 3 ){
         power = 1;
@@ -120,7 +395,6 @@ bool TSL2561_I2C::isPowerEnabled(){
 }
 
 int TSL2561_I2C::readGain(){
-    char timing = readSingleRegister( TSL_TIMING );
     char gain_bit = ( timing << 3 ) >> 7; // keep only bit 4
     int gain;
     switch (gain_bit) {
@@ -138,7 +412,7 @@ int TSL2561_I2C::readGain(){
 }
 
 int TSL2561_I2C::setGain( const int gain ){
-    char timing_old = readSingleRegister( TSL_TIMING );
+    char timing_old = timing;
     char timing_new = 0;
     int ack = 0;
     switch (gain){
@@ -155,33 +429,19 @@ int TSL2561_I2C::setGain( const int gain ){
     
     if ( ack != 2 ){
         ack = writeSingleRegister( TSL_TIMING, timing_new );
+        if ( ack == 0 ){
+            timing = timing_new;
+        }
     }
     return ack;
 }
 
 float TSL2561_I2C::readIntegrationTime(){
-    char timing = readSingleRegister( TSL_TIMING );
-    char integ = ( timing << 6 ) >> 6; // keep bits 0 & 1
-    int itime;
-    switch (integ) {
-        case 0:
-            itime = 13.7;
-            break;
-        case 1:
-            itime = 101;
-            break;
-        case 2:
-            itime = 402;
-            break;
-        default:
-            itime = 0;
-            break;
-    }
-    return itime;
+    return integrationTimeOf( timing );
 }
 
 int TSL2561_I2C::setIntegrationTime( const float itime ){
-    char timing_old = readSingleRegister( TSL_TIMING );
+    char timing_old = timing;
     char timing_new = 0;
     int ack = 0;
     if( abs( itime - 13.7 ) <= 0.001 ){
@@ -199,6 +459,9 @@ int TSL2561_I2C::setIntegrationTime( const float itime ){
     }
     if ( ack != 2 ){
         ack = writeSingleRegister( TSL_TIMING, timing_new );
+        if ( ack == 0 ){
+            timing = timing_new;
+        }
     }
     return ack;
 }
@@ -260,6 +523,7 @@ int TSL2561_I2C::setInterruptControl( const int control ){
 }
 
 int TSL2561_I2C::clearInterrupt(){
+    transactions++;
     char tx = 192;
     int ack = i2c.write( TSL_SLAVE_ADDRESS << 1, &tx, 1 ); // writes 0b11000000 to command register to clear interrupt
     return ack;
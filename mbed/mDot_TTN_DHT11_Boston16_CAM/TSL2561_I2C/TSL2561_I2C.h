@@ -2,6 +2,9 @@
 #define TSL2561_I2C_H
 #include "mbed.h"
 
+// Lux is computed with the datasheet's fixed-point CalculateLux; define
+// TSL2561_FLOAT_LUX to use the floating-point formulas instead
+//
 //Defines 
 #define TSL_SLAVE_ADDRESS       0x29
 
@@ -59,13 +62,111 @@ public:
     int getIROnly();
     
     /** Read sensors and calculate Illuminance in lux
+     *
+     *  Both channels come in one 4-byte burst from TSL_DATA0LOW; gain
+     *  and integration time are taken from the cached configuration.
      *
      * @returns
      *     Illuminance (lux)
      */
     float getLux();
     
+    /** Calculate Illuminance from raw channel counts, as getLux() does
+     *
+     * @param ch0 broadband (visible + IR) count
+     * @param ch1 IR count
+     * @param timing TIMING register value the counts were taken with
+     *
+     * @returns
+     *     Illuminance (lux)
+     */
+    static float calculateLux( int ch0, int ch1, char timing );
+    
+    /** Enable automatic ranging.
+     *
+     *  Each getLux() picks gain and integration time for the next
+     *  reading from this one: the shortest integration that keeps
+     *  the ADC in range with enough counts, with hysteresis so it
+     *  does not flip between neighbouring ranges. A saturated
+     *  reading is taken again straight away at 1x / 13.7 ms.
+     *
+     * @param enable true to enable, false to keep the present range
+     */
+    void setAutoRange( bool enable );
+    
+    /** Check if automatic ranging is enabled.
+     *
+     * @returns
+     *     true if enabled
+     */
+    bool isAutoRange();
+    
+    /** Gain used for the last getLux() reading.
+     *
+     * @returns
+     *     1 or 16
+     */
+    int getLastGain();
+    
+    /** Integration time used for the last getLux() reading.
+     *
+     * @returns
+     *     Integration time in milliseconds
+     */
+    float getLastIntegrationTime();
+    
+    /** Return the TIMING register (cached), e.g. to keep the range found
+     *  by automatic ranging across a reset of the MCU.
+     *
+     * @returns
+     *     TIMING register value
+     */
+    char getTiming();
+    
+    /** Write the TIMING register; integration restarts at the new setting.
+     *
+     * @param timing_new TIMING register value
+     *
+     * @returns
+     *     0 if successful
+     *     non-0 if otherwise
+     */
+    int setTiming( const char timing_new );
+    
+    /** Time until the integration started by powering up or changing
+     *  range completes; getLux() busy-waits for it otherwise.
+     *
+     * @returns
+     *     Milliseconds left, 0 if a reading is available
+     */
+    int getSettleTime();
+    
+    /** Re-read TIMING and CONTROL into the cached configuration.
+     *  Only needed if the device may have been reset behind our back.
+     *
+     * @returns
+     *     0 if successful
+     *     non-0 if otherwise
+     */
+    int syncConfiguration();
+    
+    /** Number of bus transactions since the count was last reset.
+     *  A register write, or a command write plus repeated-start read,
+     *  counts as one.
+     *
+     * @returns
+     *     Transaction count
+     */
+    unsigned int getTransactionCount();
+    
+    /** Reset the bus transaction count to zero.
+     */
+    void resetTransactionCount();
+    
     /** Power up the device.
+     *
+     * Coming from power down, the next reading waits until the first
+     * integration cycle has completed.
      *
      * @returns
      *     1 if successful
@@ -81,7 +182,7 @@ public:
      */
     int disablePower();
     
-    /** Check if power to the device is enabled.
+    /** Check if power to the device is enabled (cached).
      *
      * @returns
      *     1 if power ON
@@ -89,7 +190,7 @@ public:
      */
     bool isPowerEnabled();
  
-    /** Return present gain value
+    /** Return present gain value (cached)
      *
      * @returns
      *     1 (low gain mode)
@@ -107,7 +208,7 @@ public:
      */
     int setGain( const int gain );
     
-    /** Read the current integration time.
+    /** Read the current integration time (cached).
      *
      * @returns
      *     Integration time in milliseconds
@@ -222,6 +323,25 @@ public:
 private:
     I2C i2c;
     
+    // Shadows of the TIMING and CONTROL registers; every write to
+    // either goes through this driver, so there is no need to read
+    // them back from the device.
+    char timing;
+    char control;
+    
+    unsigned int transactions;
+    
+    bool auto_range;
+    char last_timing;       // TIMING the last reading was taken with
+    Timer settle;           // runs while the first integration at a new range completes
+    bool settling;
+    int settle_ms;
+    
+    void readChannels( int& ch0, int& ch1 );
+    bool isSaturated( int ch0, int ch1 );
+    int setRange( char timing_new );
+    char chooseRange( int ch0 );
+    
     int writeSingleRegister( char address, char data );
     int writeMultipleRegisters( char address, char* data, int quantity );
     char readSingleRegister( char address );
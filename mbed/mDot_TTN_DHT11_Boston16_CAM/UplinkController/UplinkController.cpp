@@ -0,0 +1,180 @@
+#include "UplinkController.h"
+#include "MTSLog.h"
+
+// demodulation floor of SF12 and the step to the next faster rate, in
+// tenths of a dB (SX1272 datasheet)
+#define SNR_FLOOR_SF12  -200
+#define SNR_FLOOR_STEP  25
+
+// Time on air of a frame at 125 kHz, coding rate 4/5, 8 preamble symbols
+// and an explicit header, in ms rounded up as mDot::getTimeOnAir() gives
+// it (SX1272 datasheet, 4.1.1.7). 13 bytes of LoRaWAN header and MIC go
+// around the payload.
+static uint32_t airtime_ms(unsigned sf, size_t payload) {
+    unsigned de = sf >= 11;     // low data rate optimisation
+    int bits = 8 * (int)(13 + payload) - 4 * (int)sf + 28 + 16;
+    unsigned span = 4 * (sf - 2 * de);
+    unsigned n = bits > 0 ? (bits + span - 1) / span * 5 : 0;
+    // in quarter symbols, 12.25 of preamble, 8 of header and n of payload;
+    // a symbol is 2^sf / 125 kHz, or 8 << sf us
+    uint32_t us = (4 * (8 + 8 + n) + 17) * (2u << sf);
+    return (us + 999) / 1000;
+}
+
+UplinkController::UplinkController(State &state, mDot *dot, unsigned probe_interval,
+                                   int margin_db, unsigned duty_percent, uint32_t max_airtime_ms) :
+    _state(state), _dot(dot), _probe_interval(probe_interval ? probe_interval : 1),
+    _margin_db(margin_db), _duty_percent(duty_percent ? duty_percent : 100),
+    _max_airtime_ms(max_airtime_ms), _acked(false) {
+    if (!_state.valid || _state.dr < slowest() || _state.dr > mDot::SF_7) {
+        // start fast and let the first uplink, a probe, say otherwise
+        _state.valid = 1;
+        _state.dr = mDot::SF_7;
+        _state.since_probe = _probe_interval;
+        _state.missed = 0;
+        _state.snr_count = 0;
+    }
+
+    // the longest frame of each data rate, worked out here rather than by
+    // setting the radio to each rate and asking it
+    bool eu = _dot->getFrequencyBand() == mDot::FB_868;
+    for (uint8_t dr = mDot::SF_12; dr <= mDot::SF_7; dr++) {
+        size_t max = eu ? mDot::MaxLengths_868[dr] : mDot::MaxLengths_915[dr];
+        if (!eu) {
+            unsigned sf = 12 - (dr - mDot::SF_12);
+            while (max > 0 && airtime_ms(sf, max) > _max_airtime_ms)
+                max--;
+        }
+        _max_payload[dr] = max;
+    }
+}
+
+uint8_t UplinkController::slowest() const {
+    return _dot->getFrequencyBand() == mDot::FB_868 ? mDot::SF_12 : mDot::SF_10;
+}
+
+void UplinkController::begin() {
+    int32_t ret;
+    _state.airtime_ms = 0;
+    if ((ret = _dot->setTxDataRate(_state.dr)) != mDot::MDOT_OK)
+        logError("Failed to set SF %d:%s", ret, mDot::getReturnCodeString(ret).c_str());
+}
+
+size_t UplinkController::maxPayload(uint8_t dr) const {
+    return dr <= mDot::SF_7 ? _max_payload[dr] : 0;
+}
+
+size_t UplinkController::getMaxPayload() {
+    return maxPayload(_state.dr);
+}
+
+int32_t UplinkController::send(const uint8_t *data, size_t len, bool confirmed) {
+    uint8_t dr = _state.dr;
+    while (len > maxPayload(dr)) {
+        if (dr >= mDot::SF_7)
+            return mDot::MDOT_INVALID_PARAM;
+        dr++;
+    }
+    if (dr != _state.dr)
+        logInfo("%u byte frame needs %s", (unsigned)len, getDataRateName(dr));
+    _dot->setTxDataRate(dr);
+
+    // a confirmation asked for keeps track of the link, but only probes,
+    // spaced out, move the data rate
+    bool scheduled = _state.missed || _state.since_probe + 1u >= _probe_interval;
+    bool probe = scheduled || confirmed;
+    _dot->setAck(probe ? 1 : 0);
+
+    _frame.reserve(MAX_FRAME);     // once, on the first send since boot
+    _frame.assign(data, data + len);
+    int32_t ret = _dot->send(_frame);
+    _acked = probe && ret == mDot::MDOT_OK;
+    if (ret != mDot::MDOT_OK && ret != mDot::MDOT_TIMEOUT) {
+        // it did not go out: nothing learnt
+        _dot->setTxDataRate(_state.dr);
+        return ret;
+    }
+    _state.airtime_ms += _dot->getTimeOnAir(len);
+
+    if (!probe) {
+        if (_state.since_probe < 0xFF)
+            _state.since_probe++;
+    } else if (_acked) {
+        if (scheduled)
+            _state.since_probe = 0;
+        _state.missed = 0;
+        for (unsigned i = SNR_HISTORY - 1; i > 0; i--)
+            _state.snr[i] = _state.snr[i - 1];
+        _state.snr[0] = _dot->getSnrStats().last;
+        if (_state.snr_count < SNR_HISTORY)
+            _state.snr_count++;
+
+        // the best recent SNR, as LoRaWAN network servers do: fading only
+        // ever takes margin away
+        int best = _state.snr[0];
+        for (unsigned i = 1; i < _state.snr_count; i++)
+            if (_state.snr[i] > best)
+                best = _state.snr[i];
+        int floor = SNR_FLOOR_SF12 + SNR_FLOOR_STEP * (_state.dr - mDot::SF_12);
+        int spare = best * 10 / 4 - floor - _margin_db * 10;
+        int steps = spare >= 30 ? spare / 30 : spare < 0 ? -1 : 0;
+        if (scheduled && adapt(steps))
+            logInfo("SNR %d dB: %s", best / 4, getDataRateName(_state.dr));
+    } else {
+        // the SNR history is of a link that is no longer there
+        _state.since_probe = 0;
+        _state.snr_count = 0;
+        if (_state.missed < 0xFF)
+            _state.missed++;
+        if (scheduled && adapt(-1))
+            logInfo("Missed ack: %s", getDataRateName(_state.dr));
+    }
+    _dot->setTxDataRate(_state.dr);
+    return ret;
+}
+
+// true if the data rate changed
+bool UplinkController::adapt(int steps) {
+    int dr = _state.dr + steps;
+    if (dr > mDot::SF_7)
+        dr = mDot::SF_7;
+    if (dr < slowest())
+        dr = slowest();
+    if (dr == _state.dr)
+        return false;
+    _state.dr = dr;
+    return true;
+}
+
+bool UplinkController::wasAcked() const {
+    return _acked;
+}
+
+bool UplinkController::isUp() const {
+    return _state.missed == 0;
+}
+
+uint32_t UplinkController::getInterval(uint32_t min_s, unsigned cycles) {
+    unsigned duty = _duty_percent;
+    if (_dot->getFrequencyBand() == mDot::FB_868 && duty > 1)
+        duty = 1;
+    // the time on air spread over the cycles to the next uplink
+    uint32_t off_ms = _state.airtime_ms * (100 - duty) / duty;
+    uint32_t duty_s = (off_ms / (cycles ? cycles : 1) + 999) / 1000;
+    uint32_t band_s = (_dot->getNextTxMs() + 999) / 1000;
+    uint32_t s = min_s;
+    if (duty_s > s)
+        s = duty_s;
+    if (band_s > s)
+        s = band_s;
+    return s;
+}
+
+uint8_t UplinkController::getDataRate() const {
+    return _state.dr;
+}
+
+const char *UplinkController::getDataRateName(uint8_t dr) {
+    static const char *names[] = { "SF12", "SF11", "SF10", "SF9", "SF8", "SF7", "SF7H", "FSK" };
+    return dr < sizeof(names) / sizeof(names[0]) ? names[dr] : "?";
+}
@@ -0,0 +1,120 @@
+#ifndef UPLINK_CONTROLLER_H
+#define UPLINK_CONTROLLER_H
+
+#include "mDot.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/** Picks the data rate, frame size and send interval of each uplink.
+ *
+ * A node-side ADR: every probe_interval uplinks, and on every uplink after
+ * a missed acknowledgement until one comes, the frame goes out confirmed.
+ * The SNR the acknowledgement comes back with, against the demodulation
+ * floor of the spreading factor, tells how much margin the data rate
+ * leaves. Every 3 dB to spare over margin_db moves the data rate up a step;
+ * falling short of margin_db, or missing the acknowledgement, moves it down
+ * one. Unconfirmed uplinks tell nothing and change nothing; a frame
+ * confirmed on request updates the SNR history and the missed count but
+ * leaves the data rate to the probes.
+ *
+ * A frame longer than the data rate carries, or in US 915 than fits the
+ * max_airtime_ms dwell time, goes out at the slowest faster rate that
+ * takes it. The send interval is
+ * stretched so that time on air stays within duty_percent, or the 1% duty
+ * cycle of EU 868, on top of what the band enforces through getNextTxMs().
+ *
+ * @code
+ * UplinkController::State state;      // keep across deep sleep, zeroed at first
+ * UplinkController link(state, dot);
+ *
+ * link.begin();
+ * size_t n = build_frame(data, link.getMaxPayload());
+ * if (link.send(data, n) == mDot::MDOT_OK && link.wasAcked())
+ *     ...
+ * dot->sleep(link.getInterval(10), mDot::RTC_ALARM, true);
+ * @endcode
+ */
+class UplinkController {
+public:
+    enum {
+        SNR_HISTORY = 4,
+        MAX_FRAME = 255     // longest LoRaWAN payload of any data rate
+    };
+
+    /** What has to outlive the controller: plain data, fit for a user file. */
+    struct State {
+        uint8_t valid;          // dr has been picked
+        uint8_t dr;             // data rate the link margin allows
+        uint8_t since_probe;    // uplinks since the last confirmed one
+        uint8_t missed;         // acknowledgements missed in a row
+        uint8_t snr_count;      // entries of snr in use
+        int8_t snr[SNR_HISTORY];    // SNR of the last acknowledgements in quarter dB,
+                                    // as the radio reports it, newest first
+        uint16_t airtime_ms;    // time on air of this cycle's uplinks
+    };
+
+    /** Create a controller working on state, which must be zeroed before
+     * the first use.
+     *
+     * @param probe_interval  a confirmed uplink at least this often; 1 for all
+     * @param margin_db       link margin to keep over the demodulation floor
+     * @param duty_percent    time on air allowed, in percent of the time
+     * @param max_airtime_ms  longest time on air for one frame in US 915
+     */
+    UplinkController(State &state, mDot *dot, unsigned probe_interval = 8,
+                     int margin_db = 10, unsigned duty_percent = 1,
+                     uint32_t max_airtime_ms = 400);
+
+    /** Set the radio to the link's data rate, to start a cycle. */
+    void begin();
+
+    /** @returns the longest frame the link's data rate carries */
+    size_t getMaxPayload();
+
+    /** Send a frame at the link's data rate or faster, confirmed if it is
+     * time for a probe or if asked for, and learn from the outcome. The
+     * frame is copied into a buffer the controller keeps, so sending does
+     * not allocate.
+     *
+     * @returns what mDot::send() returned, or MDOT_INVALID_PARAM if no
+     *          data rate carries the frame
+     */
+    int32_t send(const uint8_t *data, size_t len, bool confirmed = false);
+
+    /** @returns true if the last frame sent was acknowledged */
+    bool wasAcked() const;
+
+    /** @returns false after a missed acknowledgement, until the next one */
+    bool isUp() const;
+
+    /** @param min_s   shortest interval wanted, in seconds
+     *  @param cycles  cycles until the next uplink, to spread its time on air
+     *  @returns seconds to sleep before the next cycle
+     */
+    uint32_t getInterval(uint32_t min_s, unsigned cycles = 1);
+
+    /** @returns the data rate the link margin allows */
+    uint8_t getDataRate() const;
+
+    /** @returns a data rate as "SF7" and so on */
+    static const char *getDataRateName(uint8_t dr);
+
+private:
+    uint8_t slowest() const;
+    size_t maxPayload(uint8_t dr) const;
+    bool adapt(int steps);
+
+    State &_state;
+    mDot *_dot;
+    unsigned _probe_interval;
+    int _margin_db;
+    unsigned _duty_percent;
+    uint32_t _max_airtime_ms;
+    bool _acked;
+    uint8_t _max_payload[mDot::SF_7 + 1];   // longest frame of each data rate
+    std::vector<uint8_t> _frame;    // what mDot::send() takes, reserved once
+};
+
+#endif
@@ -0,0 +1,29 @@
+/* mbed Microcontroller Library - host simulation target */
+#ifndef MBED_PERIPHERALNAMES_H
+#define MBED_PERIPHERALNAMES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    UART_1 = 1,
+    UART_2,
+    UART_6 = 6
+} UARTName;
+
+#define STDIO_UART_TX  PA_9
+#define STDIO_UART_RX  PA_10
+#define STDIO_UART     UART_1
+
+typedef enum {
+    I2C_1 = 1,
+    I2C_2,
+    I2C_3
+} I2CName;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,37 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * Stand-in for the STM32F4 CMSIS headers.  Only the core intrinsics that the
+ * firmware and libmDot headers actually touch are provided; they are routed
+ * into the simulator (see host/sim/sim.cpp).
+ */
+#ifndef MBED_CMSIS_H
+#define MBED_CMSIS_H
+
+#include <stdint.h>
+
+#define __I     volatile const
+#define __O     volatile
+#define __IO    volatile
+
+typedef int IRQn_Type;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void __WFI(void);
+void __WFE(void);
+void __SEV(void);
+void __NOP(void);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+uint32_t __get_IPSR(void);
+void NVIC_SystemReset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * Peripheral set of the simulated mDot: the pieces the firmware uses (GPIO,
+ * pin interrupts, I2C, serial, sleep) are backed by host/hal, the rest are
+ * switched off so their headers compile to nothing.
+ */
+#ifndef MBED_DEVICE_H
+#define MBED_DEVICE_H
+
+#define DEVICE_PORTIN           0
+#define DEVICE_PORTOUT          0
+#define DEVICE_PORTINOUT        0
+
+#define DEVICE_INTERRUPTIN      1
+
+#define DEVICE_ANALOGIN         0
+#define DEVICE_ANALOGOUT        0
+
+#define DEVICE_SERIAL           1
+
+#define DEVICE_I2C              1
+#define DEVICE_I2CSLAVE         0
+
+#define DEVICE_SPI              0
+#define DEVICE_SPISLAVE         0
+
+#define DEVICE_RTC              0
+
+#define DEVICE_PWMOUT           0
+
+#define DEVICE_SLEEP            1
+
+//=======================================
+
+#define DEVICE_SEMIHOST         0
+#define DEVICE_LOCALFILESYSTEM  0
+#define DEVICE_ID_LENGTH       24
+
+#define DEVICE_DEBUG_AWARENESS  0
+
+#define DEVICE_STDIO_MESSAGES   1
+
+#define DEVICE_ERROR_RED        0
+
+#include "objects.h"
+
+#endif
@@ -0,0 +1,34 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * Unlike the STM32 port, gpio_read()/gpio_write() are real calls here: every
+ * access is a simulator event that costs CPU time and can move a bus line.
+ */
+#ifndef MBED_GPIO_OBJECT_H
+#define MBED_GPIO_OBJECT_H
+
+#include "mbed_assert.h"
+#include "cmsis.h"
+#include "PortNames.h"
+#include "PeripheralNames.h"
+#include "PinNames.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    PinName  pin;
+    int      output;
+    int      value;
+    PinMode  mode;
+} gpio_t;
+
+static inline int gpio_is_connected(const gpio_t *obj) {
+    return obj->pin != (PinName)NC;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,51 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * HAL object layouts for the simulator.  Pins stay real PinName values from
+ * the mDot PinNames.h so that the firmware's pin map is used unchanged.
+ */
+#ifndef MBED_OBJECTS_H
+#define MBED_OBJECTS_H
+
+#include "cmsis.h"
+#include "PortNames.h"
+#include "PeripheralNames.h"
+#include "PinNames.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct gpio_irq_s {
+    PinName pin;
+    uint32_t id;
+    uint32_t event;     // IRQ_RISE/IRQ_FALL enable bits
+    uint32_t enabled;
+    void *hook;         // simulator line listener
+};
+
+struct serial_s {
+    UARTName uart;
+    uint32_t baudrate;
+    uint32_t databits;
+    uint32_t stopbits;
+    uint32_t parity;
+    PinName pin_tx;
+    PinName pin_rx;
+};
+
+struct i2c_s {
+    I2CName  i2c;
+    PinName  sda;
+    PinName  scl;
+    int      hz;
+    int      state;     // byte-level API: 0 idle, 1 after START, 2 addressed
+    void    *dev;       // simulator device addressed by the current transfer
+};
+
+#include "gpio_object.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
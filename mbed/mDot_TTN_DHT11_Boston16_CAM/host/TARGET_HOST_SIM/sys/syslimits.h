@@ -0,0 +1,11 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * FileBase.h expects the newlib <sys/syslimits.h>; glibc keeps the same
+ * limits in <limits.h>.
+ */
+#ifndef MBED_HOST_SYS_SYSLIMITS_H
+#define MBED_HOST_SYS_SYSLIMITS_H
+
+#include <limits.h>
+
+#endif
@@ -0,0 +1,122 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2013 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Host build: the FILE behind a Stream comes from glibc's fopencookie()
+ * instead of newlib's retargeted open(), and is unbuffered like on target.
+ */
+#include "Stream.h"
+
+#include <stdarg.h>
+
+namespace mbed {
+
+static ssize_t stream_cookie_read(void *cookie, char *buf, size_t size) {
+    return static_cast<FileHandle *>(cookie)->read(buf, size);
+}
+
+static ssize_t stream_cookie_write(void *cookie, const char *buf, size_t size) {
+    return static_cast<FileHandle *>(cookie)->write(buf, size);
+}
+
+Stream::Stream(const char *name) : FileLike(name), _file(NULL) {
+    cookie_io_functions_t io = { stream_cookie_read, stream_cookie_write, NULL, NULL };
+    _file = fopencookie(static_cast<FileHandle *>(this), "w+", io);
+    if (_file)
+        setvbuf(_file, NULL, _IONBF, 0);
+}
+
+Stream::~Stream() {
+    if (_file != NULL)
+        fclose(_file);
+}
+
+int Stream::putc(int c) {
+    fflush(_file);
+    return _putc(c);
+}
+int Stream::puts(const char *s) {
+    fflush(_file);
+    while (*s) {
+        _putc(*s++);
+    }
+    return 0;
+}
+int Stream::getc() {
+    fflush(_file);
+    return _getc();
+}
+char* Stream::gets(char *s, int size) {
+    return fgets(s, size, _file);
+}
+
+int Stream::close() {
+    return 0;
+}
+
+ssize_t Stream::write(const void* buffer, size_t length) {
+    const char* ptr = (const char*)buffer;
+    const char* end = ptr + length;
+    while (ptr != end) {
+        if (_putc(*ptr++) == EOF) {
+            break;
+        }
+    }
+    return ptr - (const char*)buffer;
+}
+
+ssize_t Stream::read(void* buffer, size_t length) {
+    char* ptr = (char*)buffer;
+    char* end = ptr + length;
+    while (ptr != end) {
+        int c = _getc();
+        if (c==EOF) break;
+        *ptr++ = c;
+    }
+    return ptr - (const char*)buffer;
+}
+
+off_t Stream::lseek(off_t offset, int whence) {
+    return 0;
+}
+
+int Stream::isatty() {
+    return 0;
+}
+
+int Stream::fsync() {
+    return 0;
+}
+
+off_t Stream::flen() {
+    return 0;
+}
+
+int Stream::printf(const char* format, ...) {
+    va_list arg;
+    va_start(arg, format);
+    int r = vfprintf(_file, format, arg);
+    va_end(arg);
+    return r;
+}
+
+int Stream::scanf(const char* format, ...) {
+    va_list arg;
+    va_start(arg, format);
+    int r = vfscanf(_file, format, arg);
+    va_end(arg);
+    return r;
+}
+
+} // namespace mbed
@@ -0,0 +1,36 @@
+/* mbed Microcontroller Library - host simulation target */
+#include "handle.h"
+
+#include <vector>
+
+namespace mbed {
+
+static std::vector<void *> &handles() {
+    static std::vector<void *> table(1, (void *)0);     // id 0 is never valid
+    return table;
+}
+
+uint32_t host_handle_alloc(void *obj) {
+    std::vector<void *> &t = handles();
+    for (uint32_t id = 1; id < t.size(); id++) {
+        if (t[id] == 0) {
+            t[id] = obj;
+            return id;
+        }
+    }
+    t.push_back(obj);
+    return (uint32_t)(t.size() - 1);
+}
+
+void host_handle_free(uint32_t id) {
+    std::vector<void *> &t = handles();
+    if (id < t.size())
+        t[id] = 0;
+}
+
+void *host_handle_get(uint32_t id) {
+    std::vector<void *> &t = handles();
+    return id < t.size() ? t[id] : 0;
+}
+
+} // namespace mbed
@@ -0,0 +1,20 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * The HAL passes object pointers around as uint32_t ids, which does not fit
+ * a 64-bit host.  Objects that register with the HAL get a small integer id
+ * from this table instead.
+ */
+#ifndef MBED_HOST_HANDLE_H
+#define MBED_HOST_HANDLE_H
+
+#include <stdint.h>
+
+namespace mbed {
+
+uint32_t host_handle_alloc(void *obj);
+void host_handle_free(uint32_t id);
+void *host_handle_get(uint32_t id);
+
+} // namespace mbed
+
+#endif
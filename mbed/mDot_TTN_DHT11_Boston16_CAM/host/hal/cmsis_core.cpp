@@ -0,0 +1,45 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * Cortex-M core intrinsics used by the firmware, the RTOS headers and
+ * libmDot, mapped onto the simulator.
+ */
+#include "cmsis.h"
+#include "sim.h"
+
+void __WFI(void) {
+    sim::wait_for_interrupt(sim::CPU_SLEEP);
+}
+
+void __WFE(void) {
+    sim::wait_for_interrupt(sim::CPU_SLEEP);
+}
+
+void __SEV(void) {
+}
+
+void __NOP(void) {
+}
+
+void __disable_irq(void) {
+    sim::irq_mask(true);
+}
+
+void __enable_irq(void) {
+    sim::irq_mask(false);
+}
+
+uint32_t __get_PRIMASK(void) {
+    return sim::irq_masked() ? 1 : 0;
+}
+
+void __set_PRIMASK(uint32_t primask) {
+    sim::irq_mask(primask & 1);
+}
+
+uint32_t __get_IPSR(void) {
+    return sim::in_isr() ? 15 : 0;
+}
+
+void NVIC_SystemReset(void) {
+    sim::stop("system reset requested");
+}
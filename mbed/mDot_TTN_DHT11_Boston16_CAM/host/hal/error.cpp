@@ -0,0 +1,29 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * error(), mbed_die() and failed MBED_ASSERTs end the simulation instead of
+ * blinking LEDs.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "mbed_assert.h"
+#include "mbed_error.h"
+#include "mbed_interface.h"
+#include "sim.h"
+
+void error(const char* format, ...) {
+    va_list arg;
+    va_start(arg, format);
+    vfprintf(stderr, format, arg);
+    va_end(arg);
+    sim::stop("error() called by firmware");
+}
+
+void mbed_die(void) {
+    sim::stop("mbed_die() called by firmware");
+}
+
+void mbed_assert_internal(const char *expr, const char *file, int line) {
+    fprintf(stderr, "mbed assertation failed: %s, file: %s, line %d \n", expr, file, line);
+    sim::stop("MBED_ASSERT failed");
+}
@@ -0,0 +1,93 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * GPIO on simulated lines.  Register accesses cost a few core cycles each,
+ * which is what makes bit-banged protocols take time in the simulator.
+ */
+#include "gpio_api.h"
+#include "line.h"
+#include "power.h"
+
+using sim::Line;
+
+uint32_t gpio_set(PinName pin) {
+    return 1u << STM_PIN(pin);
+}
+
+void gpio_init(gpio_t *obj, PinName pin) {
+    obj->pin = pin;
+    obj->output = 0;
+    obj->value = 0;
+    obj->mode = PullNone;
+    if (pin == (PinName)NC)
+        return;
+    Line::get(pin).mcu_config(false, PullNone);
+}
+
+void gpio_mode(gpio_t *obj, PinMode mode) {
+    obj->mode = mode;
+    sim::busy(sim::power::GPIO_CONFIG_NS);
+    Line::get(obj->pin).mcu_config(obj->output != 0, mode);
+}
+
+void gpio_dir(gpio_t *obj, PinDirection direction) {
+    obj->output = (direction == PIN_OUTPUT);
+    sim::busy(sim::power::GPIO_CONFIG_NS);
+    Line::get(obj->pin).mcu_config(obj->output != 0, obj->mode);
+}
+
+void gpio_write(gpio_t *obj, int value) {
+    MBED_ASSERT(obj->pin != (PinName)NC);
+    obj->value = value ? 1 : 0;
+    sim::busy(sim::power::GPIO_WRITE_NS);
+    Line::get(obj->pin).mcu_write(obj->value);
+}
+
+int gpio_read(gpio_t *obj) {
+    MBED_ASSERT(obj->pin != (PinName)NC);
+    return Line::get(obj->pin).mcu_read();
+}
+
+/* the generic helpers from mbed's common/gpio.c */
+
+static inline void _gpio_init_in(gpio_t *gpio, PinName pin, PinMode mode) {
+    gpio_init(gpio, pin);
+    if (pin != NC) {
+        gpio_dir(gpio, PIN_INPUT);
+        gpio_mode(gpio, mode);
+    }
+}
+
+static inline void _gpio_init_out(gpio_t *gpio, PinName pin, PinMode mode, int value) {
+    gpio_init(gpio, pin);
+    if (pin != NC) {
+        gpio_write(gpio, value);
+        gpio_dir(gpio, PIN_OUTPUT);
+        gpio_mode(gpio, mode);
+    }
+}
+
+void gpio_init_in(gpio_t *gpio, PinName pin) {
+    gpio_init_in_ex(gpio, pin, PullDefault);
+}
+
+void gpio_init_in_ex(gpio_t *gpio, PinName pin, PinMode mode) {
+    _gpio_init_in(gpio, pin, mode);
+}
+
+void gpio_init_out(gpio_t *gpio, PinName pin) {
+    gpio_init_out_ex(gpio, pin, 0);
+}
+
+void gpio_init_out_ex(gpio_t *gpio, PinName pin, int value) {
+    _gpio_init_out(gpio, pin, PullNone, value);
+}
+
+void gpio_init_inout(gpio_t *gpio, PinName pin, PinDirection direction, PinMode mode, int value) {
+    if (direction == PIN_INPUT) {
+        _gpio_init_in(gpio, pin, mode);
+        if (pin != NC)
+            gpio_write(gpio, value); // we prepare the value in case it is switched later
+    } else {
+        _gpio_init_out(gpio, pin, mode, value);
+    }
+}
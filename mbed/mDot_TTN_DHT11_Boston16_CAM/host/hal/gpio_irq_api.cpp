@@ -0,0 +1,92 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * EXTI on simulated lines: an edge on the line sets the pending flag and the
+ * handler runs in interrupt context after the core's entry latency, not from
+ * inside the line change.  That keeps a sensor model that pulls a line from
+ * being re-entered by the firmware's reaction before its own update is done.
+ */
+#include "gpio_irq_api.h"
+#include "line.h"
+#include "sim.h"
+
+namespace {
+
+// exception entry plus the mbed EXTI dispatch, at 96 MHz
+static const sim::time_ns IRQ_LATENCY = 1 * sim::US;
+
+class IrqHook : public sim::LineListener {
+public:
+    IrqHook(gpio_irq_t *obj, gpio_irq_handler handler) :
+        _obj(obj), _handler(handler), _level(sim::Line::get(obj->pin).level()),
+        _pending(0), _dispatch(this, &IrqHook::dispatch) {
+    }
+
+    virtual void line_changed(sim::Line &line) {
+        int level = line.level();
+        if (level == _level)
+            return;
+        _level = level;
+        gpio_irq_event event = level ? IRQ_RISE : IRQ_FALL;
+        if (!_obj->enabled || !(_obj->event & (1u << event)))
+            return;
+        _pending |= 1u << event;
+        if (!_dispatch.pending())
+            _dispatch.schedule_in(IRQ_LATENCY);
+    }
+
+private:
+    void dispatch() {
+        unsigned pending = _pending;
+        _pending = 0;
+        sim::touch();
+        if (pending & (1u << IRQ_FALL))
+            _handler(_obj->id, IRQ_FALL);
+        if (pending & (1u << IRQ_RISE))
+            _handler(_obj->id, IRQ_RISE);
+    }
+
+    gpio_irq_t *_obj;
+    gpio_irq_handler _handler;
+    int _level;
+    unsigned _pending;
+    sim::MemberEvent<IrqHook> _dispatch;
+};
+
+} // namespace
+
+int gpio_irq_init(gpio_irq_t *obj, PinName pin, gpio_irq_handler handler, uint32_t id) {
+    if (pin == NC)
+        return -1;
+    obj->pin = pin;
+    obj->id = id;
+    obj->event = 0;
+    obj->enabled = 1;
+    IrqHook *hook = new IrqHook(obj, handler);
+    obj->hook = hook;
+    sim::Line::get(pin).add_listener(hook);
+    return 0;
+}
+
+void gpio_irq_free(gpio_irq_t *obj) {
+    IrqHook *hook = static_cast<IrqHook *>(obj->hook);
+    if (!hook)
+        return;
+    sim::Line::get(obj->pin).remove_listener(hook);
+    delete hook;
+    obj->hook = 0;
+}
+
+void gpio_irq_set(gpio_irq_t *obj, gpio_irq_event event, uint32_t enable) {
+    if (enable)
+        obj->event |= 1u << event;
+    else
+        obj->event &= ~(1u << event);
+}
+
+void gpio_irq_enable(gpio_irq_t *obj) {
+    obj->enabled = 1;
+}
+
+void gpio_irq_disable(gpio_irq_t *obj) {
+    obj->enabled = 0;
+}
@@ -0,0 +1,126 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * Polled I2C master.  Transfers are byte-accurate against the simulated
+ * devices and keep the CPU busy for their duration on the wire: a START,
+ * nine SCL periods per byte (address included) and a STOP.
+ */
+#include "i2c_api.h"
+#include "i2c_device.h"
+
+using sim::I2CDevice;
+
+static sim::time_ns bit_time(i2c_t *obj) {
+    return sim::SEC / (obj->hz ? obj->hz : 100000);
+}
+
+static void bus_time(i2c_t *obj, unsigned bits) {
+    sim::time_ns t = bits * bit_time(obj);
+    sim::i2c_bus(obj->sda).transfer(t);
+    sim::busy(t);
+}
+
+void i2c_init(i2c_t *obj, PinName sda, PinName scl) {
+    obj->i2c = I2C_3;
+    obj->sda = sda;
+    obj->scl = scl;
+    obj->hz = 100000;
+    obj->state = 0;
+    obj->dev = 0;
+    sim::i2c_bus(sda);
+}
+
+void i2c_frequency(i2c_t *obj, int hz) {
+    obj->hz = hz;
+}
+
+void i2c_reset(i2c_t *obj) {
+    obj->state = 0;
+    obj->dev = 0;
+}
+
+static I2CDevice *address(i2c_t *obj, int address) {
+    I2CDevice *dev = I2CDevice::find(obj->sda, (address >> 1) & 0x7F);
+    bus_time(obj, 1 + 9);
+    if (dev)
+        dev->i2c_start(address & 1);
+    obj->dev = dev;
+    return dev;
+}
+
+static void finish(i2c_t *obj, int stop) {
+    if (!stop)
+        return;
+    bus_time(obj, 1);
+    sim::i2c_bus(obj->sda).transaction();
+    if (obj->dev)
+        static_cast<I2CDevice *>(obj->dev)->i2c_stop();
+    obj->dev = 0;
+    obj->state = 0;
+}
+
+int i2c_write(i2c_t *obj, int addr, const char *data, int length, int stop) {
+    I2CDevice *dev = address(obj, addr & ~1);
+    if (!dev) {
+        finish(obj, 1);
+        return I2C_ERROR_NO_SLAVE;
+    }
+    int count;
+    for (count = 0; count < length; count++) {
+        bus_time(obj, 9);
+        if (!dev->i2c_write((uint8_t)data[count])) {
+            finish(obj, 1);
+            return count;
+        }
+    }
+    finish(obj, stop);
+    return length;
+}
+
+int i2c_read(i2c_t *obj, int addr, char *data, int length, int stop) {
+    I2CDevice *dev = address(obj, addr | 1);
+    if (!dev) {
+        finish(obj, 1);
+        return I2C_ERROR_NO_SLAVE;
+    }
+    for (int count = 0; count < length; count++) {
+        bus_time(obj, 9);
+        data[count] = (char)dev->i2c_read();
+    }
+    finish(obj, stop);
+    return length;
+}
+
+/* byte-level API used by I2C::start()/stop()/read(ack)/write(data) */
+
+int i2c_start(i2c_t *obj) {
+    bus_time(obj, 1);
+    obj->state = 1;
+    return 0;
+}
+
+int i2c_stop(i2c_t *obj) {
+    obj->state = 1;
+    finish(obj, 1);
+    return 0;
+}
+
+int i2c_byte_read(i2c_t *obj, int last) {
+    bus_time(obj, 9);
+    I2CDevice *dev = static_cast<I2CDevice *>(obj->dev);
+    return dev ? dev->i2c_read() : 0xFF;
+}
+
+int i2c_byte_write(i2c_t *obj, int data) {
+    bus_time(obj, 9);
+    if (obj->state == 1) {
+        I2CDevice *dev = I2CDevice::find(obj->sda, (data >> 1) & 0x7F);
+        obj->dev = dev;
+        obj->state = 2;
+        if (!dev)
+            return 0;
+        dev->i2c_start(data & 1);
+        return 1;
+    }
+    I2CDevice *dev = static_cast<I2CDevice *>(obj->dev);
+    return dev && dev->i2c_write((uint8_t)data) ? 1 : 0;
+}
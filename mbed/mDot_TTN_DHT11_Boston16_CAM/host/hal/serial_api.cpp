@@ -0,0 +1,90 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * Polled UART transmit: each character keeps the CPU busy for one frame time
+ * at the configured baud rate and is echoed to the host's stdout (unless the
+ * simulator runs with -q).  Nothing is ever received.
+ */
+#include <stdio.h>
+
+#include "serial_api.h"
+#include "sim.h"
+
+static sim::Bus &uart_bus() {
+    static sim::Bus bus("uart", 0, false);
+    return bus;
+}
+
+// the USART registers are shared by every serial_t on the same pins
+static uint32_t uart_baud[7] = { 9600, 9600, 9600, 9600, 9600, 9600, 9600 };
+
+static UARTName uart_for(PinName tx) {
+    switch (tx) {
+        case PA_2:  return UART_2;
+        default:    return UART_1;
+    }
+}
+
+void serial_init(serial_t *obj, PinName tx, PinName rx) {
+    obj->uart = uart_for(tx);
+    obj->baudrate = uart_baud[obj->uart];
+    obj->databits = 8;
+    obj->stopbits = 1;
+    obj->parity = ParityNone;
+    obj->pin_tx = tx;
+    obj->pin_rx = rx;
+}
+
+void serial_free(serial_t *obj) {
+}
+
+void serial_baud(serial_t *obj, int baudrate) {
+    obj->baudrate = baudrate;
+    uart_baud[obj->uart] = baudrate;
+}
+
+void serial_format(serial_t *obj, int data_bits, SerialParity parity, int stop_bits) {
+    obj->databits = data_bits;
+    obj->parity = parity;
+    obj->stopbits = stop_bits;
+}
+
+void serial_irq_handler(serial_t *obj, uart_irq_handler handler, uint32_t id) {
+}
+
+void serial_irq_set(serial_t *obj, SerialIrq irq, uint32_t enable) {
+}
+
+int serial_getc(serial_t *obj) {
+    sim::stop("firmware blocked reading serial input, which the simulator does not provide");
+    return -1;
+}
+
+void serial_putc(serial_t *obj, int c) {
+    uint32_t baud = uart_baud[obj->uart];
+    uint32_t bits = 1 + obj->databits + obj->stopbits + (obj->parity != ParityNone);
+    sim::time_ns frame = (sim::time_ns)bits * sim::SEC / (baud ? baud : 9600);
+    uart_bus().transfer(frame);
+    sim::busy(frame);
+    if (!sim::options().quiet)
+        putchar(c);
+}
+
+int serial_readable(serial_t *obj) {
+    return 0;
+}
+
+int serial_writable(serial_t *obj) {
+    return 1;
+}
+
+void serial_clear(serial_t *obj) {
+}
+
+void serial_break_set(serial_t *obj) {
+}
+
+void serial_break_clear(serial_t *obj) {
+}
+
+void serial_pinout_tx(PinName tx) {
+}
@@ -0,0 +1,16 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * Both modes wait for the next interrupt; the difference is only the supply
+ * current charged meanwhile.  Unlike STOP mode on the STM32, the us ticker
+ * keeps counting through deepsleep().
+ */
+#include "sleep_api.h"
+#include "sim.h"
+
+void sleep(void) {
+    sim::wait_for_interrupt(sim::CPU_SLEEP);
+}
+
+void deepsleep(void) {
+    sim::wait_for_interrupt(sim::CPU_DEEPSLEEP);
+}
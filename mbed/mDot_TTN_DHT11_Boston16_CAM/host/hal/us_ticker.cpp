@@ -0,0 +1,65 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * The 32-bit microsecond ticker (TIM5 on the STM32F411) is a view of the
+ * simulator clock; the compare interrupt is a simulator event.
+ */
+#include "us_ticker_api.h"
+#include "sim.h"
+
+static void us_ticker_fire(void *) {
+    sim::touch();
+    us_ticker_irq_handler();
+}
+
+static sim::FunctionEvent &us_ticker_alarm() {
+    static sim::FunctionEvent alarm(us_ticker_fire, 0);
+    return alarm;
+}
+
+static const ticker_interface_t us_interface = {
+    us_ticker_init,
+    us_ticker_read,
+    us_ticker_disable_interrupt,
+    us_ticker_clear_interrupt,
+    us_ticker_set_interrupt,
+};
+
+static ticker_event_queue_t events;
+
+static const ticker_data_t us_data = {
+    &us_interface,
+    &events,
+};
+
+const ticker_data_t *get_us_ticker_data(void) {
+    return &us_data;
+}
+
+void us_ticker_irq_handler(void) {
+    ticker_irq_handler(&us_data);
+}
+
+void us_ticker_init(void) {
+}
+
+uint32_t us_ticker_read(void) {
+    // code that watches the clock is not a pure polling spin
+    sim::touch();
+    return (uint32_t)(sim::now() / sim::US);
+}
+
+void us_ticker_set_interrupt(timestamp_t timestamp) {
+    sim::time_ns now_us = sim::now() / sim::US;
+    int32_t delta = (int32_t)(timestamp - (uint32_t)now_us);
+    if (delta <= 0)
+        us_ticker_alarm().schedule_at(sim::now());
+    else
+        us_ticker_alarm().schedule_at((now_us + (uint32_t)delta) * sim::US);
+}
+
+void us_ticker_disable_interrupt(void) {
+    us_ticker_alarm().cancel();
+}
+
+void us_ticker_clear_interrupt(void) {
+}
@@ -0,0 +1,20 @@
+/* mbed Microcontroller Library - host simulation target
+ *
+ * wait_us() spins on the us ticker on the real part, so it is simulated as
+ * busy CPU time; interrupts (and other threads) still run meanwhile.
+ */
+#include "wait_api.h"
+#include "sim.h"
+
+void wait(float s) {
+    wait_us(s * 1000000.0f);
+}
+
+void wait_ms(int ms) {
+    wait_us(ms * 1000);
+}
+
+void wait_us(int us) {
+    if (us > 0)
+        sim::busy((sim::time_ns)us * sim::US);
+}
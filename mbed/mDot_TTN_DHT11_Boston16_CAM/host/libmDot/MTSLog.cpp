@@ -0,0 +1,78 @@
+/* libmDot for the host simulator - MTSLog
+ *
+ * The mDot library logs through the C library's stdout, which the mbed
+ * retarget layer sends out of the debug UART.  Here the formatted message is
+ * written character by character to the same UART so that it costs the
+ * firmware the same time on the wire as it does on the board.
+ */
+#include "MTSLog.h"
+#include "serial_api.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+using namespace mts;
+
+int MTSLog::currentLevel = MTSLog::WARNING_LEVEL;
+
+const char* MTSLog::NONE_LABEL = "NONE";
+const char* MTSLog::FATAL_LABEL = "FATAL";
+const char* MTSLog::ERROR_LABEL = "ERROR";
+const char* MTSLog::WARNING_LABEL = "WARNING";
+const char* MTSLog::INFO_LABEL = "INFO";
+const char* MTSLog::DEBUG_LABEL = "DEBUG";
+const char* MTSLog::TRACE_LABEL = "TRACE";
+
+static serial_t *stdio_uart() {
+    static serial_t uart;
+    static bool ready = false;
+    if (!ready) {
+        serial_init(&uart, USBTX, USBRX);
+        ready = true;
+    }
+    return &uart;
+}
+
+void MTSLog::printMessage(int level, const char* format, ...) {
+    if (!printable(level))
+        return;
+
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    serial_t *uart = stdio_uart();
+    for (const char *p = buf; *p; p++)
+        serial_putc(uart, *p);
+}
+
+bool MTSLog::printable(int level) {
+    return level <= currentLevel;
+}
+
+void MTSLog::setLogLevel(int level) {
+    if (level < NONE_LEVEL)
+        currentLevel = NONE_LEVEL;
+    else if (level > TRACE_LEVEL)
+        currentLevel = TRACE_LEVEL;
+    else
+        currentLevel = level;
+}
+
+int MTSLog::getLogLevel() {
+    return currentLevel;
+}
+
+const char* MTSLog::getLogLevelString() {
+    switch (currentLevel) {
+        case FATAL_LEVEL:   return FATAL_LABEL;
+        case ERROR_LEVEL:   return ERROR_LABEL;
+        case WARNING_LEVEL: return WARNING_LABEL;
+        case INFO_LEVEL:    return INFO_LABEL;
+        case DEBUG_LEVEL:   return DEBUG_LABEL;
+        case TRACE_LEVEL:   return TRACE_LABEL;
+        default:            return NONE_LABEL;
+    }
+}
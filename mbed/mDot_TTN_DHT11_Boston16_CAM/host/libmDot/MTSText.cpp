@@ -0,0 +1,89 @@
+/* libmDot for the host simulator - MTSText
+ *
+ * The string helpers from MTS-Utils that the firmware links against.
+ */
+#include "MTSText.h"
+
+#include <ctype.h>
+#include <stdio.h>
+
+using namespace mts;
+
+std::string Text::getLine(const std::string& source, const size_t& start, size_t& cursor) {
+    char delimiters[2] = { '\r', '\n' };
+    size_t end = source.find_first_of(delimiters, start, 2);
+    if (end == std::string::npos) {
+        cursor = std::string::npos;
+        return "";
+    }
+    std::string line = source.substr(start, end - start);
+    cursor = end + 1;
+    if (cursor < source.size() && source[end] == '\r' && source[cursor] == '\n')
+        cursor++;
+    return line;
+}
+
+std::vector<std::string> Text::split(const std::string& str, char delimiter, int limit) {
+    return split(str, std::string(1, delimiter), limit);
+}
+
+std::vector<std::string> Text::split(const std::string& str, const std::string& delimiter, int limit) {
+    std::vector<std::string> result;
+    size_t start = 0;
+    size_t end;
+    while ((end = str.find(delimiter, start)) != std::string::npos &&
+            (limit <= 0 || (int)result.size() < limit - 1)) {
+        result.push_back(str.substr(start, end - start));
+        start = end + delimiter.size();
+    }
+    result.push_back(str.substr(start));
+    return result;
+}
+
+std::string Text::readString(char* index, int length) {
+    return std::string(index, length);
+}
+
+std::string Text::toUpper(const std::string str) {
+    std::string upper = str;
+    for (size_t i = 0; i < upper.size(); i++)
+        upper[i] = (char)toupper(upper[i]);
+    return upper;
+}
+
+std::string Text::float2String(double val, int precision) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", precision, val);
+    return buf;
+}
+
+std::string Text::bin2hexString(const std::vector<uint8_t>& data, const char* delim, bool leadingZeros) {
+    return bin2hexString(data.empty() ? NULL : &data[0], data.size(), delim, leadingZeros);
+}
+
+std::string Text::bin2hexString(const uint8_t* data, const uint32_t len, const char* delim, bool leadingZeros) {
+    std::string str;
+    char buf[8];
+    for (uint32_t i = 0; i < len; i++) {
+        if (i > 0)
+            str.append(delim);
+        snprintf(buf, sizeof(buf), leadingZeros ? "0x%02x" : "%02x", data[i]);
+        str.append(buf);
+    }
+    return str;
+}
+
+void Text::ltrim(std::string& str, const char* args) {
+    size_t pos = str.find_first_not_of(args);
+    str.erase(0, pos == std::string::npos ? str.size() : pos);
+}
+
+void Text::rtrim(std::string& str, const char* args) {
+    size_t pos = str.find_last_not_of(args);
+    str.erase(pos == std::string::npos ? 0 : pos + 1);
+}
+
+void Text::trim(std::string& str, const char* args) {
+    ltrim(str, args);
+    rtrim(str, args);
+}
@@ -0,0 +1,834 @@
+/* libmDot for the host simulator
+ *
+ * Stands in for MultiTech's binary-only libmDot with the parts of mDot's API
+ * the firmware uses.  Configuration is kept in memory; send() runs an ABP
+ * class A uplink against a model of the SX1272: transmit for the LoRa time
+ * on air, then the RX1 and RX2 windows 1 s and 2 s after the end of the
+ * transmission, with the calling thread blocked (the CPU idles in the mDot
+ * idle thread meanwhile).  EU868 adds the 1% duty cycle; link loss comes
+ * from the scenario, as a loss rate and as an SNR that the slower spreading
+ * factors can go further below.
+ *
+ * Flash (the saved configuration and the user files) lives in the process
+ * and survives sleep(), which like the real library only knows deep sleep:
+ * the module is torn down, the core spends the interval in standby and the
+ * firmware starts again from main().
+ *
+ * What the library allocates for itself is not known, so the stand-in's own
+ * memory is kept out of the firmware's heap count; what it hands back to
+ * the firmware by value is counted.
+ */
+#include "mDot.h"
+#include "MTSLog.h"
+#include "sim.h"
+#include "power.h"
+#include "scenario.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+
+using namespace mts;
+
+// MAC work around a transmission: frame build, AES-CTR/CMAC and SPI setup
+// of the radio before TX, and downlink handling after each RX window.
+static const sim::time_ns MAC_TX_PREP   = 2 * sim::MS;
+static const sim::time_ns MAC_RX_HANDLE = 500 * sim::US;
+static const sim::time_ns RX_MARGIN     = 3 * sim::MS;
+
+// SPI flash file system: a page program with its metadata update, a read
+static const sim::time_ns FLASH_WRITE   = 5 * sim::MS;
+static const sim::time_ns FLASH_READ    = 500 * sim::US;
+
+// SPIFFS writes copy-on-write in 256-byte logical pages, and every write
+// rewrites the file's index page too
+static const size_t FLASH_PAGE = 256;
+static const unsigned MAX_OPEN_FILES = 4;
+
+const uint8_t mDot::MaxLengths_915[] = { 0, 0, 11, 53, 125, 242, 242, 0 };
+const uint8_t mDot::MaxLengths_868[] = { 51, 51, 51, 115, 222, 222, 222, 222 };
+
+mDot* mDot::_instance = NULL;
+
+class LoRaConfig {
+public:
+    LoRaConfig() {
+        reset();
+    }
+
+    void reset() {
+        network_name = "";
+        network_addr.assign(4, 0);
+        network_session_key.assign(16, 0);
+        data_session_key.assign(16, 0);
+        public_network = false;
+        join_mode = mDot::MANUAL;
+        join_byte_order = mDot::LSB;
+        join_retries = 2;
+        link_check_count = 0;
+        link_check_threshold = 5;
+        frequency_sub_band = 0;
+        tx_data_rate = mDot::SF_10;
+        tx_power = 11;
+        tx_wait = true;
+        crc = true;
+        ack = 0;
+        adr = false;
+        log_level = MTSLog::INFO_LEVEL;
+    }
+
+    std::string network_name;
+    std::vector<uint8_t> network_addr;
+    std::vector<uint8_t> network_session_key;
+    std::vector<uint8_t> data_session_key;
+    bool public_network;
+    uint8_t join_mode;
+    uint8_t join_byte_order;
+    uint8_t join_retries;
+    uint8_t link_check_count;
+    uint8_t link_check_threshold;
+    uint8_t frequency_sub_band;
+    uint8_t tx_data_rate;
+    uint32_t tx_power;
+    bool tx_wait;
+    bool crc;
+    uint8_t ack;
+    bool adr;
+    uint8_t log_level;
+};
+
+// what the module keeps in flash across a reset
+struct Flash {
+    bool config_saved;
+    LoRaConfig config;
+    std::map<std::string, std::vector<uint8_t> > files;
+
+    Flash() : config_saved(false) {}
+
+    static Flash &get() {
+        static Flash flash;
+        return flash;
+    }
+};
+
+class MdotRadio {
+public:
+    MdotRadio() : load("radio"), alarm(&MdotRadio::done, this), busy(0),
+        band_free(0), joined(false), up_counter(0) {
+    }
+
+    /** Block the calling thread for dt of radio activity drawing mA. */
+    void run(sim::time_ns dt, double mA) {
+        load.set(mA);
+        alarm.schedule_in(dt);
+        busy.wait();
+        load.set(0);
+    }
+
+    /** Block the calling thread with the radio asleep. */
+    void pause(sim::time_ns dt) {
+        alarm.schedule_in(dt);
+        busy.wait();
+    }
+
+    static void done(void *arg) {
+        static_cast<MdotRadio *>(arg)->busy.release();
+    }
+
+    sim::Load load;
+    sim::FunctionEvent alarm;
+    rtos::Semaphore busy;
+    sim::time_ns band_free;
+    bool joined;
+    uint32_t up_counter;
+};
+
+/* LoRa modulation */
+
+struct Modulation {
+    int sf;         // 0 for FSK
+    uint32_t bw;
+};
+
+static bool eu() {
+    return sim::options().band == 868;
+}
+
+static Modulation modulation(uint8_t dr) {
+    Modulation m;
+    m.bw = 125000;
+    switch (dr) {
+        case mDot::SF_12: m.sf = 12; break;
+        case mDot::SF_11: m.sf = 11; break;
+        case mDot::SF_10: m.sf = 10; break;
+        case mDot::SF_9:  m.sf = 9;  break;
+        case mDot::SF_8:  m.sf = 8;  break;
+        case mDot::SF_7:  m.sf = 7;  break;
+        case mDot::SF_7H:
+            // EU DR6 is SF7/250 kHz; US DR4 is SF8/500 kHz
+            m.sf = eu() ? 7 : 8;
+            m.bw = eu() ? 250000 : 500000;
+            break;
+        default:
+            m.sf = 0;
+            m.bw = 0;
+            break;
+    }
+    return m;
+}
+
+static double symbol_s(const Modulation &m) {
+    return (double)(1 << m.sf) / (double)m.bw;
+}
+
+// Semtech AN1200.13: explicit header, CRC on, coding rate 4/5
+static sim::time_ns airtime(const Modulation &m, unsigned phy_len) {
+    if (m.sf == 0) {
+        // 50 kbps FSK: preamble, sync word, length, payload, CRC
+        return (sim::time_ns)((5 + 3 + 1 + phy_len + 2) * 8 * (double)sim::SEC / 50000.0);
+    }
+    int de = m.sf >= 11 && m.bw == 125000;
+    double num = 8.0 * phy_len - 4.0 * m.sf + 28 + 16;
+    double n = ceil(num / (4.0 * (m.sf - 2 * de))) * 5;
+    double symbols = 8 + 4.25 + 8 + (n > 0 ? n : 0);
+    return (sim::time_ns)(symbols * symbol_s(m) * (double)sim::SEC);
+}
+
+// a receive window stays open for about 8 symbols when nothing arrives
+static sim::time_ns rx_window(const Modulation &m) {
+    return (sim::time_ns)(8 * symbol_s(m) * (double)sim::SEC) + RX_MARGIN;
+}
+
+static Modulation rx1_modulation(uint8_t dr) {
+    Modulation m = modulation(dr);
+    if (!eu() && m.sf) {
+        // US915 answers on the 500 kHz downlink channels
+        m.bw = 500000;
+        if (m.sf == 8 && dr == mDot::SF_7H)
+            m.sf = 7;
+    }
+    return m;
+}
+
+static Modulation rx2_modulation() {
+    Modulation m;
+    // TTN: EU868 RX2 is SF9/125 kHz, US915 RX2 is SF12/500 kHz
+    m.sf = eu() ? 9 : 12;
+    m.bw = eu() ? 125000 : 500000;
+    return m;
+}
+
+// Chance of losing a frame sent at modulation m: the scenario's loss rate,
+// and the link SNR (at 125 kHz) against the demodulation floor of the
+// spreading factor, falling off over about a dB either side of it.
+static double loss(const Modulation &m) {
+    double p = sim::scenario("radio.loss", 0);
+    if (m.sf == 0)
+        return p;
+    double floor = -20.0 + 2.5 * (12 - m.sf);
+    double snr = sim::scenario("radio.snr", 7) - 10.0 * log10((double)m.bw / 125000.0);
+    double below = 1.0 / (1.0 + exp(snr - floor));
+    return 1.0 - (1.0 - p) * (1.0 - below);
+}
+
+// LoRaWAN MHDR + FHDR + FPort + MIC around the application payload
+static unsigned phy_length(size_t payload) {
+    return 13 + payload;
+}
+
+/* construction and configuration */
+
+mDot::mDot() :
+    _mac(NULL), _radio(new MdotRadio), _events(NULL), _config(new LoRaConfig),
+    _idle_thread(idle, NULL, osPriorityIdle), _activity_led_state(OFF),
+    _activity_led(NULL), _activity_led_enable(false), _activity_led_pin(NC),
+    _activity_led_external(false), _linkFailCount(0), _class(0), _wakeup(NULL),
+    _wakeup_pin(NC) {
+    memset(&_stats, 0, sizeof(_stats));
+    if (Flash::get().config_saved)
+        *_config = Flash::get().config;
+}
+
+mDot::~mDot() {
+    delete _radio;
+    delete _config;
+}
+
+mDot* mDot::getInstance() {
+    if (_instance == NULL) {
+        sim::SimHeap scope;
+        _instance = new mDot();
+    }
+    return _instance;
+}
+
+std::string mDot::getId() {
+    return "host-sim";
+}
+
+void mDot::resetConfig() {
+    sim::SimHeap scope;
+    _config->reset();
+    _radio->joined = false;
+}
+
+bool mDot::saveConfig() {
+    sim::busy(FLASH_WRITE);
+    sim::SimHeap scope;
+    Flash::get().config = *_config;
+    Flash::get().config_saved = true;
+    return true;
+}
+
+int32_t mDot::setLogLevel(const uint8_t& level) {
+    if (level > MTSLog::TRACE_LEVEL)
+        return MDOT_INVALID_PARAM;
+    _config->log_level = level;
+    MTSLog::setLogLevel(level);
+    return MDOT_OK;
+}
+
+uint8_t mDot::getLogLevel() {
+    return _config->log_level;
+}
+
+uint8_t mDot::getFrequencyBand() {
+    return eu() ? FB_868 : FB_915;
+}
+
+int32_t mDot::setFrequencySubBand(const uint8_t& band) {
+    if (band > FSB_8)
+        return MDOT_INVALID_PARAM;
+    _config->frequency_sub_band = band;
+    return MDOT_OK;
+}
+
+uint8_t mDot::getFrequencySubBand() {
+    return _config->frequency_sub_band;
+}
+
+int32_t mDot::setPublicNetwork(const bool& on) {
+    _config->public_network = on;
+    return MDOT_OK;
+}
+
+bool mDot::getPublicNetwork() {
+    return _config->public_network;
+}
+
+std::vector<uint8_t> mDot::getDeviceId() {
+    static const uint8_t id[8] = { 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x51, 0x3D };
+    return std::vector<uint8_t>(id, id + 8);
+}
+
+int32_t mDot::setNetworkAddress(const std::vector<uint8_t>& addr) {
+    if (addr.size() != 4)
+        return MDOT_INVALID_PARAM;
+    _config->network_addr = addr;
+    return MDOT_OK;
+}
+
+std::vector<uint8_t> mDot::getNetworkAddress() {
+    return _config->network_addr;
+}
+
+int32_t mDot::setNetworkSessionKey(const std::vector<uint8_t>& key) {
+    if (key.size() != 16)
+        return MDOT_INVALID_PARAM;
+    _config->network_session_key = key;
+    return MDOT_OK;
+}
+
+std::vector<uint8_t> mDot::getNetworkSessionKey() {
+    return _config->network_session_key;
+}
+
+int32_t mDot::setDataSessionKey(const std::vector<uint8_t>& key) {
+    if (key.size() != 16)
+        return MDOT_INVALID_PARAM;
+    _config->data_session_key = key;
+    return MDOT_OK;
+}
+
+std::vector<uint8_t> mDot::getDataSessionKey() {
+    return _config->data_session_key;
+}
+
+int32_t mDot::setNetworkName(const std::string& name) {
+    _config->network_name = name;
+    return MDOT_OK;
+}
+
+std::string mDot::getNetworkName() {
+    return _config->network_name;
+}
+
+uint32_t mDot::setJoinByteOrder(uint8_t order) {
+    if (order > MSB)
+        return MDOT_INVALID_PARAM;
+    _config->join_byte_order = order;
+    return MDOT_OK;
+}
+
+uint8_t mDot::getJoinByteOrder() {
+    return _config->join_byte_order;
+}
+
+int32_t mDot::setJoinRetries(const uint8_t& retries) {
+    _config->join_retries = retries;
+    return MDOT_OK;
+}
+
+uint8_t mDot::getJoinRetries() {
+    return _config->join_retries;
+}
+
+int32_t mDot::setJoinMode(const uint8_t& mode) {
+    if (mode > AUTO_OTA)
+        return MDOT_INVALID_PARAM;
+    _config->join_mode = mode;
+    return MDOT_OK;
+}
+
+uint8_t mDot::getJoinMode() {
+    return _config->join_mode;
+}
+
+bool mDot::getNetworkJoinStatus() {
+    return _radio->joined;
+}
+
+int32_t mDot::setLinkCheckCount(const uint8_t& count) {
+    _config->link_check_count = count;
+    return MDOT_OK;
+}
+
+uint8_t mDot::getLinkCheckCount() {
+    return _config->link_check_count;
+}
+
+int32_t mDot::setLinkCheckThreshold(const uint8_t& count) {
+    _config->link_check_threshold = count;
+    return MDOT_OK;
+}
+
+uint8_t mDot::getLinkCheckThreshold() {
+    return _config->link_check_threshold;
+}
+
+uint32_t mDot::getUpLinkCounter() {
+    return _radio->up_counter;
+}
+
+mDot::rssi_stats mDot::getRssiStats() {
+    rssi_stats s;
+    s.last = s.min = s.max = s.avg = (int16_t)sim::scenario("radio.rssi", -90);
+    return s;
+}
+
+mDot::snr_stats mDot::getSnrStats() {
+    snr_stats s;
+    // in quarter dB, as the SX1272 packet SNR register and libmDot give it
+    double q = floor(sim::scenario("radio.snr", 7) * 4 + 0.5);
+    s.last = s.min = s.max = s.avg = (int8_t)(q > 127 ? 127 : q < -128 ? -128 : q);
+    return s;
+}
+
+uint32_t mDot::getNextTxMs() {
+    sim::time_ns now = sim::now();
+    if (_radio->band_free <= now)
+        return 0;
+    return (uint32_t)((_radio->band_free - now + sim::MS - 1) / sim::MS);
+}
+
+int32_t mDot::setTxDataRate(const uint8_t& dr) {
+    if (dr > SF_50 || (eu() ? false : (dr < SF_10 || dr == SF_50)))
+        return MDOT_INVALID_PARAM;
+    _config->tx_data_rate = dr;
+    return MDOT_OK;
+}
+
+uint8_t mDot::getTxDataRate() {
+    return _config->tx_data_rate;
+}
+
+int32_t mDot::setTxPower(const uint32_t& power) {
+    if (power < 2 || power > 20)
+        return MDOT_INVALID_PARAM;
+    _config->tx_power = power;
+    return MDOT_OK;
+}
+
+uint32_t mDot::getTxPower() {
+    return _config->tx_power;
+}
+
+int32_t mDot::setTxWait(const bool& enable) {
+    _config->tx_wait = enable;
+    return MDOT_OK;
+}
+
+bool mDot::getTxWait() {
+    return _config->tx_wait;
+}
+
+uint32_t mDot::getTimeOnAir(uint8_t bytes) {
+    sim::time_ns t = airtime(modulation(_config->tx_data_rate), phy_length(bytes));
+    return (uint32_t)((t + sim::MS - 1) / sim::MS);
+}
+
+int32_t mDot::setCrc(const bool& on) {
+    _config->crc = on;
+    return MDOT_OK;
+}
+
+bool mDot::getCrc() {
+    return _config->crc;
+}
+
+int32_t mDot::setAck(const uint8_t& retries) {
+    if (retries > 8)
+        return MDOT_INVALID_PARAM;
+    _config->ack = retries;
+    return MDOT_OK;
+}
+
+uint8_t mDot::getAck() {
+    return _config->ack;
+}
+
+int32_t mDot::setAdr(const bool& on) {
+    _config->adr = on;
+    return MDOT_OK;
+}
+
+bool mDot::getAdr() {
+    return _config->adr;
+}
+
+mDot::mdot_stats mDot::getStats() {
+    return _stats;
+}
+
+void mDot::resetStats() {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/* string helpers */
+
+std::string mDot::getReturnCodeString(const int32_t& code) {
+    switch (code) {
+        case MDOT_OK:                  return "Success";
+        case MDOT_INVALID_PARAM:       return "Invalid Parameter";
+        case MDOT_TX_ERROR:            return "TX Error";
+        case MDOT_RX_ERROR:            return "RX Error";
+        case MDOT_JOIN_ERROR:          return "Join Error";
+        case MDOT_TIMEOUT:             return "Timeout";
+        case MDOT_NOT_JOINED:          return "Not Joined";
+        case MDOT_ENCRYPTION_DISABLED: return "Encryption Disabled";
+        case MDOT_NO_FREE_CHAN:        return "No Free Channel";
+        case MDOT_ERROR:               return "Error";
+        default:                       return "Unknown Return Code";
+    }
+}
+
+std::string mDot::getLastError() {
+    return _last_error;
+}
+
+void mDot::setLastError(const std::string& str) {
+    _last_error = str;
+}
+
+std::string mDot::JoinModeStr(uint8_t mode) {
+    switch (mode) {
+        case MANUAL:   return "MANUAL";
+        case OTA:      return "OTA";
+        case AUTO_OTA: return "AUTO_OTA";
+        default:       return "unknown";
+    }
+}
+
+std::string mDot::DataRateStr(uint8_t rate) {
+    static const char *names[] = { "SF_12", "SF_11", "SF_10", "SF_9", "SF_8", "SF_7", "SF_7H", "SF_50" };
+    return rate <= SF_50 ? names[rate] : "unknown";
+}
+
+std::string mDot::FrequencyBandStr(uint8_t band) {
+    return band == FB_868 ? "FB_868" : band == FB_915 ? "FB_915" : "unknown";
+}
+
+std::string mDot::FrequencySubBandStr(uint8_t band) {
+    static const char *names[] = { "FSB_ALL", "FSB_1", "FSB_2", "FSB_3", "FSB_4", "FSB_5", "FSB_6", "FSB_7", "FSB_8" };
+    return band <= FSB_8 ? names[band] : "unknown";
+}
+
+/* network */
+
+int32_t mDot::joinNetwork() {
+    return joinBase(_config->join_retries);
+}
+
+int32_t mDot::joinNetworkOnce() {
+    return joinBase(0);
+}
+
+int32_t mDot::joinBase(const uint32_t& retries) {
+    _stats.Joins++;
+    if (_config->join_mode == MANUAL) {
+        // ABP: the session keys are the join
+        _radio->joined = true;
+        return MDOT_OK;
+    }
+    for (uint32_t attempt = 0; attempt <= retries; attempt++) {
+        if (getNextTxMs())
+            return MDOT_NO_FREE_CHAN;
+        Modulation m = modulation(_config->tx_data_rate);
+        sim::time_ns t = airtime(m, 23);
+        sim::busy(MAC_TX_PREP);
+        _radio->run(t, sim::power::RADIO_TX_MA);
+        if (eu())
+            _radio->band_free = sim::now() + 99 * t;
+        // JoinAccept arrives in RX1, 5 s after the request
+        _radio->pause(5 * sim::SEC);
+        if (sim::random_uniform() >= loss(m)) {
+            _radio->run(airtime(rx1_modulation(_config->tx_data_rate), 17 + 13), sim::power::RADIO_RX_MA);
+            sim::busy(MAC_RX_HANDLE);
+            _radio->joined = true;
+            return MDOT_OK;
+        }
+        _radio->run(rx_window(rx1_modulation(_config->tx_data_rate)), sim::power::RADIO_RX_MA);
+        _radio->pause(1 * sim::SEC);
+        _radio->run(rx_window(rx2_modulation()), sim::power::RADIO_RX_MA);
+        _stats.JoinFails++;
+    }
+    return MDOT_JOIN_ERROR;
+}
+
+void mDot::resetNetworkSession() {
+    _radio->joined = false;
+}
+
+int32_t mDot::send(const std::vector<uint8_t>& data, const bool& blocking, const bool& highBw) {
+    return sendBase(data, _config->ack > 0, blocking, highBw);
+}
+
+int32_t mDot::sendBase(const std::vector<uint8_t>& data, const bool& confirmed, const bool& blocking, const bool& highBw) {
+    if (!_radio->joined) {
+        setLastError("Not joined to network");
+        return MDOT_NOT_JOINED;
+    }
+    uint8_t dr = _config->tx_data_rate;
+    uint8_t max = eu() ? MaxLengths_868[dr] : MaxLengths_915[dr];
+    if (data.size() > max) {
+        setLastError("Data exceeds datarate max payload");
+        return MDOT_INVALID_PARAM;
+    }
+    if (getNextTxMs()) {
+        setLastError("No free channel");
+        return MDOT_NO_FREE_CHAN;
+    }
+
+    sim::uplink_begin();
+    Modulation m = modulation(dr);
+    sim::time_ns t = airtime(m, phy_length(data.size()));
+    sim::busy(MAC_TX_PREP);
+    _radio->run(t, sim::power::RADIO_TX_MA);
+    if (eu())
+        _radio->band_free = sim::now() + 99 * t;
+    _radio->up_counter++;
+    _stats.Up++;
+
+    bool delivered = sim::random_uniform() >= loss(m);
+    // class A: RX1 one second after the end of the uplink, RX2 one later
+    _radio->pause(1 * sim::SEC);
+    _radio->run(rx_window(rx1_modulation(dr)), sim::power::RADIO_RX_MA);
+    sim::busy(MAC_RX_HANDLE);
+    bool acked = confirmed && delivered;
+    if (!acked) {
+        _radio->pause(1 * sim::SEC - rx_window(rx1_modulation(dr)) - MAC_RX_HANDLE);
+        _radio->run(rx_window(rx2_modulation()), sim::power::RADIO_RX_MA);
+        sim::busy(MAC_RX_HANDLE);
+    }
+
+    sim::uplink_end(&data[0], data.size(), t, dr, delivered);
+    if (confirmed && !acked) {
+        _stats.MissedAcks++;
+        setLastError("No ack received");
+        return MDOT_TIMEOUT;
+    }
+    return MDOT_OK;
+}
+
+int32_t mDot::recv(std::vector<uint8_t>& data) {
+    data.clear();
+    return MDOT_ERROR;
+}
+
+/* sleep */
+
+void mDot::sleep(const uint32_t& interval, const uint8_t& wakeup_mode, const bool& deepsleep) {
+    if (wakeup_mode != RTC_ALARM)
+        sim::stop("sleep: only the RTC alarm wakes the simulated mDot");
+    sim::time_ns dt = (sim::time_ns)interval * sim::SEC;
+    // RAM is lost: the next getInstance() builds a new module from flash
+    _instance = NULL;
+    delete this;
+    sim::standby(dt);
+}
+
+/* user files */
+
+// a file's contents, created empty if need be
+static std::vector<uint8_t> &file_data(const char *file) {
+    sim::SimHeap scope;
+    return Flash::get().files[file];
+}
+
+static std::vector<uint8_t> *find_file(const char *file) {
+    sim::SimHeap scope;
+    std::map<std::string, std::vector<uint8_t> >::iterator it = Flash::get().files.find(file);
+    return it == Flash::get().files.end() ? NULL : &it->second;
+}
+
+static void program(const char *file, size_t offset, size_t len) {
+    size_t pages = len ? (offset + len - 1) / FLASH_PAGE - offset / FLASH_PAGE + 1 : 0;
+    sim::busy(FLASH_WRITE);
+    sim::flash_write(file, len, (pages + 1) * FLASH_PAGE);
+}
+
+bool mDot::saveUserFile(const char* file, void* data, uint32_t size) {
+    if (!file || strlen(file) >= sizeof(((mdot_file *)0)->name))
+        return false;
+    program(file, 0, size);
+    sim::SimHeap scope;
+    const uint8_t *p = (const uint8_t *)data;
+    Flash::get().files[file].assign(p, p + size);
+    return true;
+}
+
+bool mDot::appendUserFile(const char* file, void* data, uint32_t size) {
+    if (!file || strlen(file) >= sizeof(((mdot_file *)0)->name))
+        return false;
+    const uint8_t *p = (const uint8_t *)data;
+    size_t offset = file_data(file).size();
+    program(file, offset, size);
+    sim::SimHeap scope;
+    std::vector<uint8_t> &f = file_data(file);
+    f.insert(f.end(), p, p + size);
+    return true;
+}
+
+bool mDot::readUserFile(const char* file, void* data, uint32_t size) {
+    const std::vector<uint8_t> *f = find_file(file);
+    if (!f || f->size() < size)
+        return false;
+    sim::busy(FLASH_READ);
+    memcpy(data, &(*f)[0], size);
+    return true;
+}
+
+bool mDot::deleteUserFile(const char* file) {
+    sim::busy(FLASH_WRITE);
+    sim::SimHeap scope;
+    return Flash::get().files.erase(file) > 0;
+}
+
+// open files are the library's RAM: a reset loses them, as on the module
+struct OpenFile {
+    std::string name;
+    size_t pos;
+    int mode;
+};
+
+static std::map<int16_t, OpenFile> &open_files() {
+    static std::map<int16_t, OpenFile> open;
+    return open;
+}
+
+static std::vector<uint8_t> *open_data(const mDot::mdot_file &file, OpenFile **of) {
+    std::map<int16_t, OpenFile>::iterator it = open_files().find(file.fd);
+    if (it == open_files().end())
+        return NULL;
+    std::vector<uint8_t> *f = find_file(it->second.name.c_str());
+    if (f)
+        *of = &it->second;
+    return f;
+}
+
+mDot::mdot_file mDot::openUserFile(const char* file, int mode) {
+    mdot_file f;
+    memset(&f, 0, sizeof(f));
+    f.fd = -1;
+    if (!file || strlen(file) >= sizeof(f.name) || open_files().size() >= MAX_OPEN_FILES)
+        return f;
+    if (!find_file(file) && !(mode & FM_CREAT))
+        return f;
+    std::vector<uint8_t> &data = file_data(file);
+    if ((mode & FM_TRUNC) && (mode & FM_WRONLY) && !data.empty()) {
+        data.clear();
+        program(file, 0, 0);
+    }
+    static int16_t next_fd;
+    f.fd = next_fd++ & 0x7FFF;
+    strcpy(f.name, file);
+    f.size = data.size();
+    sim::SimHeap scope;
+    OpenFile of;
+    of.name = file;
+    of.pos = (mode & FM_APPEND) ? data.size() : 0;
+    of.mode = mode;
+    open_files()[f.fd] = of;
+    return f;
+}
+
+bool mDot::seekUserFile(mDot::mdot_file& file, size_t offset, int whence) {
+    OpenFile *of;
+    std::vector<uint8_t> *data = open_data(file, &of);
+    if (!data)
+        return false;
+    size_t base = whence == SEEK_END ? data->size() : whence == SEEK_CUR ? of->pos : 0;
+    if (base + offset > data->size())
+        return false;
+    of->pos = base + offset;
+    return true;
+}
+
+int mDot::readUserFile(mDot::mdot_file& file, void* data, size_t length) {
+    OpenFile *of;
+    std::vector<uint8_t> *d = open_data(file, &of);
+    if (!d || !(of->mode & FM_RDONLY))
+        return -1;
+    size_t n = of->pos < d->size() ? std::min(length, d->size() - of->pos) : 0;
+    sim::busy(FLASH_READ);
+    if (n)
+        memcpy(data, &(*d)[of->pos], n);
+    of->pos += n;
+    return (int)n;
+}
+
+int mDot::writeUserFile(mDot::mdot_file& file, void* data, size_t length) {
+    OpenFile *of;
+    std::vector<uint8_t> *d = open_data(file, &of);
+    if (!d || !(of->mode & FM_WRONLY))
+        return -1;
+    if (of->mode & FM_APPEND)
+        of->pos = d->size();
+    program(file.name, of->pos, length);
+    sim::SimHeap scope;
+    if (of->pos + length > d->size())
+        d->resize(of->pos + length);
+    if (length)
+        memcpy(&(*d)[of->pos], data, length);
+    of->pos += length;
+    file.size = d->size();
+    return (int)length;
+}
+
+bool mDot::closeUserFile(mDot::mdot_file& file) {
+    bool open = open_files().erase(file.fd) > 0;
+    file.fd = -1;
+    return open;
+}
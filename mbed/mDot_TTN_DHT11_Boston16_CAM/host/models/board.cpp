@@ -0,0 +1,35 @@
+/* host simulator - the rain-garden board
+ *
+ * Pin assignments follow main.cpp.  The single-wire, 1-wire and SHT data
+ * lines carry external pull-ups on the board; the bus gaps decide how long a
+ * pause between edges still counts as the bus being busy.
+ */
+#include "models.h"
+#include "scenario.h"
+
+namespace sim {
+
+void board_init() {
+    static Bus dht_bus("dht", 25 * MS, true);
+    static Bus onewire_bus("1wire", 1 * MS, true);
+    static Bus sht_bus("sht", 2 * MS, true);
+    i2c_bus(PC_9);
+
+    Line::get(PA_1).set_pullup(true);
+    Line::get(PA_1).set_bus(&dht_bus);
+    Line::get(PA_11).set_pullup(true);
+    Line::get(PA_11).set_bus(&onewire_bus);
+    Line::get(PA_4).set_pullup(true);
+    Line::get(PA_4).set_bus(&sht_bus);
+    Line::get(PC_13).set_bus(&sht_bus);
+
+    static Dht22Model dht(PA_1);
+    static Ds18b20Model water(PA_11, 0);
+    // further probes on the same 1-wire line, as the scenario asks
+    for (unsigned i = 1; i < (unsigned)scenario("water.probes", 1); i++)
+        new Ds18b20Model(PA_11, i);
+    static Sht1xModel soil(PA_4, PC_13);
+    static Tsl2561Model light(PC_9, 0x29);
+}
+
+} // namespace sim
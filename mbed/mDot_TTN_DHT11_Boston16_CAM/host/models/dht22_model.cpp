@@ -0,0 +1,81 @@
+/* host simulator - DHT22
+ *
+ * After the host holds the line low for at least 500 us and releases it, the
+ * sensor answers 20-40 us later with 80 us low, 80 us high and then 40 bits,
+ * each a 50 us low followed by 26 us (0) or 70 us (1) high, MSB first:
+ * humidity x10, temperature x10 with bit 15 as the sign, and a checksum.
+ */
+#include "models.h"
+#include "power.h"
+#include "scenario.h"
+
+#include <math.h>
+
+namespace sim {
+
+static const time_ns START_MIN  = 500 * US;
+static const time_ns RESPONSE   = 30 * US;
+
+Dht22Model::Dht22Model(PinName pin) :
+    _line(Line::get(pin)), _load("dht22", power::DHT22_IDLE_MA),
+    _event(this, &Dht22Model::step), _index(0), _fall(0), _low(false),
+    _sending(false), _self(false) {
+    _line.add_listener(this);
+}
+
+void Dht22Model::line_changed(Line &line) {
+    if (_self || _sending)
+        return;
+    if (line.level() == 0) {
+        _fall = now();
+        _low = true;
+    } else if (_low) {
+        _low = false;
+        if (now() - _fall >= START_MIN && scenario("dht.present", 1) != 0)
+            start_frame();
+    }
+}
+
+void Dht22Model::start_frame() {
+    double rh = scenario("air.rh", 50.0);
+    double t = scenario("air.temp", 20.0);
+    uint16_t h = (uint16_t)floor(rh * 10.0 + 0.5);
+    uint16_t tv = (uint16_t)floor(fabs(t) * 10.0 + 0.5) & 0x7FFF;
+    if (t < 0)
+        tv |= 0x8000;
+    uint8_t data[5];
+    data[0] = h >> 8;
+    data[1] = h & 0xFF;
+    data[2] = tv >> 8;
+    data[3] = tv & 0xFF;
+    data[4] = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+
+    _durations.clear();
+    _durations.push_back(80 * US);
+    _durations.push_back(80 * US);
+    for (int i = 0; i < 40; i++) {
+        int bit = (data[i / 8] >> (7 - i % 8)) & 1;
+        _durations.push_back(50 * US);
+        _durations.push_back(bit ? 70 * US : 26 * US);
+    }
+    _durations.push_back(50 * US);
+    _index = 0;
+    _sending = true;
+    _load.set(power::DHT22_ACTIVE_MA);
+    _event.schedule_in(RESPONSE);
+}
+
+void Dht22Model::step() {
+    bool done = _index >= _durations.size();
+    _self = true;
+    _line.pull_low(this, !done && _index % 2 == 0);
+    _self = false;
+    if (done) {
+        _sending = false;
+        _load.set(power::DHT22_IDLE_MA);
+        return;
+    }
+    _event.schedule_in(_durations[_index++]);
+}
+
+} // namespace sim
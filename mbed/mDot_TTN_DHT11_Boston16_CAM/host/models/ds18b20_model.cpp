@@ -0,0 +1,289 @@
+/* host simulator - DS18B20
+ *
+ * Slave side of the 1-wire protocol.  A low pulse of 480 us or more is a
+ * reset, answered with a presence pulse; shorter ones are time slots.  In a
+ * write slot the master's low time decides the bit (under 15 us is a 1); in a
+ * read slot the device sends a 0 by holding the line low for 30 us from the
+ * master's falling edge.  Several devices on one line resolve through the
+ * wired-AND, which is what makes SEARCH ROM work.
+ */
+#include "models.h"
+#include "power.h"
+#include "scenario.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace sim {
+
+static const time_ns RESET_MIN     = 400 * US;
+static const time_ns WRITE1_MAX    = 15 * US;
+static const time_ns PRESENCE_WAIT = 30 * US;
+static const time_ns PRESENCE_LOW  = 120 * US;
+static const time_ns PRESENCE_END  = 240 * US;
+static const time_ns READ_HOLD     = 30 * US;
+
+enum {
+    READ_ROM = 0x33, MATCH_ROM_CMD = 0x55, SKIP_ROM = 0xCC, SEARCH_ROM_CMD = 0xF0,
+    ALARM_SEARCH = 0xEC, CONVERT = 0x44, WRITE_SCRATCHPAD = 0x4E,
+    READ_SCRATCHPAD = 0xBE, COPY_SCRATCHPAD = 0x48, RECALL_E2 = 0xB8,
+    READ_POWER = 0xB4
+};
+
+static uint8_t crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        uint8_t byte = *data++;
+        for (int i = 0; i < 8; i++) {
+            uint8_t mix = (crc ^ byte) & 1;
+            crc >>= 1;
+            if (mix)
+                crc ^= 0x8C;
+            byte >>= 1;
+        }
+    }
+    return crc;
+}
+
+Ds18b20Model::Ds18b20Model(PinName pin, unsigned index) :
+    _line(Line::get(pin)), _load("ds18b20", power::DS18B20_IDLE_MA),
+    _presence(this, &Ds18b20Model::presence),
+    _release(this, &Ds18b20Model::release),
+    _converted(this, &Ds18b20Model::conversion_done),
+    _state(IDLE), _rx(0), _rx_bits(0), _tx_bit(0), _search_bit(0),
+    _search_phase(0), _fall(0), _quiet_until(0), _conv_end(0), _low(false),
+    _read_slot(false), _self(false) {
+    char name[32];
+    snprintf(name, sizeof(name), index ? "water.temp.%u" : "water.temp", index);
+    _channel = name;
+    snprintf(name, sizeof(name), "ds.present.%u", index);
+    _present = name;
+
+    // a made-up but valid registration number per probe
+    _rom[0] = 0x28;
+    _rom[1] = (uint8_t)(0x5E + index * 0x31);
+    _rom[2] = (uint8_t)(0xA2 ^ (index * 0x17));
+    _rom[3] = 0x16;
+    _rom[4] = (uint8_t)(0x04 + index);
+    _rom[5] = 0x00;
+    _rom[6] = 0x00;
+    _rom[7] = crc8(_rom, 7);
+
+    // power-on scratchpad: 85 degC, TH/TL from EEPROM, 12 bit
+    static const uint8_t por[8] = { 0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10 };
+    memcpy(_scratch, por, 8);
+    _scratch[8] = crc8(_scratch, 8);
+
+    _line.add_listener(this);
+}
+
+void Ds18b20Model::line_changed(Line &line) {
+    if (_self || now() < _quiet_until)
+        return;
+    if (scenario("ds.present", 1) == 0 || scenario(_present.c_str(), 1) == 0)
+        return;
+    if (line.level() == 0) {
+        _fall = now();
+        _low = true;
+        // the slot is a read or a write depending on the state at its start
+        _read_slot = sending();
+        if (_read_slot && next_bit() == 0) {
+            pull(true);
+            _release.schedule_at(_fall + READ_HOLD);
+        }
+    } else if (_low) {
+        _low = false;
+        time_ns width = now() - _fall;
+        if (width >= RESET_MIN)
+            reset();
+        else if (!_read_slot && _state != IDLE)
+            receive(width < WRITE1_MAX ? 1 : 0);
+    }
+}
+
+void Ds18b20Model::pull(bool low) {
+    _self = true;
+    _line.pull_low(this, low);
+    _self = false;
+}
+
+void Ds18b20Model::release() {
+    pull(false);
+}
+
+void Ds18b20Model::presence() {
+    pull(true);
+    _release.schedule_in(PRESENCE_LOW);
+}
+
+void Ds18b20Model::reset() {
+    _release.cancel();
+    pull(false);
+    _state = ROM_CMD;
+    _rx = 0;
+    _rx_bits = 0;
+    _presence.schedule_in(PRESENCE_WAIT);
+    _quiet_until = now() + PRESENCE_END;
+}
+
+bool Ds18b20Model::sending() const {
+    switch (_state) {
+        case SEND:
+        case CONVERTING:
+        case POWER:
+            return true;
+        case SEARCH_ROM:
+            return _search_phase < 2;
+        default:
+            return false;
+    }
+}
+
+int Ds18b20Model::next_bit() {
+    switch (_state) {
+        case SEND: {
+            if (_tx_bit >= _tx.size() * 8)
+                return 1;
+            int bit = (_tx[_tx_bit / 8] >> (_tx_bit % 8)) & 1;
+            _tx_bit++;
+            return bit;
+        }
+        case CONVERTING:
+            return now() >= _conv_end ? 1 : 0;
+        case SEARCH_ROM: {
+            int bit = (_rom[_search_bit / 8] >> (_search_bit % 8)) & 1;
+            return _search_phase++ == 0 ? bit : !bit;
+        }
+        default:
+            return 1;
+    }
+}
+
+void Ds18b20Model::receive(int bit) {
+    if (_state == SEARCH_ROM) {
+        int mine = (_rom[_search_bit / 8] >> (_search_bit % 8)) & 1;
+        _search_phase = 0;
+        if (bit != mine)
+            _state = IDLE;      // deselected until the next reset
+        else if (++_search_bit == 64)
+            _state = IDLE;
+        return;
+    }
+
+    _rx |= (uint64_t)bit << _rx_bits;
+    _rx_bits++;
+    switch (_state) {
+        case ROM_CMD:
+        case FUNC_CMD:
+            if (_rx_bits == 8) {
+                uint8_t cmd = (uint8_t)_rx;
+                _rx = 0;
+                _rx_bits = 0;
+                if (_state == ROM_CMD)
+                    rom_command(cmd);
+                else
+                    function_command(cmd);
+            }
+            break;
+        case MATCH_ROM:
+            if (_rx_bits == 64) {
+                bool match = true;
+                for (int i = 0; i < 8; i++)
+                    if ((uint8_t)(_rx >> (8 * i)) != _rom[i])
+                        match = false;
+                _rx = 0;
+                _rx_bits = 0;
+                _state = match ? FUNC_CMD : IDLE;
+            }
+            break;
+        case RECV_SCRATCH:
+            if (_rx_bits == 24) {
+                _scratch[2] = (uint8_t)_rx;
+                _scratch[3] = (uint8_t)(_rx >> 8);
+                _scratch[4] = (uint8_t)((_rx >> 16) & 0x60) | 0x1F;
+                _scratch[8] = crc8(_scratch, 8);
+                _rx = 0;
+                _rx_bits = 0;
+                _state = IDLE;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void Ds18b20Model::rom_command(uint8_t cmd) {
+    switch (cmd) {
+        case READ_ROM:
+            send(_rom, 8);
+            break;
+        case SKIP_ROM:
+            _state = FUNC_CMD;
+            break;
+        case MATCH_ROM_CMD:
+            _state = MATCH_ROM;
+            break;
+        case SEARCH_ROM_CMD:
+            _state = SEARCH_ROM;
+            _search_bit = 0;
+            _search_phase = 0;
+            break;
+        default:
+            // ALARM SEARCH: no alarm condition is ever flagged
+            _state = IDLE;
+            break;
+    }
+}
+
+void Ds18b20Model::function_command(uint8_t cmd) {
+    switch (cmd) {
+        case CONVERT:
+            _state = CONVERTING;
+            _conv_end = now() + conversion_time();
+            _load.set(power::DS18B20_ACTIVE_MA);
+            _converted.schedule_at(_conv_end);
+            break;
+        case READ_SCRATCHPAD:
+            send(_scratch, 9);
+            break;
+        case WRITE_SCRATCHPAD:
+            _state = RECV_SCRATCH;
+            break;
+        case READ_POWER:
+            _state = POWER;     // externally powered: reads as 1
+            break;
+        default:
+            // COPY SCRATCHPAD / RECALL E2 have nothing to model
+            _state = IDLE;
+            break;
+    }
+}
+
+void Ds18b20Model::send(const uint8_t *data, size_t len) {
+    _tx.assign(data, data + len);
+    _tx_bit = 0;
+    _state = SEND;
+}
+
+time_ns Ds18b20Model::conversion_time() const {
+    switch ((_scratch[4] >> 5) & 3) {
+        case 0:  return 93750 * US;
+        case 1:  return 187500 * US;
+        case 2:  return 375 * MS;
+        default: return 750 * MS;
+    }
+}
+
+void Ds18b20Model::conversion_done() {
+    double t = scenario(_channel.c_str(), 15.0);
+    int raw = (int)floor(t * 16.0 + 0.5);
+    // lower resolutions leave the low bits undefined; the part reads them as 0
+    raw &= ~((1 << (3 - ((_scratch[4] >> 5) & 3))) - 1);
+    _scratch[0] = (uint8_t)raw;
+    _scratch[1] = (uint8_t)(raw >> 8);
+    _scratch[8] = crc8(_scratch, 8);
+    _load.set(power::DS18B20_IDLE_MA);
+}
+
+} // namespace sim
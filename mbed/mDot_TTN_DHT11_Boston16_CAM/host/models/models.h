@@ -0,0 +1,154 @@
+/* host simulator - sensor models
+ *
+ * Pin-level models of the rain-garden sensors.  Each one watches its lines
+ * and answers the way the part does on the wire, with datasheet timing, so
+ * the unmodified drivers exercise their real bit-banging paths.  Readings
+ * come from the scenario (see scenario.h).
+ */
+#ifndef HOST_MODELS_H
+#define HOST_MODELS_H
+
+#include "line.h"
+#include "i2c_device.h"
+
+#include <string>
+#include <vector>
+
+namespace sim {
+
+/** AOSONG DHT22 single-wire humidity/temperature sensor. */
+class Dht22Model : public LineListener {
+public:
+    Dht22Model(PinName pin);
+    virtual void line_changed(Line &line);
+
+private:
+    void step();
+    void start_frame();
+
+    Line &_line;
+    Load _load;
+    MemberEvent<Dht22Model> _event;
+    std::vector<time_ns> _durations;    // alternating low/high, starting low
+    size_t _index;
+    time_ns _fall;
+    bool _low;
+    bool _sending;
+    bool _self;
+};
+
+/** Maxim DS18B20 1-wire thermometer; several can share one line. */
+class Ds18b20Model : public LineListener {
+public:
+    Ds18b20Model(PinName pin, unsigned index);
+    virtual void line_changed(Line &line);
+
+    const uint8_t *rom() const { return _rom; }
+
+private:
+    enum State {
+        IDLE, ROM_CMD, MATCH_ROM, SEARCH_ROM, FUNC_CMD, SEND, RECV_SCRATCH,
+        CONVERTING, POWER
+    };
+
+    void reset();
+    bool sending() const;
+    int next_bit();
+    void receive(int bit);
+    void rom_command(uint8_t cmd);
+    void function_command(uint8_t cmd);
+    void send(const uint8_t *data, size_t len);
+    void pull(bool low);
+    void presence();
+    void release();
+    void conversion_done();
+    time_ns conversion_time() const;
+
+    Line &_line;
+    Load _load;
+    MemberEvent<Ds18b20Model> _presence;
+    MemberEvent<Ds18b20Model> _release;
+    MemberEvent<Ds18b20Model> _converted;
+    std::string _channel;
+    std::string _present;
+    uint8_t _rom[8];
+    uint8_t _scratch[9];
+    State _state;
+    uint64_t _rx;
+    unsigned _rx_bits;
+    std::vector<uint8_t> _tx;
+    unsigned _tx_bit;
+    unsigned _search_bit;
+    unsigned _search_phase;
+    time_ns _fall;
+    time_ns _quiet_until;
+    time_ns _conv_end;
+    bool _low;
+    bool _read_slot;
+    bool _self;
+};
+
+/** Sensirion SHT1x on its two-wire (not I2C) interface. */
+class Sht1xModel : public LineListener {
+public:
+    Sht1xModel(PinName data, PinName sck);
+    virtual void line_changed(Line &line);
+
+private:
+    enum State {
+        IDLE, RX_CMD, ACK_CMD, MEASURING, TX, TX_ACK, RX_STATUS, ACK_STATUS
+    };
+
+    void data_changed(int level);
+    void sck_rise();
+    void sck_fall();
+    void command(uint8_t cmd);
+    void measured();
+    void present_bit();
+    void pull(bool low);
+    uint8_t crc(const uint8_t *data, size_t len) const;
+
+    Line &_data;
+    Line &_sck;
+    Load _load;
+    MemberEvent<Sht1xModel> _done;
+    State _state;
+    int _start_phase;
+    uint8_t _cmd;
+    uint8_t _rx;
+    unsigned _bits;
+    uint8_t _status;
+    std::vector<uint8_t> _tx;
+    unsigned _tx_bit;
+    bool _self;
+};
+
+/** TAOS TSL2561 light-to-digital converter on hardware I2C. */
+class Tsl2561Model : public I2CDevice {
+public:
+    Tsl2561Model(PinName sda, uint8_t address);
+
+    virtual void i2c_start(bool read);
+    virtual bool i2c_write(uint8_t data);
+    virtual uint8_t i2c_read();
+
+private:
+    void write_reg(uint8_t reg, uint8_t value);
+    uint8_t read_reg(uint8_t reg);
+    void latch(int channel);
+    time_ns integration_time() const;
+
+    Load _load;
+    uint8_t _regs[16];
+    uint8_t _ptr;
+    bool _first;
+    time_ns _on_since;
+    bool _powered;
+};
+
+/** Wire the models to the rain-garden board's pins. */
+void board_init();
+
+} // namespace sim
+
+#endif
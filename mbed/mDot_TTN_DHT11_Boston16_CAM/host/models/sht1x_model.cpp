@@ -0,0 +1,254 @@
+/* host simulator - SHT1x
+ *
+ * The Sensirion two-wire interface: a "transmission start" (DATA falls while
+ * SCK is high, SCK pulses low, DATA rises while SCK is high), a command byte
+ * sampled on SCK rising edges and acknowledged by pulling DATA low for the
+ * ninth clock.  Measurements end with DATA pulled low; the result is shifted
+ * out MSB first, a new bit after every SCK falling edge, with the master
+ * acknowledging each byte.  A NACK ends the transfer (the CRC is optional).
+ */
+#include "models.h"
+#include "power.h"
+#include "scenario.h"
+
+#include <math.h>
+
+namespace sim {
+
+enum {
+    CMD_TEMP = 0x03, CMD_RH = 0x05, CMD_READ_STATUS = 0x07,
+    CMD_WRITE_STATUS = 0x06, CMD_RESET = 0x1E
+};
+
+enum { STATUS_LOW_RES = 0x01, STATUS_WRITABLE = 0x07 };
+
+Sht1xModel::Sht1xModel(PinName data, PinName sck) :
+    _data(Line::get(data)), _sck(Line::get(sck)),
+    _load("sht1x", power::SHT1X_IDLE_MA), _done(this, &Sht1xModel::measured),
+    _state(IDLE), _start_phase(0), _cmd(0), _rx(0), _bits(0), _status(0),
+    _tx_bit(0), _self(false) {
+    _data.add_listener(this);
+    _sck.add_listener(this);
+}
+
+void Sht1xModel::line_changed(Line &line) {
+    if (_self)
+        return;
+    if (&line == &_data) {
+        data_changed(line.level());
+    } else if (line.level()) {
+        if (_start_phase == 2)
+            _start_phase = 3;
+        sck_rise();
+    } else {
+        if (_start_phase == 1)
+            _start_phase = 2;
+        else if (_start_phase == 3)
+            _start_phase = 0;
+        sck_fall();
+    }
+}
+
+void Sht1xModel::data_changed(int level) {
+    if (!_sck.level()) {
+        if (_start_phase == 2 && level)
+            _start_phase = 0;
+        return;
+    }
+    if (!level) {
+        _start_phase = 1;
+    } else if (_start_phase == 3) {
+        // transmission start: aborts whatever was going on
+        _start_phase = 0;
+        if (scenario("sht.present", 1) == 0)
+            return;
+        _done.cancel();
+        pull(false);
+        _state = RX_CMD;
+        _rx = 0;
+        _bits = 0;
+    } else {
+        _start_phase = 0;
+    }
+}
+
+void Sht1xModel::sck_rise() {
+    int level = _data.level();
+    switch (_state) {
+        case RX_CMD:
+        case RX_STATUS:
+            if (_bits < 8) {
+                _rx = (uint8_t)((_rx << 1) | level);
+                _bits++;
+            }
+            break;
+        case TX_ACK:
+            if (level) {
+                // NACK: transfer ends
+                _tx.clear();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void Sht1xModel::sck_fall() {
+    switch (_state) {
+        case RX_CMD:
+            if (_bits == 8) {
+                _cmd = _rx;
+                // the top three bits are the address, always 000
+                if ((_cmd >> 5) == 0 && (_cmd == CMD_TEMP || _cmd == CMD_RH ||
+                        _cmd == CMD_READ_STATUS || _cmd == CMD_WRITE_STATUS ||
+                        _cmd == CMD_RESET)) {
+                    pull(true);
+                    _state = ACK_CMD;
+                } else {
+                    _state = IDLE;
+                }
+            }
+            break;
+        case ACK_CMD:
+            pull(false);
+            command(_cmd);
+            break;
+        case RX_STATUS:
+            if (_bits == 8) {
+                pull(true);
+                _state = ACK_STATUS;
+            }
+            break;
+        case ACK_STATUS:
+            pull(false);
+            _status = (uint8_t)((_status & ~STATUS_WRITABLE) | (_rx & STATUS_WRITABLE));
+            _state = IDLE;
+            break;
+        case TX:
+            _tx_bit++;
+            if (_tx_bit % 8 == 0) {
+                pull(false);    // let the master acknowledge
+                _state = TX_ACK;
+            } else {
+                present_bit();
+            }
+            break;
+        case TX_ACK:
+            if (_tx_bit < _tx.size() * 8) {
+                _state = TX;
+                present_bit();
+            } else {
+                pull(false);
+                _state = IDLE;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void Sht1xModel::command(uint8_t cmd) {
+    switch (cmd) {
+        case CMD_TEMP:
+        case CMD_RH: {
+            bool low = _status & STATUS_LOW_RES;
+            time_ns max = cmd == CMD_TEMP ? (low ? 80 * MS : 320 * MS)
+                                          : (low ? 20 * MS : 80 * MS);
+            // parts finish well inside the datasheet maximum
+            _state = MEASURING;
+            _load.set(power::SHT1X_ACTIVE_MA);
+            _done.schedule_in(max * 85 / 100);
+            break;
+        }
+        case CMD_READ_STATUS: {
+            uint8_t data[2] = { _status, 0 };
+            data[1] = crc(data, 1);
+            _tx.assign(data, data + 2);
+            _tx_bit = 0;
+            _state = TX;
+            present_bit();
+            break;
+        }
+        case CMD_WRITE_STATUS:
+            _state = RX_STATUS;
+            _rx = 0;
+            _bits = 0;
+            break;
+        case CMD_RESET:
+            _status = 0;
+            _state = IDLE;
+            break;
+    }
+}
+
+// invert SOrh -> RH (linear plus temperature compensation) by bisection
+static double rh_of(double so, double t, bool low) {
+    double c1 = -2.0468, c2 = low ? 0.5872 : 0.0367, c3 = low ? -4.0845e-4 : -1.5955e-6;
+    double t1 = 0.01, t2 = low ? 0.00128 : 0.00008;
+    double lin = c1 + c2 * so + c3 * so * so;
+    return (t - 25.0) * (t1 + t2 * so) + lin;
+}
+
+void Sht1xModel::measured() {
+    bool low = _status & STATUS_LOW_RES;
+    double t = scenario("soil.temp", 15.0);
+    uint16_t value;
+    if (_cmd == CMD_TEMP) {
+        double max = low ? 4095 : 16383;
+        double so = floor((t + 39.7) / (low ? 0.04 : 0.01) + 0.5);
+        value = (uint16_t)(so < 0 ? 0 : so > max ? max : so);
+    } else {
+        double rh = scenario("soil.rh", 40.0);
+        double lo = 0, hi = low ? 255 : 4095;
+        for (int i = 0; i < 40; i++) {
+            double mid = (lo + hi) / 2;
+            if (rh_of(mid, t, low) < rh)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        value = (uint16_t)floor(lo + 0.5);
+    }
+    _load.set(power::SHT1X_IDLE_MA);
+
+    uint8_t data[3] = { (uint8_t)(value >> 8), (uint8_t)value, 0 };
+    uint8_t crc_in[3] = { _cmd, data[0], data[1] };
+    data[2] = crc(crc_in, 3);
+    _tx.assign(data, data + 3);
+    _tx_bit = 0;
+    _state = TX;
+    // the first bit is always 0 and doubles as "data ready"
+    present_bit();
+}
+
+void Sht1xModel::present_bit() {
+    int bit = (_tx[_tx_bit / 8] >> (7 - _tx_bit % 8)) & 1;
+    pull(!bit);
+}
+
+void Sht1xModel::pull(bool low) {
+    _self = true;
+    _data.pull_low(this, low);
+    _self = false;
+}
+
+// CRC-8 (x^8 + x^5 + x^4 + 1) seeded with the reversed status nibble and
+// sent bit-reversed, per the SHT1x CRC application note
+uint8_t Sht1xModel::crc(const uint8_t *data, size_t len) const {
+    uint8_t c = 0;
+    for (int i = 0; i < 4; i++)
+        if (_status & (1 << i))
+            c |= 0x80 >> i;
+    while (len--) {
+        c ^= *data++;
+        for (int i = 0; i < 8; i++)
+            c = (c & 0x80) ? (uint8_t)((c << 1) ^ 0x31) : (uint8_t)(c << 1);
+    }
+    uint8_t r = 0;
+    for (int i = 0; i < 8; i++)
+        if (c & (1 << i))
+            r |= 0x80 >> i;
+    return r;
+}
+
+} // namespace sim
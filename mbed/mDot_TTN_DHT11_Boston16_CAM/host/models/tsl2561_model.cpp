@@ -0,0 +1,121 @@
+/* host simulator - TSL2561
+ *
+ * Register file behind the command byte (CMD bit 7, CLEAR bit 6, address in
+ * the low nibble); the address auto-increments on every data byte.  While
+ * powered the two ADC channels integrate continuously; the data registers
+ * hold the result of the last complete integration cycle, scaled from the
+ * scenario's 402 ms / 1x counts to the configured time and gain.
+ */
+#include "models.h"
+#include "power.h"
+#include "scenario.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace sim {
+
+enum {
+    REG_CONTROL = 0x0, REG_TIMING = 0x1, REG_INTERRUPT = 0x6, REG_ID = 0xA,
+    REG_DATA0LOW = 0xC, REG_DATA1LOW = 0xE
+};
+
+enum { CMD = 0x80, CMD_CLEAR = 0x40, POWER_ON = 0x03, GAIN_16X = 0x10 };
+
+Tsl2561Model::Tsl2561Model(PinName sda, uint8_t address) :
+    I2CDevice(sda, address), _load("tsl2561", power::TSL2561_OFF_MA),
+    _ptr(0), _first(false), _on_since(0), _powered(false) {
+    memset(_regs, 0, sizeof(_regs));
+    _regs[REG_TIMING] = 0x02;
+    _regs[REG_ID] = 0x50;
+}
+
+void Tsl2561Model::i2c_start(bool read) {
+    _first = !read;
+}
+
+bool Tsl2561Model::i2c_write(uint8_t data) {
+    if (scenario("tsl.present", 1) == 0)
+        return false;
+    if (_first) {
+        _first = false;
+        if (data & CMD) {
+            _ptr = data & 0x0F;
+            return true;
+        }
+        return false;
+    }
+    write_reg(_ptr, data);
+    _ptr = (_ptr + 1) & 0x0F;
+    return true;
+}
+
+uint8_t Tsl2561Model::i2c_read() {
+    uint8_t value = read_reg(_ptr);
+    _ptr = (_ptr + 1) & 0x0F;
+    return value;
+}
+
+void Tsl2561Model::write_reg(uint8_t reg, uint8_t value) {
+    if (reg == REG_CONTROL) {
+        bool on = (value & POWER_ON) == POWER_ON;
+        if (on && !_powered) {
+            _on_since = now();
+            _regs[REG_DATA0LOW] = _regs[REG_DATA0LOW + 1] = 0;
+            _regs[REG_DATA1LOW] = _regs[REG_DATA1LOW + 1] = 0;
+        }
+        _powered = on;
+        _load.set(on ? power::TSL2561_ON_MA : power::TSL2561_OFF_MA);
+        _regs[REG_CONTROL] = value & POWER_ON;
+        return;
+    }
+    if (reg == REG_TIMING && _powered)
+        _on_since = now();      // a new setting restarts integration
+    if (reg != REG_ID && reg < REG_DATA0LOW)
+        _regs[reg] = value;
+}
+
+uint8_t Tsl2561Model::read_reg(uint8_t reg) {
+    // reading the low byte latches the high byte of the same channel
+    if (reg == REG_DATA0LOW)
+        latch(0);
+    else if (reg == REG_DATA1LOW)
+        latch(1);
+    return _regs[reg];
+}
+
+time_ns Tsl2561Model::integration_time() const {
+    switch (_regs[REG_TIMING] & 3) {
+        case 0:  return 13700 * US;
+        case 1:  return 101 * MS;
+        default: return 402 * MS;
+    }
+}
+
+void Tsl2561Model::latch(int channel) {
+    if (!_powered)
+        return;
+    time_ns itime = integration_time();
+    if (now() - _on_since < itime || (_regs[REG_TIMING] & 3) == 3)
+        return;     // no completed cycle yet, or manual integration
+    double counts = scenario(channel ? "light.ch1" : "light.ch0", channel ? 300.0 : 1000.0);
+    counts *= (double)itime / (double)(402 * MS);
+    if (_regs[REG_TIMING] & GAIN_16X)
+        counts *= 16;
+    double max;
+    switch (_regs[REG_TIMING] & 3) {
+        case 0:  max = 5047;  break;
+        case 1:  max = 37177; break;
+        default: max = 65535; break;
+    }
+    if (counts > max)
+        counts = max;
+    if (counts < 0)
+        counts = 0;
+    uint16_t value = (uint16_t)floor(counts + 0.5);
+    uint8_t reg = channel ? REG_DATA1LOW : REG_DATA0LOW;
+    _regs[reg] = value & 0xFF;
+    _regs[reg + 1] = value >> 8;
+}
+
+} // namespace sim
@@ -0,0 +1,1053 @@
+/* CMSIS-RTOS API on the host simulator
+ *
+ * A small stand-in for RTX 4.61 with the same observable behaviour: fixed
+ * priority preemptive scheduling, round-robin between equal priorities every
+ * OS_ROBINTOUT ticks, a 1 ms SysTick driving delays and timeouts, and user
+ * timers run from a timer thread at OS_TIMERPRIO.  Threads are ucontext
+ * coroutines; a switch only happens when the running thread blocks or, after
+ * an interrupt, when the reschedule hook finds a better thread ready.
+ *
+ * With OS_TICKLESS the idle demon does what RTX_Conf_CM.c's does: with the
+ * scheduler suspended it stretches the SysTick up to the tick before the
+ * next delay or timer expiry, sleeps, and accounts for the whole ticks that
+ * passed.  Every tick that is taken costs OS_TICK_COST of run time.
+ *
+ * osKernelGetProfile() and osThreadGetCycles() count the simulated run-mode
+ * time at OS_CLOCK, charged to the thread that had the core as RTX_Conf_CM.c's
+ * OS_PROFILE does; interrupt handlers are not told apart from the thread they
+ * interrupt, so the interrupt counts stay empty.
+ *
+ * Control blocks are allocated on the host heap, the memory handed in by the
+ * os*Def macros is only used as a key.  Mutexes do not do priority
+ * inheritance.
+ */
+#include "cmsis_os.h"
+#include "sim.h"
+
+#include <ucontext.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <list>
+#include <vector>
+
+#define OS_TICK_US      1000
+#define OS_CLOCK        96000000
+#define OS_ROBINTOUT    5
+#define OS_TIMERPRIO    osPriorityHigh
+#ifndef OS_TICKLESS
+#define OS_TICKLESS     1
+#endif
+// 0x00FFFFFF / (OS_TRV + 1) at 96 MHz
+#define OS_TICKLESS_MAX 174
+// rt_systick() with nothing to switch to
+#define OS_TICK_COST    (3 * sim::US)
+
+// host stacks are much bigger than the target ones: printf and friends on
+// glibc need far more than newlib
+#define HOST_STACK_SIZE (256 * 1024)
+
+enum {
+    INACTIVE = 0, READY, RUNNING, WAIT_DLY, WAIT_ITV, WAIT_OR, WAIT_AND,
+    WAIT_SEM, WAIT_MBX, WAIT_MUT
+};
+
+#define PRIO_LEVELS     7
+#define PRIO_INDEX(p)   ((int)(p) - (int)osPriorityIdle)
+
+// the kernel's own memory, kept out of the firmware's heap accounting: on
+// the board the control blocks and lists are static
+typedef std::list<os_thread_cb *, sim::HostAllocator<os_thread_cb *> > WaitList;
+typedef std::deque<os_thread_cb *, sim::HostAllocator<os_thread_cb *> > ReadyQueue;
+typedef std::list<os_timer_cb *, sim::HostAllocator<os_timer_cb *> > TimerList;
+typedef std::deque<os_timer_cb *, sim::HostAllocator<os_timer_cb *> > TimerQueue;
+typedef std::deque<uint32_t, sim::HostAllocator<uint32_t> > ValueQueue;
+
+struct os_thread_cb : sim::HostObject {
+    ucontext_t ctx;
+    char *stack;
+    os_pthread func;
+    void *arg;
+    osPriority prio;
+    uint8_t state;
+    osThreadDef_t *def;
+    uint32_t requested_stack;
+
+    int32_t signals;
+    int32_t wait_signals;
+    osEvent result;
+
+    WaitList *waiting_on;
+    uint32_t wake_tick;
+    bool timed;
+
+    uint64_t cycles;
+};
+
+struct os_mutex_cb : sim::HostObject {
+    os_thread_cb *owner;
+    uint32_t count;
+    WaitList waiters;
+};
+
+struct os_semaphore_cb : sim::HostObject {
+    int32_t tokens;
+    WaitList waiters;
+};
+
+struct os_timer_cb : sim::HostObject {
+    os_ptimer func;
+    void *arg;
+    os_timer_type type;
+    uint32_t period;
+    uint32_t due;
+    bool running;
+};
+
+struct os_pool_cb : sim::HostObject {
+    uint32_t item_sz;
+    uint32_t pool_sz;
+    char *mem;
+    std::vector<void *, sim::HostAllocator<void *> > free_list;
+};
+
+struct os_messageQ_cb : sim::HostObject {
+    ValueQueue q;
+    uint32_t size;
+    WaitList getters;
+    WaitList putters;
+    ValueQueue pending_put;     // value a blocked putter is carrying
+};
+
+struct os_mailQ_cb : sim::HostObject {
+    os_pool_cb pool;
+    os_messageQ_cb *queue;
+    WaitList allocators;
+};
+
+/* kernel state */
+
+static bool kernel_running;
+static bool in_kernel;
+static bool resched;
+static uint32_t os_time;
+static uint32_t robin_ticks;
+static os_thread_cb *current;
+static os_thread_cb *zombie;
+static ucontext_t kernel_ctx;
+// containers behind an accessor: threads may be created from the
+// firmware's global constructors
+struct Lists {
+    WaitList threads;           // every thread with a stack
+    ReadyQueue ready[PRIO_LEVELS];
+    WaitList timed_waits;
+    TimerList timers;
+    TimerQueue timer_cbq;
+};
+
+static Lists &lists() {
+    static Lists l;
+    return l;
+}
+static os_thread_cb *timer_thread;
+// threads dropped by a reset, freed once we are off their stacks
+static std::vector<os_thread_cb *, sim::HostAllocator<os_thread_cb *> > halted;
+// profile: the thread the run time goes to, NULL for the idle demon
+static os_thread_cb *prof_run;
+static sim::time_ns prof_mark;
+static uint64_t prof_busy;
+static uint64_t prof_idle;
+
+static void tick(void *);
+static sim::FunctionEvent &systick() {
+    static sim::FunctionEvent e(tick, 0);
+    return e;
+}
+
+// the stretched SysTick interrupt: only there to wake the core
+static void stretch_end(void *) {
+}
+static sim::FunctionEvent &stretch() {
+    static sim::FunctionEvent e(stretch_end, 0);
+    return e;
+}
+
+// The control block outlives the thread so that a stale id (a Thread object
+// whose function returned) still reads as INACTIVE; only the stack goes.
+static void free_thread(os_thread_cb *t) {
+    if (t->def)
+        t->def->tcb.state = INACTIVE;
+    free(t->stack);
+    t->stack = NULL;
+    lists().threads.remove(t);
+}
+
+static void set_state(os_thread_cb *t, uint8_t state) {
+    t->state = state;
+    if (t->def)
+        t->def->tcb.state = state;
+}
+
+static void make_ready(os_thread_cb *t) {
+    set_state(t, READY);
+    lists().ready[PRIO_INDEX(t->prio)].push_back(t);
+    if (current && t->prio > current->prio)
+        resched = true;
+}
+
+static void unready(os_thread_cb *t) {
+    ReadyQueue &q = lists().ready[PRIO_INDEX(t->prio)];
+    for (ReadyQueue::iterator it = q.begin(); it != q.end(); ++it) {
+        if (*it == t) {
+            q.erase(it);
+            return;
+        }
+    }
+}
+
+static os_thread_cb *highest_ready() {
+    for (int i = PRIO_LEVELS - 1; i >= 0; i--)
+        if (!lists().ready[i].empty())
+            return lists().ready[i].front();
+    return NULL;
+}
+
+/* Charge the run time since the last switch to the thread that had the
+ * core, and count for next from now on. */
+static void prof_switch(os_thread_cb *next) {
+    sim::time_ns now = sim::cpu_time(sim::CPU_RUN);
+    uint64_t run = (uint64_t)(now - prof_mark) * (OS_CLOCK / 1000000) / 1000;
+    prof_mark = now;
+    if (prof_run) {
+        prof_run->cycles += run;
+        prof_busy += run;
+    } else {
+        prof_idle += run;
+    }
+    prof_run = next;
+}
+
+#if OS_TICKLESS
+/* os_suspend(), rt_tick_sleep() and os_resume() from the idle demon. */
+static void idle_tickless() {
+    uint32_t ticks = OS_TICKLESS_MAX;
+    for (WaitList::iterator it = lists().timed_waits.begin(); it != lists().timed_waits.end(); ++it) {
+        uint32_t d = (*it)->wake_tick - os_time;
+        if (d < ticks)
+            ticks = d;
+    }
+    for (TimerList::iterator it = lists().timers.begin(); it != lists().timers.end(); ++it) {
+        uint32_t d = (*it)->due - os_time;
+        if ((*it)->running && d < ticks)
+            ticks = d;
+    }
+    if (ticks <= 1 || !systick().pending()) {
+        if (!sim::idle(sim::CPU_SLEEP))
+            sim::stop("deadlock: all threads blocked with no wake-up pending");
+        return;
+    }
+
+    // the tick that is due is left to the SysTick handler
+    sim::time_ns period = OS_TICK_US * sim::US;
+    sim::time_ns first = systick().when();
+    systick().cancel();
+    stretch().schedule_at(first + (ticks - 2) * period);
+    sim::idle(sim::CPU_SLEEP);
+    stretch().cancel();
+
+    uint32_t elapsed = 0;
+    if (sim::now() >= first)
+        elapsed = (uint32_t)((sim::now() - first) / period) + 1;
+    if (elapsed > ticks - 1)
+        elapsed = ticks - 1;
+    os_time += elapsed;
+    robin_ticks = 0;
+    systick().schedule_at(first + elapsed * period);
+}
+#endif
+
+/* Leave the running thread (already moved to its new state) for the best
+ * ready one, idling the CPU until there is one. */
+static void schedule() {
+    os_thread_cb *prev = current;
+    in_kernel = true;
+    prof_switch(NULL);
+    os_thread_cb *next;
+    while ((next = highest_ready()) == NULL) {
+#if OS_TICKLESS
+        idle_tickless();
+#else
+        // os_idle_demon() spins, so the core stays in run mode
+        if (!sim::idle(sim::CPU_RUN))
+            sim::stop("deadlock: all threads blocked with no wake-up pending");
+#endif
+    }
+    unready(next);
+    set_state(next, RUNNING);
+    prof_switch(next);
+    current = next;
+    robin_ticks = 0;
+    resched = false;
+    in_kernel = false;
+    if (next != prev)
+        swapcontext(&prev->ctx, &next->ctx);
+    if (zombie && zombie != current) {
+        free_thread(zombie);
+        zombie = NULL;
+    }
+}
+
+static void preempt() {
+    make_ready(current);
+    schedule();
+}
+
+static void reschedule_hook() {
+    if (!kernel_running || in_kernel || !current || !resched)
+        return;
+    resched = false;
+    os_thread_cb *t = highest_ready();
+    if (!t)
+        return;
+    if (t->prio > current->prio || (robin_ticks >= OS_ROBINTOUT && t->prio == current->prio))
+        preempt();
+}
+
+/* blocking */
+
+static uint32_t ms_to_ticks(uint32_t millisec) {
+    return (millisec * 1000 + OS_TICK_US - 1) / OS_TICK_US;
+}
+
+static void block(uint8_t state, WaitList *list, uint32_t millisec) {
+    set_state(current, state);
+    current->waiting_on = list;
+    if (list) {
+        // priority order, FIFO within a priority
+        WaitList::iterator it = list->begin();
+        while (it != list->end() && (*it)->prio >= current->prio)
+            ++it;
+        list->insert(it, current);
+    }
+    current->timed = millisec != osWaitForever;
+    if (current->timed) {
+        current->wake_tick = os_time + ms_to_ticks(millisec);
+        lists().timed_waits.push_back(current);
+    }
+    schedule();
+}
+
+static void wake(os_thread_cb *t, osStatus status) {
+    if (t->waiting_on) {
+        t->waiting_on->remove(t);
+        t->waiting_on = NULL;
+    }
+    if (t->timed) {
+        lists().timed_waits.remove(t);
+        t->timed = false;
+    }
+    t->result.status = status;
+    make_ready(t);
+}
+
+/* SysTick */
+
+static void tick(void *) {
+    os_time++;
+    robin_ticks++;
+    systick().schedule_in(OS_TICK_US * sim::US);
+    sim::busy(OS_TICK_COST);
+
+    for (WaitList::iterator it = lists().timed_waits.begin(); it != lists().timed_waits.end(); ) {
+        os_thread_cb *t = *it++;
+        if ((int32_t)(os_time - t->wake_tick) >= 0)
+            wake(t, osEventTimeout);
+    }
+
+    for (TimerList::iterator it = lists().timers.begin(); it != lists().timers.end(); ++it) {
+        os_timer_cb *tm = *it;
+        if (tm->running && (int32_t)(os_time - tm->due) >= 0) {
+            if (tm->type == osTimerPeriodic)
+                tm->due += tm->period;
+            else
+                tm->running = false;
+            lists().timer_cbq.push_back(tm);
+        }
+    }
+    if (!lists().timer_cbq.empty() && timer_thread && timer_thread->state == WAIT_MBX)
+        wake(timer_thread, osOK);
+
+    if (robin_ticks >= OS_ROBINTOUT && current && !lists().ready[PRIO_INDEX(current->prio)].empty())
+        resched = true;
+}
+
+/* threads */
+
+static void thread_entry() {
+    os_thread_cb *t = current;
+    for (size_t i = 0; i < halted.size(); i++) {
+        free(halted[i]->stack);
+        halted[i]->stack = NULL;
+    }
+    halted.clear();
+    t->func(t->arg);
+    // returning from the thread function ends the thread
+    set_state(t, INACTIVE);
+    zombie = t;
+    schedule();
+}
+
+static void timer_thread_fn(void const *) {
+    for (;;) {
+        while (lists().timer_cbq.empty())
+            block(WAIT_MBX, NULL, osWaitForever);
+        os_timer_cb *tm = lists().timer_cbq.front();
+        lists().timer_cbq.pop_front();
+        tm->func(tm->arg);
+    }
+}
+
+osThreadId osThreadCreate(osThreadDef_t *thread_def, void *argument) {
+    if (sim::in_isr() || !thread_def || !thread_def->pthread)
+        return NULL;
+    os_thread_cb *t = new os_thread_cb;
+    memset(&t->result, 0, sizeof(t->result));
+    t->stack = (char *)malloc(HOST_STACK_SIZE);
+    t->func = thread_def->pthread;
+    t->arg = argument;
+    t->prio = thread_def->tpriority;
+    t->def = thread_def;
+    t->requested_stack = thread_def->stacksize ? thread_def->stacksize : DEFAULT_STACK_SIZE;
+    t->signals = 0;
+    t->wait_signals = 0;
+    t->waiting_on = NULL;
+    t->timed = false;
+    t->cycles = 0;
+    thread_def->tcb.priv_stack = t->requested_stack;
+
+    getcontext(&t->ctx);
+    t->ctx.uc_stack.ss_sp = t->stack;
+    t->ctx.uc_stack.ss_size = HOST_STACK_SIZE;
+    t->ctx.uc_link = NULL;
+    makecontext(&t->ctx, thread_entry, 0);
+    lists().threads.push_back(t);
+
+    make_ready(t);
+    if (kernel_running && current && t->prio > current->prio)
+        preempt();
+    return t;
+}
+
+osThreadId osThreadGetId(void) {
+    return sim::in_isr() ? NULL : current;
+}
+
+osStatus osThreadTerminate(osThreadId thread_id) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (!thread_id || thread_id->state == INACTIVE)
+        return osErrorResource;
+    if (thread_id == current) {
+        set_state(current, INACTIVE);
+        zombie = current;
+        schedule();
+        return osOK;    // not reached
+    }
+    if (thread_id->state == READY)
+        unready(thread_id);
+    if (thread_id->waiting_on)
+        thread_id->waiting_on->remove(thread_id);
+    if (thread_id->timed)
+        lists().timed_waits.remove(thread_id);
+    if (thread_id == timer_thread)
+        timer_thread = NULL;
+    set_state(thread_id, INACTIVE);
+    free_thread(thread_id);
+    return osOK;
+}
+
+osStatus osThreadYield(void) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (!lists().ready[PRIO_INDEX(current->prio)].empty())
+        preempt();
+    return osOK;
+}
+
+osStatus osThreadSetPriority(osThreadId thread_id, osPriority priority) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (!thread_id || thread_id->state == INACTIVE)
+        return osErrorParameter;
+    if (priority < osPriorityIdle || priority > osPriorityRealtime)
+        return osErrorValue;
+    if (thread_id->state == READY) {
+        unready(thread_id);
+        thread_id->prio = priority;
+        make_ready(thread_id);
+    } else {
+        thread_id->prio = priority;
+    }
+    os_thread_cb *t = highest_ready();
+    if (t && current && t->prio > current->prio)
+        preempt();
+    return osOK;
+}
+
+osPriority osThreadGetPriority(osThreadId thread_id) {
+    if (!thread_id || thread_id->state == INACTIVE)
+        return osPriorityError;
+    return thread_id->prio;
+}
+
+osStatus osThreadGetCycles(osThreadId thread_id, uint64_t *cycles) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (!thread_id || thread_id->state == INACTIVE || !cycles)
+        return osErrorParameter;
+    prof_switch(current);
+    *cycles = thread_id->cycles;
+    return osOK;
+}
+
+osStatus osDelay(uint32_t millisec) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (millisec == 0)
+        return osOK;
+    block(WAIT_DLY, NULL, millisec);
+    return osEventTimeout;
+}
+
+/* kernel */
+
+static void halt();
+static void boot();
+
+osStatus osKernelInitialize(void) {
+    sim::set_reschedule_hook(reschedule_hook);
+    sim::set_reset_hooks(halt, boot);
+    return osOK;
+}
+
+static osThreadDef_t os_thread_def_osTimerThread = { timer_thread_fn, OS_TIMERPRIO, 4 * DEFAULT_STACK_SIZE, NULL };
+
+static os_thread_cb *start() {
+    timer_thread = osThreadCreate(&os_thread_def_osTimerThread, NULL);
+    kernel_running = true;
+    systick().schedule_in(OS_TICK_US * sim::US);
+
+    os_thread_cb *next = highest_ready();
+    if (next) {
+        unready(next);
+        set_state(next, RUNNING);
+        current = next;
+    }
+    prof_run = next;
+    prof_mark = sim::cpu_time(sim::CPU_RUN);
+    return next;
+}
+
+osStatus osKernelStart(void) {
+    if (kernel_running)
+        return osOK;
+    os_thread_cb *next = start();
+    if (!next)
+        return osErrorResource;
+    swapcontext(&kernel_ctx, &next->ctx);
+    return osOK;
+}
+
+int32_t osKernelRunning(void) {
+    return kernel_running;
+}
+
+osStatus osKernelGetProfile(osProfile *profile) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (!profile)
+        return osErrorParameter;
+    prof_switch(current);
+    profile->elapsed = (uint64_t)os_time * OS_TICK_US * (OS_CLOCK / 1000000);
+    profile->threads = prof_busy;
+    profile->idle = prof_idle;
+    profile->isr = 0;
+    return osOK;
+}
+
+osStatus osKernelGetIrqProfile(uint32_t, osIrqProfile *) {
+    return sim::in_isr() ? osErrorISR : osErrorParameter;
+}
+
+/* signals */
+
+int32_t osSignalSet(osThreadId thread_id, int32_t signals) {
+    if (!thread_id || thread_id->state == INACTIVE)
+        return 0x80000000;
+    int32_t prev = thread_id->signals;
+    thread_id->signals |= signals;
+    int32_t want = thread_id->wait_signals;
+    int32_t have = thread_id->signals;
+    if ((thread_id->state == WAIT_OR && (have & want)) ||
+        (thread_id->state == WAIT_AND && (have & want) == want)) {
+        int32_t got = thread_id->state == WAIT_OR ? (have & want) : want;
+        thread_id->signals &= ~got;
+        thread_id->result.value.signals = got;
+        wake(thread_id, osEventSignal);
+    }
+    return prev;
+}
+
+int32_t osSignalClear(osThreadId thread_id, int32_t signals) {
+    if (sim::in_isr() || !thread_id || thread_id->state == INACTIVE)
+        return 0x80000000;
+    int32_t prev = thread_id->signals;
+    thread_id->signals &= ~signals;
+    return prev;
+}
+
+int32_t osSignalGet(osThreadId thread_id) {
+    if (!thread_id || thread_id->state == INACTIVE)
+        return 0x80000000;
+    return thread_id->signals;
+}
+
+osEvent osSignalWait(int32_t signals, uint32_t millisec) {
+    osEvent ev;
+    memset(&ev, 0, sizeof(ev));
+    if (sim::in_isr()) {
+        ev.status = osErrorISR;
+        return ev;
+    }
+    int32_t have = current->signals;
+    bool any = signals == 0;
+    int32_t want = any ? 0xFFFF : signals;
+    if ((any && have) || (!any && (have & want) == want)) {
+        int32_t got = any ? have : want;
+        current->signals &= ~got;
+        ev.status = osEventSignal;
+        ev.value.signals = got;
+        return ev;
+    }
+    if (millisec == 0) {
+        ev.status = osOK;
+        return ev;
+    }
+    current->wait_signals = want;
+    block(any ? WAIT_OR : WAIT_AND, NULL, millisec);
+    ev = current->result;
+    if (ev.status != osEventSignal)
+        ev.value.signals = 0;
+    return ev;
+}
+
+/* timers */
+
+osTimerId osTimerCreate(osTimerDef_t *timer_def, os_timer_type type, void *argument) {
+    if (sim::in_isr() || !timer_def || !timer_def->ptimer)
+        return NULL;
+    os_timer_cb *tm = new os_timer_cb;
+    tm->func = timer_def->ptimer;
+    tm->arg = argument;
+    tm->type = type;
+    tm->period = 0;
+    tm->due = 0;
+    tm->running = false;
+    lists().timers.push_back(tm);
+    return tm;
+}
+
+osStatus osTimerStart(osTimerId timer_id, uint32_t millisec) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (!timer_id)
+        return osErrorParameter;
+    if (millisec == 0)
+        return osErrorValue;
+    timer_id->period = ms_to_ticks(millisec);
+    timer_id->due = os_time + timer_id->period;
+    timer_id->running = true;
+    return osOK;
+}
+
+osStatus osTimerStop(osTimerId timer_id) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (!timer_id)
+        return osErrorParameter;
+    if (!timer_id->running)
+        return osErrorResource;
+    timer_id->running = false;
+    return osOK;
+}
+
+osStatus osTimerDelete(osTimerId timer_id) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (!timer_id)
+        return osErrorParameter;
+    lists().timers.remove(timer_id);
+    for (TimerQueue::iterator it = lists().timer_cbq.begin(); it != lists().timer_cbq.end(); ) {
+        if (*it == timer_id)
+            it = lists().timer_cbq.erase(it);
+        else
+            ++it;
+    }
+    delete timer_id;
+    return osOK;
+}
+
+/* mutexes */
+
+osMutexId osMutexCreate(osMutexDef_t *mutex_def) {
+    if (sim::in_isr() || !mutex_def)
+        return NULL;
+    os_mutex_cb *m = new os_mutex_cb;
+    m->owner = NULL;
+    m->count = 0;
+    return m;
+}
+
+osStatus osMutexWait(osMutexId mutex_id, uint32_t millisec) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (!mutex_id)
+        return osErrorParameter;
+    if (!mutex_id->owner || mutex_id->owner == current) {
+        mutex_id->owner = current;
+        mutex_id->count++;
+        return osOK;
+    }
+    if (millisec == 0)
+        return osErrorResource;
+    block(WAIT_MUT, &mutex_id->waiters, millisec);
+    return current->result.status == osOK ? osOK : osErrorTimeoutResource;
+}
+
+osStatus osMutexRelease(osMutexId mutex_id) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (!mutex_id)
+        return osErrorParameter;
+    if (mutex_id->owner != current)
+        return osErrorResource;
+    if (--mutex_id->count)
+        return osOK;
+    mutex_id->owner = NULL;
+    if (!mutex_id->waiters.empty()) {
+        os_thread_cb *t = mutex_id->waiters.front();
+        mutex_id->owner = t;
+        mutex_id->count = 1;
+        wake(t, osOK);
+        if (t->prio > current->prio)
+            preempt();
+    }
+    return osOK;
+}
+
+osStatus osMutexDelete(osMutexId mutex_id) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (!mutex_id)
+        return osErrorParameter;
+    while (!mutex_id->waiters.empty())
+        wake(mutex_id->waiters.front(), osErrorResource);
+    delete mutex_id;
+    return osOK;
+}
+
+/* semaphores */
+
+osSemaphoreId osSemaphoreCreate(osSemaphoreDef_t *semaphore_def, int32_t count) {
+    if (sim::in_isr() || !semaphore_def || count < 0 || count > osFeature_Semaphore)
+        return NULL;
+    os_semaphore_cb *s = new os_semaphore_cb;
+    s->tokens = count;
+    return s;
+}
+
+int32_t osSemaphoreWait(osSemaphoreId semaphore_id, uint32_t millisec) {
+    if (sim::in_isr() || !semaphore_id)
+        return -1;
+    if (semaphore_id->tokens > 0) {
+        semaphore_id->tokens--;
+        return semaphore_id->tokens + 1;
+    }
+    if (millisec == 0)
+        return 0;
+    block(WAIT_SEM, &semaphore_id->waiters, millisec);
+    if (current->result.status != osOK)
+        return 0;
+    return semaphore_id->tokens + 1;
+}
+
+osStatus osSemaphoreRelease(osSemaphoreId semaphore_id) {
+    if (!semaphore_id)
+        return osErrorParameter;
+    if (!semaphore_id->waiters.empty()) {
+        os_thread_cb *t = semaphore_id->waiters.front();
+        wake(t, osOK);
+        if (!sim::in_isr() && t->prio > current->prio)
+            preempt();
+        return osOK;
+    }
+    if (semaphore_id->tokens >= osFeature_Semaphore)
+        return osErrorResource;
+    semaphore_id->tokens++;
+    return osOK;
+}
+
+osStatus osSemaphoreDelete(osSemaphoreId semaphore_id) {
+    if (sim::in_isr())
+        return osErrorISR;
+    if (!semaphore_id)
+        return osErrorParameter;
+    while (!semaphore_id->waiters.empty())
+        wake(semaphore_id->waiters.front(), osErrorResource);
+    delete semaphore_id;
+    return osOK;
+}
+
+/* memory pools */
+
+static void pool_init(os_pool_cb *p, uint32_t pool_sz, uint32_t item_sz) {
+    p->item_sz = (item_sz + 7) & ~7u;
+    p->pool_sz = pool_sz;
+    p->mem = (char *)malloc((size_t)p->item_sz * pool_sz);
+    for (uint32_t i = pool_sz; i > 0; i--)
+        p->free_list.push_back(p->mem + (size_t)(i - 1) * p->item_sz);
+}
+
+osPoolId osPoolCreate(osPoolDef_t *pool_def) {
+    if (sim::in_isr() || !pool_def || !pool_def->pool_sz || !pool_def->item_sz)
+        return NULL;
+    os_pool_cb *p = new os_pool_cb;
+    pool_init(p, pool_def->pool_sz, pool_def->item_sz);
+    return p;
+}
+
+void *osPoolAlloc(osPoolId pool_id) {
+    if (!pool_id || pool_id->free_list.empty())
+        return NULL;
+    void *item = pool_id->free_list.back();
+    pool_id->free_list.pop_back();
+    return item;
+}
+
+void *osPoolCAlloc(osPoolId pool_id) {
+    void *item = osPoolAlloc(pool_id);
+    if (item)
+        memset(item, 0, pool_id->item_sz);
+    return item;
+}
+
+osStatus osPoolFree(osPoolId pool_id, void *block) {
+    if (!pool_id)
+        return osErrorParameter;
+    char *b = (char *)block;
+    if (b < pool_id->mem || b >= pool_id->mem + (size_t)pool_id->item_sz * pool_id->pool_sz)
+        return osErrorValue;
+    pool_id->free_list.push_back(block);
+    return osOK;
+}
+
+/* message queues */
+
+osMessageQId osMessageCreate(osMessageQDef_t *queue_def, osThreadId thread_id) {
+    if (sim::in_isr() || !queue_def || !queue_def->queue_sz)
+        return NULL;
+    os_messageQ_cb *q = new os_messageQ_cb;
+    q->size = queue_def->queue_sz;
+    return q;
+}
+
+osStatus osMessagePut(osMessageQId queue_id, uint32_t info, uint32_t millisec) {
+    if (!queue_id)
+        return osErrorParameter;
+    if (!queue_id->getters.empty()) {
+        os_thread_cb *t = queue_id->getters.front();
+        t->result.value.v = info;
+        wake(t, osEventMessage);
+        if (!sim::in_isr() && t->prio > current->prio)
+            preempt();
+        return osOK;
+    }
+    if (queue_id->q.size() < queue_id->size) {
+        queue_id->q.push_back(info);
+        return osOK;
+    }
+    if (millisec == 0 || sim::in_isr())
+        return osErrorResource;
+    queue_id->pending_put.push_back(info);
+    block(WAIT_MBX, &queue_id->putters, millisec);
+    if (current->result.status != osOK) {
+        // timed out: take our message back
+        for (ValueQueue::iterator it = queue_id->pending_put.begin(); it != queue_id->pending_put.end(); ++it) {
+            if (*it == info) {
+                queue_id->pending_put.erase(it);
+                break;
+            }
+        }
+        return osErrorTimeoutResource;
+    }
+    return osOK;
+}
+
+osEvent osMessageGet(osMessageQId queue_id, uint32_t millisec) {
+    osEvent ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.def.message_id = queue_id;
+    if (!queue_id) {
+        ev.status = osErrorParameter;
+        return ev;
+    }
+    if (!queue_id->q.empty()) {
+        ev.status = osEventMessage;
+        ev.value.v = queue_id->q.front();
+        queue_id->q.pop_front();
+        if (!queue_id->putters.empty()) {
+            // a blocked putter's message takes the freed slot
+            os_thread_cb *t = queue_id->putters.front();
+            queue_id->q.push_back(queue_id->pending_put.front());
+            queue_id->pending_put.pop_front();
+            wake(t, osOK);
+        }
+        return ev;
+    }
+    if (millisec == 0 || sim::in_isr()) {
+        ev.status = millisec == 0 ? osOK : osErrorParameter;
+        return ev;
+    }
+    block(WAIT_MBX, &queue_id->getters, millisec);
+    ev.status = current->result.status;
+    if (ev.status == osEventMessage)
+        ev.value.v = current->result.value.v;
+    return ev;
+}
+
+/* mail queues */
+
+osMailQId osMailCreate(osMailQDef_t *queue_def, osThreadId thread_id) {
+    if (sim::in_isr() || !queue_def || !queue_def->queue_sz || !queue_def->item_sz)
+        return NULL;
+    os_mailQ_cb *m = new os_mailQ_cb;
+    pool_init(&m->pool, queue_def->queue_sz, queue_def->item_sz);
+    osMessageQDef_t qdef = { queue_def->queue_sz, NULL };
+    m->queue = osMessageCreate(&qdef, thread_id);
+    return m;
+}
+
+void *osMailAlloc(osMailQId queue_id, uint32_t millisec) {
+    if (!queue_id)
+        return NULL;
+    void *mail = osPoolAlloc(&queue_id->pool);
+    if (mail || millisec == 0 || sim::in_isr())
+        return mail;
+    block(WAIT_MBX, &queue_id->allocators, millisec);
+    return current->result.status == osOK ? current->result.value.p : NULL;
+}
+
+void *osMailCAlloc(osMailQId queue_id, uint32_t millisec) {
+    void *mail = osMailAlloc(queue_id, millisec);
+    if (mail)
+        memset(mail, 0, queue_id->pool.item_sz);
+    return mail;
+}
+
+// mail travels through the message queue as an index into the pool
+static uint32_t mail_index(os_mailQ_cb *m, void *mail) {
+    return (uint32_t)(((char *)mail - m->pool.mem) / m->pool.item_sz);
+}
+
+osStatus osMailPut(osMailQId queue_id, void *mail) {
+    if (!queue_id)
+        return osErrorParameter;
+    if (!mail)
+        return osErrorValue;
+    return osMessagePut(queue_id->queue, mail_index(queue_id, mail), 0);
+}
+
+osEvent osMailGet(osMailQId queue_id, uint32_t millisec) {
+    osEvent ev;
+    memset(&ev, 0, sizeof(ev));
+    if (!queue_id) {
+        ev.status = osErrorParameter;
+        return ev;
+    }
+    ev = osMessageGet(queue_id->queue, millisec);
+    if (ev.status == osEventMessage) {
+        ev.status = osEventMail;
+        ev.value.p = queue_id->pool.mem + (size_t)ev.value.v * queue_id->pool.item_sz;
+    }
+    ev.def.mail_id = queue_id;
+    return ev;
+}
+
+osStatus osMailFree(osMailQId queue_id, void *mail) {
+    if (!queue_id)
+        return osErrorParameter;
+    if (!queue_id->allocators.empty()) {
+        // hand the block straight to a waiting allocator
+        os_thread_cb *t = queue_id->allocators.front();
+        t->result.value.p = mail;
+        wake(t, osOK);
+        return osOK;
+    }
+    return osPoolFree(&queue_id->pool, mail);
+}
+
+/* startup, as RTX_CM_lib.h does it for GCC_ARM with -Wl,--wrap,main */
+
+extern "C" int __real_main(void);
+
+static void main_thread(void const *) {
+    __real_main();
+    sim::stop("main() returned");
+}
+
+osThreadDef_t os_thread_def_main = { main_thread, osPriorityNormal, 0, NULL };
+
+// Reset: every thread and timer goes, the running thread's stack included,
+// so the stacks are only freed by the first thread of the next boot.  The
+// control blocks stay behind for the Thread objects that still point at them.
+static void halt() {
+    Lists &l = lists();
+    systick().cancel();
+    stretch().cancel();
+    kernel_running = false;
+    for (WaitList::iterator it = l.threads.begin(); it != l.threads.end(); ++it) {
+        set_state(*it, INACTIVE);
+        (*it)->waiting_on = NULL;
+        (*it)->timed = false;
+        halted.push_back(*it);
+    }
+    l.threads.clear();
+    for (int i = 0; i < PRIO_LEVELS; i++)
+        l.ready[i].clear();
+    l.timed_waits.clear();
+    l.timers.clear();
+    l.timer_cbq.clear();
+    zombie = NULL;
+    timer_thread = NULL;
+    current = NULL;
+    os_time = 0;
+    robin_ticks = 0;
+    resched = false;
+    prof_run = NULL;
+    prof_busy = 0;
+    prof_idle = 0;
+}
+
+static void boot() {
+    osThreadCreate(&os_thread_def_main, NULL);
+    os_thread_cb *next = start();
+    setcontext(&next->ctx);
+}
+
+extern "C" int __wrap_main(void) {
+    osKernelInitialize();
+    osThreadCreate(&os_thread_def_main, NULL);
+    osKernelStart();
+    sim::stop("main() returned");
+    return 0;
+}
@@ -0,0 +1,65 @@
+/* host simulator - heap accounting
+ *
+ * Replaces the global operator new and delete, which are what std::vector,
+ * std::string and new itself come down to, and counts the calls the
+ * firmware makes.  The simulator's own containers (event queue, RTX control
+ * blocks and wait lists, line listeners, the report) allocate inside a
+ * SimHeap scope and are not counted: on the board those are static or do not
+ * exist.
+ */
+#include "sim.h"
+
+#include <stdlib.h>
+#include <new>
+
+namespace sim {
+
+static unsigned sim_depth;
+static unsigned long allocations;
+
+SimHeap::SimHeap() {
+    sim_depth++;
+}
+
+SimHeap::~SimHeap() {
+    sim_depth--;
+}
+
+unsigned long heap_allocations() {
+    return allocations;
+}
+
+void *host_alloc(size_t n) {
+    void *p = malloc(n ? n : 1);
+    if (!p)
+        abort();
+    return p;
+}
+
+void host_free(void *p) {
+    free(p);
+}
+
+static void *allocate(size_t n) {
+    if (!sim_depth)
+        allocations++;
+    return host_alloc(n);
+}
+
+} // namespace sim
+
+void *operator new(size_t n) {
+    return sim::allocate(n);
+}
+
+void *operator new[](size_t n) {
+    return sim::allocate(n);
+}
+
+void operator delete(void *p) throw() {
+    sim::host_free(p);
+}
+
+void operator delete[](void *p) throw() {
+    sim::host_free(p);
+}
@@ -0,0 +1,47 @@
+/* host simulator - devices on a hardware I2C bus */
+#include "i2c_device.h"
+
+#include <map>
+#include <vector>
+
+namespace sim {
+
+static std::vector<I2CDevice *> &devices() {
+    static std::vector<I2CDevice *> list;
+    return list;
+}
+
+I2CDevice::I2CDevice(PinName sda, uint8_t address) : _sda(sda), _address(address) {
+    devices().push_back(this);
+}
+
+I2CDevice::~I2CDevice() {
+    std::vector<I2CDevice *> &l = devices();
+    for (size_t i = 0; i < l.size(); i++) {
+        if (l[i] == this) {
+            l.erase(l.begin() + i);
+            break;
+        }
+    }
+}
+
+I2CDevice *I2CDevice::find(PinName sda, uint8_t address) {
+    std::vector<I2CDevice *> &l = devices();
+    for (size_t i = 0; i < l.size(); i++) {
+        if (l[i]->_sda == sda && l[i]->_address == address)
+            return l[i];
+    }
+    return 0;
+}
+
+Bus &i2c_bus(PinName sda) {
+    static std::map<int, Bus *> buses;
+    std::map<int, Bus *>::iterator it = buses.find((int)sda);
+    if (it != buses.end())
+        return *it->second;
+    Bus *bus = new Bus("i2c", 0, true);
+    buses[(int)sda] = bus;
+    return *bus;
+}
+
+} // namespace sim
@@ -0,0 +1,42 @@
+/* host simulator - devices on a hardware I2C bus
+ *
+ * The I2C peripheral is simulated at byte level: the HAL finds the device by
+ * its 7-bit address on the bus identified by the SDA pin and charges nine
+ * SCL periods per byte.
+ */
+#ifndef HOST_SIM_I2C_DEVICE_H
+#define HOST_SIM_I2C_DEVICE_H
+
+#include "PinNames.h"
+#include "sim.h"
+
+namespace sim {
+
+class I2CDevice {
+public:
+    I2CDevice(PinName sda, uint8_t address);
+    virtual ~I2CDevice();
+
+    uint8_t address() const { return _address; }
+
+    /** START or repeated START addressed to this device. */
+    virtual void i2c_start(bool read) {}
+    /** Byte from the master; returns ACK. */
+    virtual bool i2c_write(uint8_t data) = 0;
+    /** Byte to the master. */
+    virtual uint8_t i2c_read() = 0;
+    virtual void i2c_stop() {}
+
+    static I2CDevice *find(PinName sda, uint8_t address);
+
+private:
+    PinName _sda;
+    uint8_t _address;
+};
+
+/** Accounting for the I2C bus whose SDA is on the given pin. */
+Bus &i2c_bus(PinName sda);
+
+} // namespace sim
+
+#endif
@@ -0,0 +1,112 @@
+/* host simulator - GPIO lines */
+#include "line.h"
+#include "power.h"
+
+#include <map>
+
+namespace sim {
+
+// a read loop this long with nothing else going on is waiting for an event
+static const unsigned SPIN_LIMIT = 1u << 16;
+
+Line &Line::get(PinName pin) {
+    static std::map<int, Line *> lines;
+    std::map<int, Line *>::iterator it = lines.find((int)pin);
+    if (it != lines.end())
+        return *it->second;
+    Line *l = new Line(pin);
+    lines[(int)pin] = l;
+    return *l;
+}
+
+Line::Line(PinName pin) :
+    _pin(pin), _level(0), _output(false), _value(0), _mode(PullNone),
+    _pullup(false), _bus(0), _spin_activity(0), _spin_count(0) {
+}
+
+void Line::mcu_config(bool output, PinMode mode) {
+    _output = output;
+    _mode = mode;
+    update();
+}
+
+void Line::mcu_write(int value) {
+    _value = value ? 1 : 0;
+    update();
+}
+
+int Line::mcu_read() {
+    busy(power::GPIO_READ_NS);
+    if (_spin_activity == activity()) {
+        if (++_spin_count >= SPIN_LIMIT) {
+            _spin_count = 0;
+            fast_forward();
+        }
+    } else {
+        _spin_count = 0;
+    }
+    _spin_activity = activity();
+    return _level;
+}
+
+void Line::pull_low(const void *dev, bool low) {
+    for (size_t i = 0; i < _low.size(); i++) {
+        if (_low[i] == dev) {
+            if (!low) {
+                _low.erase(_low.begin() + i);
+                update();
+            }
+            return;
+        }
+    }
+    if (low) {
+        _low.push_back(dev);
+        update();
+    }
+}
+
+void Line::set_pullup(bool on) {
+    _pullup = on;
+    update();
+}
+
+void Line::add_listener(LineListener *l) {
+    _listeners.push_back(l);
+}
+
+void Line::remove_listener(LineListener *l) {
+    for (size_t i = 0; i < _listeners.size(); i++) {
+        if (_listeners[i] == l) {
+            _listeners.erase(_listeners.begin() + i);
+            return;
+        }
+    }
+}
+
+void Line::update() {
+    int level;
+    bool drives = _output && !(_mode == OpenDrain && _value);
+    if (!_low.empty())
+        level = 0;
+    else if (drives)
+        level = _value;
+    else if (_pullup || _mode == PullUp)
+        level = 1;
+    else if (_mode == PullDown)
+        level = 0;
+    else
+        level = _level;     // floating: keeps its charge
+
+    if (level == _level)
+        return;
+    _level = level;
+    touch();
+    if (_bus)
+        _bus->edge();
+    // listeners may react by pulling the line themselves
+    Listeners listeners(_listeners);
+    for (size_t i = 0; i < listeners.size(); i++)
+        listeners[i]->line_changed(*this);
+}
+
+} // namespace sim
@@ -0,0 +1,72 @@
+/* host simulator - GPIO lines
+ *
+ * Every MCU pin is a wired-AND line: it is low if the MCU drives it low or
+ * any attached device pulls it low, otherwise it follows the MCU output, the
+ * MCU pull resistor or an external pull-up on the board.  Devices and pin
+ * interrupts watch lines through LineListener.
+ */
+#ifndef HOST_SIM_LINE_H
+#define HOST_SIM_LINE_H
+
+#include "PinNames.h"
+#include "sim.h"
+
+#include <vector>
+
+namespace sim {
+
+class Line;
+
+class LineListener {
+public:
+    virtual ~LineListener() {}
+    virtual void line_changed(Line &line) = 0;
+};
+
+class Line {
+public:
+    /** The line behind a pin, created on first use. */
+    static Line &get(PinName pin);
+
+    PinName pin() const { return _pin; }
+    int level() const { return _level; }
+
+    /** MCU side, from the gpio HAL. */
+    void mcu_config(bool output, PinMode mode);
+    void mcu_write(int value);
+    int mcu_read();
+
+    /** Device side: open-drain pull-down owned by dev. */
+    void pull_low(const void *dev, bool low);
+
+    /** Board side: resistor to VDD. */
+    void set_pullup(bool on);
+    void set_bus(Bus *bus) { _bus = bus; }
+
+    void add_listener(LineListener *l);
+    void remove_listener(LineListener *l);
+
+private:
+    Line(PinName pin);
+    void update();
+
+    PinName _pin;
+    int _level;
+    bool _output;
+    int _value;
+    PinMode _mode;
+    bool _pullup;
+    Bus *_bus;
+    typedef std::vector<LineListener *, HostAllocator<LineListener *> > Listeners;
+
+    std::vector<const void *, HostAllocator<const void *> > _low;
+    Listeners _listeners;
+
+    // spin detection for mcu_read()
+    uint64_t _spin_activity;
+    unsigned _spin_count;
+};
+
+} // namespace sim
+
+#endif
@@ -0,0 +1,43 @@
+/* host simulator - power model
+ *
+ * Rough supply currents for an mDot on the rain-garden board at 3.3 V.  The
+ * MCU figures include the module's regulator and radio in standby; radio
+ * figures are for the SX1272 at +20 dBm.  They are estimates meant for
+ * comparing firmware variants against each other, so tune them to bench
+ * measurements before quoting absolute battery life.
+ */
+#ifndef HOST_SIM_POWER_H
+#define HOST_SIM_POWER_H
+
+namespace sim {
+namespace power {
+
+static const double SUPPLY_V          = 3.3;
+
+// STM32F411 at 96 MHz running / WFI sleep / STOP with RTC / standby with RTC
+static const double MCU_RUN_MA        = 14.0;
+static const double MCU_SLEEP_MA      = 6.0;
+static const double MCU_DEEPSLEEP_MA  = 0.05;
+static const double MCU_STANDBY_MA    = 0.02;
+
+static const double RADIO_TX_MA       = 120.0;
+static const double RADIO_RX_MA       = 11.5;
+
+static const double DHT22_IDLE_MA     = 0.05;
+static const double DHT22_ACTIVE_MA   = 1.5;
+static const double DS18B20_IDLE_MA   = 0.001;
+static const double DS18B20_ACTIVE_MA = 1.0;
+static const double SHT1X_IDLE_MA     = 0.0003;
+static const double SHT1X_ACTIVE_MA   = 0.55;
+static const double TSL2561_OFF_MA    = 0.0032;
+static const double TSL2561_ON_MA     = 0.24;
+
+// cost of a single GPIO register access from a DigitalInOut, in ns
+static const unsigned GPIO_READ_NS    = 40;
+static const unsigned GPIO_WRITE_NS   = 40;
+static const unsigned GPIO_CONFIG_NS  = 200;
+
+} // namespace power
+} // namespace sim
+
+#endif
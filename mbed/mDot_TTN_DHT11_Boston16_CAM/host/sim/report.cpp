@@ -0,0 +1,445 @@
+/* host simulator - bus accounting and the per-cycle report
+ *
+ * A cycle runs from the return of one mDot::send() to the return of the next
+ * one, so it holds the sleep before sampling, the acquisition and the uplink
+ * itself.  Acquisition latency is measured from the first sensor-bus edge of
+ * the cycle to the start of send().
+ *
+ * With --decode the delivered uplinks are decoded as the network would, in
+ * the order they arrive, with the firmware's own payload descriptions.
+ */
+#include "sim.h"
+#include "power.h"
+#include "DeltaPayload.h"
+#include "SensorPayload.h"
+#include "SensorStats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+namespace sim {
+
+/* buses */
+
+std::vector<Bus *> &bus_list() {
+    static std::vector<Bus *> list;
+    return list;
+}
+
+const std::vector<Bus *> &Bus::all() {
+    return bus_list();
+}
+
+static time_ns acq_start;
+static bool acq_started;
+
+Bus::Bus(const char *name, time_ns max_gap, bool sensor) :
+    _name(name), _max_gap(max_gap), _last(FOREVER), _busy(0),
+    _transactions(0), _sensor(sensor) {
+    bus_list().push_back(this);
+}
+
+void Bus::edge() {
+    time_ns t = now();
+    if (_last != FOREVER && t - _last <= _max_gap)
+        _busy += t - _last;
+    _last = t;
+    if (_sensor && !acq_started) {
+        acq_started = true;
+        acq_start = t;
+    }
+}
+
+void Bus::transfer(time_ns dt) {
+    if (_sensor && !acq_started) {
+        acq_started = true;
+        acq_start = now();
+    }
+    _busy += dt;
+    _last = now() + dt;
+}
+
+/* cycles */
+
+struct Snapshot {
+    time_ns t;
+    time_ns cpu[CPU_MODES];
+    double mJ;
+    unsigned long allocs;
+    std::vector<time_ns> bus;
+    std::vector<uint32_t> txn;
+
+    void take() {
+        t = now();
+        for (int m = 0; m < CPU_MODES; m++)
+            cpu[m] = cpu_time((CpuMode)m);
+        mJ = energy_mJ();
+        const std::vector<Bus *> &b = Bus::all();
+        bus.resize(b.size());
+        txn.resize(b.size());
+        for (size_t i = 0; i < b.size(); i++) {
+            bus[i] = b[i]->busy_time();
+            txn[i] = b[i]->transactions();
+        }
+    }
+};
+
+struct Cycle {
+    time_ns start;
+    time_ns period;
+    time_ns acq;
+    time_ns cpu[CPU_MODES];
+    std::vector<time_ns> bus;
+    std::vector<uint32_t> txn;
+    time_ns airtime;
+    double mJ;
+    unsigned long allocs;
+    int datarate;
+    bool delivered;
+    std::vector<uint8_t> payload;
+};
+
+static Snapshot last;
+static bool have_last;
+static time_ns send_start;
+static std::vector<Cycle> &cycles() {
+    static std::vector<Cycle> list;
+    return list;
+}
+
+void uplink_begin() {
+    send_start = now();
+}
+
+static double ms(time_ns t) {
+    return (double)t / (double)MS;
+}
+
+void uplink_end(const uint8_t *data, size_t len, time_ns airtime, int datarate, bool delivered) {
+    unsigned long allocs = heap_allocations();
+    SimHeap scope;
+    if (!have_last) {
+        last.take();
+        last.t = 0;
+        last.allocs = 0;
+        for (int m = 0; m < CPU_MODES; m++)
+            last.cpu[m] = 0;
+        last.mJ = 0;
+        for (size_t i = 0; i < last.bus.size(); i++) {
+            last.bus[i] = 0;
+            last.txn[i] = 0;
+        }
+        have_last = true;
+    }
+    Snapshot cur;
+    cur.take();
+    cur.allocs = allocs;    // not the report's own
+
+    Cycle c;
+    c.start = last.t;
+    c.period = cur.t - last.t;
+    c.acq = acq_started && acq_start < send_start ? send_start - acq_start : 0;
+    for (int m = 0; m < CPU_MODES; m++)
+        c.cpu[m] = cur.cpu[m] - last.cpu[m];
+    c.bus.resize(cur.bus.size());
+    c.txn.resize(cur.bus.size());
+    for (size_t i = 0; i < cur.bus.size(); i++) {
+        c.bus[i] = cur.bus[i] - (i < last.bus.size() ? last.bus[i] : 0);
+        c.txn[i] = cur.txn[i] - (i < last.txn.size() ? last.txn[i] : 0);
+    }
+    c.airtime = airtime;
+    c.mJ = cur.mJ - last.mJ;
+    c.allocs = cur.allocs - last.allocs;
+    c.datarate = datarate;
+    c.delivered = delivered;
+    c.payload.assign(data, data + len);
+    cycles().push_back(c);
+
+    last = cur;
+    acq_started = false;
+
+    const Options &o = options();
+    if (o.uplinks) {
+        FILE *f = fopen(o.uplinks, "a");
+        if (f) {
+            fprintf(f, "%.3f %d %u ", (double)cur.t / (double)SEC, datarate, (unsigned)len);
+            for (size_t i = 0; i < len; i++)
+                fprintf(f, "%02x", data[i]);
+            fprintf(f, " %s\n", delivered ? "ok" : "lost");
+            fclose(f);
+        }
+    }
+
+    if (o.cycles && cycles().size() >= o.cycles)
+        stop("%u uplink cycles completed", o.cycles);
+}
+
+/* flash */
+
+struct FlashUse {
+    unsigned writes;
+    size_t bytes;
+    size_t programmed;
+};
+
+static std::map<std::string, FlashUse> &flash_use() {
+    static std::map<std::string, FlashUse> use;
+    return use;
+}
+
+void flash_write(const char *file, size_t bytes, size_t programmed) {
+    SimHeap scope;
+    FlashUse &u = flash_use()[file];
+    u.writes++;
+    u.bytes += bytes;
+    u.programmed += programmed;
+}
+
+static void print_flash() {
+    const std::map<std::string, FlashUse> &use = flash_use();
+    double hours = (double)now() / (double)SEC / 3600.0;
+    for (std::map<std::string, FlashUse>::const_iterator it = use.begin(); it != use.end(); ++it) {
+        const FlashUse &u = it->second;
+        printf("flash %s: %u writes of %lu bytes programmed %lu (write amplification %.1f), %.1f KiB/hour\n",
+            it->first.c_str(), u.writes, (unsigned long)u.bytes, (unsigned long)u.programmed,
+            u.bytes ? (double)u.programmed / (double)u.bytes : 0.0,
+            hours > 0 ? u.programmed / 1024.0 / hours : 0.0);
+    }
+}
+
+void report_reset() {
+    acq_started = false;
+}
+
+void report_header() {
+    if (options().uplinks) {
+        FILE *f = fopen(options().uplinks, "w");
+        if (f)
+            fclose(f);
+    }
+}
+
+static void print_table() {
+    const std::vector<Bus *> &b = Bus::all();
+    const std::vector<Cycle> &list = cycles();
+
+    printf("\n%-5s %9s %9s %9s %9s %9s %9s", "cycle", "start_s", "period", "acq", "cpu_run", "cpu_slp", "cpu_deep");
+    for (size_t i = 0; i < b.size(); i++)
+        printf(" %9s", b[i]->name());
+    printf(" %9s %9s %5s %3s %s\n", "airtime", "energy_mJ", "heap", "dr", "payload");
+
+    for (size_t n = 0; n < list.size(); n++) {
+        const Cycle &c = list[n];
+        printf("%-5u %9.3f %9.1f %9.1f %9.1f %9.1f %9.1f", (unsigned)n, (double)c.start / (double)SEC,
+            ms(c.period), ms(c.acq), ms(c.cpu[CPU_RUN]), ms(c.cpu[CPU_SLEEP]), ms(c.cpu[CPU_DEEPSLEEP]));
+        for (size_t i = 0; i < b.size(); i++)
+            printf(" %9.1f", i < c.bus.size() ? ms(c.bus[i]) : 0.0);
+        printf(" %9.1f %9.2f %5lu %3d ", ms(c.airtime), c.mJ, c.allocs, c.datarate);
+        for (size_t i = 0; i < c.payload.size(); i++)
+            printf("%02x", c.payload[i]);
+        printf("%s\n", c.delivered ? "" : " (lost)");
+    }
+}
+
+static void print_csv() {
+    const std::vector<Bus *> &b = Bus::all();
+    const std::vector<Cycle> &list = cycles();
+
+    printf("cycle,start_s,period_ms,acq_ms,cpu_run_ms,cpu_sleep_ms,cpu_deep_ms");
+    for (size_t i = 0; i < b.size(); i++)
+        printf(",%s_ms,%s_txn", b[i]->name(), b[i]->name());
+    printf(",airtime_ms,energy_mJ,heap_allocs,datarate,delivered,payload\n");
+
+    for (size_t n = 0; n < list.size(); n++) {
+        const Cycle &c = list[n];
+        printf("%u,%.6f,%.3f,%.3f,%.3f,%.3f,%.3f", (unsigned)n, (double)c.start / (double)SEC,
+            ms(c.period), ms(c.acq), ms(c.cpu[CPU_RUN]), ms(c.cpu[CPU_SLEEP]), ms(c.cpu[CPU_DEEPSLEEP]));
+        for (size_t i = 0; i < b.size(); i++)
+            printf(",%.3f,%u", i < c.bus.size() ? ms(c.bus[i]) : 0.0, i < c.txn.size() ? c.txn[i] : 0);
+        printf(",%.3f,%.4f,%lu,%d,%d,", ms(c.airtime), c.mJ, c.allocs, c.datarate, c.delivered ? 1 : 0);
+        for (size_t i = 0; i < c.payload.size(); i++)
+            printf("%02x", c.payload[i]);
+        printf("\n");
+    }
+}
+
+// measurement epochs in an uplink: a batch frame (format 0x13) says how
+// many it carries and a statistics frame (0x15) how many it summarises,
+// any other frame is one; a replay (format 0x14) carries a frame sent
+// before, after the varint age
+static unsigned samples(const Cycle &c) {
+    size_t i = 0;
+    if (c.payload.size() >= 1 && c.payload[0] == 0x14) {
+        for (i = 1; i < c.payload.size() && (c.payload[i] & 0x80); i++)
+            ;
+        i++;
+    }
+    if (c.payload.size() >= i + 2 && (c.payload[i] == 0x13 || c.payload[i] == 0x15))
+        return c.payload[i + 1];
+    return 1;
+}
+
+static bool replayed(const Cycle &c) {
+    return !c.payload.empty() && c.payload[0] == 0x14;
+}
+
+static void print_readings(double t, const int32_t *fields) {
+    printf("%9.1f", t);
+    for (unsigned i = 0; i < SensorPayload::FIELDS; i++)
+        printf("  %s %.2f", SensorPayload::name(i), SensorPayload::value(i, fields[i]));
+    printf("\n");
+}
+
+static void print_stats(double t, unsigned epochs, const SensorStats::Summary *fields) {
+    printf("%9.1f  %u epochs:", t, epochs);
+    for (unsigned i = 0; i < SensorPayload::FIELDS; i++) {
+        const SensorStats::Summary &s = fields[i];
+        if (!s.select)
+            continue;
+        printf("  %s", SensorPayload::name(i));
+        if (s.select & SensorStats::StatMean)
+            printf(" %.2f", SensorPayload::value(i, s.mean));
+        if (s.select & (SensorStats::StatMin | SensorStats::StatMax)) {
+            printf(" [");
+            if (s.select & SensorStats::StatMin)
+                printf("%.2f", SensorPayload::value(i, s.min));
+            printf("..");
+            if (s.select & SensorStats::StatMax)
+                printf("%.2f", SensorPayload::value(i, s.max));
+            printf("]");
+        }
+        if (s.select & SensorStats::StatSD)
+            printf(" sd %.3f", SensorPayload::value(i, s.sd));
+        if (s.count != epochs)
+            printf(" (%u read)", s.count);
+    }
+    printf("\n");
+}
+
+static void print_decoded() {
+    const std::vector<Cycle> &list = cycles();
+    DeltaDecoder delta(SensorPayload::FIELDS);
+    BatchDecoder batch(SensorPayload::FIELDS);
+    StatsDecoder stats(SensorPayload::FIELDS);
+
+    printf("\n%9s  readings decoded from the delivered uplinks\n", "time_s");
+    for (size_t n = 0; n < list.size(); n++) {
+        const Cycle &c = list[n];
+        if (!c.delivered || c.payload.empty())
+            continue;
+        double t = (double)(c.start + c.period) / (double)SEC;
+        const uint8_t *p = &c.payload[0];
+        const uint8_t *end = p + c.payload.size();
+        if (*p == 0x14) {
+            uint32_t age;
+            p = DeltaPayload::getVarint(p + 1, end, &age);
+            if (!p || p == end) {
+                printf("%9.1f  malformed replay\n", t);
+                continue;
+            }
+            t -= age;
+        }
+
+        int32_t fields[DeltaPayload::MAX_FIELDS];
+        if (*p == SensorPayload::FORMAT) {
+            if (SensorPayload::decode(p, end - p, fields))
+                print_readings(t, fields);
+            else
+                printf("%9.1f  malformed 0x%02x frame\n", t, *p);
+        } else if (*p == DeltaPayload::FORMAT) {
+            DeltaDecoder::Result r = delta.decode(p, end - p, fields);
+            if (r == DeltaDecoder::DECODED)
+                print_readings(t, fields);
+            else
+                printf("%9.1f  %s\n", t, r == DeltaDecoder::NO_REFERENCE ? "delta frame without its reference" : "malformed 0x12 frame");
+        } else if (*p == DeltaPayload::FORMAT_BATCH) {
+            static int32_t records[BatchEncoder::MAX_RECORDS][DeltaPayload::MAX_FIELDS];
+            static uint32_t ages[BatchEncoder::MAX_RECORDS];
+            unsigned count;
+            if (batch.decode(p, end - p, records, ages, BatchEncoder::MAX_RECORDS, &count) == BatchDecoder::DECODED) {
+                for (unsigned i = 0; i < count; i++)
+                    print_readings(t - ages[i], records[i]);
+            } else {
+                printf("%9.1f  malformed 0x13 frame\n", t);
+            }
+        } else if (*p == SensorStats::FORMAT) {
+            SensorStats::Summary summary[SensorPayload::FIELDS];
+            unsigned epochs;
+            uint32_t age;
+            if (stats.decode(p, end - p, summary, &epochs, &age) == StatsDecoder::DECODED)
+                print_stats(t - age, epochs, summary);
+            else
+                printf("%9.1f  malformed 0x15 frame\n", t);
+        } else {
+            printf("%9.1f  unknown format 0x%02x\n", t, *p);
+        }
+    }
+}
+
+void report_summary() {
+    const std::vector<Cycle> &list = cycles();
+    const Options &o = options();
+
+    if (o.csv) {
+        print_csv();
+        return;
+    }
+
+    printf("\n== simulation stopped at %.3f s: %s\n", (double)now() / (double)SEC, stop_reason());
+    if (list.empty()) {
+        printf("no uplinks sent\n");
+        return;
+    }
+    print_table();
+    if (o.decode)
+        print_decoded();
+
+    // steady state: skip the first cycle, which carries the boot and join
+    size_t first = list.size() > 1 ? 1 : 0;
+    double n = (double)(list.size() - first);
+    double period = 0, acq = 0, run = 0, mJ = 0, allocs = 0;
+    unsigned long max_allocs = 0;
+    for (size_t i = first; i < list.size(); i++) {
+        period += ms(list[i].period);
+        acq += ms(list[i].acq);
+        run += ms(list[i].cpu[CPU_RUN]);
+        mJ += list[i].mJ;
+        allocs += list[i].allocs;
+        if (list[i].allocs > max_allocs)
+            max_allocs = list[i].allocs;
+    }
+    period /= n;
+    acq /= n;
+    run /= n;
+    mJ /= n;
+    allocs /= n;
+    double mA = period > 0 ? mJ / power::SUPPLY_V / (period / 1000.0) : 0.0;
+    printf("\nsteady state over %u cycles: period %.1f ms, acquisition %.1f ms, cpu run %.1f ms (%.1f%%)\n",
+        (unsigned)n, period, acq, run, period > 0 ? 100.0 * run / period : 0.0);
+    printf("energy %.2f mJ/cycle, average current %.3f mA, %.1f days on 2000 mAh\n",
+        mJ, mA, mA > 0 ? 2000.0 / mA / 24.0 : 0.0);
+    printf("heap %.1f allocations/cycle (most %lu), %lu in the first cycle\n",
+        allocs, max_allocs, list[0].allocs);
+
+    // a replayed sample was counted when it was first sent
+    unsigned sent = 0, delivered = 0, frames = 0, replays = 0;
+    for (size_t i = 0; i < list.size(); i++) {
+        if (replayed(list[i]))
+            replays++;
+        else
+            sent += samples(list[i]);
+        if (list[i].delivered) {
+            delivered += samples(list[i]);
+            frames++;
+        }
+    }
+    double hours = (double)now() / (double)SEC / 3600.0;
+    printf("delivered %u of %u samples in %u of %u uplinks, %.1f samples/hour\n",
+        delivered, sent, frames, (unsigned)list.size(), hours > 0 ? delivered / hours : 0.0);
+    if (replays)
+        printf("%u uplinks were replays of queued frames\n", replays);
+    print_flash();
+}
+
+} // namespace sim
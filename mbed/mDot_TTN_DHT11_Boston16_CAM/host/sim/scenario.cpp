@@ -0,0 +1,93 @@
+/* host simulator - scripted environment */
+#include "scenario.h"
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+struct Point {
+    double t;
+    double value;
+};
+
+typedef std::map<std::string, std::vector<Point> > Channels;
+
+static Channels &channels() {
+    static Channels c;
+    return c;
+}
+
+bool scenario_load(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "sim: cannot open scenario %s\n", path);
+        return false;
+    }
+    char line[256];
+    unsigned n = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), f)) {
+        n++;
+        char *hash = strchr(line, '#');
+        if (hash)
+            *hash = 0;
+        char name[64];
+        Point p;
+        int fields = sscanf(line, "%lf %63s %lf", &p.t, name, &p.value);
+        if (fields <= 0)
+            continue;
+        if (fields != 3) {
+            fprintf(stderr, "sim: %s:%u: expected \"<time_s> <channel> <value>\"\n", path, n);
+            ok = false;
+            continue;
+        }
+        std::vector<Point> &points = channels()[name];
+        if (!points.empty() && p.t < points.back().t) {
+            fprintf(stderr, "sim: %s:%u: time goes backwards for %s\n", path, n, name);
+            ok = false;
+            continue;
+        }
+        points.push_back(p);
+    }
+    fclose(f);
+    return ok;
+}
+
+double scenario(const char *channel, double dflt) {
+    Channels::const_iterator it = channels().find(channel);
+    if (it == channels().end() || it->second.empty())
+        return dflt;
+    const std::vector<Point> &points = it->second;
+    double t = (double)now() / (double)SEC;
+    if (t <= points.front().t)
+        return points.front().value;
+    for (size_t i = 1; i < points.size(); i++) {
+        if (t < points[i].t) {
+            const Point &a = points[i - 1];
+            const Point &b = points[i];
+            return a.value + (b.value - a.value) * (t - a.t) / (b.t - a.t);
+        }
+    }
+    return points.back().value;
+}
+
+double random_uniform() {
+    static bool seeded;
+    static unsigned short state[3];
+    if (!seeded) {
+        unsigned seed = options().seed;
+        state[0] = 0x330E;
+        state[1] = (unsigned short)seed;
+        state[2] = (unsigned short)(seed >> 16);
+        seeded = true;
+    }
+    return erand48(state);
+}
+
+} // namespace sim
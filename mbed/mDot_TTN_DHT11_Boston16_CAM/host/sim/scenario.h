@@ -0,0 +1,34 @@
+/* host simulator - scripted environment
+ *
+ * A scenario file drives what the sensors see and how the radio link behaves.
+ * Each line is "<time_s> <channel> <value>"; values are interpolated linearly
+ * between points and held after the last one.  '#' starts a comment.
+ *
+ *   air.temp air.rh       DHT22, degC and %RH
+ *   water.temp[.N]        DS18B20 probe N (default 0), degC
+ *   water.probes          number of probes on the 1-wire bus (at time 0)
+ *   soil.temp soil.rh     SHT1x, degC and %RH
+ *   light.ch0 light.ch1   TSL2561 counts at 402 ms and 1x gain
+ *   radio.loss            probability that an uplink is lost, 0..1
+ *   radio.rssi radio.snr  link signal figures, dBm and dB; below the
+ *                         spreading factor's floor, uplinks are lost too
+ *   <sensor>.present      0 disconnects a sensor (dht, ds, sht, tsl)
+ *   ds.present.N          0 disconnects DS18B20 probe N alone
+ */
+#ifndef HOST_SIM_SCENARIO_H
+#define HOST_SIM_SCENARIO_H
+
+namespace sim {
+
+/** Load a scenario file; false (with a message on stderr) if it is unusable. */
+bool scenario_load(const char *path);
+
+/** Value of a channel at the current simulated time, or dflt if unscripted. */
+double scenario(const char *channel, double dflt);
+
+/** Deterministic pseudo-random number in [0, 1), seeded from the options. */
+double random_uniform();
+
+} // namespace sim
+
+#endif
@@ -0,0 +1,377 @@
+/* host simulator - virtual time, events, CPU and power accounting */
+#include "sim.h"
+#include "power.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace sim {
+
+// All simulator state lives behind accessors so that it is usable from the
+// firmware's global constructors, whatever the link order.
+struct EventQueue {
+    EventMap events;
+
+    static EventQueue &get() {
+        static EventQueue queue;
+        return queue;
+    }
+
+    void insert(Event *e, time_ns t) {
+        e->_when = t;
+        e->_pos = events.insert(std::make_pair(t, e));
+        e->_pending = true;
+    }
+
+    void remove(Event *e) {
+        events.erase(e->_pos);
+        e->_pending = false;
+    }
+
+    time_ns next() const {
+        return events.empty() ? FOREVER : events.begin()->first;
+    }
+
+    Event *pop() {
+        Event *e = events.begin()->second;
+        remove(e);
+        return e;
+    }
+};
+
+static time_ns t_now;
+static CpuMode mode = CPU_RUN;
+static time_ns mode_time[CPU_MODES];
+static int isr_depth;
+static bool masked;
+static uint64_t activity_count;
+static void (*reschedule_hook)(void);
+static void (*stop_hook)(void);
+static void (*halt_hook)(void);
+static void (*boot_hook)(void);
+static bool in_standby;
+static bool is_stopped;
+static char reason[160];
+static double total_mJ;
+
+static std::vector<Load *> &loads() {
+    static std::vector<Load *> list;
+    return list;
+}
+
+static Load &cpu_load() {
+    static Load load("mcu", power::MCU_RUN_MA);
+    return load;
+}
+
+static double mode_current(CpuMode m) {
+    switch (m) {
+        case CPU_SLEEP:     return power::MCU_SLEEP_MA;
+        case CPU_DEEPSLEEP: return in_standby ? power::MCU_STANDBY_MA : power::MCU_DEEPSLEEP_MA;
+        default:            return power::MCU_RUN_MA;
+    }
+}
+
+/* power and time bookkeeping */
+
+static time_ns last_integration;
+
+void integrate() {
+    time_ns dt = t_now - last_integration;
+    if (dt == 0)
+        return;
+    double s = (double)dt / (double)SEC;
+    std::vector<Load *> &l = loads();
+    for (size_t i = 0; i < l.size(); i++) {
+        double mJ = l[i]->_mA * power::SUPPLY_V * s;
+        l[i]->_mJ += mJ;
+        total_mJ += mJ;
+    }
+    last_integration = t_now;
+}
+
+static void advance(time_ns t) {
+    if (t <= t_now)
+        return;
+    mode_time[mode] += t - t_now;
+    t_now = t;
+    integrate();
+}
+
+static void set_mode(CpuMode m) {
+    cpu_load();
+    if (m == mode)
+        return;
+    integrate();
+    mode = m;
+    cpu_load().set(mode_current(m));
+}
+
+time_ns now() {
+    return t_now;
+}
+
+time_ns cpu_time(CpuMode m) {
+    return mode_time[m];
+}
+
+CpuMode cpu_mode() {
+    return mode;
+}
+
+/* events */
+
+Event::Event() : _when(0), _pending(false) {
+}
+
+Event::~Event() {
+    cancel();
+}
+
+void Event::schedule_at(time_ns t) {
+    EventQueue &q = EventQueue::get();
+    if (_pending)
+        q.remove(this);
+    q.insert(this, t < t_now ? t_now : t);
+}
+
+void Event::cancel() {
+    if (_pending)
+        EventQueue::get().remove(this);
+}
+
+static bool fire_due() {
+    EventQueue &q = EventQueue::get();
+    bool fired = false;
+    while (!masked && !is_stopped && q.next() <= t_now) {
+        Event *e = q.pop();
+        isr_depth++;
+        e->fire();
+        isr_depth--;
+        fired = true;
+    }
+    return fired;
+}
+
+static void after_interrupts() {
+    if (isr_depth == 0 && !masked && reschedule_hook)
+        reschedule_hook();
+}
+
+static void check_limit(time_ns target) {
+    const Options &o = options();
+    if (o.time_limit && target > o.time_limit) {
+        advance(o.time_limit);
+        stop("time limit reached");
+    }
+}
+
+void busy(time_ns dt) {
+    time_ns target = t_now + dt;
+    if (isr_depth || masked) {
+        // handlers run to completion; pending events wait for them
+        CpuMode m = mode;
+        set_mode(CPU_RUN);
+        check_limit(target);
+        advance(target);
+        set_mode(m);
+        return;
+    }
+    EventQueue &q = EventQueue::get();
+    for (;;) {
+        set_mode(CPU_RUN);
+        time_ns next = q.next();
+        if (next > target) {
+            check_limit(target);
+            advance(target);
+            return;
+        }
+        check_limit(next);
+        advance(next);
+        if (fire_due())
+            after_interrupts();
+    }
+}
+
+bool idle(CpuMode m) {
+    EventQueue &q = EventQueue::get();
+    time_ns next = q.next();
+    if (next == FOREVER)
+        return false;
+    set_mode(m);
+    check_limit(next);
+    advance(next);
+    fire_due();
+    set_mode(CPU_RUN);
+    after_interrupts();
+    return true;
+}
+
+void wait_for_interrupt(CpuMode m) {
+    if (isr_depth) {
+        stop("WFI executed from an interrupt handler");
+        return;
+    }
+    if (!idle(m))
+        stop("deadlock: CPU sleeping with no wake-up source pending");
+}
+
+void run_isr(void (*fn)(void *), void *arg) {
+    isr_depth++;
+    fn(arg);
+    isr_depth--;
+    activity_count++;
+    after_interrupts();
+}
+
+bool in_isr() {
+    return isr_depth > 0;
+}
+
+void irq_mask(bool m) {
+    masked = m;
+    if (!masked && isr_depth == 0 && fire_due())
+        after_interrupts();
+}
+
+bool irq_masked() {
+    return masked;
+}
+
+uint64_t activity() {
+    return activity_count;
+}
+
+void touch() {
+    activity_count++;
+}
+
+void fast_forward() {
+    // keep servicing events until one of them produces something the
+    // polling loop could observe
+    uint64_t seen = activity_count;
+    while (activity_count == seen) {
+        time_ns next = EventQueue::get().next();
+        if (next == FOREVER) {
+            const Options &o = options();
+            if (o.time_limit)
+                next = o.time_limit + 1;
+            else {
+                stop("firmware polling an input that can never change");
+                return;
+            }
+        }
+        busy(next - t_now);
+    }
+}
+
+void set_reschedule_hook(void (*hook)(void)) {
+    reschedule_hook = hook;
+}
+
+void set_stop_hook(void (*hook)(void)) {
+    stop_hook = hook;
+}
+
+void set_reset_hooks(void (*halt)(void), void (*boot)(void)) {
+    halt_hook = halt;
+    boot_hook = boot;
+}
+
+void standby(time_ns dt) {
+    if (isr_depth)
+        stop("standby entered from an interrupt handler");
+    if (!halt_hook || !boot_hook)
+        stop("standby without an RTOS to reset");
+    halt_hook();
+
+    // the models' own events still happen; nothing of the firmware's is
+    // left to run them against
+    time_ns wake = t_now + dt;
+    EventQueue &q = EventQueue::get();
+    in_standby = true;
+    set_mode(CPU_DEEPSLEEP);
+    while (q.next() <= wake) {
+        check_limit(q.next());
+        advance(q.next());
+        fire_due();
+    }
+    check_limit(wake);
+    advance(wake);
+    in_standby = false;
+    set_mode(CPU_RUN);
+    activity_count++;
+    report_reset();
+    boot_hook();
+    stop("reset did not restart the firmware");
+    finish();
+}
+
+void stop(const char *fmt, ...) {
+    if (!is_stopped) {
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(reason, sizeof(reason), fmt, ap);
+        va_end(ap);
+        is_stopped = true;
+    }
+    if (stop_hook)
+        stop_hook();
+    finish();
+}
+
+bool stopped() {
+    return is_stopped;
+}
+
+const char *stop_reason() {
+    return reason;
+}
+
+void finish() {
+    integrate();
+    fflush(stdout);
+    report_summary();
+    fflush(stdout);
+    fflush(stderr);
+    // we may be on a thread's stack: skip the firmware's global destructors
+    _exit(0);
+}
+
+/* loads */
+
+Load::Load(const char *name, double mA) : _name(name), _mA(mA), _mJ(0.0) {
+    integrate();
+    loads().push_back(this);
+}
+
+Load::~Load() {
+    integrate();
+    std::vector<Load *> &l = loads();
+    for (size_t i = 0; i < l.size(); i++) {
+        if (l[i] == this) {
+            l.erase(l.begin() + i);
+            break;
+        }
+    }
+}
+
+void Load::set(double mA) {
+    if (mA == _mA)
+        return;
+    integrate();
+    _mA = mA;
+}
+
+double Load::energy_mJ() const {
+    return _mJ;
+}
+
+double energy_mJ() {
+    integrate();
+    return total_mJ;
+}
+
+} // namespace sim
@@ -0,0 +1,273 @@
+/* host simulator - virtual time, events, CPU and power accounting
+ *
+ * The firmware runs unmodified on the host; everything it does to the
+ * outside world goes through the HAL in host/hal, which turns pin and bus
+ * traffic into simulated time.  Time only moves when the firmware spends it:
+ * busy() for code that keeps the core running (wait_us, bit-banging, blocking
+ * bus transfers) and wait_for_interrupt()/idle() when the core sleeps until
+ * the next scheduled Event.
+ *
+ * Events fire in "interrupt context"; after a batch has been serviced the
+ * RTOS layer gets a chance to switch threads through the reschedule hook.
+ */
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <new>
+#include <vector>
+
+namespace sim {
+
+typedef uint64_t time_ns;
+
+static const time_ns US  = 1000ULL;
+static const time_ns MS  = 1000000ULL;
+static const time_ns SEC = 1000000000ULL;
+static const time_ns FOREVER = ~0ULL;
+
+/** Current simulated time. */
+time_ns now();
+
+/** Operator new calls made by the firmware since start-up. */
+unsigned long heap_allocations();
+
+/** Simulator bookkeeping: allocations while one of these is in scope are
+ *  not the firmware's and are not counted.  The scope must not span
+ *  anything that can switch threads (busy(), idle(), RTOS calls). */
+class SimHeap {
+public:
+    SimHeap();
+    ~SimHeap();
+private:
+    SimHeap(const SimHeap &);
+    SimHeap &operator=(const SimHeap &);
+};
+
+/** Memory for the simulator's own objects, which is never counted: the RTOS
+ *  control blocks derive from HostObject, and containers that live across
+ *  thread switches take a HostAllocator. */
+void *host_alloc(size_t n);
+void host_free(void *p);
+
+struct HostObject {
+    static void *operator new(size_t n) { return host_alloc(n); }
+    static void operator delete(void *p) { host_free(p); }
+};
+
+template <typename T>
+class HostAllocator {
+public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+    template <typename U> struct rebind { typedef HostAllocator<U> other; };
+
+    HostAllocator() {}
+    HostAllocator(const HostAllocator &) {}
+    template <typename U> HostAllocator(const HostAllocator<U> &) {}
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+    pointer allocate(size_type n, const void * = 0) { return (pointer)host_alloc(n * sizeof(T)); }
+    void deallocate(pointer p, size_type) { host_free(p); }
+    size_type max_size() const { return (size_type)-1 / sizeof(T); }
+    void construct(pointer p, const T &v) { new ((void *)p) T(v); }
+    void destroy(pointer p) { p->~T(); }
+};
+
+template <typename T, typename U>
+bool operator==(const HostAllocator<T> &, const HostAllocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator!=(const HostAllocator<T> &, const HostAllocator<U> &) { return false; }
+
+class Event;
+typedef std::multimap<time_ns, Event *, std::less<time_ns>,
+                      HostAllocator<std::pair<const time_ns, Event *> > > EventMap;
+
+/** Something that happens at a point in simulated time. */
+class Event {
+public:
+    Event();
+    virtual ~Event();
+
+    void schedule_at(time_ns t);
+    void schedule_in(time_ns dt) { schedule_at(now() + dt); }
+    void cancel();
+    bool pending() const { return _pending; }
+    time_ns when() const { return _when; }
+
+    /** Called from interrupt context when the event is due. */
+    virtual void fire() = 0;
+
+private:
+    friend struct EventQueue;
+    EventMap::iterator _pos;
+    time_ns _when;
+    bool _pending;
+
+    Event(const Event &);
+    Event &operator=(const Event &);
+};
+
+/** Event calling back a member function. */
+template <typename T>
+class MemberEvent : public Event {
+public:
+    MemberEvent(T *obj, void (T::*fn)(void)) : _obj(obj), _fn(fn) {}
+    virtual void fire() { (_obj->*_fn)(); }
+private:
+    T *_obj;
+    void (T::*_fn)(void);
+};
+
+/** Event calling back a free function with a context pointer. */
+class FunctionEvent : public Event {
+public:
+    FunctionEvent(void (*fn)(void *), void *arg) : _fn(fn), _arg(arg) {}
+    virtual void fire() { _fn(_arg); }
+private:
+    void (*_fn)(void *);
+    void *_arg;
+};
+
+enum CpuMode {
+    CPU_RUN = 0,
+    CPU_SLEEP,
+    CPU_DEEPSLEEP,
+    CPU_MODES
+};
+
+/** Foreground code keeps the core busy for dt (interrupts still fire). */
+void busy(time_ns dt);
+
+/** WFI: sleep in the given mode until at least one event has been serviced. */
+void wait_for_interrupt(CpuMode mode);
+
+/** RTOS idle: like wait_for_interrupt(), false when nothing is pending at all. */
+bool idle(CpuMode mode);
+
+/** Run fn as an interrupt handler (for edges caused by the CPU itself). */
+void run_isr(void (*fn)(void *), void *arg);
+bool in_isr();
+
+/** Interrupt masking as seen by __disable_irq()/__enable_irq(). */
+void irq_mask(bool masked);
+bool irq_masked();
+
+/** Monotonic counter bumped by anything that could change what the CPU sees
+ *  (line edges, firmware interrupt handlers, clock reads); used to detect
+ *  firmware spinning on an input that cannot change.  Background events such
+ *  as the RTOS tick do not count. */
+uint64_t activity();
+void touch();
+
+/** Skip a pure polling spin forward, event by event, until there is activity;
+ *  the skipped time is charged as busy time. */
+void fast_forward();
+
+void set_reschedule_hook(void (*hook)(void));
+void set_stop_hook(void (*hook)(void));
+
+/** The RTOS layer's side of a system reset: halt drops every thread and timer
+ *  (it is called on the thread that asked for the reset), boot starts main()
+ *  on a fresh kernel and does not return. */
+void set_reset_hooks(void (*halt)(void), void (*boot)(void));
+
+/** Standby with the RTC running: RAM is lost, the core is off for dt and the
+ *  wake-up is a reset, so main() starts over.  Sensor models keep running.
+ *  The firmware's globals are not constructed again, which is the one thing
+ *  that differs from the board.  Does not return. */
+void standby(time_ns dt) __attribute__((noreturn));
+
+/** End the run (time limit, cycle limit, deadlock, firmware error). */
+void stop(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+bool stopped();
+const char *stop_reason();
+
+/** Print the report and leave the process; used once the kernel is gone. */
+void finish() __attribute__((noreturn));
+
+/** Time spent in each CPU mode since start-up; standby counts as deep sleep. */
+time_ns cpu_time(CpuMode mode);
+CpuMode cpu_mode();
+
+/** A current draw on the 3.3 V rail that is integrated into the energy total. */
+class Load {
+public:
+    Load(const char *name, double mA = 0.0);
+    ~Load();
+    void set(double mA);
+    double mA() const { return _mA; }
+    const char *name() const { return _name; }
+    double energy_mJ() const;
+private:
+    friend void integrate();
+    const char *_name;
+    double _mA;
+    double _mJ;
+};
+
+/** Total energy drawn from the supply since reset. */
+double energy_mJ();
+
+/** A wire-level bus; time between edges closer than max_gap counts as busy. */
+class Bus {
+public:
+    Bus(const char *name, time_ns max_gap, bool sensor);
+    void edge();
+    void transfer(time_ns dt);
+    time_ns busy_time() const { return _busy; }
+    const char *name() const { return _name; }
+    bool sensor() const { return _sensor; }
+    uint32_t transactions() const { return _transactions; }
+    void transaction() { _transactions++; }
+
+    static const std::vector<Bus *> &all();
+
+private:
+    const char *_name;
+    time_ns _max_gap;
+    time_ns _last;
+    time_ns _busy;
+    uint32_t _transactions;
+    bool _sensor;
+};
+
+/** Run options, parsed before any firmware constructor runs. */
+struct Options {
+    time_ns time_limit;
+    unsigned cycles;
+    bool quiet;
+    bool csv;
+    bool decode;        // list the readings the uplinks decode to
+    const char *scenario;
+    const char *uplinks;
+    int band;           // 915 or 868
+    unsigned seed;
+    bool bench;         // a test times its unit instead of checking it
+};
+
+Options &options();
+
+/** Report hooks driven by the fake radio. */
+void uplink_begin();
+void uplink_end(const uint8_t *data, size_t len, time_ns airtime, int datarate, bool delivered);
+/** Report hook driven by the fake flash: a write of bytes to file, for
+ *  which the file system programmed the given number of bytes of flash. */
+void flash_write(const char *file, size_t bytes, size_t programmed);
+
+/** A reset: sensor traffic before it (powering sensors down) is not acquisition. */
+void report_reset();
+void report_header();
+void report_summary();
+
+} // namespace sim
+
+#endif
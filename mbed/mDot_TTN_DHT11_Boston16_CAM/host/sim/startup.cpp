@@ -0,0 +1,99 @@
+/* host simulator - command line and start-up
+ *
+ * Runs from a high-priority constructor so that the options, the scenario and
+ * the board models are in place before the firmware's global constructors
+ * start talking to the sensors.
+ */
+#include "sim.h"
+#include "scenario.h"
+#include "models.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace sim {
+
+Options &options() {
+    static Options o = {
+        3600 * SEC,     // time_limit
+        5,              // cycles
+        false,          // quiet
+        false,          // csv
+        false,          // decode
+        NULL,           // scenario
+        NULL,           // uplinks
+        915,            // band
+        1,              // seed
+        false,          // bench
+    };
+    return o;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "usage: %s [options] [scenario]\n"
+        "  -n N          stop after N uplinks (default 5, 0 for no limit)\n"
+        "  -t SECONDS    stop at this simulated time (default 3600, 0 for none)\n"
+        "  -q            do not echo the firmware's serial output\n"
+        "  --csv         print the per-cycle report as CSV\n"
+        "  --decode      list the readings each delivered uplink decodes to\n"
+        "  --uplinks F   append every uplink payload to file F\n"
+        "  --band B      915 (US, default) or 868 (EU duty cycle)\n"
+        "  --seed S      seed for radio loss (default 1)\n"
+        "  --bench       (tests) time the unit instead of checking it\n",
+        prog);
+    exit(2);
+}
+
+static void parse(int argc, char **argv) {
+    Options &o = options();
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *next = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "-n") && next) {
+            o.cycles = (unsigned)strtoul(next, NULL, 0);
+            i++;
+        } else if (!strcmp(a, "-t") && next) {
+            o.time_limit = (time_ns)(strtod(next, NULL) * (double)SEC);
+            i++;
+        } else if (!strcmp(a, "-q")) {
+            o.quiet = true;
+        } else if (!strcmp(a, "--csv")) {
+            o.csv = true;
+        } else if (!strcmp(a, "--decode")) {
+            o.decode = true;
+        } else if (!strcmp(a, "--uplinks") && next) {
+            o.uplinks = next;
+            i++;
+        } else if (!strcmp(a, "--band") && next) {
+            o.band = atoi(next);
+            if (o.band != 915 && o.band != 868)
+                usage(argv[0]);
+            i++;
+        } else if (!strcmp(a, "--seed") && next) {
+            o.seed = (unsigned)strtoul(next, NULL, 0);
+            i++;
+        } else if (!strcmp(a, "--bench")) {
+            o.bench = true;
+        } else if (a[0] != '-' && !o.scenario) {
+            o.scenario = a;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    // the report goes to stdout as well: keep it apart from the firmware
+    if (o.csv)
+        o.quiet = true;
+}
+
+__attribute__((constructor(101)))
+static void startup(int argc, char **argv, char **envp) {
+    parse(argc, argv);
+    if (options().scenario && !scenario_load(options().scenario))
+        exit(2);
+    board_init();
+    report_header();
+}
+
+} // namespace sim
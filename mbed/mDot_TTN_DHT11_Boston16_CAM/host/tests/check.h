@@ -0,0 +1,55 @@
+/* host tests - checks and the pass/fail exit
+ *
+ * A test counts its checks with CHECK() and its variants, which print the
+ * ones that fail, and ends with check_exit(), which prints the tally and
+ * exits with 1 if anything failed.  It exits straight away, so a test run
+ * on the simulated board ends there without the simulator's report.
+ *
+ * Usable from C as well as C++, for the kernel tests.
+ */
+#ifndef HOST_TEST_CHECK_H
+#define HOST_TEST_CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static unsigned check_count;
+static unsigned check_failed;
+
+static inline int check_result(int ok, const char *file, int line, const char *what) {
+    check_count++;
+    if (!ok) {
+        check_failed++;
+        printf("%s:%d: check failed: %s\n", file, line, what);
+    }
+    return ok;
+}
+
+/* Each evaluates its arguments once and returns whether the check held. */
+#define CHECK(cond) \
+    check_result((cond) != 0, __FILE__, __LINE__, #cond)
+#define CHECK_EQ(a, b) \
+    check_equal((long long)(a), (long long)(b), __FILE__, __LINE__, #a " == " #b)
+#define CHECK_NEAR(a, b, tol) \
+    check_near((double)(a), (double)(b), (double)(tol), __FILE__, __LINE__, #a " ~ " #b)
+
+static inline int check_equal(long long a, long long b, const char *file, int line, const char *what) {
+    if (!check_result(a == b, file, line, what))
+        printf("    %lld != %lld\n", a, b);
+    return a == b;
+}
+
+static inline int check_near(double a, double b, double tol, const char *file, int line, const char *what) {
+    double d = a > b ? a - b : b - a;
+    if (!check_result(d <= tol, file, line, what))
+        printf("    %g vs %g, off by %g (tolerance %g)\n", a, b, d, tol);
+    return d <= tol;
+}
+
+static inline void check_exit(const char *name) {
+    printf("%s: %u checks, %u failed\n", name, check_count, check_failed);
+    fflush(stdout);
+    _Exit(check_failed != 0);
+}
+
+#endif
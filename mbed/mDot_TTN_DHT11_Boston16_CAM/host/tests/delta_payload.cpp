@@ -0,0 +1,338 @@
+/* host test - delta frames from DeltaEncoder through a lossy link to DeltaDecoder
+ *
+ * The encoder is driven the way main.cpp drives it: every frame is sent,
+ * some are lost, and delivered() is only called for the ones acknowledged,
+ * which always got through.  Over many thousand frames, so that the 7-bit
+ * sequence number wraps again and again, the link loses frames at random,
+ * loses every keyframe for a while, loses everything for long bursts and
+ * goes long stretches without an acknowledgement, and the encoder is now
+ * and then rebuilt from its State as after deep sleep.  Every frame that
+ * arrives must decode to exactly the fields that were sent.
+ *
+ * Then frames that are cut short, overlong, of another format or with
+ * fields the decoder does not have must come out MALFORMED, and leave the
+ * decoder as it was.
+ *
+ * Batch frames are filled with records taken every few seconds, off the
+ * whole second, up to frame sizes from a few bytes to the largest, with
+ * the encoder now and then rebuilt from its State halfway.  Each must
+ * decode to the records added, with every record's age within a second of
+ * the time from its taking to the frame's, and none may be longer than
+ * asked.  Cut short, with a byte too many, or with a record older than the
+ * frame or a first record that is not first, it must come out MALFORMED.
+ */
+#include "mbed.h"
+#include "DeltaPayload.h"
+#include "check.h"
+
+#include <string.h>
+
+static const unsigned FIELDS = 6;
+static const unsigned INTERVAL = 16;
+static const unsigned FRAMES = 20000;
+
+static unsigned random_below(unsigned n) {
+    return (unsigned)rand() % n;
+}
+
+/* Readings that mostly creep, now and then jump, and sometimes sit at the
+ * ends of the range, where only wrap-around arithmetic gets the delta. */
+static void next_fields(int32_t *fields) {
+    for (unsigned i = 0; i < FIELDS; i++) {
+        unsigned r = random_below(100);
+        if (r < 50)
+            continue;
+        else if (r < 90)
+            fields[i] += (int32_t)random_below(21) - 10;
+        else if (r < 97)
+            fields[i] = (int32_t)(random_below(1u << 16) << 15) - (1 << 30);
+        else
+            fields[i] = random_below(2) ? INT32_MAX - (int32_t)random_below(3)
+                                        : INT32_MIN + (int32_t)random_below(3);
+    }
+}
+
+enum Phase { STEADY, NO_KEYFRAMES, OUTAGE, NO_ACKS };
+
+static void round_trip() {
+    static DeltaEncoder::State state;   // zeroed, as on first start
+    DeltaEncoder *enc = new DeltaEncoder(state, FIELDS, INTERVAL);
+    DeltaDecoder dec(FIELDS);
+    int32_t fields[FIELDS] = { 0 };
+    unsigned sent = 0, received = 0, decoded = 0, keyframes = 0, lost_keyframes = 0;
+    unsigned steady_sent = 0, steady_keyframes = 0;
+    unsigned wraps = 0;
+    uint8_t last_seq = 0;
+
+    Phase phase = STEADY;
+    unsigned phase_left = 100;
+    for (unsigned f = 0; f < FRAMES; f++) {
+        if (--phase_left == 0) {
+            phase = random_below(2) ? STEADY : (Phase)(1 + random_below(3));
+            phase_left = phase == STEADY ? 50 + random_below(200) : 10 + random_below(150);
+        }
+        if (random_below(500) == 0) {
+            // woken from deep sleep: only the State is left
+            delete enc;
+            enc = new DeltaEncoder(state, FIELDS, INTERVAL);
+        }
+
+        next_fields(fields);
+        uint8_t buf[DeltaPayload::MAX_FRAME];
+        size_t n = enc->encode(fields, buf, sizeof(buf));
+        if (!CHECK(n > 0))
+            continue;
+        sent++;
+        bool key = enc->wasKeyframe();
+        CHECK_EQ(key, (buf[1] & DeltaPayload::CtlKeyframe) != 0);
+        keyframes += key;
+        if (phase == STEADY) {
+            steady_sent++;
+            steady_keyframes += key;
+        }
+
+        bool arrives;
+        switch (phase) {
+        case NO_KEYFRAMES: arrives = !key && random_below(10) != 0; break;
+        case OUTAGE:       arrives = false; break;
+        default:           arrives = random_below(10) != 0; break;
+        }
+        lost_keyframes += key && !arrives;
+        // a probe every few frames; an acknowledgement means it arrived
+        bool acked = arrives && phase != NO_ACKS && random_below(8) == 0;
+        if (acked)
+            enc->delivered();
+        if (!arrives)
+            continue;
+
+        received++;
+        int32_t out[FIELDS];
+        uint8_t seq;
+        DeltaDecoder::Result r = dec.decode(buf, n, out, &seq);
+        if (!CHECK_EQ(r, DeltaDecoder::DECODED)) {
+            printf("    frame %u (%s, seq %u, ref %u) did not decode\n", f, key ? "key" : "delta",
+                   buf[1] & DeltaPayload::SeqMask, key ? 0 : buf[2]);
+            continue;
+        }
+        decoded++;
+        CHECK_EQ(seq, buf[1] & DeltaPayload::SeqMask);
+        if (!CHECK(memcmp(out, fields, sizeof(out)) == 0))
+            printf("    frame %u decoded to other fields\n", f);
+        if (seq < last_seq)
+            wraps++;
+        last_seq = seq;
+    }
+    delete enc;
+
+    printf("delta_payload: %u frames sent, %u keyframes (%u lost), %u received, %u decoded, "
+           "%u sequence wraps seen\n", sent, keyframes, lost_keyframes, received, decoded, wraps);
+    CHECK(wraps > 100);
+    CHECK(lost_keyframes > 100);
+    // while acknowledgements come, deltas are what goes
+    if (!CHECK(steady_keyframes * 4 < steady_sent))
+        printf("    %u keyframes in %u frames with a working link\n", steady_keyframes, steady_sent);
+}
+
+/* A frame that must not decode, and must not disturb the decoder either. */
+static void check_malformed(DeltaDecoder &dec, const uint8_t *buf, size_t len, const char *what) {
+    int32_t out[FIELDS];
+    if (!CHECK_EQ(dec.decode(buf, len, out), DeltaDecoder::MALFORMED))
+        printf("    %s decoded\n", what);
+}
+
+static void malformed() {
+    DeltaEncoder::State state;
+    memset(&state, 0, sizeof(state));
+    DeltaEncoder enc(state, FIELDS, INTERVAL);
+    DeltaDecoder dec(FIELDS);
+    int32_t fields[FIELDS] = { 1, -1, 300, -70000, INT32_MAX, INT32_MIN };
+    int32_t out[FIELDS];
+
+    uint8_t key[DeltaPayload::MAX_FRAME];
+    size_t kn = enc.encode(fields, key, sizeof(key));
+    enc.delivered();
+    CHECK_EQ(dec.decode(key, kn, out), DeltaDecoder::DECODED);
+
+    fields[2] += 5;
+    uint8_t delta[DeltaPayload::MAX_FRAME];
+    size_t dn = enc.encode(fields, delta, sizeof(delta));
+    CHECK(!enc.wasKeyframe());
+
+    // every frame cut short, and with a byte too many
+    const uint8_t *frames[] = { key, delta };
+    const size_t lens[] = { kn, dn };
+    for (unsigned k = 0; k < 2; k++) {
+        for (size_t len = 0; len < lens[k]; len++)
+            check_malformed(dec, frames[k], len, "a truncated frame");
+        uint8_t longer[DeltaPayload::MAX_FRAME + 1];
+        memcpy(longer, frames[k], lens[k]);
+        longer[lens[k]] = 0;
+        check_malformed(dec, longer, lens[k] + 1, "a frame with a trailing byte");
+    }
+
+    // another format
+    uint8_t other[DeltaPayload::MAX_FRAME];
+    memcpy(other, delta, dn);
+    other[0] = DeltaPayload::FORMAT_BATCH;
+    check_malformed(dec, other, dn, "a 0x13 frame");
+    other[0] = 0x11;
+    check_malformed(dec, other, dn, "a 0x11 frame");
+
+    // a field the decoder does not have
+    const uint8_t extra[] = { DeltaPayload::FORMAT, DeltaPayload::CtlKeyframe | 5, 1 << FIELDS, 2 };
+    check_malformed(dec, extra, sizeof(extra), "a frame with an extra field");
+
+    // a varint of six bytes, and one that never ends
+    const uint8_t overlong[] = { DeltaPayload::FORMAT, DeltaPayload::CtlKeyframe | 5, 1,
+                                 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 };
+    check_malformed(dec, overlong, sizeof(overlong), "an overlong varint");
+    const uint8_t endless[] = { DeltaPayload::FORMAT, DeltaPayload::CtlKeyframe | 5, 1,
+                                0x80, 0x80, 0x80 };
+    check_malformed(dec, endless, sizeof(endless), "an unterminated varint");
+
+    // none of it changed what the delta decodes against
+    CHECK_EQ(dec.decode(delta, dn, out), DeltaDecoder::DECODED);
+    CHECK(memcmp(out, fields, sizeof(out)) == 0);
+}
+
+static void batch_round_trip() {
+    static const size_t sizes[] = { 12, 24, 51, 115, 222, BatchEncoder::MAX_BATCH_FRAME };
+    static int32_t records[BatchEncoder::MAX_RECORDS][DeltaPayload::MAX_FIELDS];
+    static int32_t out[BatchEncoder::MAX_RECORDS][DeltaPayload::MAX_FIELDS];
+    static uint32_t taken[BatchEncoder::MAX_RECORDS];
+    static uint32_t ages[BatchEncoder::MAX_RECORDS];
+    BatchDecoder dec(FIELDS);
+    int32_t fields[FIELDS] = { 0 };
+    uint32_t now_ms = 0xFFFFFFFF - 400000;     // the clock wraps as well
+    unsigned frames = 0, total = 0;
+
+    for (unsigned f = 0; f < 2000; f++) {
+        size_t max_frame = sizes[f % (sizeof(sizes) / sizeof(sizes[0]))];
+        BatchEncoder::State state;
+        memset(&state, 0, sizeof(state));
+        BatchEncoder *enc = new BatchEncoder(state, FIELDS);
+        unsigned n = 0;
+
+        for (;;) {
+            now_ms += 1000 * random_below(60) + random_below(1000);
+            next_fields(fields);
+            if (!enc->add(now_ms, fields, max_frame))
+                break;
+            memcpy(records[n], fields, sizeof(fields));
+            taken[n++] = now_ms;
+            CHECK_EQ(enc->getCount(), n);
+            if (random_below(20) == 0) {
+                // woken from deep sleep: only the State is left
+                delete enc;
+                enc = new BatchEncoder(state, FIELDS);
+            }
+        }
+        now_ms += random_below(30000);
+
+        uint8_t buf[BatchEncoder::MAX_BATCH_FRAME];
+        size_t len = enc->finish(now_ms, buf, max_frame);
+        delete enc;
+        if (n == 0) {
+            CHECK_EQ(len, 0);
+            continue;
+        }
+        if (!CHECK(len > 0 && len <= max_frame)) {
+            printf("    %u records in %u bytes, at most %u\n", n, (unsigned)len, (unsigned)max_frame);
+            continue;
+        }
+
+        unsigned count = 0;
+        if (!CHECK_EQ(dec.decode(buf, len, out, ages, BatchEncoder::MAX_RECORDS, &count), BatchDecoder::DECODED) ||
+            !CHECK_EQ(count, n))
+            continue;
+        for (unsigned r = 0; r < n; r++) {
+            if (!CHECK(memcmp(out[r], records[r], sizeof(fields)) == 0))
+                printf("    record %u of %u decoded to other fields\n", r, n);
+            int32_t error_ms = (int32_t)(ages[r] * 1000 - (now_ms - taken[r]));
+            if (!CHECK(error_ms >= -1000 && error_ms <= 1000))
+                printf("    record %u of %u aged %u s, taken %u ms before\n", r, n, ages[r], now_ms - taken[r]);
+        }
+        // and not into fewer records than it holds
+        CHECK_EQ(dec.decode(buf, len, out, ages, n - 1, &count), BatchDecoder::TOO_MANY);
+        frames++;
+        total += n;
+    }
+    printf("delta_payload: %u batch frames, %u records\n", frames, total);
+    CHECK(total > 10 * frames);
+}
+
+static void check_batch_malformed(const BatchDecoder &dec, const uint8_t *buf, size_t len, const char *what) {
+    static int32_t out[4][DeltaPayload::MAX_FIELDS];
+    uint32_t ages[4];
+    unsigned count = 99;
+    if (!CHECK_EQ(dec.decode(buf, len, out, ages, 4, &count), BatchDecoder::MALFORMED))
+        printf("    %s decoded\n", what);
+    CHECK_EQ(count, 99);
+}
+
+static void batch_malformed() {
+    BatchDecoder dec(2);
+    int32_t out[4][DeltaPayload::MAX_FIELDS];
+    uint32_t ages[4];
+    unsigned count;
+
+    // two records, 5 and 2 s old: { 1, 0 } then { 1, -1 }
+    const uint8_t good[] = { DeltaPayload::FORMAT_BATCH, 2, 5, 0, 0x01, 2, 3, 0x02, 1 };
+    CHECK_EQ(dec.decode(good, sizeof(good), out, ages, 4, &count), BatchDecoder::DECODED);
+    CHECK_EQ(count, 2);
+    CHECK(out[0][0] == 1 && out[0][1] == 0 && out[1][0] == 1 && out[1][1] == -1);
+    CHECK(ages[0] == 5 && ages[1] == 2);
+
+    for (size_t len = 0; len < sizeof(good); len++)
+        check_batch_malformed(dec, good, len, "a truncated batch");
+    uint8_t longer[sizeof(good) + 1];
+    memcpy(longer, good, sizeof(good));
+    longer[sizeof(good)] = 0;
+    check_batch_malformed(dec, longer, sizeof(longer), "a batch with a trailing byte");
+
+    uint8_t bad[sizeof(good)];
+    memcpy(bad, good, sizeof(good));
+    bad[0] = DeltaPayload::FORMAT;
+    check_batch_malformed(dec, bad, sizeof(bad), "a 0x12 frame");
+
+    // the second record 6 s after the first, in a frame only 5 s after it
+    memcpy(bad, good, sizeof(good));
+    bad[6] = 6;
+    check_batch_malformed(dec, bad, sizeof(bad), "a record older than its frame");
+    // the first record after another
+    memcpy(bad, good, sizeof(good));
+    bad[3] = 1;
+    check_batch_malformed(dec, bad, sizeof(bad), "a first record with a dt");
+    // a field the decoder does not have
+    memcpy(bad, good, sizeof(good));
+    bad[7] = 0x04;
+    check_batch_malformed(dec, bad, sizeof(bad), "a batch with an extra field");
+}
+
+static void varints() {
+    static const int32_t values[] = { 0, 1, -1, 63, -64, 64, 8191, -8192, 8192,
+                                      1 << 20, INT32_MAX, INT32_MIN, INT32_MIN + 1 };
+    for (unsigned i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        uint8_t buf[5];
+        uint32_t u = DeltaPayload::zigzag(values[i]);
+        CHECK_EQ(DeltaPayload::unzigzag(u), values[i]);
+        uint8_t *end = DeltaPayload::putVarint(buf, buf + sizeof(buf), u);
+        if (!CHECK(end != NULL))
+            continue;
+        uint32_t v = ~u;
+        CHECK(DeltaPayload::getVarint(buf, end, &v) == end);
+        CHECK_EQ(v, u);
+        // and not in one byte less
+        CHECK(DeltaPayload::putVarint(buf, end - 1, u) == NULL);
+    }
+}
+
+int main() {
+    srand(1);
+    varints();
+    round_trip();
+    malformed();
+    batch_round_trip();
+    batch_malformed();
+    check_exit("delta_payload");
+}
@@ -0,0 +1,137 @@
+/* host test - EventDetector thresholds, hysteresis and baselines
+ *
+ * Above and Below must come on the first time the reading is past the
+ * threshold, say so once, and stay on until it is back past it by more
+ * than the hysteresis.  A reading missing from a sample must leave its
+ * rules as they were.
+ *
+ * Rise and Fall with no time constant must go off on one step of more than
+ * the threshold.  With a time constant, a steady slope of less than
+ * threshold / tau per second must never set them off, and one of twice
+ * that must, at about the time the baseline lags by the threshold; then,
+ * the reading steady again, the rule must go off once the baseline has
+ * caught up.  That must hold sampled every few seconds and every quarter
+ * of a second, with the clock wrapping on the way.
+ */
+#include "mbed.h"
+#include "EventDetector.h"
+#include "check.h"
+
+#include <string.h>
+
+enum { FieldA, FieldB, FIELDS };
+
+static void thresholds() {
+    static const EventDetector::Rule rules[] = {
+        { FieldA, EventDetector::Above, 100, 10, 0 },
+        { FieldB, EventDetector::Below, -50, 5, 0 },
+    };
+    EventDetector::State state;
+    memset(&state, 0, sizeof(state));
+    EventDetector events(state, rules, 2);
+
+    // field A, field B, the rules that come on, the rules that are on
+    static const struct {
+        int32_t a, b;
+        unsigned valid, onset, active;
+    } steps[] = {
+        { 90, 0, 3, 0, 0 },
+        { 100, -50, 3, 0, 0 },      // at the threshold is not past it
+        { 101, -51, 3, 3, 3 },
+        { 150, -80, 3, 0, 3 },      // on already
+        { 90, -45, 3, 0, 3 },       // back, but within the hysteresis
+        { 89, -44, 3, 0, 0 },
+        { 101, 0, 3, 1, 1 },
+        { 101, -60, 1, 0, 1 },      // B not read: not on
+        { 0, -60, 2, 2, 3 },        // A not read: still on
+        { 0, 0, 3, 0, 0 },
+    };
+    uint32_t now_ms = 0;
+    for (unsigned i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        int32_t fields[FIELDS] = { steps[i].a, steps[i].b };
+        bool ok = CHECK_EQ(events.update(now_ms, fields, steps[i].valid), steps[i].onset) &
+                  CHECK_EQ(events.getActive(), steps[i].active);
+        if (!ok)
+            printf("    step %u: A %d, B %d\n", i, steps[i].a, steps[i].b);
+        now_ms += 1000;
+    }
+}
+
+static void step() {
+    static const EventDetector::Rule rules[] = {
+        { FieldA, EventDetector::Rise, 20, 5, 0 },
+        { FieldA, EventDetector::Fall, 20, 5, 0 },
+    };
+    EventDetector::State state;
+    memset(&state, 0, sizeof(state));
+    EventDetector events(state, rules, 2);
+    int32_t fields[FIELDS] = { 1000, 0 };
+
+    // the first reading is the baseline, and the next as soon after as may be
+    CHECK_EQ(events.update(0, fields), 0);
+    fields[FieldA] = 1020;
+    CHECK_EQ(events.update(0, fields), 0);
+    fields[FieldA] = 1041;
+    CHECK_EQ(events.update(100, fields), 1);
+    CHECK_EQ(events.update(200, fields), 0);
+    CHECK_EQ(events.getActive(), 0);
+    fields[FieldA] = 1020;
+    CHECK_EQ(events.update(300, fields), 2);
+    fields[FieldA] = 1003;
+    CHECK_EQ(events.update(400, fields), 0);
+    CHECK_EQ(events.getActive(), 2);
+    CHECK_EQ(events.update(500, fields), 0);
+    CHECK_EQ(events.getActive(), 0);
+}
+
+/* Reading A climbing at slope units a second from 0, sampled every
+ * interval_ms for 600 s, then steady for as long again, against a Rise
+ * rule of threshold 64 and tau 60 s; on a Fall rule, falling.  Returns
+ * the time in seconds the rule came on, or -1, and whether it was off at
+ * the end. */
+static double ramp(EventDetector::Kind kind, double slope, uint32_t interval_ms, bool *off) {
+    const EventDetector::Rule rules[] = { { FieldA, (uint8_t)kind, 64, 16, 60 } };
+    EventDetector::State state;
+    memset(&state, 0, sizeof(state));
+    EventDetector events(state, rules, 1);
+    uint32_t start = 0xFFFFFFFF - 100000;
+    double on = -1;
+
+    for (uint32_t t = 0; t <= 1200000; t += interval_ms) {
+        double x = slope * (t < 600000 ? t : 600000) / 1000;
+        int32_t fields[FIELDS] = { (int32_t)(kind == EventDetector::Rise ? x : -x), 0 };
+        if (events.update(start + t, fields) && on < 0)
+            on = t / 1000.0;
+    }
+    *off = events.getActive() == 0;
+    return on;
+}
+
+static void baselines() {
+    static const uint32_t intervals[] = { 250, 1000, 5000 };
+    static const EventDetector::Kind kinds[] = { EventDetector::Rise, EventDetector::Fall };
+
+    for (unsigned k = 0; k < 2; k++) {
+        for (unsigned i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++) {
+            bool off;
+            // 64 / 60 s is the slope that sets it off in the end
+            double slow = ramp(kinds[k], 0.5, intervals[i], &off);
+            if (!CHECK(slow < 0 && off))
+                printf("    %s at 0.5 a second, every %u ms: on at %.2f s\n",
+                       k ? "fall" : "rise", intervals[i], slow);
+            // at 2 a second the baseline lags by the threshold after
+            // tau ln(120 / 56), 46 s
+            double fast = ramp(kinds[k], 2, intervals[i], &off);
+            if (!CHECK(fast > 35 && fast < 55 && off))
+                printf("    %s at 2 a second, every %u ms: on at %.2f s, %s at the end\n",
+                       k ? "fall" : "rise", intervals[i], fast, off ? "off" : "on");
+        }
+    }
+}
+
+int main() {
+    thresholds();
+    step();
+    baselines();
+    check_exit("event_detector");
+}
@@ -0,0 +1,225 @@
+/* host test - FrameQueue on the simulated mDot's user files
+ *
+ * Frames are queued and taken off at random, with a plain list alongside,
+ * many times round a ring of a few slots: whatever peek() gives must be the
+ * oldest frame on the list, with its time, and when the ring runs full the
+ * oldest frame must make room and be counted as dropped.  The file must
+ * never grow past the ring.
+ *
+ * A slot that does not read back must be skipped and counted: one left
+ * from the ring's last time round, one cut short by a reset, one with a
+ * byte changed and a file that ends early.
+ *
+ * With a write budget, a burst of as many frames as there are slots must
+ * go into the queue and the next be dropped, and frames offered every few
+ * seconds for hours, across the wrap of the clock, must be queued at the
+ * budget's rate.  A State whose head ran more than a ring past its tail,
+ * as from a larger ring, must come back as a full ring.
+ */
+#include "mbed.h"
+#include "mDot.h"
+#include "FrameQueue.h"
+#include "check.h"
+
+#include <string.h>
+#include <vector>
+
+static const unsigned SLOTS = 4;
+
+static unsigned random_below(unsigned n) {
+    return (unsigned)rand() % n;
+}
+
+/* Frame number seq: of varying length, every byte telling which it is. */
+static size_t frame(uint32_t seq, uint8_t *buf) {
+    size_t len = 1 + (seq * 37) % FrameQueue::MAX_FRAME;
+    for (size_t i = 0; i < len; i++)
+        buf[i] = (uint8_t)(seq * 7 + i);
+    return len;
+}
+
+/* Whether the oldest frame is number seq, queued at time_ms. */
+static bool peeks(FrameQueue &q, uint32_t seq, uint32_t time_ms) {
+    uint8_t want[FrameQueue::MAX_FRAME], got[FrameQueue::MAX_FRAME];
+    size_t len = frame(seq, want);
+    uint32_t t = ~time_ms;
+    int n = q.peek(got, sizeof(got), &t);
+    if (n == (int)len && t == time_ms && memcmp(got, want, len) == 0)
+        return true;
+    printf("    frame %u of %u bytes at %u ms: peek gave %d bytes at %u ms\n",
+           seq, (unsigned)len, time_ms, n, t);
+    return false;
+}
+
+static void ring(mDot *dot) {
+    FrameQueue::State state;
+    memset(&state, 0, sizeof(state));
+    FrameQueue q(state, dot, "ring.queue", SLOTS, 0);
+    std::vector<uint32_t> model;        // sequence numbers, oldest first
+    uint32_t seq = 0, dropped = 0;
+    uint8_t buf[FrameQueue::MAX_FRAME];
+    uint32_t t;
+
+    // empty, and no frames of no length or too long
+    CHECK_EQ(q.peek(buf, sizeof(buf), &t), 0);
+    CHECK(!q.push(0, buf, 0));
+    CHECK(!q.push(0, buf, FrameQueue::MAX_FRAME + 1));
+    dropped += 2;
+    CHECK_EQ(q.getDropped(), dropped);
+
+    for (unsigned step = 0; step < 3000; step++) {
+        if (random_below(100) < 55) {
+            size_t len = frame(seq, buf);
+            if (!CHECK(q.push(seq * 1000, buf, len)))
+                break;
+            model.push_back(seq++);
+            if (model.size() > SLOTS) {
+                model.erase(model.begin());
+                dropped++;
+            }
+        } else if (!model.empty()) {
+            if (!CHECK(peeks(q, model[0], model[0] * 1000)))
+                break;
+            q.pop();
+            model.erase(model.begin());
+        } else {
+            CHECK_EQ(q.peek(buf, sizeof(buf), &t), 0);
+            q.pop();
+        }
+        if (!CHECK_EQ(q.getCount(), model.size()) || !CHECK_EQ(q.getDropped(), dropped))
+            break;
+    }
+    CHECK(seq > 100 * SLOTS);
+    CHECK(dropped > 10);
+
+    mDot::mdot_file f = dot->openUserFile("ring.queue", mDot::FM_RDONLY);
+    CHECK_EQ(f.size, SLOTS * FrameQueue::SLOT_SIZE);
+    dot->closeUserFile(f);
+}
+
+static void skipped(mDot *dot) {
+    static const size_t RING = SLOTS * FrameQueue::SLOT_SIZE;
+    FrameQueue::State state;
+    memset(&state, 0, sizeof(state));
+    FrameQueue q(state, dot, "skip.queue", SLOTS, 0);
+    uint8_t buf[FrameQueue::MAX_FRAME];
+    uint8_t file[RING], earlier[RING];
+    uint32_t t;
+
+    // round the ring once, keeping what the file then held, and half again
+    for (uint32_t seq = 0; seq < SLOTS; seq++)
+        q.push(seq, buf, frame(seq, buf));
+    CHECK(dot->readUserFile("skip.queue", earlier, RING));
+    for (uint32_t seq = SLOTS; seq < 2 * SLOTS; seq++)
+        q.push(seq, buf, frame(seq, buf));
+    CHECK_EQ(q.getDropped(), SLOTS);
+    CHECK(dot->readUserFile("skip.queue", file, RING));
+
+    // frame 5 back to frame 1, frame 6 cut short after its header, a byte
+    // of frame 7 changed
+    const size_t slot = FrameQueue::SLOT_SIZE;
+    memcpy(&file[1 * slot], &earlier[1 * slot], slot);
+    memset(&file[2 * slot + FrameQueue::SLOT_HEADER], 0xFF, slot - FrameQueue::SLOT_HEADER);
+    file[3 * slot + FrameQueue::SLOT_HEADER] ^= 0x01;
+    CHECK(dot->saveUserFile("skip.queue", file, RING));
+
+    CHECK(peeks(q, 4, 4));
+    q.pop();
+    CHECK_EQ(q.peek(buf, sizeof(buf), &t), 0);
+    CHECK_EQ(q.getCount(), 0);
+    CHECK_EQ(q.getDropped(), SLOTS + 3);
+
+    // a file that ends in the middle of the next slot, before the one after
+    q.push(8, buf, frame(8, buf));
+    q.push(9, buf, frame(9, buf));
+    CHECK(dot->readUserFile("skip.queue", file, RING));
+    CHECK(dot->saveUserFile("skip.queue", file, FrameQueue::SLOT_HEADER + 1));
+    CHECK_EQ(q.peek(buf, sizeof(buf), &t), 0);
+    CHECK_EQ(q.getCount(), 0);
+    CHECK_EQ(q.getDropped(), SLOTS + 5);
+
+    // and no file at all, which is an error and skips nothing
+    CHECK(dot->saveUserFile("skip.queue", file, RING));
+    CHECK(q.push(10, buf, frame(10, buf)));
+    CHECK(dot->deleteUserFile("skip.queue"));
+    CHECK_EQ(q.peek(buf, sizeof(buf), &t), -1);
+    CHECK_EQ(q.getCount(), 1);
+}
+
+static void budget(mDot *dot) {
+    static const unsigned PER_HOUR = 60;
+    static const uint32_t HOUR_MS = 3600000;
+    FrameQueue::State state;
+    memset(&state, 0, sizeof(state));
+    FrameQueue q(state, dot, "budget.queue", SLOTS, PER_HOUR);
+    uint8_t buf[FrameQueue::MAX_FRAME];
+    size_t len = frame(0, buf);
+
+    // a burst of a ring's worth, and no more
+    uint32_t now_ms = 0xFFFFFFFF - 5 * HOUR_MS;
+    for (unsigned i = 0; i < SLOTS; i++)
+        CHECK(q.push(now_ms, buf, len));
+    CHECK(!q.push(now_ms, buf, len));
+    CHECK_EQ(q.getDropped(), 1);
+    // the next one comes back a frame's interval later, and that frame
+    // pushes the oldest out of the full ring
+    CHECK(!q.push(now_ms + HOUR_MS / PER_HOUR - 1, buf, len));
+    CHECK(q.push(now_ms + HOUR_MS / PER_HOUR, buf, len));
+    CHECK_EQ(q.getDropped(), 3);
+
+    // a long outage: a frame every ten seconds for ten hours, across the
+    // wrap of the clock, taken off again so the ring never runs full
+    while (q.getCount())
+        q.pop();
+    uint32_t start = now_ms += HOUR_MS;
+    unsigned queued = 0, offered = 0;
+    for (; now_ms - start < 10 * HOUR_MS; now_ms += 10000) {
+        offered++;
+        if (q.push(now_ms, buf, len)) {
+            queued++;
+            q.pop();
+        }
+    }
+    printf("frame_queue: %u of %u frames queued in 10 hours at %u an hour\n", queued, offered, PER_HOUR);
+    CHECK(queued >= 10 * PER_HOUR && queued <= 10 * PER_HOUR + SLOTS);
+    CHECK_EQ(q.getDropped(), 3 + offered - queued);
+}
+
+static void clamped(mDot *dot) {
+    FrameQueue::State state;
+    memset(&state, 0, sizeof(state));
+
+    // from a ring of 16, with 10 frames on it
+    state.head = 26;
+    state.tail = 16;
+    FrameQueue q(state, dot, "clamp.queue", SLOTS, 0);
+    CHECK_EQ(q.getCount(), SLOTS);
+    CHECK_EQ(state.tail, 26 - SLOTS);
+
+    // the same across the wrap of the positions
+    state.head = 3;
+    state.tail = 0xFFFFFFF0;
+    FrameQueue w(state, dot, "clamp.queue", SLOTS, 0);
+    CHECK_EQ(w.getCount(), SLOTS);
+    CHECK_EQ(state.tail, (uint32_t)3 - SLOTS);
+
+    // a State that fits is left alone
+    state.head = 1;
+    state.tail = 0xFFFFFFFE;
+    FrameQueue k(state, dot, "clamp.queue", SLOTS, 0);
+    CHECK_EQ(k.getCount(), 3);
+
+    // and a ring of no slots has one
+    FrameQueue one(state, dot, "clamp.queue", 0, 0);
+    CHECK_EQ(one.getCount(), 1);
+}
+
+int main() {
+    srand(1);
+    mDot *dot = mDot::getInstance();
+    ring(dot);
+    skipped(dot);
+    budget(dot);
+    clamped(dot);
+    check_exit("frame_queue");
+}
@@ -0,0 +1,48 @@
+/* host kernel tests - the SysTick and SCB registers of a modelled core
+ *
+ * Stands in for the mbed device header that rt_Tickless.c includes.  Each
+ * register is an object whose reads and writes go to core_read() and
+ * core_write(), which a test provides to model the timer cycle by cycle;
+ * that is why such a test builds the kernel source as C++.  Only what
+ * rt_Tickless.c uses is here.
+ */
+#ifndef HOST_TEST_CMSIS_H
+#define HOST_TEST_CMSIS_H
+
+#include <stdint.h>
+
+enum CoreRegister { SYSTICK_CTRL, SYSTICK_LOAD, SYSTICK_VAL, SCB_ICSR };
+
+uint32_t core_read(CoreRegister reg);
+void core_write(CoreRegister reg, uint32_t value);
+
+template <CoreRegister R>
+struct CoreReg {
+    operator uint32_t() const { return core_read(R); }
+    CoreReg &operator=(uint32_t value) { core_write(R, value); return *this; }
+};
+
+struct SysTick_Type {
+    CoreReg<SYSTICK_CTRL> CTRL;
+    CoreReg<SYSTICK_LOAD> LOAD;
+    CoreReg<SYSTICK_VAL>  VAL;
+};
+
+struct SCB_Type {
+    CoreReg<SCB_ICSR> ICSR;
+};
+
+static SysTick_Type core_systick;
+static SCB_Type core_scb;
+
+#define SysTick (&core_systick)
+#define SCB     (&core_scb)
+
+#define SysTick_CTRL_ENABLE_Msk    (1UL << 0)
+#define SysTick_CTRL_TICKINT_Msk   (1UL << 1)
+#define SysTick_CTRL_CLKSOURCE_Msk (1UL << 2)
+#define SysTick_CTRL_COUNTFLAG_Msk (1UL << 16)
+#define SCB_ICSR_PENDSTCLR_Msk     (1UL << 25)
+#define SCB_ICSR_PENDSTSET_Msk     (1UL << 26)
+
+#endif
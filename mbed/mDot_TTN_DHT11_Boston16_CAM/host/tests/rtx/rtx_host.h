@@ -0,0 +1,18 @@
+/* host kernel tests - what the RTX sources need from the core on the host
+ *
+ * The kernel tests build RTX sources unchanged for the host, with this
+ * header included first.  They are built as for a Cortex-M0 (-D__CORTEX_M0),
+ * whose rt_HAL_CM.h finds the top set bit in C rather than with a CLZ
+ * instruction, and with __CMSIS_GENERIC, so that the interrupt mask comes
+ * from here rather than from Cortex-M assembler.  Nothing interrupts a
+ * kernel test, so masking does nothing.
+ */
+#ifndef HOST_TEST_RTX_HOST_H
+#define HOST_TEST_RTX_HOST_H
+
+#define __CMSIS_GENERIC
+
+static inline void __enable_irq(void) {}
+static inline unsigned __disable_irq(void) { return 0; }
+
+#endif
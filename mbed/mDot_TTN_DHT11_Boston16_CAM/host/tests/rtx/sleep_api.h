@@ -0,0 +1,15 @@
+/* host kernel tests - mbed's sleep(), which a test that needs it provides */
+#ifndef HOST_TEST_SLEEP_API_H
+#define HOST_TEST_SLEEP_API_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sleep(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,315 @@
+/* host kernel test - the ready queue of rt_List.c against a sorted list
+ *
+ * rt_List.c is built into this test, so that its priority levels can be
+ * looked at.  Random puts, gets, puts at the head, yields, priority
+ * changes and removals on a set of tasks go to the ready queue and to a
+ * plain array kept the way RTX kept the ready list before: sorted by
+ * priority, first in first out within one, with rt_put_rdy_first() at
+ * the head.  After each one the levels, read from the top, must hold the
+ * array's tasks in its order, each FIFO's tail must be its last task,
+ * rdy_map must have a bit for exactly the levels that are not empty, and
+ * os_rdy.p_lnk must be the array's first task.  Priorities above
+ * osPriorityRealtime, which share the top level, come up now and then.
+ *
+ * With --bench it times instead a get and a put of the highest priority
+ * task, and a removal and a put of any, for ready queues of K tasks, on
+ * the levels and on the sorted array.
+ */
+#include "rt_List.c"
+
+#include "check.h"
+
+#include <string.h>
+#include <time.h>
+
+#define TASKS   24
+#define OPS     400000
+#define BENCH_TASKS  65         /* the most ready, idle included, --bench times */
+
+U32 os_time;
+struct OS_TSK os_tsk;
+U32 os_fifo[4*2+1];            /* a post service queue, not used here */
+
+void os_error (U32 err_code) {
+  CHECK(0);
+}
+
+static struct OS_TCB tcb[TASKS];
+static struct OS_TCB running;
+
+/* the ready list as RTX kept it, highest priority first */
+static P_TCB model[BENCH_TASKS];
+static unsigned model_n;
+
+static U32 random32 (void) {
+  static U32 x = 2463534242u;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+/* Mostly the osPriority levels, now and then one of the kernel's own. */
+static U8 random_prio (void) {
+  static const U8 high[] = { 8, 9, 100, 254, 255 };
+  if (random32() % 16 == 0) {
+    return high[random32() % sizeof(high)];
+  }
+  return (U8)(random32() % 8);
+}
+
+static void model_insert (unsigned at, P_TCB p) {
+  memmove (&model[at + 1], &model[at], (model_n - at) * sizeof(model[0]));
+  model[at] = p;
+  model_n++;
+}
+
+static void model_put (P_TCB p) {
+  unsigned at = 0;
+  while (at < model_n && model[at]->prio >= p->prio) {
+    at++;
+  }
+  model_insert (at, p);
+}
+
+static void model_remove (P_TCB p) {
+  unsigned at = 0;
+  while (model[at] != p) {
+    at++;
+  }
+  memmove (&model[at], &model[at + 1], (model_n - at - 1) * sizeof(model[0]));
+  model_n--;
+}
+
+/* A task in the ready queue, or one that is not: NULL if there is none. */
+static P_TCB pick (BOOL ready) {
+  unsigned i, start = random32() % TASKS;
+  for (i = 0; i < TASKS; i++) {
+    P_TCB p = &tcb[(start + i) % TASKS];
+    if ((p->state == READY) == ready) {
+      return (p);
+    }
+  }
+  return (NULL);
+}
+
+static int check_queue (U32 op, const char *what) {
+  unsigned n = 0;
+  int ok = 1;
+  S32 lvl;
+
+  for (lvl = RDY_LEVELS - 1; lvl >= 0; lvl--) {
+    P_TCB p, last = NULL;
+    ok &= ((rdy_map >> lvl) & 1) == (rdy_head[lvl] != NULL);
+    for (p = rdy_head[lvl]; p != NULL && n < TASKS; p = p->p_lnk) {
+      ok &= RDY_LEVEL(p->prio) == (U32)lvl && p == model[n++];
+      last = p;
+    }
+    ok &= rdy_tail[lvl] == last;
+  }
+  ok &= n == model_n && (rdy_map >> RDY_LEVELS) == 0;
+  ok &= os_rdy.p_lnk == (model_n ? model[0] : NULL);
+  if (!CHECK(ok)) {
+    printf ("    after op %u, %s\n", op, what);
+  }
+  return (ok);
+}
+
+static void ready_queue (void) {
+  unsigned i, puts = 0, gets = 0, firsts = 0, yields = 0, resorts = 0, moved = 0, rmvs = 0;
+  U32 op;
+
+  for (i = 0; i < TASKS; i++) {
+    tcb[i].cb_type = TCB;
+    tcb[i].state = INACTIVE;
+    tcb[i].prio = random_prio ();
+  }
+  running.cb_type = TCB;
+  running.state = RUNNING;
+  os_tsk.run = &running;
+
+  for (op = 0; op < OPS; op++) {
+    P_TCB p;
+    const char *what;
+
+    switch (random32() % 8) {
+    case 0:
+    case 1:
+      /* a task becomes ready */
+      if ((p = pick (__FALSE)) == NULL) {
+        continue;
+      }
+      p->prio = random_prio ();
+      p->state = READY;
+      rt_put_prio (&os_rdy, p);
+      model_put (p);
+      what = "rt_put_prio";
+      puts++;
+      break;
+    case 2:
+    case 3:
+      /* the highest priority one runs */
+      if (model_n == 0) {
+        continue;
+      }
+      p = rt_get_first (&os_rdy);
+      CHECK(p == model[0] && p->p_lnk == NULL);
+      model_remove (model[0]);
+      p->state = INACTIVE;
+      what = "rt_get_first";
+      gets++;
+      break;
+    case 4:
+      /* a task preempted by an interrupt goes back at the head */
+      if ((p = pick (__FALSE)) == NULL) {
+        continue;
+      }
+      if (model_n && p->prio < model[0]->prio) {
+        p->prio = model[0]->prio;
+      }
+      p->state = READY;
+      rt_put_rdy_first (p);
+      model_insert (0, p);
+      what = "rt_put_rdy_first";
+      firsts++;
+      break;
+    case 5:
+      /* the running task yields to one of its priority, if any */
+      if (model_n == 0) {
+        continue;
+      }
+      running.prio = random32() % 2 ? model[0]->prio : random_prio ();
+      p = rt_get_same_rdy_prio ();
+      if (model[0]->prio == running.prio) {
+        CHECK(p == model[0]);
+        model_remove (model[0]);
+        p->state = INACTIVE;
+      }
+      else {
+        CHECK(p == NULL);
+      }
+      what = "rt_get_same_rdy_prio";
+      yields++;
+      break;
+    case 6:
+      /* a ready task changes priority */
+      if ((p = pick (__TRUE)) == NULL) {
+        continue;
+      }
+      p->prio = random_prio ();
+      rt_resort_prio (p);
+      model_remove (p);
+      model_put (p);
+      what = "rt_resort_prio";
+      resorts++;
+      break;
+    default:
+      /* a ready task is deleted, now and then after its priority changed */
+      if ((p = pick (__TRUE)) == NULL) {
+        continue;
+      }
+      if (random32() % 4 == 0) {
+        p->prio = random_prio ();
+        moved++;
+      }
+      rt_rmv_list (p);
+      model_remove (p);
+      p->state = INACTIVE;
+      what = "rt_rmv_list";
+      rmvs++;
+      break;
+    }
+    if (!check_queue (op, what)) {
+      break;
+    }
+  }
+
+  printf ("rtx_list: %u puts, %u gets, %u puts first, %u yields, %u resorts, "
+          "%u removals (%u after a priority change)\n",
+          puts, gets, firsts, yields, resorts, rmvs, moved);
+}
+
+static double now_ns (void) {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec * 1e9 + ts.tv_nsec);
+}
+
+static void bench (void) {
+  static const unsigned sizes[] = { 1, 4, 8, 16, 32, 64 };
+  static struct OS_TCB task[BENCH_TASKS];
+  const unsigned rounds = 2000000;
+  unsigned s, i, k, m;
+
+  printf ("ns per operation with K tasks ready besides idle\n");
+  printf ("%-24s", "K");
+  for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    printf ("%6u", sizes[s]);
+  }
+  printf ("\n");
+
+  for (k = 0; k < 4; k++) {
+    /* the levels, then the sorted array */
+    m = k % 2;
+    if (m == 0) {
+      printf ("%s\n", k == 0 ? "get first + put" : "remove any + put");
+    }
+    printf ("  %-22s", m == 0 ? "levels" : "sorted list");
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      unsigned n = sizes[s] + 1;
+      double t;
+
+      memset (rdy_head, 0, sizeof(rdy_head));
+      memset (rdy_tail, 0, sizeof(rdy_tail));
+      rdy_map = 0;
+      os_rdy.p_lnk = NULL;
+      model_n = 0;
+      for (i = 0; i < n; i++) {
+        memset (&task[i], 0, sizeof(task[i]));
+        task[i].cb_type = TCB;
+        task[i].state = READY;
+        task[i].prio = i == 0 ? 0 : (U8)(1 + random32() % 7);
+        if (m == 0) {
+          rt_put_prio (&os_rdy, &task[i]);
+        }
+        else {
+          model_put (&task[i]);
+        }
+      }
+
+      t = now_ns ();
+      for (i = 0; i < rounds; i++) {
+        P_TCB p = k < 2 ? NULL : &task[i % n];
+        if (m == 0) {
+          if (p == NULL) {
+            p = rt_get_first (&os_rdy);
+          }
+          else {
+            rt_rmv_list (p);
+          }
+          rt_put_prio (&os_rdy, p);
+        }
+        else {
+          if (p == NULL) {
+            p = model[0];
+          }
+          model_remove (p);
+          model_put (p);
+        }
+      }
+      t = now_ns () - t;
+      printf ("%6.1f", t / rounds / 2);
+    }
+    printf ("\n");
+  }
+}
+
+int main (int argc, char **argv) {
+  if (argc > 1 && strcmp (argv[1], "--bench") == 0) {
+    bench ();
+    return (0);
+  }
+  ready_queue ();
+  check_exit ("rtx_list");
+  return (0);
+}
@@ -0,0 +1,190 @@
+/* host kernel test - rt_tick_sleep() against a cycle model of the SysTick
+ *
+ * rt_Tickless.c is built into this test as C++, with tests/rtx/cmsis.h
+ * turning its register accesses into calls to the model below: a 24-bit
+ * down-counter that reloads from LOAD on the cycle after it reaches 0, sets
+ * COUNTFLAG (cleared by reading CTRL or writing VAL) and, with TICKINT,
+ * pends the interrupt on each 1 -> 0 step.  Every register access takes
+ * ACCESS_CYCLES.  sleep() runs the model to the SysTick interrupt or, for
+ * an early wake-up, to a random point before it.
+ *
+ * For random stretches from random points of the tick, this checks that
+ * the ticks returned are the tick boundaries that passed before the
+ * counter was read, that the expired tick is not left pending, and that
+ * once the scheduler unlocks the SysTick the next interrupt comes on the
+ * next boundary of the original grid, give or take the cycles the counter
+ * was stopped while it was reprogrammed.
+ */
+#include "cmsis.h"
+
+extern "C" {
+#include "rt_Tickless.c"
+}
+
+#include "check.h"
+
+// 96 MHz, 1 ms tick
+U32 const os_trv = 95999;
+
+static const unsigned STRETCHES = 20000;
+static const unsigned ACCESS_CYCLES = 2;
+// what a stretch may move the tick phase by: the counter stands still for
+// the four accesses that set the stretch up, and after an early wake-up it
+// runs on for two accesses that do not see it and stands still for three
+static const unsigned MAX_SLIP = 9 * ACCESS_CYCLES;
+
+static uint64_t now;                // cycles
+static bool enabled, tickint, countflag, pending;
+static uint32_t load, val;
+
+static uint32_t random32() {
+    static uint32_t x = 2463534242u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/* Run the counter for 'cycles'. */
+static void run(uint64_t cycles) {
+    now += cycles;
+    if (!enabled)
+        return;
+    while (cycles > 0) {
+        if (val == 0) {
+            val = load;
+            cycles--;
+        } else if (val <= cycles) {
+            cycles -= val;
+            val = 0;
+            countflag = true;
+            if (tickint)
+                pending = true;
+        } else {
+            val -= (uint32_t)cycles;
+            cycles = 0;
+        }
+    }
+}
+
+/* Cycles from now to the next 1 -> 0 step of the counter. */
+static uint64_t next_step() {
+    return val > 0 ? val : 1 + (uint64_t)load;
+}
+
+uint32_t core_read(CoreRegister reg) {
+    run(ACCESS_CYCLES);
+    switch (reg) {
+    case SYSTICK_CTRL: {
+        uint32_t ctrl = SysTick_CTRL_CLKSOURCE_Msk |
+                        (enabled ? SysTick_CTRL_ENABLE_Msk : 0) |
+                        (tickint ? SysTick_CTRL_TICKINT_Msk : 0) |
+                        (countflag ? SysTick_CTRL_COUNTFLAG_Msk : 0);
+        countflag = false;
+        return ctrl;
+    }
+    case SYSTICK_LOAD:
+        return load;
+    case SYSTICK_VAL:
+        return val;
+    case SCB_ICSR:
+        return pending ? SCB_ICSR_PENDSTSET_Msk : 0;
+    }
+    return 0;
+}
+
+void core_write(CoreRegister reg, uint32_t value) {
+    run(ACCESS_CYCLES);
+    switch (reg) {
+    case SYSTICK_CTRL:
+        enabled = (value & SysTick_CTRL_ENABLE_Msk) != 0;
+        tickint = (value & SysTick_CTRL_TICKINT_Msk) != 0;
+        break;
+    case SYSTICK_LOAD:
+        load = value & 0x00FFFFFF;
+        break;
+    case SYSTICK_VAL:
+        val = 0;
+        countflag = false;
+        break;
+    case SCB_ICSR:
+        if (value & SCB_ICSR_PENDSTCLR_Msk)
+            pending = false;
+        if (value & SCB_ICSR_PENDSTSET_Msk)
+            pending = true;
+        break;
+    }
+}
+
+static bool wake_early;
+static uint64_t woke;
+
+void sleep(void) {
+    // interrupts are masked, but a pending one still ends the WFI
+    if (!pending && enabled && tickint) {
+        uint64_t cycles = next_step();
+        if (wake_early)
+            cycles = 1 + random32() % cycles;
+        run(cycles);
+    }
+    woke = now;
+}
+
+int main() {
+    const uint64_t period = os_trv + 1;
+    const uint32_t max_ticks = 0x00FFFFFF / period;
+    unsigned early = 0, whole = 0;
+    uint64_t slip_max = 0;
+
+    // running as the kernel leaves it, locked by os_suspend()
+    enabled = true;
+    load = os_trv;
+    val = 1 + random32() % os_trv;
+
+    for (unsigned i = 0; i < STRETCHES; i++) {
+        // let the phase wander between stretches
+        run(random32() % (3 * period));
+        pending = false;
+        countflag = false;
+
+        // boundary k is at first + (k - 1) * period
+        uint64_t first = now + next_step();
+        uint32_t ticks = 2 + random32() % (max_ticks + 40);
+        wake_early = random32() % 2 != 0;
+
+        uint32_t passed = rt_tick_sleep(ticks);
+
+        // the boundaries up to the wake-up, and no further than the stretch
+        uint32_t stretch = (ticks < max_ticks ? ticks : max_ticks) - 1;
+        uint32_t expected = woke >= first ? (uint32_t)((woke - first) / period) + 1 : 0;
+        if (expected > stretch)
+            expected = stretch;
+        if (!CHECK_EQ(passed, expected))
+            printf("    stretch %u of %u ticks, woke %llu cycles after the first boundary\n",
+                   i, ticks, (unsigned long long)(woke - first));
+        CHECK(!pending);
+        if (passed == stretch)
+            whole++;
+        else
+            early++;
+
+        // os_resume() unlocks the SysTick: the next interrupt is the next
+        // boundary after the ticks accounted for
+        core_write(SYSTICK_CTRL, SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk |
+                                 SysTick_CTRL_ENABLE_Msk);
+        uint64_t next = now + next_step();
+        uint64_t due = first + passed * period;
+        uint64_t slip = next > due ? next - due : due - next;
+        if (slip > slip_max)
+            slip_max = slip;
+        if (!CHECK(next >= due && slip <= MAX_SLIP))
+            printf("    stretch %u: next tick at %lld cycles from its boundary\n",
+                   i, (long long)(next - due));
+        CHECK_EQ(load, os_trv);
+        core_write(SYSTICK_CTRL, SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk);
+    }
+
+    printf("rtx_tickless: %u whole stretches, %u woken early, tick phase within %llu cycles\n",
+           whole, early, (unsigned long long)slip_max);
+    check_exit("rtx_tickless");
+}
@@ -0,0 +1,235 @@
+/* host kernel test - the timer wheel of rt_List.c across the 32-bit wrap
+ *
+ * Time-outs with delays from 1 tick to 2^31, most of them short, are put
+ * on a wheel and taken off it again at random, while the time goes on one
+ * tick at a time, as rt_dec_dly() sees it, or straight to the next expiry
+ * rt_whl_next() gives, as the tickless idle does.  The time starts just
+ * short of the 32-bit wrap and passes it again and again.  Each time-out
+ * must come out of rt_whl_get() on its tick and no other, rt_whl_next()
+ * must give the nearest expiry, so that a jump steps over none, and the
+ * wheel's count must be the number of time-outs on it.  Taking off one
+ * that is not on the wheel must leave it alone.
+ *
+ * With --bench it times instead a put and a removal, and a tick with the
+ * time-outs due on it put back, for wheels of N time-outs with delays of
+ * up to 10000 ticks.
+ */
+#include "rt_List.c"
+
+#include "check.h"
+
+#include <string.h>
+#include <time.h>
+
+#define TOUTS       500
+#define STEPS       4000000
+#define MAX_DELAY   0x80000000u
+
+U32 os_time;
+struct OS_TSK os_tsk;
+U32 os_fifo[4*2+1];             /* a post service queue, not used here */
+
+void os_error (U32 err_code) {
+  CHECK(0);
+}
+
+static struct OS_WHEEL whl;
+static struct OS_TOUT tout[TOUTS];
+
+/* what the wheel should hold */
+static U32 expiry[TOUTS];
+static BOOL armed[TOUTS];
+static U32 armed_n;
+
+static U32 random32 (void) {
+  static U32 x = 2463534242u;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+/* 1 to MAX_DELAY ticks, as likely in each power of 2. */
+static U32 random_delay (void) {
+  return (1 + (random32() >> (1 + random32() % 31)));
+}
+
+/* The nearest expiry after "time" by the list above, and whether every */
+/* time-out on it is still ahead. */
+static U32 model_next (U32 time, BOOL *ahead) {
+  U32 i, delta, next = 0xFFFFFFFF;
+
+  *ahead = __TRUE;
+  for (i = 0; i < TOUTS; i++) {
+    if (armed[i]) {
+      delta = expiry[i] - time;
+      if (delta == 0 || delta > MAX_DELAY) {
+        *ahead = __FALSE;
+      }
+      if (delta < next) {
+        next = delta;
+      }
+    }
+  }
+  return (next);
+}
+
+/* Take off the wheel what expires at "time". */
+static U32 expire (U32 time) {
+  P_TOUT p;
+  U32 n = 0;
+
+  while ((p = rt_whl_get (&whl, time)) != NULL) {
+    U32 i = (U32)(p - tout);
+    if (!CHECK(i < TOUTS && armed[i] && expiry[i] == time)) {
+      printf ("    time 0x%08x: time-out %u of 0x%08x came out\n", time, i, expiry[i]);
+      break;
+    }
+    CHECK(p->pp_prev == NULL);
+    armed[i] = __FALSE;
+    armed_n--;
+    n++;
+  }
+  return (n);
+}
+
+static void stress (void) {
+  U32 time = 0xFFFFFFFF - 5000, last = time;
+  U32 step, i, arms = 0, cancels = 0, idle = 0, ticks = 0, jumps = 0, fired = 0, wraps = 0;
+  BOOL ahead;
+
+  rt_whl_init (&whl);
+  for (step = 0; step < STEPS; step++) {
+    U32 r = random32() % 100;
+    i = random32() % TOUTS;
+
+    if (r < 30) {
+      /* a task waits, or a timer starts */
+      if (armed[i]) {
+        continue;
+      }
+      expiry[i] = time + random_delay ();
+      rt_whl_put (&whl, &tout[i], expiry[i]);
+      armed[i] = __TRUE;
+      armed_n++;
+      arms++;
+    }
+    else if (r < 45) {
+      /* the wait ends early, or the timer stops */
+      rt_whl_rmv (&whl, &tout[i]);
+      if (armed[i]) {
+        armed[i] = __FALSE;
+        armed_n--;
+        cancels++;
+      }
+      else {
+        idle++;
+      }
+    }
+    else if (r < 80) {
+      /* a tick */
+      time++;
+      fired += expire (time);
+      ticks++;
+    }
+    else {
+      /* the idle demon sleeps to the next expiry */
+      U32 next = rt_whl_next (&whl, time);
+      U32 want = model_next (time, &ahead);
+      if (!CHECK(next == want && ahead)) {
+        printf ("    time 0x%08x: next expiry in %u ticks, %u by the list\n", time, next, want);
+        break;
+      }
+      if (next == 0xFFFFFFFF) {
+        continue;
+      }
+      time += next;
+      if (!CHECK(expire (time) > 0)) {
+        break;
+      }
+      jumps++;
+    }
+    if (!CHECK(whl.count == armed_n)) {
+      break;
+    }
+    if (time < last) {
+      wraps++;
+    }
+    last = time;
+  }
+
+  /* and nothing left behind */
+  model_next (time, &ahead);
+  CHECK(ahead);
+  for (i = 0; i < TOUTS; i++) {
+    rt_whl_rmv (&whl, &tout[i]);
+  }
+  CHECK(whl.count == 0);
+  CHECK(wraps > 1);
+
+  printf ("rtx_wheel: %u puts, %u removals (%u of time-outs not on it), %u ticks, "
+          "%u jumps, %u expiries, %u wraps\n", arms, cancels + idle, idle, ticks, jumps, fired, wraps);
+}
+
+static double now_ns (void) {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec * 1e9 + ts.tv_nsec);
+}
+
+static void bench (void) {
+  static const U32 sizes[] = { 16, 64, 256, 1024, 4096, 8192 };
+  static struct OS_TOUT bt[8192];
+  const U32 rounds = 1000000;
+  U32 s, i, r, time = 0;
+
+  printf ("ns per operation with N time-outs of 1 to 10000 ticks, %u slots\n", OS_WHEEL_SLOTS);
+  printf ("%-24s", "N");
+  for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    printf ("%8u", sizes[s]);
+  }
+  printf ("\n");
+
+  for (r = 0; r < 2; r++) {
+    printf ("%-24s", r == 0 ? "put + remove" : "tick, woken put back");
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      U32 n = sizes[s];
+      double t;
+
+      rt_whl_init (&whl);
+      memset (bt, 0, sizeof(bt));
+      for (i = 0; i < n; i++) {
+        rt_whl_put (&whl, &bt[i], time + 1 + random32() % 10000);
+      }
+
+      t = now_ns ();
+      for (i = 0; i < rounds; i++) {
+        if (r == 0) {
+          P_TOUT p = &bt[i % n];
+          rt_whl_rmv (&whl, p);
+          rt_whl_put (&whl, p, time + 1 + i % 10000);
+        }
+        else {
+          P_TOUT p;
+          time++;
+          while ((p = rt_whl_get (&whl, time)) != NULL) {
+            rt_whl_put (&whl, p, time + 1 + (i * 7919) % 10000);
+          }
+        }
+      }
+      t = now_ns () - t;
+      printf ("%8.1f", t / rounds);
+    }
+    printf ("\n");
+  }
+}
+
+int main (int argc, char **argv) {
+  if (argc > 1 && strcmp (argv[1], "--bench") == 0) {
+    bench ();
+    return (0);
+  }
+  stress ();
+  check_exit ("rtx_wheel");
+  return (0);
+}
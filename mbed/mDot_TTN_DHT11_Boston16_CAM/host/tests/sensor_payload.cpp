@@ -0,0 +1,152 @@
+/* host test - FormatSensor1 (0x11) frames from SensorPayload
+ *
+ * A frame of known readings must come out byte for byte as the format
+ * lays it down.  Then, for every combination of flags, fields anywhere in
+ * their range must make a frame of the length the flags call for that
+ * decodes to the same fields, the ones left out reading 0; FlagVcc, which
+ * has no field, is not sent.  A frame that is cut short, too long, of
+ * another format or with a flag the format does not have must not decode,
+ * nor must a frame be built in a buffer too small for it.
+ *
+ * Readings are rounded to the nearest step of their field, halves away
+ * from zero, and those beyond what the field holds, and NaN, clamped.
+ */
+#include "mbed.h"
+#include "SensorPayload.h"
+#include "check.h"
+
+#include <math.h>
+#include <string.h>
+
+static unsigned random_below(unsigned n) {
+    return (unsigned)rand() % n;
+}
+
+/* A value field i can hold, often at either end of its range. */
+static int32_t random_field(unsigned i) {
+    static const int32_t min[] = { Voltage::MIN, Temperature::MIN, Pressure::MIN, Humidity::MIN, Light::MIN,
+                                   Temperature::MIN, Temperature::MIN, Humidity::MIN };
+    static const int32_t max[] = { Voltage::MAX, Temperature::MAX, Pressure::MAX, Humidity::MAX, Light::MAX,
+                                   Temperature::MAX, Temperature::MAX, Humidity::MAX };
+    switch (random_below(8)) {
+    case 0: return min[i];
+    case 1: return max[i];
+    default: return min[i] + (int32_t)random_below(max[i] - min[i] + 1);
+    }
+}
+
+static void known_frame() {
+    int32_t fields[PayloadFields] = { 0 };
+    fields[FieldAirT] = SensorPayload::quantize<FieldAirT>(21.5);      // 5504
+    fields[FieldAirP] = SensorPayload::quantize<FieldAirP>(1013);      // 253.25
+    fields[FieldAirRH] = SensorPayload::quantize<FieldAirRH>(45);      // 115.2
+    fields[FieldWaterT] = SensorPayload::quantize<FieldWaterT>(-1.5);  // -384
+    static const uint8_t want[] = { SensorPayload::FORMAT, FlagTPH | FlagWater,
+                                    0x15, 0x80, 0x00, 0xFD, 0x73, 0xFE, 0x80 };
+
+    uint8_t buf[SensorPayload::MAX_FRAME];
+    size_t n = SensorPayload::encode(fields, FlagTPH | FlagWater, buf, sizeof(buf));
+    CHECK_EQ(n, sizeof(want));
+    CHECK(memcmp(buf, want, sizeof(want)) == 0);
+
+    int32_t out[PayloadFields];
+    unsigned flags = 0;
+    CHECK(SensorPayload::decode(want, sizeof(want), out, &flags));
+    CHECK_EQ(flags, FlagTPH | FlagWater);
+    CHECK_NEAR(SensorPayload::value(FieldAirT, out[FieldAirT]), 21.5, 0);
+    CHECK_NEAR(SensorPayload::value(FieldAirP, out[FieldAirP]), 1012, 0);
+    CHECK_NEAR(SensorPayload::value(FieldAirRH, out[FieldAirRH]), 44.921875, 1e-5);
+    CHECK_NEAR(SensorPayload::value(FieldWaterT, out[FieldWaterT]), -1.5, 0);
+    CHECK_EQ(out[FieldVbat], 0);
+    CHECK_EQ(out[FieldSoilRH], 0);
+}
+
+static void round_trip() {
+    for (unsigned flags = 0; flags < 0x40; flags++) {
+        for (unsigned k = 0; k < 50; k++) {
+            int32_t fields[PayloadFields];
+            for (unsigned i = 0; i < PayloadFields; i++)
+                fields[i] = random_field(i);
+
+            uint8_t buf[SensorPayload::MAX_FRAME + 1];
+            size_t n = SensorPayload::encode(fields, flags, buf, SensorPayload::MAX_FRAME);
+            size_t want = 2 + ((flags & FlagVbat) ? 2 : 0) + ((flags & FlagTPH) ? 5 : 0) +
+                          ((flags & FlagLux) ? 2 : 0) + ((flags & FlagWater) ? 2 : 0) +
+                          ((flags & FlagSoilTH) ? 3 : 0);
+            if (!CHECK_EQ(n, want))
+                continue;
+            CHECK_EQ(SensorPayload::encode(fields, flags, buf, n - 1), 0);
+
+            int32_t out[PayloadFields];
+            unsigned got = ~0u;
+            if (!CHECK(SensorPayload::decode(buf, n, out, &got)))
+                continue;
+            // FlagVcc has no field, and is not sent
+            CHECK_EQ(got, flags & ~FlagVcc);
+            static const unsigned field_flag[] = { FlagVbat, FlagTPH, FlagTPH, FlagTPH, FlagLux,
+                                                   FlagWater, FlagSoilTH, FlagSoilTH };
+            for (unsigned i = 0; i < PayloadFields; i++)
+                if (!CHECK_EQ(out[i], (flags & field_flag[i]) ? fields[i] : 0))
+                    printf("    field %s, flags 0x%02x\n", SensorPayload::name(i), flags);
+
+            // one byte short and one too many
+            CHECK(!SensorPayload::decode(buf, n - 1, out));
+            buf[n] = 0;
+            CHECK(!SensorPayload::decode(buf, n + 1, out));
+        }
+    }
+
+    const uint8_t other[] = { 0x12, FlagLux, 0x00, 0x01 };
+    int32_t out[PayloadFields];
+    CHECK(!SensorPayload::decode(other, sizeof(other), out));
+    const uint8_t unknown[] = { SensorPayload::FORMAT, FlagLux | 0x40, 0x00, 0x01 };
+    CHECK(!SensorPayload::decode(unknown, sizeof(unknown), out));
+    CHECK(!SensorPayload::decode(unknown, 1, out));
+}
+
+static void clamped() {
+    float nan = NAN;
+
+    CHECK_EQ(SensorPayload::quantize<FieldAirT>(200), Temperature::MAX);
+    CHECK_EQ(SensorPayload::quantize<FieldAirT>(-200), Temperature::MIN);
+    CHECK_EQ(SensorPayload::quantize<FieldAirT>(nan), Temperature::MIN);
+    CHECK_EQ(SensorPayload::quantize<FieldAirRH>(150), Humidity::MAX);
+    CHECK_EQ(SensorPayload::quantize<FieldAirRH>(-5), 0);
+    CHECK_EQ(SensorPayload::quantize<FieldAirRH>(nan), 0);
+    CHECK_EQ(SensorPayload::quantize<FieldLux>(1e6), Light::MAX);
+    CHECK_EQ(SensorPayload::quantize<FieldVbat>(-9), Voltage::MIN);
+    CHECK_EQ(SensorPayload::quantize<FieldAirP>(1e9), Pressure::MAX);
+
+    // halves away from zero
+    CHECK_EQ(SensorPayload::quantize<FieldAirT>(0.5f / 256), 1);
+    CHECK_EQ(SensorPayload::quantize<FieldAirT>(-0.5f / 256), -1);
+    CHECK_EQ(SensorPayload::quantize<FieldAirT>(0.49f / 256), 0);
+    CHECK_EQ(SensorPayload::quantize<FieldAirT>(-0.49f / 256), 0);
+
+    // a clamped NaN goes out and comes back as the bottom of the range
+    int32_t fields[PayloadFields] = { 0 };
+    fields[FieldSoilT] = SensorPayload::quantize<FieldSoilT>(nan);
+    fields[FieldSoilRH] = SensorPayload::quantize<FieldSoilRH>(nan);
+    uint8_t buf[SensorPayload::MAX_FRAME];
+    size_t n = SensorPayload::encode(fields, FlagSoilTH, buf, sizeof(buf));
+    int32_t out[PayloadFields];
+    CHECK(SensorPayload::decode(buf, n, out));
+    CHECK_NEAR(SensorPayload::value(FieldSoilT, out[FieldSoilT]), -128, 0);
+    CHECK_EQ(out[FieldSoilRH], 0);
+
+    // and anything in range to within half a step
+    for (unsigned k = 0; k < 10000; k++) {
+        float t = -120 + 240.0f * random_below(1000000) / 1000000;
+        float v = SensorPayload::value(FieldWaterT, SensorPayload::quantize<FieldWaterT>(t));
+        if (!CHECK_NEAR(v, t, 0.5 / 256 + 1e-5))
+            break;
+    }
+}
+
+int main() {
+    srand(1);
+    known_frame();
+    round_trip();
+    clamped();
+    check_exit("sensor_payload");
+}
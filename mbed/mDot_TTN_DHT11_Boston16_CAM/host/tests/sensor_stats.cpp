@@ -0,0 +1,183 @@
+/* host test - statistics frames (0x15) from StatsAccumulator to StatsDecoder
+ *
+ * Epochs of known readings go into an accumulator whose fields send all of
+ * their statistics, some of them, or none, and are read every epoch, in
+ * only a few, or never.  The frame must decode to the mean, minimum,
+ * maximum and standard deviation worked out by hand, each field with the
+ * number of times it was read; a field that sends nothing is left out, and
+ * reads back with no statistics and a count of 0.  Asked for only the
+ * means, the frame must carry nothing else.
+ *
+ * Then many frames of random readings across the fields' range, half the
+ * fields short now and then, must decode to what the accumulator says, and
+ * that must be the mean and population deviation rounded to nearest.
+ */
+#include "mbed.h"
+#include "SensorStats.h"
+#include "check.h"
+
+#include <math.h>
+#include <string.h>
+
+static unsigned random_below(unsigned n) {
+    return (unsigned)rand() % n;
+}
+
+static bool decode(const StatsAccumulator &acc, uint32_t now_ms, unsigned fields, unsigned stats,
+                   SensorStats::Summary *out, unsigned *epochs, uint32_t *age) {
+    uint8_t buf[SensorStats::MAX_FRAME];
+    size_t n = acc.finish(now_ms, buf, sizeof(buf), stats);
+    StatsDecoder dec(fields);
+    return CHECK(n > 0) && CHECK_EQ(dec.decode(buf, n, out, epochs, age), StatsDecoder::DECODED);
+}
+
+static void check_summary(const SensorStats::Summary &s, unsigned select, unsigned count,
+                          int32_t mean, int32_t min, int32_t max, uint32_t sd, const char *what) {
+    bool ok = CHECK_EQ(s.select, select) & CHECK_EQ(s.count, count);
+    if (select & SensorStats::StatMean)
+        ok &= CHECK_EQ(s.mean, mean);
+    if (select & SensorStats::StatMin)
+        ok &= CHECK_EQ(s.min, min);
+    if (select & SensorStats::StatMax)
+        ok &= CHECK_EQ(s.max, max);
+    if (select & SensorStats::StatSD)
+        ok &= CHECK_EQ(s.sd, sd);
+    if (!ok)
+        printf("    %s\n", what);
+}
+
+static void known() {
+    enum { FIELDS = 6, EPOCHS = 8 };
+    static const uint8_t select[FIELDS] = {
+        SensorStats::StatAll, SensorStats::StatAll, SensorStats::StatMean | SensorStats::StatSD,
+        SensorStats::StatAll, 0, SensorStats::StatMin | SensorStats::StatMax
+    };
+    static const int32_t readings[EPOCHS][FIELDS] = {
+        { 2, -10, 100, 0, 1, -5 },
+        { 4, -20, 0, 0, 1, 3 },
+        { 4, -30, 0, 0, 1, 8 },
+        { 4, -10, 0, 0, 1, -7 },
+        { 5, -20, 0, 0, 1, 0 },
+        { 5, -30, 300, 0, 1, 0 },
+        { 7, -10, 0, 0, 1, 0 },
+        { 9, -20, 0, 0, 1, 0 },
+    };
+    StatsAccumulator::State state;
+    memset(&state, 0, sizeof(state));
+    StatsAccumulator acc(state, FIELDS, select);
+
+    // field 2 read in epochs 0 and 5, field 3 never, field 5 in the first four
+    uint32_t now_ms = 1000000;
+    for (unsigned e = 0; e < EPOCHS; e++) {
+        unsigned valid = 0x13 | (e == 0 || e == 5 ? 0x04 : 0) | (e < 4 ? 0x20 : 0);
+        CHECK(acc.add(now_ms, readings[e], valid));
+        now_ms += 30000 + 400;
+    }
+    CHECK_EQ(acc.getCount(), EPOCHS);
+
+    SensorStats::Summary out[FIELDS];
+    unsigned epochs;
+    uint32_t age;
+    if (!decode(acc, now_ms, FIELDS, SensorStats::StatAll, out, &epochs, &age))
+        return;
+    CHECK_EQ(epochs, EPOCHS);
+    CHECK_EQ(age, 243);     // 8 x 30.4 s, to the nearest second
+    // 40 / 8, and the squares' mean 232 / 8 less 25 is 4
+    check_summary(out[0], SensorStats::StatAll, 8, 5, 2, 9, 2, "2 4 4 4 5 5 7 9");
+    // -150 / 8 rounds away from zero; the variance is 60.94
+    check_summary(out[1], SensorStats::StatAll, 8, -19, -30, -10, 8, "-10 -20 -30 ...");
+    check_summary(out[2], SensorStats::StatMean | SensorStats::StatSD, 2, 200, 0, 0, 100, "100 and 300");
+    check_summary(out[3], 0, 0, 0, 0, 0, 0, "never read");
+    check_summary(out[4], 0, 0, 0, 0, 0, 0, "sends nothing");
+    check_summary(out[5], SensorStats::StatMin | SensorStats::StatMax, 4, 0, -7, 8, 0, "-5 3 8 -7");
+
+    // the means alone, and of the fields that send them
+    if (!decode(acc, now_ms, FIELDS, SensorStats::StatMean, out, &epochs, &age))
+        return;
+    check_summary(out[0], SensorStats::StatMean, 8, 5, 0, 0, 0, "the mean of field 0");
+    check_summary(out[1], SensorStats::StatMean, 8, -19, 0, 0, 0, "the mean of field 1");
+    check_summary(out[2], SensorStats::StatMean, 2, 200, 0, 0, 0, "the mean of field 2");
+    check_summary(out[3], 0, 0, 0, 0, 0, 0, "never read, means only");
+    check_summary(out[4], 0, 0, 0, 0, 0, 0, "sends nothing, means only");
+    check_summary(out[5], 0, 0, 0, 0, 0, 0, "no mean to send");
+
+    // cleared, nothing to send
+    acc.clear();
+    uint8_t buf[SensorStats::MAX_FRAME];
+    CHECK_EQ(acc.finish(now_ms, buf, sizeof(buf)), 0);
+}
+
+static void random_frames() {
+    enum { FIELDS = SensorStats::MAX_FIELDS };
+    static const uint8_t select[FIELDS] = {
+        SensorStats::StatAll, SensorStats::StatAll, SensorStats::StatAll, SensorStats::StatAll,
+        SensorStats::StatAll, SensorStats::StatAll, SensorStats::StatAll, SensorStats::StatAll
+    };
+    unsigned frames = 0, short_fields = 0;
+
+    for (unsigned f = 0; f < 500; f++) {
+        StatsAccumulator::State state;
+        memset(&state, 0, sizeof(state));
+        StatsAccumulator acc(state, FIELDS, select);
+        unsigned epochs = 1 + random_below(SensorStats::MAX_EPOCHS);
+        double sum[FIELDS] = { 0 }, sumsq[FIELDS] = { 0 };
+        unsigned count[FIELDS] = { 0 };
+        int32_t lo[FIELDS], hi[FIELDS];
+        // a field sits in a narrow band of some width anywhere in the range
+        int32_t base[FIELDS], width[FIELDS];
+        for (unsigned i = 0; i < FIELDS; i++) {
+            base[i] = -32768 + (int32_t)random_below(65536 + 32768);
+            width[i] = 1 + random_below(random_below(2) ? 10 : 60000);
+        }
+
+        for (unsigned e = 0; e < epochs; e++) {
+            int32_t x[FIELDS];
+            unsigned valid = 0;
+            for (unsigned i = 0; i < FIELDS; i++) {
+                x[i] = base[i] + (int32_t)random_below(width[i]);
+                if (random_below(100) < (i < 4 ? 100 : 90))
+                    valid |= 1 << i;
+                if (!(valid & (1 << i)))
+                    continue;
+                lo[i] = count[i] == 0 || x[i] < lo[i] ? x[i] : lo[i];
+                hi[i] = count[i] == 0 || x[i] > hi[i] ? x[i] : hi[i];
+                sum[i] += x[i];
+                sumsq[i] += (double)x[i] * x[i];
+                count[i]++;
+            }
+            acc.add(e * 60000, x, valid);
+        }
+
+        SensorStats::Summary out[FIELDS];
+        unsigned n;
+        uint32_t age;
+        if (!decode(acc, epochs * 60000, FIELDS, SensorStats::StatAll, out, &n, &age))
+            break;
+        CHECK_EQ(n, epochs);
+        CHECK_EQ(age, epochs * 60);
+        for (unsigned i = 0; i < FIELDS; i++) {
+            SensorStats::Summary s = acc.summarize(i);
+            if (!CHECK(memcmp(&s, &out[i], sizeof(s)) == 0))
+                printf("    field %u of frame %u decoded to what was not summed\n", i, f);
+            if (!CHECK_EQ(s.count, count[i]) || count[i] == 0)
+                continue;
+            short_fields += count[i] < epochs;
+            double mean = sum[i] / count[i];
+            double sd = sqrt(sumsq[i] / count[i] - mean * mean);
+            bool ok = CHECK_NEAR(s.mean, mean, 0.5) & CHECK_EQ(s.min, lo[i]) & CHECK_EQ(s.max, hi[i]) &
+                      CHECK_NEAR(s.sd, sd, 0.5 + 1e-6 * sd);
+            if (!ok)
+                printf("    field %u of frame %u: %u readings, mean %.3f sd %.3f\n", i, f, count[i], mean, sd);
+        }
+        frames++;
+    }
+    printf("sensor_stats: %u frames, %u short fields\n", frames, short_fields);
+    CHECK(short_fields > frames);
+}
+
+int main() {
+    srand(1);
+    known();
+    random_frames();
+    check_exit("sensor_stats");
+}
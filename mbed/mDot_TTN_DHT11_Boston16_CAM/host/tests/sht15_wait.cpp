@@ -0,0 +1,221 @@
+/* host test - the SHT15 measurement wait, polled and interrupt-driven
+ *
+ * The SHT1x ends a measurement by pulling DATA low, 80-320 ms after the
+ * command.  SHT15::update() blocks its thread on the data-ready interrupt
+ * meanwhile, so the core sleeps; the driver used to look at the line every
+ * millisecond with wait_ms(1) instead, holding the core throughout.  That
+ * polled wait is kept here as the baseline, on the bit-bang transport.
+ * update() is run on the bit-bang and on the timer-driven transport: it
+ * must read what the polled wait reads, take no longer, and keep the core
+ * running for no more than the bus transfers.  The same goes for
+ * update(callback), whose readout runs on the SHT15's thread, and whose
+ * callback must come on it, not from an interrupt.
+ *
+ * With --bench it prints instead, per update, the time it takes, the time
+ * the core runs, the SHT bus time and the energy drawn, for each way.
+ */
+#include "mbed.h"
+#include "rtos.h"
+#include "sht15.hpp"
+#include "timed_i2c.hpp"
+#include "sim.h"
+#include "check.h"
+
+#include <string.h>
+
+#define SHT_DATA_PIN PA_4
+#define SHT_SCK_PIN PC_13
+
+static const unsigned UPDATES = 5;
+static const uint32_t CLOCK_HZ = 50000;
+
+/* The bit-bang transport with the wait as it was. */
+class PolledI2C : public SHTx::I2C {
+public:
+    PolledI2C(PinName sda, PinName scl) : SHTx::I2C(sda, scl) {}
+
+    bool poll() {
+        this->sda_pin.input();
+        for (unsigned i = 0; i < 500; i++) {
+            wait_ms(1);
+            if (!this->sda_pin)
+                return true;
+        }
+        return false;
+    }
+};
+
+static bool polled_read(PolledI2C &bus, uint8_t command, uint16_t &value) {
+    bus.start();
+    if (!bus.write(command) || !bus.poll()) {
+        bus.stop();
+        return false;
+    }
+    value = bus.read(1) << 8;
+    value |= bus.read(0);
+    bus.stop();
+    return true;
+}
+
+/* What an update costs, from start() to stop(). */
+class Meter {
+public:
+    Meter() : _bus(NULL), _n(0), _elapsed(0), _run(0), _busy(0), _mJ(0) {
+        for (size_t i = 0; i < sim::Bus::all().size(); i++)
+            if (!strcmp(sim::Bus::all()[i]->name(), "sht"))
+                _bus = sim::Bus::all()[i];
+    }
+    void start() {
+        _t0 = sim::now();
+        _run0 = sim::cpu_time(sim::CPU_RUN);
+        _busy0 = _bus->busy_time();
+        _mJ0 = sim::energy_mJ();
+    }
+    void stop() {
+        _elapsed += sim::now() - _t0;
+        _run += sim::cpu_time(sim::CPU_RUN) - _run0;
+        _busy += _bus->busy_time() - _busy0;
+        _mJ += sim::energy_mJ() - _mJ0;
+        _n++;
+    }
+    // per update
+    double elapsed_ms() const { return ms(_elapsed); }
+    double run_ms() const { return ms(_run); }
+    double bus_ms() const { return ms(_busy); }
+    double mJ() const { return _n ? _mJ / _n : 0; }
+
+private:
+    sim::Bus *_bus;
+    unsigned _n;
+    sim::time_ns _t0, _run0, _busy0;
+    double _mJ0;
+    sim::time_ns _elapsed, _run, _busy;
+    double _mJ;
+
+    double ms(sim::time_ns t) const {
+        return _n ? (double)t / sim::MS / _n : 0;
+    }
+};
+
+struct Reading {
+    bool ok;
+    uint16_t temperature;
+    uint16_t humidity;
+};
+
+static Reading polled(Meter &m) {
+    PolledI2C bus(SHT_DATA_PIN, SHT_SCK_PIN);
+    bus.setFrequency(CLOCK_HZ);
+    wait_ms(11);
+    Reading r = { true, 0, 0 };
+    for (unsigned i = 0; i < UPDATES; i++) {
+        m.start();
+        r.ok &= polled_read(bus, SHTx::SHT15::cmd_read_temperature, r.temperature);
+        r.ok &= polled_read(bus, SHTx::SHT15::cmd_read_humidity, r.humidity);
+        m.stop();
+    }
+    return r;
+}
+
+static Reading update(SHTx::Transport &bus, Meter &m, float &t, float &rh) {
+    bus.setFrequency(CLOCK_HZ);
+    SHTx::SHT15 sht(bus);
+    sht.setScale(false);
+    sht.reset();
+    Reading r = { true, 0, 0 };
+    for (unsigned i = 0; i < UPDATES; i++) {
+        m.start();
+        r.ok &= sht.update();
+        m.stop();
+    }
+    r.temperature = sht.temperature;
+    r.humidity = sht.humidity;
+    t = sht.getTemperature();
+    rh = sht.getHumidity();
+    return r;
+}
+
+static Semaphore updated(0);
+static bool called_in_isr;
+
+static void update_done() {
+    called_in_isr |= __get_IPSR() != 0;
+    updated.release();
+}
+
+static Reading update_async(SHTx::Transport &bus, Meter &m) {
+    bus.setFrequency(CLOCK_HZ);
+    SHTx::SHT15 sht(bus);
+    sht.setScale(false);
+    sht.reset();
+    Reading r = { true, 0, 0 };
+    for (unsigned i = 0; i < UPDATES; i++) {
+        m.start();
+        r.ok &= sht.update(&update_done);
+        r.ok &= sht.isUpdating() && !sht.update(&update_done);
+        updated.wait();
+        r.ok &= !sht.isUpdating() && sht.updateSucceeded();
+        m.stop();
+    }
+    r.temperature = sht.temperature;
+    r.humidity = sht.humidity;
+    return r;
+}
+
+static void print(const char *way, const Meter &m) {
+    printf("%-28s %9.1f %9.2f %9.2f %9.3f\n", way, m.elapsed_ms(), m.run_ms(), m.bus_ms(), m.mJ());
+}
+
+int main() {
+    Meter poll_m, bang_m, timed_m, async_m;
+    float bang_t, bang_rh, timed_t, timed_rh;
+
+    Reading p = polled(poll_m);
+    Reading b, t, a;
+    {
+        SHTx::I2C bus(SHT_DATA_PIN, SHT_SCK_PIN);
+        b = update(bus, bang_m, bang_t, bang_rh);
+    }
+    {
+        SHTx::TimedI2C bus(SHT_DATA_PIN, SHT_SCK_PIN);
+        t = update(bus, timed_m, timed_t, timed_rh);
+        a = update_async(bus, async_m);
+    }
+
+    if (sim::options().bench) {
+        printf("per update (temperature and humidity), SHT bus at %u kHz\n", (unsigned)(CLOCK_HZ / 1000));
+        printf("%-28s %9s %9s %9s %9s\n", "", "time ms", "run ms", "bus ms", "mJ");
+        print("polled wait_ms(1), bit-bang", poll_m);
+        print("interrupt, bit-bang", bang_m);
+        print("interrupt, timed", timed_m);
+        print("update(callback), timed", async_m);
+        fflush(stdout);
+        _Exit(0);
+    }
+
+    CHECK(p.ok && b.ok && t.ok && a.ok);
+    // the model's default temperature; the humidity is compared raw, as
+    // main uses it
+    CHECK_NEAR(bang_t, 15.0, 0.01);
+    CHECK_EQ(b.temperature, p.temperature);
+    CHECK_EQ(b.humidity, p.humidity);
+    CHECK_EQ(t.temperature, p.temperature);
+    CHECK_EQ(t.humidity, p.humidity);
+    CHECK_EQ(a.temperature, p.temperature);
+    CHECK_EQ(a.humidity, p.humidity);
+    CHECK(!called_in_isr);
+    CHECK_NEAR(timed_t, bang_t, 0);
+    CHECK_NEAR(timed_rh, bang_rh, 0);
+
+    // the polled wait kept the core running; the interrupt does not, and
+    // is not late either
+    CHECK(poll_m.run_ms() > 0.9 * poll_m.elapsed_ms());
+    CHECK(bang_m.elapsed_ms() <= poll_m.elapsed_ms());
+    CHECK(timed_m.elapsed_ms() <= poll_m.elapsed_ms());
+    CHECK(async_m.elapsed_ms() <= poll_m.elapsed_ms());
+    CHECK(bang_m.run_ms() <= bang_m.bus_ms() + 0.1);
+    CHECK(timed_m.run_ms() < bang_m.run_ms());
+    CHECK(async_m.run_ms() < bang_m.run_ms());
+    CHECK(bang_m.mJ() < poll_m.mJ());
+    check_exit("sht15_wait");
+}
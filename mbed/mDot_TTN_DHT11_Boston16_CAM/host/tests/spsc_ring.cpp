@@ -0,0 +1,289 @@
+/* host test - SpscRing between two host threads, across the index wrap
+ *
+ * The ring's indices run freely through 2^32, so they are first walked up
+ * to just short of it with empty spans.  There a ring filled to the last
+ * slot must refuse one more and count it, and give everything back in
+ * order.  Then a producer and a consumer thread, on cores of their own or
+ * preempting each other on one, hammer it with every way in and out:
+ * push() and pop(), write() and read() of runs up to twice the ring, and
+ * writeSpan()/commit() and readSpan()/consume() of part of a span, each
+ * side now and then stalling so that the ring runs full and runs dry.
+ * The producer mostly gives way to the consumer when the ring is full, and
+ * the consumer to the producer when it is empty.  Every item carries its
+ * sequence number and a check word; the consumer must see whole items, in
+ * order, and exactly the ones that were not counted as dropped.
+ *
+ * With --bench it times instead, per item, a push and a pop one at a time
+ * and in runs, on one thread, against mbed's CircularBuffer of the same
+ * size, which has no way in or out but push() and pop(); and a write()
+ * and read() of the runs, which only the ring has.
+ */
+#include "SpscRing.h"
+#include "CircularBuffer.h"
+#include "sim.h"
+#include "check.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+static const uint32_t N = 64;
+static const uint32_t ITEMS = 5000000;
+
+struct Item {
+    uint32_t seq;
+    uint32_t check;
+};
+
+typedef SpscRing<Item, N> Ring;
+
+static uint32_t check_of(uint32_t seq) {
+    return seq * 2654435761u ^ 0x5bd1e995u;
+}
+
+static Item item(uint32_t seq) {
+    Item v = { seq, check_of(seq) };
+    return v;
+}
+
+static uint32_t random32(uint32_t &x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/* Hold the thread up for a while, to let the other side overtake it. */
+static void stall(uint32_t &x) {
+    volatile uint32_t spin = random32(x) % 2000;
+    while (spin > 0)
+        spin--;
+}
+
+static Ring ring;
+static uint32_t produced;           // sequence numbers handed out
+static bool producer_done;
+
+static void *producer(void *) {
+    uint32_t x = 2463534242u;
+    uint32_t seq = 0;
+    Item run[2 * N];
+
+    while (seq < ITEMS) {
+        if (ring.full() && random32(x) % 8 != 0) {
+            sched_yield();
+            continue;
+        }
+        uint32_t r = random32(x) % 100;
+        if (r < 40) {
+            ring.push(item(seq++));
+        } else if (r < 70) {
+            uint32_t n = 1 + random32(x) % (2 * N);
+            for (uint32_t i = 0; i < n; i++)
+                run[i] = item(seq + i);
+            ring.write(run, n);
+            seq += n;
+        } else if (r < 98) {
+            uint32_t len;
+            Item *p = ring.writeSpan(&len);
+            if (len == 0)
+                continue;
+            uint32_t n = 1 + random32(x) % len;
+            for (uint32_t i = 0; i < n; i++)
+                p[i] = item(seq + i);
+            ring.commit(n);
+            seq += n;
+        } else {
+            stall(x);
+        }
+    }
+    produced = seq;
+    __atomic_store_n(&producer_done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+struct Consumed {
+    uint32_t received;
+    uint32_t next;          // lowest sequence number still to come
+    uint32_t bad;
+    bool ran_dry;
+};
+
+static void take(Consumed &c, const Item &v) {
+    if (v.check != check_of(v.seq) || v.seq < c.next) {
+        if (c.bad++ == 0)
+            printf("    item %u (check 0x%08x) after %u\n", v.seq, v.check, c.next - 1);
+        return;
+    }
+    c.next = v.seq + 1;
+    c.received++;
+}
+
+static void consumer(Consumed &c) {
+    uint32_t x = 88675123u;
+    Item buf[2 * N];
+
+    for (;;) {
+        bool done = __atomic_load_n(&producer_done, __ATOMIC_ACQUIRE);
+        uint32_t r = random32(x) % 100;
+        uint32_t got = 0;
+        if (r < 40) {
+            Item v;
+            if (ring.pop(v)) {
+                take(c, v);
+                got = 1;
+            }
+        } else if (r < 70) {
+            got = ring.read(buf, 1 + random32(x) % (2 * N));
+            for (uint32_t i = 0; i < got; i++)
+                take(c, buf[i]);
+        } else if (r < 97) {
+            uint32_t len;
+            const Item *p = ring.readSpan(&len);
+            if (len > 0) {
+                got = 1 + random32(x) % len;
+                for (uint32_t i = 0; i < got; i++)
+                    take(c, p[i]);
+                ring.consume(got);
+            }
+        } else {
+            stall(x);
+            continue;
+        }
+        if (got == 0) {
+            // empty, and with the producer done, for good
+            if (done)
+                break;
+            c.ran_dry = true;
+            sched_yield();
+        }
+    }
+}
+
+/* Walk the indices on by n with spans committed and consumed unwritten. */
+static void advance(uint32_t n) {
+    uint32_t len;
+    while (n > 0) {
+        ring.writeSpan(&len);
+        if (len > n)
+            len = n;
+        ring.commit(len);
+        ring.readSpan(&len);
+        ring.consume(len);
+        n -= len;
+    }
+}
+
+static void fill_at_wrap() {
+    CHECK(ring.empty());
+    for (uint32_t i = 0; i < N; i++)
+        CHECK(ring.push(item(i)));
+    CHECK(ring.full());
+    CHECK(!ring.push(item(N)));
+    CHECK_EQ(ring.getDropped(), 1);
+    CHECK_EQ(ring.size(), N);
+
+    uint32_t len;
+    ring.writeSpan(&len);
+    CHECK_EQ(len, 0);
+    // the filled slots run to the end of the pool, and on from its start
+    ring.readSpan(&len);
+    CHECK_EQ(len, N / 2);
+
+    Item v = item(0);
+    for (uint32_t i = 0; i < N; i++)
+        if (!CHECK(ring.pop(v) && v.seq == i && v.check == check_of(i)))
+            break;
+    CHECK(!ring.pop(v));
+    CHECK(ring.empty());
+}
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static Ring bench_ring;
+static mbed::CircularBuffer<Item, N> bench_buffer;
+
+/* ns per item through b, pushed and popped run items at a time. */
+template <typename Buffer>
+static double push_pop(Buffer &b, uint32_t run) {
+    const uint32_t items = 20000000;
+    uint32_t sum = 0;
+    Item v = item(0);
+
+    double t = now_ns();
+    for (uint32_t seq = 0; seq < items; seq += run) {
+        for (uint32_t i = 0; i < run; i++)
+            b.push(item(seq + i));
+        for (uint32_t i = 0; i < run; i++) {
+            b.pop(v);
+            sum += v.check;
+        }
+    }
+    t = now_ns() - t;
+    CHECK(sum != 0);
+    return t / items;
+}
+
+static double write_read(uint32_t run) {
+    const uint32_t items = 20000000;
+    uint32_t sum = 0;
+    Item buf[N];
+
+    double t = now_ns();
+    for (uint32_t seq = 0; seq < items; seq += run) {
+        for (uint32_t i = 0; i < run; i++)
+            buf[i] = item(seq + i);
+        bench_ring.write(buf, run);
+        bench_ring.read(buf, run);
+        for (uint32_t i = 0; i < run; i++)
+            sum += buf[i].check;
+    }
+    t = now_ns() - t;
+    CHECK(sum != 0);
+    return t / items;
+}
+
+static void bench() {
+    printf("ns per item, on one thread, %u items of %u bytes\n", N, (unsigned)sizeof(Item));
+    printf("%-24s %10s %16s\n", "", "SpscRing", "CircularBuffer");
+    printf("%-24s %10.2f %16.2f\n", "push, pop", push_pop(bench_ring, 1), push_pop(bench_buffer, 1));
+    printf("%-24s %10.2f %16.2f\n", "32 pushes, 32 pops", push_pop(bench_ring, 32), push_pop(bench_buffer, 32));
+    printf("%-24s %10.2f %16s\n", "write, read of 32", write_read(32), "-");
+}
+
+int main() {
+    if (sim::options().bench) {
+        bench();
+        fflush(stdout);
+        _Exit(0);
+    }
+
+    // the ring filled half each side of the wrap, then the threads
+    // starting a little short of it
+    advance((uint32_t)0 - N / 2);
+    fill_at_wrap();
+    advance((uint32_t)0 - N / 2 - 1000);
+    uint32_t dropped_before = ring.getDropped();
+
+    pthread_t thread;
+    if (!CHECK(pthread_create(&thread, NULL, producer, NULL) == 0))
+        check_exit("spsc_ring");
+    Consumed c = { 0, 0, 0, false };
+    consumer(c);
+    pthread_join(thread, NULL);
+
+    uint32_t dropped = ring.getDropped() - dropped_before;
+    printf("spsc_ring: %u items, %u received, %u dropped\n", produced, c.received, dropped);
+    CHECK_EQ(c.bad, 0);
+    CHECK_EQ(c.received + dropped, produced);
+    CHECK(ring.empty());
+    CHECK(c.received > 1000);
+    // it ran full and it ran dry
+    CHECK(dropped > 0);
+    CHECK(c.ran_dry);
+    check_exit("spsc_ring");
+}
@@ -0,0 +1,108 @@
+/* host test - wake-ups under the tickless idle demon
+ *
+ * With OS_TICKLESS the idle demon stops the periodic tick until the next
+ * delay or timer expiry.  Here one thread sleeps for random delays, a
+ * periodic RtosTimer runs and a second thread is woken by a Timeout at
+ * random times off the tick grid, all at once, and every wake-up is checked
+ * against the tick it is due on: a stretch must end on the tick that has
+ * work, and an interrupt that ends one early must neither be held back nor
+ * shift the grid.  The core has to spend nearly all of the run asleep.
+ */
+#include "mbed.h"
+#include "rtos.h"
+#include "sim.h"
+#include "check.h"
+
+static const sim::time_ns TICK = sim::MS;
+// a thread runs this long after the tick that wakes it, at most
+static const sim::time_ns LATENCY = 50 * sim::US;
+
+static const unsigned DELAYS = 400;
+static const unsigned TIMER_MS = 7;
+static const unsigned SIGNALS = 300;
+
+// the time of the tick the main thread synchronised to; tick k is at
+// grid + k * TICK
+static sim::time_ns grid;
+
+static unsigned random_below(unsigned n) {
+    return (unsigned)rand() % n;
+}
+
+/* Whether a wake-up at 'now' is the one due on tick 'k'. */
+static bool on_tick(sim::time_ns now, uint64_t k) {
+    sim::time_ns due = grid + k * TICK;
+    if (now >= due && now - due < LATENCY)
+        return true;
+    printf("    woke at %llu ns, tick %llu is at %llu ns\n",
+           (unsigned long long)now, (unsigned long long)k, (unsigned long long)due);
+    return false;
+}
+
+static uint64_t timer_tick;
+static unsigned timer_runs;
+
+static void timer_expired(void const *) {
+    timer_tick += TIMER_MS;
+    timer_runs++;
+    CHECK(on_tick(sim::now(), timer_tick));
+}
+
+static Thread *signalled;
+static sim::time_ns signal_due;
+
+static void signal_isr() {
+    signalled->signal_set(1);
+}
+
+static void signal_task(void const *) {
+    Timeout timeout;
+    for (unsigned i = 0; i < SIGNALS; i++) {
+        // anywhere in the next 100 ms, not on the tick grid
+        uint32_t us = 50 + random_below(100000);
+        signal_due = sim::now() + us * sim::US;
+        timeout.attach_us(&signal_isr, us);
+        Thread::signal_wait(1);
+        sim::time_ns now = sim::now();
+        if (!CHECK(now >= signal_due && now - signal_due < LATENCY))
+            printf("    signal due at %llu ns, woke at %llu ns\n",
+                   (unsigned long long)signal_due, (unsigned long long)now);
+    }
+    Thread::wait(osWaitForever);
+}
+
+int main() {
+    srand(1);
+
+    // wake on a tick: it is within LATENCY of now
+    Thread::wait(1);
+    grid = sim::now();
+    sim::time_ns run_start = sim::cpu_time(sim::CPU_RUN);
+
+    RtosTimer timer(&timer_expired, osTimerPeriodic);
+    timer.start(TIMER_MS);
+
+    Thread signaller(&signal_task);
+    signalled = &signaller;
+
+    uint64_t tick = 0;
+    for (unsigned i = 0; i < DELAYS; i++) {
+        // mostly long enough to be stretched, some too short to be
+        uint32_t d = random_below(4) == 0 ? 1 + random_below(3) : 1 + random_below(300);
+        Thread::wait(d);
+        tick += d;
+        CHECK(on_tick(sim::now(), tick));
+    }
+    timer.stop();
+
+    sim::time_ns elapsed = sim::now() - grid;
+    CHECK_EQ(timer_runs, elapsed / (TIMER_MS * TICK));
+
+    // the core was woken for the work above, not for every tick
+    sim::time_ns run = sim::cpu_time(sim::CPU_RUN) - run_start;
+    if (!CHECK(run * 100 < elapsed))
+        printf("    %llu ns in run mode out of %llu ns\n",
+               (unsigned long long)run, (unsigned long long)elapsed);
+
+    check_exit("tickless");
+}
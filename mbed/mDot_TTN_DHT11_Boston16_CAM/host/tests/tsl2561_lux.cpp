@@ -0,0 +1,128 @@
+/* host test - TSL2561 fixed-point lux against the datasheet equations
+ *
+ * TSL2561_I2C::calculateLux() uses the datasheet's CalculateLux: channel
+ * scaling by 2^10 and a piecewise-linear table in the ch1/ch0 ratio for the
+ * T, FN and CL packages.  It is checked here against the floating-point
+ * equations the table approximates (the TSL2561_FLOAT_LUX path), for every
+ * gain and integration time, on both sides of each ratio breakpoint.
+ *
+ * With --bench it times instead a call of each, the fixed-point one and the
+ * float one as TSL2561_FLOAT_LUX builds it, over the same inputs.
+ */
+#include "mbed.h"
+#include "TSL2561_I2C.h"
+#include "sim.h"
+#include "check.h"
+
+#include <math.h>
+#include <time.h>
+
+/* The driver once more, as TSL2561_FLOAT_LUX builds it, under another name. */
+#undef TSL2561_I2C_H
+#define TSL2561_FLOAT_LUX
+#define TSL2561_I2C TSL2561_I2C_Float
+#include "TSL2561_I2C.cpp"
+#undef TSL2561_I2C
+#undef TSL2561_FLOAT_LUX
+
+/* The datasheet equations for the T, FN and CL packages, normalised to
+ * 1x gain and 402 ms as the float path does. */
+static double datasheet_lux(int ch0, int ch1, char timing) {
+    static const double itime[] = { 13.7, 101, 402 };
+    double d0 = ch0 * (402.0 / itime[timing & 3]);
+    double d1 = ch1 * (402.0 / itime[timing & 3]);
+    if (timing & 0x10) {
+        d0 /= 16;
+        d1 /= 16;
+    }
+    double ratio = d1 / d0;
+    if (ratio < 0.5)
+        return 0.0304 * d0 - 0.062 * d0 * pow(ratio, 1.4);
+    if (ratio < 0.61)
+        return 0.0224 * d0 - 0.031 * d1;
+    if (ratio < 0.80)
+        return 0.0128 * d0 - 0.0153 * d1;
+    if (ratio < 1.30)
+        return 0.00146 * d0 - 0.00112 * d1;
+    return 0;
+}
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* ns per call, over channel 1 from none to past the last breakpoint of
+ * channel 0, at every timing. */
+static double time_lux(float (*lux)(int, int, char)) {
+    static const char timings[] = { 0x00, 0x10, 0x01, 0x11, 0x02, 0x12 };
+    const unsigned rounds = 2000;
+    volatile float sink = 0;
+    unsigned calls = 0;
+
+    double t = now_ns();
+    for (unsigned r = 0; r < rounds; r++) {
+        for (unsigned i = 0; i < sizeof(timings); i++) {
+            for (int ch1 = 0; ch1 < 1400; ch1 += 7) {
+                sink = lux(1000 + r, ch1, timings[i]);
+                calls++;
+            }
+        }
+    }
+    (void)sink;
+    return (now_ns() - t) / calls;
+}
+
+int main() {
+    if (sim::options().bench) {
+        printf("ns per calculateLux() on the host\n");
+        printf("%-16s %9.1f\n", "fixed-point", time_lux(&TSL2561_I2C::calculateLux));
+        printf("%-16s %9.1f\n", "float", time_lux(&TSL2561_I2C_Float::calculateLux));
+        fflush(stdout);
+        _Exit(0);
+    }
+
+    static const char timings[] = { 0x00, 0x10, 0x01, 0x11, 0x02, 0x12 };
+    // the short integrations stop counting before 65535
+    static const int full_scale[] = { 5047, 37177, 65535 };
+    // the table's breakpoints, and a little either side of each
+    static const double breakpoints[] = { 0.125, 0.25, 0.375, 0.5, 0.61, 0.80, 1.30 };
+    static const double offsets[] = { -0.01, -0.002, 0, 0.002, 0.01 };
+
+    for (unsigned t = 0; t < sizeof(timings); t++) {
+        char timing = timings[t];
+        int top = full_scale[timing & 3];
+        const int counts[] = { 1000, 4000, top / 2, top };
+
+        for (unsigned c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+            int ch0 = counts[c];
+
+            // no light on the IR channel: the broadband term alone
+            double lux = TSL2561_I2C::calculateLux(ch0, 0, timing);
+            double broadband = datasheet_lux(ch0, 0, timing);
+            CHECK_NEAR(lux, broadband, 0.02 * broadband + 0.01);
+
+            for (unsigned b = 0; b < sizeof(breakpoints) / sizeof(breakpoints[0]); b++) {
+                for (unsigned o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+                    int ch1 = (int)(ch0 * (breakpoints[b] + offsets[o]) + 0.5);
+                    double ref = datasheet_lux(ch0, ch1, timing);
+                    lux = TSL2561_I2C::calculateLux(ch0, ch1, timing);
+                    // the table is within 2% of the broadband term, plus the
+                    // rounding to hundredths
+                    if (!CHECK_NEAR(lux, ref, 0.02 * broadband + 0.01))
+                        printf("    timing 0x%02x ch0 %d ch1 %d\n", timing, ch0, ch1);
+                    CHECK(lux >= 0);
+                }
+            }
+
+            // past a ratio of 1.30 there is no visible light to speak of
+            CHECK_EQ(TSL2561_I2C::calculateLux(ch0, ch0 * 14 / 10, timing) * 100, 0);
+        }
+
+        // dark: both channels 0
+        CHECK_EQ(TSL2561_I2C::calculateLux(0, 0, timing) * 100, 0);
+    }
+
+    check_exit("tsl2561_lux");
+}
@@ -22,7 +22,18 @@
 #include "DHT22.h"
 #include "TSL2561_I2C.h"
 #include "sht15.hpp"
+#include "timed_i2c.hpp"
 #include "DS18B20.h"
+#include "SensorScheduler.h"
+#include "DeltaPayload.h"
+#include "SensorPayload.h"
+#include "SensorStats.h"
+#include "EventDetector.h"
+#include "UplinkController.h"
+#include "FrameQueue.h"
+#include "us_ticker_api.h"
+#include <stddef.h>
+#include <string.h>
 #include <string>
 #include <vector>
 
@@ -34,14 +45,16 @@ using namespace mts;
 #define DHT_PIN PA_1
 DHT22 dht(DHT_PIN);
 
-// water temp sensor
+// water temp sensor; several probes may share the 1-wire bus
 #define DS_PIN PA_11
+#define DS_MAX_PROBES 4
 DS18B20 thermom(DS_PIN, DS18B20::RES_12_BIT); 
 
 // soil temp/humid sensor
 #define SHT_DATA_PIN PA_4
 #define SHT_SCK_PIN PC_13
-SHTx::SHT15 sht(SHT_DATA_PIN, SHT_SCK_PIN);
+SHTx::TimedI2C sht_bus(SHT_DATA_PIN, SHT_SCK_PIN);
+SHTx::SHT15 sht(sht_bus);
 
 // light sensor
 #define TSL_DATA_PIN PC_9
@@ -60,16 +73,151 @@ TSL2561_I2C tsl(TSL_DATA_PIN, TSL_SCK_PIN);
  * https://account.thethingsnetwork.org/
  */
 
+#if defined(TARGET_HOST_SIM)
+// the simulated network accepts any session; see host/README
+uint8_t AppSKey[16] = { 0 };
+uint8_t NwkSKey[16] = { 0 };
+uint8_t NetworkAddr[4] = { 0 };
+#else
 uint8_t AppSKey[16] = /* replace with Application Session Key in MSB format from TTN dashboard */;
 uint8_t NwkSKey[16] = /* replace with Network Session Key in MSB format from TTN dashboard */;
 uint8_t NetworkAddr[4] = /* replace with 4-byte Device Address from TTN dashboard */;
+#endif
 
 // Some defines for the LoRa configuration
-#define LORA_SF mDot::SF_7
 #define LORA_ACK 0
 #define LORA_TXPOWER 20
 static uint8_t config_frequency_sub_band = 2;
 
+// The data rate follows the link margin, measured on a confirmed uplink
+// every UPLINK_PROBE_INTERVAL (every uplink with LORA_ACK), and the send
+// interval stretches to keep time on air within UPLINK_DUTY_PERCENT, or
+// the band's own duty cycle if lower (1% in EU 868, none in US 915)
+#define UPLINK_PROBE_INTERVAL 8
+#define UPLINK_MARGIN_DB 10
+#define UPLINK_DUTY_PERCENT 100
+#define UPLINK_MAX_AIRTIME_MS 400   // the US 915 dwell time
+
+// FormatSensor1 sends every field every time; FormatSensorDelta only what
+// changed since the last frame that got through, with a full keyframe
+// every PAYLOAD_KEYFRAME_INTERVAL frames and whenever none got through in
+// as many; FormatSensorBatch samples every cycle but sends only every
+// PAYLOAD_BATCH_EPOCHS, all of them in one frame no longer than the data
+// rate carries; FormatSensorStats samples every
+// cycle and sends every PAYLOAD_STATS_EPOCHS the statistics payload_stats
+// picks for each field
+#define PAYLOAD_FORMAT FormatSensorDelta
+#define PAYLOAD_KEYFRAME_INTERVAL 16
+#define PAYLOAD_BATCH_EPOCHS 6
+#define PAYLOAD_STATS_EPOCHS 30
+static const uint8_t payload_stats[PayloadFields] = {
+    /* vbat */      SensorStats::StatMean,
+    /* air T */     SensorStats::StatMean | SensorStats::StatMin | SensorStats::StatMax,
+    /* air P */     SensorStats::StatMean,
+    /* air RH */    SensorStats::StatMean | SensorStats::StatMin | SensorStats::StatMax,
+    /* light */     SensorStats::StatMean | SensorStats::StatMax,
+    /* water T */   SensorStats::StatAll,
+    /* soil T */    SensorStats::StatMean,
+    /* soil RH */   SensorStats::StatAll,
+};
+
+// With EVENT_HEARTBEAT_S set, uplinks wait for events: a cycle sends when
+// one of event_rules comes on, and every cycle while one is on, sampling
+// every EVENT_SAMPLE_INTERVAL_S; otherwise only EVENT_HEARTBEAT_S after the
+// last uplink. Rules are in the scale the fields are sent in. 0 sends as
+// often as the payload format does
+#define EVENT_HEARTBEAT_S 0
+#define EVENT_SAMPLE_INTERVAL_S 5
+static const EventDetector::Rule event_rules[] = {
+    // rain reaching the roots: soil 4% wetter than over the last 2 minutes
+    { FieldSoilRH, EventDetector::Rise, SensorPayload::quantize<FieldSoilRH>(4.0),
+      SensorPayload::quantize<FieldSoilRH>(2.0), 120 },
+    // runoff coming through the garden, warmer or colder than the pool
+    { FieldWaterT, EventDetector::Rise, SensorPayload::quantize<FieldWaterT>(0.3),
+      SensorPayload::quantize<FieldWaterT>(0.15), 300 },
+    { FieldWaterT, EventDetector::Fall, SensorPayload::quantize<FieldWaterT>(0.3),
+      SensorPayload::quantize<FieldWaterT>(0.15), 300 },
+};
+
+// A frame that did not get through, as a FormatSensor1 frame, the whole
+// batch or the statistics, waits in QUEUE_FILE and goes out again, wrapped in a FormatReplay
+// frame, up to QUEUE_REPLAY_PER_CYCLE at a time once acknowledgements come
+// back. A ring of QUEUE_SLOTS flash pages, with at most QUEUE_WRITES_PER_HOUR
+// frames queued per hour
+#define QUEUE_FILE "uplink.queue"
+#define QUEUE_SLOTS 64
+#define QUEUE_WRITES_PER_HOUR 60
+#define QUEUE_REPLAY_PER_CYCLE 2
+
+// Every PROFILE_LOG_INTERVAL cycles the debug log shows where the processor
+// time since the wake-up went and how much stack each sensor task has used;
+// the serial output takes run time of its own. 0 for never
+#define PROFILE_LOG_INTERVAL 10
+
+#if PROFILE_LOG_INTERVAL
+static float percent(uint64_t part, uint64_t whole)
+{
+  return whole ? 100.0f * part / whole : 0.0f;
+}
+#endif
+
+/* Duty cycle
+ * Between uplinks the mDot goes to deep sleep: RAM is lost and the RTC alarm
+ * wakes it up through a reset, so main() starts over every cycle.  Whatever
+ * has to outlive a cycle goes into a user file in the mDot's flash (libmDot
+ * keeps the RTC backup registers to itself).
+ */
+#define STATE_FILE "raingarden.state"
+#define STATE_MAGIC 0x52474437  // "RGD7"; change with the layout
+#define STATUS_BLINK_MS 20
+#define SAMPLE_INTERVAL_S 10    // use 600 for 10min
+
+struct PersistentState {
+    uint32_t magic;
+    uint32_t boots;         // cold boots and wake-ups
+    uint16_t seq;           // uplink cycle count
+    uint8_t probes;         // 0: search the 1-wire bus on the next boot
+    char tsl_timing;        // light sensor range picked by auto-ranging
+    DS18B20::ROM_Code_t roms[DS_MAX_PROBES];
+    DeltaEncoder::State payload;    // reference frame of the delta format
+    BatchEncoder::State batch;      // epochs not sent yet
+    StatsAccumulator::State stats;  // statistics of the epochs not sent yet
+    UplinkController::State uplink; // data rate and link margin
+    FrameQueue::State queue;        // frames waiting in QUEUE_FILE
+    EventDetector::State events;    // rules on, and their baselines
+    uint32_t uplink_ms;     // clock_ms of the last uplink, for the heartbeat
+    uint32_t clock_ms;      // time awake and asleep since the cold boot
+    uint32_t check;         // Adler-32 of everything above
+};
+
+static uint32_t stateCheck(const PersistentState& s)
+{
+    const uint8_t* p = (const uint8_t*)&s;
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < offsetof(PersistentState, check); i++) {
+        a = (a + p[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+// true if a valid state was found, i.e. we are waking up from deep sleep
+static bool loadState(mDot* dot, PersistentState& s)
+{
+    if (dot->readUserFile(STATE_FILE, &s, sizeof(s)) &&
+        s.magic == STATE_MAGIC && s.check == stateCheck(s))
+        return true;
+    memset(&s, 0, sizeof(s));   // padding too, for the check
+    s.magic = STATE_MAGIC;
+    return false;
+}
+
+static bool saveState(mDot* dot, PersistentState& s)
+{
+    s.check = stateCheck(s);
+    return dot->saveUserFile(STATE_FILE, &s, sizeof(s));
+}
+
 // functions for ensuring network endianness (little-endian)
 uint16_t hton16(const uint16_t x)
 {
@@ -86,193 +234,134 @@ void hton16(uint16_t * x)
 
 
 
-// build a transmit buffer (from https://raw.githubusercontent.com/mcci-catena/Catena4410-Sketches/master/catena4410_sensor1/catena4410_sensor1.ino)
-class TxBuffer_t
-        {
-public:
-        uint8_t buf[32];   // this sets the largest buffer size
-        uint8_t *p;
-
-        TxBuffer_t() : p(buf) {};
-        void begin()
-                {
-                p = buf;
-                }
-        void put(uint8_t c)
-                {
-                if (p < buf + sizeof(buf))
-                        *p++ = c;
-                }
-        void put1u(int32_t v)
-                {
-                if (v > 0xFF)
-                        v = 0xFF;
-                else if (v < 0)
-                        v = 0;
-                put((uint8_t) v);
-                }
-        void put2(uint32_t v)
-                {
-                if (v > 0xFFFF)
-                        v = 0xFFFF;
-
-                put((uint8_t) (v >> 8));
-                put((uint8_t) v);
-                }
-        void put2(int32_t v)
-                {
-                if (v < -0x8000)
-                        v = -0x8000;
-                else if (v > 0x7FFF)
-                        v = 0x7FFF;
-
-                put2((uint32_t) v);
-                }
-        void put3(uint32_t v)
-                {
-                if (v > 0xFFFFFF)
-                        v = 0xFFFFFF;
-
-                put((uint8_t) (v >> 16));
-                put((uint8_t) (v >> 8));
-                put((uint8_t) v);
-                }
-        void put2u(int32_t v)
-                {
-                if (v < 0)
-                        v = 0;
-                else if (v > 0xFFFF)
-                        v = 0xFFFF;
-                put2((uint32_t) v);
-                }
-        void put3(int32_t v)
-                {
-                if (v < -0x800000)
-                        v = -0x800000;
-                else if (v > 0x7FFFFF)
-                        v = 0x7FFFFF;
-                put3((uint32_t) v);
-                }
-        uint8_t *getp(void)
-                {
-                return p;
-                }
-        size_t getn(void)
-                {
-                return p - buf;
-                }
-        uint8_t *getbase(void)
-                {
-                return buf;
-                }
-        void put2sf(float v)
-                {
-                int32_t iv;
-
-                if (v > 32766.5f)
-                        iv = 0x7fff;
-                else if (v < -32767.5f)
-                        iv = -0x8000;
-                else
-                        iv = (int32_t)(v + 0.5f);
-
-                put2(iv);
-                }
-        void put2uf(float v)
-                {
-                uint32_t iv;
-
-                if (v > 65535.5f)
-                        iv = 0xffff;
-                else if (v < 0.5f)
-                        iv = 0;
-                else
-                        iv = (uint32_t)(v + 0.5f);
-
-                put2(iv);
-                }
-        void put1uf(float v)
-                {
-                uint8_t c;
-
-                if (v > 254.5)
-                        c = 0xFF;
-                else if (v < 0.5)
-                        c = 0;
-                else
-                        c = (uint8_t) v;
-
-                put(c);
-                }
-        void putT(float T)
-                {
-                put2sf(T * 256.0f + 0.5f);                
-                }
-        void putRH(float RH)
-                {
-                put1uf((RH / 0.390625f) + 0.5f);
-                }
-        void putV(float V)
-                {
-                put2sf(V * 4096.0f + 0.5f);
-                }
-        void putP(float P)
-                {
-                put2uf(P / 4.0f + 0.5f);
-                }
-        void putLux(float Lux)
-                {
-                put2uf(Lux);
-                }
-        };
-
 /* the magic byte at the front of the buffer */
 enum    {
-        FormatSensor1 = 0x11,
+        FormatSensor1 = SensorPayload::FORMAT,  // see SensorPayload.h
+        FormatSensorDelta = DeltaPayload::FORMAT,  // see DeltaPayload.h
+        FormatSensorBatch = DeltaPayload::FORMAT_BATCH,
+        FormatReplay = 0x14,
+        FormatSensorStats = SensorStats::FORMAT,   // see SensorStats.h
         };
 
-/* the flags for the second byte of the buffer */
+/* a FormatReplay frame: the magic byte, how many seconds ago the frame was
+   queued as a varint, then the frame as it was first sent */
 enum    {
-        FlagVbat = 1 << 0,
-        FlagVcc = 1 << 1,
-        FlagTPH = 1 << 2,
-        FlagLux = 1 << 3,
-        FlagWater = 1 << 4,
-        FlagSoilTH = 1 << 5,
+        ReplayHeader = 1 + 5,
         };
 
+/* Sensor acquisition tasks, run concurrently by the SensorScheduler; each
+   puts its readings in the record it is handed, tagged with payload fields */
+
+// every wake is a reset, so the stacks are static rather than allocated anew
+static uint64_t air_stack[DEFAULT_STACK_SIZE / 8];
+static uint64_t water_stack[DEFAULT_STACK_SIZE / 8];
+static uint64_t soil_stack[DEFAULT_STACK_SIZE / 8];
+static uint64_t light_stack[DEFAULT_STACK_SIZE / 8];
+
+// air: the DHT22 start pulse and frame are timed, so hold the timing lock
+class AirTask : public SensorTask {
+public:
+    AirTask() : SensorTask("air", osPriorityAboveNormal, 100,
+            sizeof(air_stack), (unsigned char *)air_stack),
+        error(DHT22::ERROR_NONE) {}
+    DHT22::Error error;
+protected:
+    virtual bool acquire(SensorSample &sample) {
+        lockTiming();
+        bool ok = dht.sample();
+        unlockTiming();
+        error = dht.getError();
+        sample.put(FieldAirT, (float)dht.getTemperature()/10.0);
+        sample.put(FieldAirRH, (float)dht.getHumidity()/10.0);
+        return ok;
+    }
+};
 
+// water: 1-wire slots are timed; the conversion in between is not
+class WaterTask : public SensorTask {
+public:
+    WaterTask() : SensorTask("water", osPriorityAboveNormal, 1000,
+            sizeof(water_stack), (unsigned char *)water_stack),
+        probes(0), converted(0) {}
+    DS18B20::ROM_Code_t roms[DS_MAX_PROBES];
+    unsigned probes;
+protected:
+    // every probe converted at once, each a FieldWaterT value in turn
+    virtual bool acquire(SensorSample &sample) {
+        if (probes == 0)
+            return false;
+        while (converted.wait(0) > 0)
+            ;   // a late callback from an overrun cycle
+        lockTiming();
+        unsigned absent = thermom.StartConversion(this, &WaterTask::done);
+        unlockTiming();
+        // no presence pulse: nothing is converting, so there is nothing
+        // to wait for
+        if (absent)
+            return false;
+        converted.wait(getDeadline());
+        lockTiming();
+        unsigned answered = thermom.ReadResults(roms, temps, probes);
+        unlockTiming();
+        for (unsigned p = 0; p < probes; p++)
+            sample.put(FieldWaterT, temps[p]);
+        // good only if every probe answered, so that one that has gone
+        // missing gets the bus searched again
+        return answered == probes;
+    }
+private:
+    float temps[DS_MAX_PROBES];
+    Semaphore converted;
+    void done() {
+        converted.release();
+    }
+};
+
+// soil: the SHT bus is clocked by us, so it does not mind being preempted
+// and this task runs below the others
+class SoilTask : public SensorTask {
+public:
+    SoilTask() : SensorTask("soil", osPriorityBelowNormal, 1000,
+            sizeof(soil_stack), (unsigned char *)soil_stack) {}
+protected:
+    virtual bool acquire(SensorSample &sample) {
+        sht.ready = true; // override error... 
+        sht.reset();
+        Thread::wait(50);
+        bool ok = sht.update();
+        sample.put(FieldSoilT, (float)sht.getTemperature());
+        sample.put(FieldSoilRH, (float)(sht.humidity)/(float)35.0);
+        return ok;
+    }
+};
+
+// light: a single I2C burst, once the sensor has integrated after power-up
+class LightTask : public SensorTask {
+public:
+    LightTask() : SensorTask("light", osPriorityNormal, 500,
+            sizeof(light_stack), (unsigned char *)light_stack) {}
+protected:
+    virtual bool acquire(SensorSample &sample) {
+        int settle = tsl.getSettleTime();
+        if (settle > 0)
+            Thread::wait(settle);
+        float lux = tsl.getLux();
+        sample.put(FieldLux, lux);
+        return lux >= 0;
+    }
+};
 
 // Serial via USB for debugging only
 Serial pc(USBTX,USBRX);
 
-int main()
+// Network settings go to flash once, on a cold boot; deep sleep keeps them
+static void configureNetwork(mDot* dot)
 {
-    TxBuffer_t b;
-    
     int32_t ret;
-    mDot* dot;
-    std::vector<uint8_t> send_data;
-    std::vector<uint8_t> recv_data;
     std::vector<uint8_t> nwkSKey;
     std::vector<uint8_t> appSKey;
-    std::vector<uint8_t> nodeAddr;
     std::vector<uint8_t> networkAddr;
 
-    float temperature = 0.0;
-
-    DigitalInOut status_led(STATUS);
-    status_led.output();
-
-    pc.baud(115200);
-    pc.printf("TTN mDot LoRa Temperature & Humidity Sensor\n\r");
-
-    // get a mDot handle
-    dot = mDot::getInstance();
-
-//  dot->setLogLevel(MTSLog::WARNING_LEVEL);
-    dot->setLogLevel(MTSLog::TRACE_LEVEL);
-
     logInfo("Checking Config");
 
     // Test if we've already saved the config
@@ -387,6 +476,53 @@ int main()
     pc.printf("TxWait: %s, ", (dot->getTxWait() ? "Y" : "N" ));
     pc.printf("CRC: %s, ", (dot->getCrc() ? "Y" : "N") );
     pc.printf("Ack: %s\r\n", (dot->getAck() ? "Y" : "N")  );
+}
+
+// a frame in hex for the log, without building a string on the heap
+static const char *hexFrame(const uint8_t *data, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+    static char text[2 * UplinkController::MAX_FRAME + 1];
+    size_t i;
+    for (i = 0; i < len && i < UplinkController::MAX_FRAME; i++) {
+        text[2 * i] = digits[data[i] >> 4];
+        text[2 * i + 1] = digits[data[i] & 0xF];
+    }
+    text[2 * i] = 0;
+    return text;
+}
+
+int main()
+{
+    int32_t ret;
+    mDot* dot;
+
+    float temperature = 0.0;
+
+    // the state's clock only moves on when we go to sleep
+    Timer awake;
+    awake.start();
+
+    DigitalInOut status_led(STATUS);
+    status_led.output();
+
+    pc.baud(115200);
+    pc.printf("TTN mDot LoRa Temperature & Humidity Sensor\n\r");
+
+    // get a mDot handle
+    dot = mDot::getInstance();
+
+//  dot->setLogLevel(MTSLog::WARNING_LEVEL);
+    dot->setLogLevel(MTSLog::TRACE_LEVEL);
+
+    PersistentState state;
+    bool woke = loadState(dot, state);
+    state.boots++;
+    if (woke) {
+        logInfo("Woke up for cycle %u (boot %lu)", state.seq, (unsigned long)state.boots);
+    } else {
+        configureNetwork(dot);
+    }
 
     logInfo("Joining Network");
     while ((ret = dot->joinNetwork()) != mDot::MDOT_OK) {
@@ -394,11 +530,16 @@ int main()
         wait_ms(dot->getNextTxMs() + 1);
     }
     logInfo("Joined Network");
-    wait_ms(500);
+    if (!woke)
+        wait_ms(500);
     
     /* Setup Sensors */
  
     logInfo("Configure Soil Sensor (SHT)");
+    // the readouts run on the soil thread, so the clock is played back
+    // from a Ticker and the thread blocks between edges; 50kHz is as fast
+    // as an interrupt per half period allows
+    sht.i2c.setFrequency(50000);
 /*    DigitalInOut sht_data(SHT_DATA_PIN);
     DigitalInOut sht_sck(SHT_SCK_PIN);
     sht_data.output();
@@ -412,151 +553,362 @@ int main()
  
     //logInfo("Configure Air Sensor (DHT)");
     // no config needed for DHT
+    // one task per sensor; bits of scheduler.acquire() in this order
+    SensorScheduler scheduler;
+    AirTask air;
+    WaterTask water;
+    SoilTask soil;
+    LightTask light;
+    scheduler.add(air);
+    scheduler.add(water);
+    scheduler.add(soil);
+    scheduler.add(light);
+    
     logInfo("Configure Water Sensor (DS)");
-    wait_ms(500);
-    DS18B20::ROM_Code_t ROM_Code;
-    wait_ms(500);
-    thermom.ReadROM(&ROM_Code);
-    logInfo("Family code: 0x%X\n\r", ROM_Code.BYTES.familyCode);
-    wait_ms(500);
-    logInfo("Serial Number: ");
-    for (unsigned i = 6; i != 0; --i) {
-        logInfo("%02X%s", ROM_Code.BYTES.serialNo[i-1], (i != 1)?":":"\r\n");
+    bool searched = false;
+    if (state.probes) {
+        // the bus was searched before going to sleep
+        water.probes = MIN(state.probes, DS_MAX_PROBES);
+        memcpy(water.roms, state.roms, sizeof(water.roms));
+    } else {
+        if (!woke) {
+            wait_ms(500);
+            wait_ms(500);
+        }
+        water.probes = thermom.SearchROM(water.roms, DS_MAX_PROBES);
+        searched = true;
+    }
+    logInfo("Found %u water probe(s)", water.probes);
+    for (unsigned p = 0; searched && p < water.probes; p++) {
+        DS18B20::ROM_Code_t &ROM_Code = water.roms[p];
+        logInfo("Probe %u family code: 0x%X", p, ROM_Code.BYTES.familyCode);
+        logInfo("Probe %u serial number: %02X:%02X:%02X:%02X:%02X:%02X", p,
+                ROM_Code.BYTES.serialNo[5], ROM_Code.BYTES.serialNo[4], ROM_Code.BYTES.serialNo[3],
+                ROM_Code.BYTES.serialNo[2], ROM_Code.BYTES.serialNo[1], ROM_Code.BYTES.serialNo[0]);
+        logInfo("Probe %u CRC: 0x%X", p, ROM_Code.BYTES.VTV);
     }
-    logInfo("CRC: 0x%X\r\n", ROM_Code.BYTES.VTV);
 
-    wait_ms(500);    
+    if (!woke)
+        wait_ms(500);    
     logInfo("Configure Light Sensor (TSL)");
     tsl.enablePower();
+    tsl.setAutoRange(true);
+    if (woke && tsl.getTiming() != state.tsl_timing) {
+        // the sensor lost its range while we were asleep
+        tsl.setTiming(state.tsl_timing);
+    }
+
+    DeltaEncoder delta(state.payload, PayloadFields, PAYLOAD_KEYFRAME_INTERVAL);
+    BatchEncoder batch(state.batch, PayloadFields);
+    StatsAccumulator stats(state.stats, PayloadFields, payload_stats);
+    EventDetector events(state.events, event_rules, sizeof(event_rules) / sizeof(event_rules[0]));
+    UplinkController link(state.uplink, dot, LORA_ACK ? 1 : UPLINK_PROBE_INTERVAL,
+                          UPLINK_MARGIN_DB, UPLINK_DUTY_PERCENT, UPLINK_MAX_AIRTIME_MS);
+    FrameQueue queue(state.queue, dot, QUEUE_FILE, QUEUE_SLOTS, QUEUE_WRITES_PER_HOUR);
 
     char dataBuf[50];
-    uint16_t seq = 0;
-    char * sf_str;
+    uint16_t seq = state.seq;
     while( 1 ) {
         
-        /* cycle through spreading factors */
-        uint8_t sf;
-        seq = 0; /* force SF7 */
-        switch (seq % 4) {
-            case 0:
-                sf = mDot::SF_7;
-                sf_str = "SF7";
-                break;
-            case 1:
-                sf = mDot::SF_8;
-                sf_str = "SF8";
-                break;
-            case 2:
-                sf = mDot::SF_9;
-                sf_str = "SF9";
-                break;
-            case 3:
-                sf = mDot::SF_10;
-                sf_str = "SF10";
-                break;
-        }        
         // Set Spreading Factor, higher is lower data rate, smaller packets but longer range
         // Lower is higher data rate, larger packets and shorter range.
-        logInfo("Set SF: %s",sf_str);
-        if((ret = dot->setTxDataRate( sf )) != mDot::MDOT_OK) {
-            logError("Failed to set SF %d:%s", ret, mDot::getReturnCodeString(ret).c_str());
-        }
+        logInfo("Set SF: %s", UplinkController::getDataRateName(link.getDataRate()));
+        link.begin();
         
         /* set default data values */
         int temp = 0;
         int humid = -1;
         
-        /* build packet */
-        b.begin();
-        uint8_t flag = 0;
-        b.put(FormatSensor1);
-        uint8_t * const pFlag = b.getp(); // save pointer to flag location
-        b.put(0x00); // placeholder for flags
+        /* build packet: the readings as sent, whatever the format */
+        int32_t fields[PayloadFields];
+        unsigned flag = 0;
         
         // TODO: read battery voltage 
-        b.putV(13.8);
+        fields[FieldVbat] = SensorPayload::quantize<FieldVbat>(13.8);
         flag |= FlagVbat;
         
-        // read from Bme280 sensor:
-        float air_temp=0, air_humid=0;
-        bool dht_success = dht.sample();    
-        wait_ms(100);
-        logInfo("Air Sensor Status: %s", dht_success?"OK":"ERROR");
-        wait_ms(100);
-        air_temp = (float)dht.getTemperature()/10.0;
-        air_humid = (float)dht.getHumidity()/10.0;
+        // read every sensor at once; the cycle takes as long as the slowest
+        enum { Air, Water, Soil, Light };
+        enum { AirOK = 1 << Air, WaterOK = 1 << Water, SoilOK = 1 << Soil, LightOK = 1 << Light };
+        uint32_t good = scheduler.acquire();
+        uint32_t encode_us = us_ticker_read();
+        logInfo("Sensors read in %u ms (air %u, water %u, soil %u, light %u)",
+                scheduler.getLatency(), air.getElapsed(), water.getElapsed(),
+                soil.getElapsed(), light.getElapsed());
+
+        // the records of the tasks that finished, NULL for the others; a
+        // task that missed its deadline is still filling a record of its
+        // own, not one of these
+        const SensorSample *air_s = scheduler.getSample(Air);
+        const SensorSample *water_s = scheduler.getSample(Water);
+        const SensorSample *soil_s = scheduler.getSample(Soil);
+        const SensorSample *light_s = scheduler.getSample(Light);
+        float air_temp = air_s ? air_s->get(FieldAirT, 0) : 0;
+        float air_humid = air_s ? air_s->get(FieldAirRH, 0) : 0;
+        logInfo("Air Sensor Status: %s (%d)", (good & AirOK)?"OK":"ERROR", air.error);
         logInfo("Air Temp: %1.01fC  Air Humid: %1.01f%%", air_temp, air_humid);
         
-        
-        b.putT(air_temp); // air temp
-        b.putP(1010.0); // air pressure
-        b.putRH(air_humid); // air humidity
+        fields[FieldAirT] = SensorPayload::quantize<FieldAirT>(air_temp);
+        fields[FieldAirP] = SensorPayload::quantize<FieldAirP>(1010.0); // air pressure
+        fields[FieldAirRH] = SensorPayload::quantize<FieldAirRH>(air_humid);
         flag |= FlagTPH;
         
-        wait_ms(100);
-        // read from light sensor
-        float lux = tsl.getLux();
-        logInfo("Ambient Light: %.4f", lux);
-        wait_ms(100);
-        b.putLux(lux*100); // ambient light
+        float lux = light_s ? light_s->get(FieldLux, -1) : -1;
+        logInfo("Ambient Light: %.4f (%dx, %.1f ms)", lux, tsl.getLastGain(), tsl.getLastIntegrationTime());
+        logDebug("TSL bus transactions: %u", tsl.getTransactionCount());
+        tsl.resetTransactionCount();
+        fields[FieldLux] = SensorPayload::quantize<FieldLux>(lux);
         flag |= FlagLux;
         
-        // read water temperature
-        wait_ms(100);
-        logInfo("Running temperature conversion...");
-        float water_temp = thermom.GetTemperature();
-        logInfo("Water Temperature: %.4fC", water_temp);         
-        wait_ms(100);
-        b.putT(water_temp); // water temperature
-        flag |= FlagWater;
-        
-        // read soil sensor
-        wait_ms(100);
-        logInfo("sht.ready = %s", sht.ready?"true":"false");
-        sht.ready = true; // override error... 
-        sht.reset();
-        wait_ms(50);
-        bool sht_success = sht.update();
-        logInfo("Soil Sensor Status: %s", sht_success?"OK":"ERROR");
-        float soil_temp = (float)sht.getTemperature();  
-        float soil_humid = (float)(sht.humidity)/(float)35.0;
-        logInfo("sht->humid = %d",sht.humidity);
+        float soil_temp = soil_s ? soil_s->get(FieldSoilT, 0) : 0;
+        float soil_humid = soil_s ? soil_s->get(FieldSoilRH, 0) : 0;
+        logInfo("Soil Sensor Status: %s", (good & SoilOK)?"OK":"ERROR");
         logInfo("Soil Temp: %1.01fC  Soil Humid: %1.01f%%", soil_temp, soil_humid);
-        b.putT(soil_temp); // soil temperature
-        b.putRH(soil_humid); // soil humidityupdate
-        
+
+        // water temperature; every probe converted at once
+        float water_temp = DS18B20::INVALID_TEMPERATURE / 16.0;
+        if (water_s) {
+            for (unsigned p = 0; p < water_s->count; p++)
+                logInfo("Water Temperature %u: %.4fC", p, water_s->value[p]);
+            water_temp = water_s->get(FieldWaterT, water_temp);
+        }
+        fields[FieldWaterT] = SensorPayload::quantize<FieldWaterT>(water_temp); // first probe
+        flag |= FlagWater;
+
+        fields[FieldSoilT] = SensorPayload::quantize<FieldSoilT>(soil_temp);
+        fields[FieldSoilRH] = SensorPayload::quantize<FieldSoilRH>(soil_humid);
         flag |= FlagSoilTH;
         
-        // write flag byte
-        *pFlag = flag;
-        
-        /* load vector */
-        send_data.clear();
-        uint8_t c;
-        int n = b.getn();
-        for( int i=0; i< n; i++ ) {
-            c = b.buf[i];
-            send_data.push_back( c );
+        // the fixed frame, and the same readings as a delta frame or batch
+        // record if that is the format in use; the fixed frame stays the
+        // fallback
+        uint8_t fixed_buf[SensorPayload::MAX_FRAME];
+        int fixed_n = SensorPayload::encode(fields, flag, fixed_buf, sizeof(fixed_buf));
+
+        // a sensor that failed this time stays out of the statistics and
+        // the event rules
+        unsigned read = 1 << FieldVbat | 1 << FieldAirP;
+        if (good & AirOK)
+            read |= 1 << FieldAirT | 1 << FieldAirRH;
+        if (good & LightOK)
+            read |= 1 << FieldLux;
+        // the payload has the first probe, which can be good while
+        // another one is missing
+        if (water_temp != DS18B20::INVALID_TEMPERATURE / 16.0)
+            read |= 1 << FieldWaterT;
+        if (good & SoilOK)
+            read |= 1 << FieldSoilT | 1 << FieldSoilRH;
+
+        // an event, or the heartbeat, is due an uplink whatever the format
+        // has gathered so far
+        uint32_t now_ms = state.clock_ms + awake.read_ms();
+        bool event_due = false;
+        if (EVENT_HEARTBEAT_S) {
+            unsigned onset = events.update(now_ms, fields, read);
+            for (unsigned r = 0; onset >> r; r++)
+                if (onset & (1 << r))
+                    logInfo("event: rule %u on %s", r, SensorPayload::name(event_rules[r].field));
+            event_due = events.getActive() || seq == 0 ||
+                        now_ms - state.uplink_ms >= EVENT_HEARTBEAT_S * 1000UL;
+        }
+
+        uint8_t * frame = fixed_buf;
+        int n = fixed_n;
+        bool send_now = EVENT_HEARTBEAT_S ? event_due : true;
+        bool batched = false;
+        bool added = true;
+        uint8_t delta_buf[DeltaPayload::MAX_FRAME];
+        uint8_t batch_buf[BatchEncoder::MAX_BATCH_FRAME];
+        uint8_t stats_buf[StatsAccumulator::MAX_FRAME];
+        if (PAYLOAD_FORMAT == FormatSensorDelta) {
+            size_t dn = delta.encode(fields, delta_buf, sizeof(delta_buf));
+            if (dn) {
+                logInfo("%s frame: %u bytes instead of %d", delta.wasKeyframe() ? "key" : "delta", (unsigned)dn, n);
+                frame = delta_buf;
+                n = dn;
+            }
+        } else if (PAYLOAD_FORMAT == FormatSensorBatch) {
+            // a record that does not fit any more sends the batch without
+            // it, and starts the next one; the batch leaves room to be
+            // replayed
+            size_t max_frame = MIN(link.getMaxPayload(), (size_t)BatchEncoder::MAX_BATCH_FRAME) - ReplayHeader;
+            batched = batch.add(now_ms, fields, max_frame);
+            send_now = !batched || (EVENT_HEARTBEAT_S ? event_due : batch.getCount() >= PAYLOAD_BATCH_EPOCHS);
+            size_t bn = send_now ? batch.finish(now_ms, batch_buf, max_frame) : 0;
+            if (bn) {
+                logInfo("batch frame: %u records in %u bytes", batch.getCount(), (unsigned)bn);
+                frame = batch_buf;
+                n = bn;
+            } else if (send_now) {
+                logError("record does not fit a %u byte frame, sending it alone", (unsigned)max_frame);
+            } else {
+                logInfo("batched record %u of %d", batch.getCount(), PAYLOAD_BATCH_EPOCHS);
+            }
+        } else if (PAYLOAD_FORMAT == FormatSensorStats) {
+            added = stats.add(now_ms, fields, read);
+            send_now = !added || (EVENT_HEARTBEAT_S ? event_due : stats.getCount() >= PAYLOAD_STATS_EPOCHS);
+            size_t max_frame = MIN(link.getMaxPayload(), (size_t)StatsAccumulator::MAX_FRAME) - ReplayHeader;
+            // a frame too long for the data rate sends the means alone
+            size_t sn = 0;
+            if (send_now && !(sn = stats.finish(now_ms, stats_buf, max_frame)) &&
+                (sn = stats.finish(now_ms, stats_buf, max_frame, StatsAccumulator::StatMean)))
+                logInfo("statistics cut to the means for a %u byte frame", (unsigned)max_frame);
+            if (sn) {
+                logInfo("statistics frame: %u epochs in %u bytes", stats.getCount(), (unsigned)sn);
+                frame = stats_buf;
+                n = sn;
+            } else if (send_now) {
+                // the epochs so far wait for a faster data rate
+                logError("statistics do not fit a %u byte frame, sending the readings alone and keeping %u epochs",
+                         (unsigned)max_frame, stats.getCount());
+            } else {
+                logInfo("statistics over %u of %d epochs", stats.getCount(), PAYLOAD_STATS_EPOCHS);
+            }
+        }
+
+        // the slowest record through each stage: its sensor task, the
+        // handoff to this thread, then the encoding of them all
+        encode_us = us_ticker_read() - encode_us;
+        uint32_t acquire_us = 0, handoff_us = 0;
+        for (unsigned i = Air; i <= Light; i++) {
+            const SensorSample *s = scheduler.getSample(i);
+            if (s) {
+                acquire_us = MAX(acquire_us, s->posted_us - s->started_us);
+                handoff_us = MAX(handoff_us, s->taken_us - s->posted_us);
+            }
+        }
+        logDebug("pipeline us: acquire %lu handoff %lu encode %lu", (unsigned long)acquire_us,
+                 (unsigned long)handoff_us, (unsigned long)encode_us);
+        if (scheduler.getStarved() || scheduler.getLate())
+            logError("sensor records: %lu tasks not started, %lu came in late",
+                     (unsigned long)scheduler.getStarved(), (unsigned long)scheduler.getLate());
+
+        if (send_now) {
+            state.uplink_ms = now_ms;
+            wait_ms(100);
+            /* send packet; statistics stand for many epochs, so they go
+               confirmed and a miss is queued */
+            bool sent = false;
+            if ((ret = link.send(frame, n, frame == stats_buf)) != mDot::MDOT_OK) {
+                logError("failed to send: [%d][%s]", ret, mDot::getReturnCodeString(ret).c_str());
+            } else {
+                logInfo("data len: %d,  send data: %s", n, hexFrame(frame, n));
+                sent = true;
+                // only an acknowledged frame is known to have been received
+                // and can be the next reference; a lost frame, keyframe or
+                // not, then costs the network that frame alone
+                if (frame == delta_buf && link.wasAcked())
+                    delta.delivered();
+            }
+
+            // what did not get through waits for the link to come back: a
+            // delta frame makes no sense later, so the fixed frame instead
+            if (!sent) {
+                uint8_t * queued = frame == delta_buf ? fixed_buf : frame;
+                size_t qn = frame == delta_buf ? fixed_n : n;
+                if (queue.push(state.clock_ms + awake.read_ms(), queued, qn))
+                    logInfo("queued %u byte frame, %u waiting", (unsigned)qn, queue.getCount());
+                else
+                    logError("dropped %u byte frame, %lu so far", (unsigned)qn, (unsigned long)queue.getDropped());
+            }
+            if (frame == batch_buf) {
+                batch.clear();
+                if (!batched)
+                    batch.add(state.clock_ms + awake.read_ms(), fields,
+                              MIN(link.getMaxPayload(), (size_t)BatchEncoder::MAX_BATCH_FRAME) - ReplayHeader);
+            }
+            if (frame == stats_buf) {
+                stats.clear();
+                if (!added)
+                    stats.add(now_ms, fields, read);
+            }
         }
 
-        wait_ms(100);
-        /* send packet */
-        if ((ret = dot->send(send_data)) != mDot::MDOT_OK) {
-            logError("failed to send: [%d][%s]", ret, mDot::getReturnCodeString(ret).c_str());
-        } else {
-            logInfo("data len: %d,  send data: %s", n, Text::bin2hexString(send_data).c_str());
+        // oldest first, while the link answers and the band lets us
+        for (int r = 0; r < QUEUE_REPLAY_PER_CYCLE && queue.getCount() && link.isUp() &&
+                        dot->getNextTxMs() == 0; r++) {
+            uint8_t replay_buf[ReplayHeader + FrameQueue::MAX_FRAME];
+            uint32_t queued_ms;
+            int qn = queue.peek(replay_buf + ReplayHeader, FrameQueue::MAX_FRAME, &queued_ms);
+            if (qn <= 0)
+                break;
+            uint32_t age_s = (state.clock_ms + awake.read_ms() - queued_ms + 500) / 1000;
+            uint8_t * p = replay_buf + ReplayHeader;
+            uint8_t head[ReplayHeader];
+            uint8_t * h = head;
+            *h++ = FormatReplay;
+            h = DeltaPayload::putVarint(h, head + sizeof(head), age_s);
+            p -= h - head;
+            memcpy(p, head, h - head);
+
+            ret = link.send(p, replay_buf + ReplayHeader + qn - p, true);
+            if (ret == mDot::MDOT_INVALID_PARAM) {
+                // a batch from when the data rate carried more
+                logError("dropped %d byte frame too long to replay", qn);
+                queue.pop();
+                continue;
+            }
+            if (ret != mDot::MDOT_OK || !link.wasAcked()) {
+                logError("failed to replay: [%d][%s]", ret, mDot::getReturnCodeString(ret).c_str());
+                break;
+            }
+            queue.pop();
+            logInfo("replayed %d byte frame from %lu s ago, %u waiting", qn,
+                    (unsigned long)age_s, queue.getCount());
         }
 
         /* sleep */
-        uint32_t sleep_time = MAX((dot->getNextTxMs() / 1000), 10 /* use 6000 for 10min */);
+        // uplinks of an event come every cycle, a heartbeat's every so many
+        uint32_t sleep_time = EVENT_HEARTBEAT_S && events.getActive() ?
+            link.getInterval(EVENT_SAMPLE_INTERVAL_S, 1) :
+            link.getInterval(SAMPLE_INTERVAL_S,
+                EVENT_HEARTBEAT_S ? MAX(EVENT_HEARTBEAT_S / SAMPLE_INTERVAL_S, 1) :
+                PAYLOAD_FORMAT == FormatSensorBatch ? PAYLOAD_BATCH_EPOCHS :
+                PAYLOAD_FORMAT == FormatSensorStats ? PAYLOAD_STATS_EPOCHS : 1);
+#if PROFILE_LOG_INTERVAL
+        // idle is what no thread or interrupt handler used, asleep or not
+        osProfile prof;
+        uint64_t main_cycles = 0;
+        if (seq % PROFILE_LOG_INTERVAL == 0 && osKernelGetProfile(&prof) == osOK &&
+            osThreadGetCycles(Thread::gettid(), &main_cycles) == osOK) {
+            uint64_t busy = prof.threads + prof.isr;
+            logDebug("cpu %%: idle %.1f isr %.1f main %.1f air %.1f water %.1f soil %.1f light %.1f",
+                     percent(prof.elapsed > busy ? prof.elapsed - busy : 0, prof.elapsed),
+                     percent(prof.isr, prof.elapsed), percent(main_cycles, prof.elapsed),
+                     percent(air.getCycles(), prof.elapsed), percent(water.getCycles(), prof.elapsed),
+                     percent(soil.getCycles(), prof.elapsed), percent(light.getCycles(), prof.elapsed));
+            logDebug("stack bytes: air %lu water %lu soil %lu light %lu of %u",
+                     (unsigned long)air.getMaxStack(), (unsigned long)water.getMaxStack(),
+                     (unsigned long)soil.getMaxStack(), (unsigned long)light.getMaxStack(),
+                     (unsigned)DEFAULT_STACK_SIZE);
+            osIrqProfile irq;
+            for (uint32_t i = 0; osKernelGetIrqProfile(i, &irq) == osOK; i++)
+                logDebug("irq %ld: %lu taken, %.2f%%", (long)irq.irqn,
+                         (unsigned long)irq.count, percent(irq.cycles, prof.elapsed));
+        }
+#endif
         logInfo("going to sleep for %d seconds", sleep_time);
         
         status_led.write(1);
-        wait_ms(1*1000);
+        wait_ms(STATUS_BLINK_MS);
         status_led.write(0);
-        wait_ms(4*1000);
         
         seq++;
+
+        // everything the next cycle needs; a probe that stopped answering
+        // gets the bus searched again
+        state.seq = seq;
+        state.probes = (good & WaterOK) ? water.probes : 0;
+        memcpy(state.roms, water.roms, sizeof(state.roms));
+        state.tsl_timing = tsl.getTiming();
+        state.clock_ms += awake.read_ms() + sleep_time * 1000;
+        awake.reset();
+        if (!saveState(dot, state)) {
+            logError("failed to save state");
+        }
+        tsl.disablePower();
+        // does not return: the RTC alarm resets the MCU and main() runs again
+        dot->sleep(sleep_time, mDot::RTC_ALARM, true);
     }
 
     return 0;
@@ -116,6 +116,16 @@ uint32_t Thread::max_stack() {
 #endif
 }
 
+uint64_t Thread::cpu_cycles() {
+#ifndef __MBED_CMSIS_RTOS_CA9
+    uint64_t cycles = 0;
+    osThreadGetCycles(_tid, &cycles);
+    return cycles;
+#else
+    return 0;
+#endif
+}
+
 osEvent Thread::signal_wait(int32_t signals, uint32_t millisec) {
     return osSignalWait(signals, millisec);
 }
@@ -108,6 +108,11 @@ public:
       @return  the maximum stack memory usage to date in bytes
     */
     uint32_t max_stack();
+    
+    /** Get the processor time this Thread has run since it was created
+      @return  the number of core clock cycles, 0 when the kernel is built without OS_PROFILE
+    */
+    uint64_t cpu_cycles();
 
     /** Wait for one or more Signal Flags to become signaled for the current RUNNING thread.
       @param   signals   wait until all specified signal flags set or 0 for any single signal flag.
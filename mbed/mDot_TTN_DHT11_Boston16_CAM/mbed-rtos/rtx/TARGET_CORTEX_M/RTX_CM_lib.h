@@ -63,19 +63,19 @@ typedef uint32_t OS_RESULT;
 
 #define runtask_id()    rt_tsk_self()
 #define mutex_init(m)   rt_mut_init(m)
-#define mutex_wait(m)   os_mut_wait(m,0xFFFF)
+#define mutex_wait(m)   os_mut_wait(m,0xFFFFFFFF)
 #define mutex_rel(m)    os_mut_release(m)
 
 extern OS_TID    rt_tsk_self    (void);
 extern void      rt_mut_init    (OS_ID mutex);
 extern OS_RESULT rt_mut_release (OS_ID mutex);
-extern OS_RESULT rt_mut_wait    (OS_ID mutex, uint16_t timeout);
+extern OS_RESULT rt_mut_wait    (OS_ID mutex, uint32_t timeout);
 
 #define os_mut_wait(mutex,timeout) _os_mut_wait((uint32_t)rt_mut_wait,mutex,timeout)
 #define os_mut_release(mutex)      _os_mut_release((uint32_t)rt_mut_release,mutex)
 
 OS_RESULT _os_mut_release (uint32_t p, OS_ID mutex)                   __svc_indirect(0);
-OS_RESULT _os_mut_wait    (uint32_t p, OS_ID mutex, uint16_t timeout) __svc_indirect(0);
+OS_RESULT _os_mut_wait    (uint32_t p, OS_ID mutex, uint32_t timeout) __svc_indirect(0);
 
 #endif
 
@@ -142,6 +142,11 @@ osMessageQId osMessageQId_osTimerMessageQ;
  void rt_stk_check  (void) {;}
 #endif
 
+#if OS_PROFILE == 0
+ void rt_prof_init   (void) {;}
+ void rt_prof_switch (P_TCB p_new) {;}
+#endif
+
 
 /*----------------------------------------------------------------------------
  *      Standard Library multithreading interface
@@ -211,6 +211,18 @@
  #define OS_TICK        1000
 #endif
 
+// <q>Tickless idle
+// <i> Lets the idle demon stop the periodic tick until the next thread delay
+// <i> or user timer is due, instead of taking a SysTick interrupt every tick.
+// <i> It only takes effect while the idle demon is the thread that runs when
+// <i> nothing else is ready. On the mDot, libmDot starts a thread of its own at
+// <i> osPriorityIdle that sleeps with __WFI() and outranks the demon, so once
+// <i> mDot::getInstance() has run the tick keeps running and this saves little.
+// <i> Default: Enabled
+#ifndef OS_TICKLESS
+ #define OS_TICKLESS    1
+#endif
+
 // </h>
 
 // <h>System Configuration
@@ -274,6 +286,18 @@
  #define OS_FIFOSZ      16
 #endif
 
+// <q>Thread profiling
+// <i> Counts the core clock cycles run by each thread, by the idle demon
+// <i> and by the interrupt handlers set with NVIC_SetVector, with the DWT
+// <i> cycle counter; see osKernelGetProfile. Needs a Cortex-M3 or up and
+// <i> a GNU linker: build every RTX source with -DOS_PROFILE=1, as
+// <i> rt_Profile.c has to see it too, and link with
+// <i> --wrap,NVIC_SetVector --wrap,NVIC_GetVector.
+// <i> Default: Disabled
+#ifndef OS_PROFILE
+ #define OS_PROFILE     0
+#endif
+
 // </h>
 
 //------------- <<< end of configuration section >>> -----------------------
@@ -296,6 +320,14 @@
 /*----------------------------------------------------------------------------
  *      OS Idle daemon
  *---------------------------------------------------------------------------*/
+#if OS_TICKLESS
+#include "cmsis.h"
+#include "sleep_api.h"
+
+/* rt_Tickless.c: sleeps through the stretch with the SysTick reprogrammed */
+extern uint32_t rt_tick_sleep (uint32_t ticks);
+#endif
+
 void os_idle_demon (void) {
   /* The idle demon is a system thread, running when no other thread is      */
   /* ready to run.                                                           */
@@ -304,9 +336,27 @@ void os_idle_demon (void) {
      Unfortunately, this usually requires disconnecting the interface chip (debugger).
      This can be done, but it would break the local file system.
   */
+#if OS_TICKLESS
+  uint32_t ticks;
+
+  for (;;) {
+    ticks = os_suspend();
+    if (ticks > 1) {
+      __disable_irq();
+      ticks = rt_tick_sleep(ticks);
+      __enable_irq();
+      os_resume(ticks);
+    } else {
+      /* the next tick has work to do anyway */
+      os_resume(0);
+      sleep();
+    }
+  }
+#else
   for (;;) {
       // sleep();
   }
+#endif
 }
 
 /*----------------------------------------------------------------------------
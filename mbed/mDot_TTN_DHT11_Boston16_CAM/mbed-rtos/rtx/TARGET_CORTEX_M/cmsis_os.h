@@ -305,6 +305,22 @@ typedef struct  {
   } def;                               ///< event definition
 } osEvent;
 
+/// Profile of where the processor time went since the kernel started (RTX extension).
+/// The counts are core clock cycles, and zero but for elapsed without OS_PROFILE.
+typedef struct os_profile  {
+  uint64_t                 elapsed;    ///< wall time, from the tick count
+  uint64_t                 threads;    ///< run by threads other than the idle demon, terminated ones too
+  uint64_t                    idle;    ///< run by the idle demon while the core was awake
+  uint64_t                     isr;    ///< spent in interrupt handlers set with NVIC_SetVector
+} osProfile;
+
+/// Profile of one interrupt handler set with NVIC_SetVector (RTX extension).
+typedef struct os_irq_profile  {
+  int32_t                     irqn;    ///< interrupt number
+  uint32_t                   count;    ///< times the interrupt was taken
+  uint64_t                  cycles;    ///< spent in its handler, nested interrupts included
+} osIrqProfile;
+
 
 //  ==== Kernel Control Functions ====
 
@@ -323,6 +339,26 @@ osStatus osKernelStart (void);
 /// \return 0 RTOS is not started, 1 RTOS is started.
 int32_t osKernelRunning(void);
 
+/// Suspend the RTX thread scheduler (RTX extension, used by a tickless idle demon).
+/// \return number of ticks until the next thread delay or user timer expires.
+uint32_t os_suspend (void);
+
+/// Resume the RTX thread scheduler (RTX extension, used by a tickless idle demon).
+/// \param[in]     sleep_time    number of ticks that passed while the scheduler was suspended.
+void os_resume (uint32_t sleep_time);
+
+/// Read the processor time profile (RTX extension).
+/// \param[out]    profile       the profile since the kernel started.
+/// \return status code that indicates the execution status of the function.
+osStatus osKernelGetProfile (osProfile *profile);
+
+/// Read the profile of an interrupt handler (RTX extension).
+/// \param[in]     index         0 for the first handler set with NVIC_SetVector, and so on.
+/// \param[out]    irq           the profile of that handler.
+/// \return status code that indicates the execution status of the function;
+///         osErrorParameter past the last handler timed.
+osStatus osKernelGetIrqProfile (uint32_t index, osIrqProfile *irq);
+
 
 //  ==== Thread Management ====
 
@@ -385,6 +421,12 @@ osStatus osThreadSetPriority (osThreadId thread_id, osPriority priority);
 /// \note MUST REMAIN UNCHANGED: \b osThreadGetPriority shall be consistent in every CMSIS-RTOS.
 osPriority osThreadGetPriority (osThreadId thread_id);
 
+/// Get the processor time an active thread has run since it was created (RTX extension).
+/// \param[in]     thread_id     thread ID obtained by \ref osThreadCreate or \ref osThreadGetId.
+/// \param[out]    cycles        core clock cycles, 0 without OS_PROFILE.
+/// \return status code that indicates the execution status of the function.
+osStatus osThreadGetCycles (osThreadId thread_id, uint64_t *cycles);
+
 
 //  ==== Generic Wait Functions ====
 
@@ -415,7 +457,7 @@ os_InRegs osEvent osWait (uint32_t millisec);
 extern osTimerDef_t os_timer_def_##name
 #else                            // define the object
 #define osTimerDef(name, function)  \
-uint32_t os_timer_cb_##name[5]; \
+uint32_t os_timer_cb_##name[7]; \
 osTimerDef_t os_timer_def_##name = \
 { (function), (os_timer_cb_##name) }
 #endif
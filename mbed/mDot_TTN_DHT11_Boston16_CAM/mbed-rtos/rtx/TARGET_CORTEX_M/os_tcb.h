@@ -14,6 +14,12 @@ typedef unsigned char      BIT;
 typedef unsigned int       BOOL;
 typedef void               (*FUNCP)(void);
 
+typedef struct OS_TOUT {          /* Time-out on a timer wheel               */
+  struct OS_TOUT  *p_next;        /* Next time-out in the same wheel slot    */
+  struct OS_TOUT **pp_prev;       /* Link to this one, NULL if not in wheel  */
+  U32    time;                    /* Expiry, as a value of os_time           */
+} *P_TOUT;
+
 typedef struct OS_TCB {
   /* General part: identical for all implementations.                        */
   U8     cb_type;                 /* Control Block Type                      */
@@ -22,9 +28,7 @@ typedef struct OS_TCB {
   U8     task_id;                 /* Task ID value for optimized TCB access  */
   struct OS_TCB *p_lnk;           /* Link pointer for ready/sem. wait list   */
   struct OS_TCB *p_rlnk;          /* Link pointer for sem./mbx lst backwards */
-  struct OS_TCB *p_dlnk;          /* Link pointer for delay list             */
-  struct OS_TCB *p_blnk;          /* Link pointer for delay list backwards   */
-  U16    delta_time;              /* Time until time out                     */
+  struct OS_TOUT tout;            /* Delay or time-out on the timer wheel    */
   U16    interval_time;           /* Time interval for periodic waits        */
   U16    events;                  /* Event flags                             */
   U16    waits;                   /* Wait flags                              */
@@ -46,6 +50,9 @@ typedef struct OS_TCB {
 
   /* Task entry point used for uVision debugger                              */
   FUNCP  ptask;                   /* Task entry address                      */
+
+  /* Profiling part: counted with OS_PROFILE                                 */
+  U64    cycles;                  /* Core clock cycles the task has run      */
 } *P_TCB;
 
 #endif
@@ -57,6 +57,7 @@
 #include "rt_Semaphore.h"
 #include "rt_Mailbox.h"
 #include "rt_MemBox.h"
+#include "rt_Profile.h"
 #include "rt_HAL_CM.h"
 
 #define os_thread_cb OS_TCB
@@ -131,6 +132,14 @@ static __inline   t __##f (t1 a1, t2 a2, t3 a3, t4 a4) {                       \
   return _##f(f,a1,a2,a3,a4);                                                  \
 }
 
+#define SVC_1_0(f,t,t1)                                                        \
+__svc_indirect(0) t  _##f (t(*)(t1),t1);                                       \
+                  t     f (t1 a1);                                             \
+__attribute__((always_inline))                                                 \
+static __inline   t __##f (t1 a1) {                                            \
+  _##f(f,a1);                                                                  \
+}
+
 #define SVC_1_2 SVC_1_1
 #define SVC_1_3 SVC_1_1
 #define SVC_2_3 SVC_2_1
@@ -144,6 +153,7 @@ typedef uint32_t __attribute__((vector_size(16))) ret128;
 
 #define RET_pointer    __r0
 #define RET_int32_t    __r0
+#define RET_uint32_t   __r0
 #define RET_osStatus   __r0
 #define RET_osPriority __r0
 #define RET_osEvent    {(osStatus)__r0, {(uint32_t)__r1}, {(void *)__r2}}
@@ -225,6 +235,13 @@ static inline  t __##f (void) {                                                \
   return (t) rv;                                                               \
 }
 
+#define SVC_1_0(f,t,t1)                                                        \
+__attribute__((always_inline))                                                 \
+static inline  t __##f (t1 a1) {                                               \
+  SVC_Arg1(t1);                                                                \
+  SVC_Call(f);                                                                 \
+}
+
 #define SVC_1_1(f,t,t1,rv)                                                     \
 __attribute__((always_inline))                                                 \
 static inline  t __##f (t1 a1) {                                               \
@@ -292,6 +309,14 @@ static inline t __##f (void) {                                                 \
   return _##f();                                                               \
 }
 
+#define SVC_1_0(f,t,t1)                                                        \
+t f (t1 a1);                                                                   \
+_Pragma("swi_number=0") __swi t _##f (t1 a1);                                  \
+static inline t __##f (t1 a1) {                                                \
+  SVC_Setup(f);                                                                \
+  _##f(a1);                                                                    \
+}
+
 #define SVC_1_1(f,t,t1,...)                                                    \
 t f (t1 a1);                                                                   \
 _Pragma("swi_number=0") __swi t _##f (t1 a1);                                  \
@@ -357,11 +382,14 @@ extern osMessageQId    osMessageQId_osTimerMessageQ;
 static uint32_t rt_ms2tick (uint32_t millisec) {
   uint32_t tick;
 
-  if (millisec == osWaitForever) return 0xFFFF; // Indefinite timeout
-  if (millisec > 4000000) return 0xFFFE;        // Max ticks supported
+  if (millisec == osWaitForever) return 0xFFFFFFFF; // Indefinite timeout
+  if (millisec / os_clockrate >= 0xFFFFFFFE / 1000) {
+    return 0xFFFFFFFE;                          // Max ticks supported
+  }
 
-  tick = ((1000 * millisec) + os_clockrate - 1)  / os_clockrate;
-  if (tick > 0xFFFE) return 0xFFFE;
+  // millisec * 1000 / os_clockrate rounded up, without overflowing
+  tick  = (millisec / os_clockrate) * 1000;
+  tick += ((millisec % os_clockrate) * 1000 + os_clockrate - 1) / os_clockrate;
 
   return tick;
 }
@@ -413,6 +441,10 @@ uint8_t os_running;                             // Kernel Running flag
 SVC_0_1(svcKernelInitialize, osStatus, RET_osStatus)
 SVC_0_1(svcKernelStart,      osStatus, RET_osStatus)
 SVC_0_1(svcKernelRunning,    int32_t,  RET_int32_t)
+SVC_0_1(rt_suspend,          U32,      RET_uint32_t)
+SVC_1_0(rt_resume,           void,     U32)
+SVC_1_1(svcKernelGetProfile, osStatus, osProfile *, RET_osStatus)
+SVC_2_1(svcKernelGetIrqProfile, osStatus, uint32_t, osIrqProfile *, RET_osStatus)
 
 extern void  sysThreadError   (osStatus status);
 osThreadId   svcThreadCreate  (osThreadDef_t *thread_def, void *argument);
@@ -459,6 +491,38 @@ int32_t svcKernelRunning(void) {
   return os_running;
 }
 
+/// Read the processor time profile
+osStatus svcKernelGetProfile (osProfile *profile) {
+
+  if (profile == NULL) return osErrorParameter;
+
+  rt_prof_switch(os_prof.run);                  // Count up to now
+  __disable_irq();                              // ISRs add to the counts
+  profile->elapsed = (uint64_t)os_time * (os_trv + 1);
+  profile->threads = os_prof.busy;
+  profile->idle    = os_idle_TCB.cycles;
+  profile->isr     = os_prof.isr;
+  __enable_irq();
+
+  return osOK;
+}
+
+/// Read the profile of an interrupt handler
+osStatus svcKernelGetIrqProfile (uint32_t index, osIrqProfile *irq) {
+  P_PROF_IRQ p_irq;
+
+  if ((irq == NULL) || (index >= os_prof.irq_cnt)) return osErrorParameter;
+
+  p_irq = &os_prof.irq[index];
+  __disable_irq();                              // ISRs add to the counts
+  irq->irqn   = p_irq->irqn;
+  irq->count  = p_irq->count;
+  irq->cycles = p_irq->cycles;
+  __enable_irq();
+
+  return osOK;
+}
+
 // Kernel Control Public API
 
 /// Initialize the RTOS Kernel for creating objects
@@ -513,6 +577,30 @@ int32_t osKernelRunning(void) {
   }
 }
 
+/// Suspend the RTX thread scheduler
+uint32_t os_suspend (void) {
+  if (__get_IPSR() != 0) return 0;              // Not allowed in ISR
+  return __rt_suspend();
+}
+
+/// Resume the RTX thread scheduler
+void os_resume (uint32_t sleep_time) {
+  if (__get_IPSR() != 0) return;                // Not allowed in ISR
+  __rt_resume(sleep_time);
+}
+
+/// Read the processor time profile
+osStatus osKernelGetProfile (osProfile *profile) {
+  if (__get_IPSR() != 0) return osErrorISR;     // Not allowed in ISR
+  return __svcKernelGetProfile(profile);
+}
+
+/// Read the profile of an interrupt handler
+osStatus osKernelGetIrqProfile (uint32_t index, osIrqProfile *irq) {
+  if (__get_IPSR() != 0) return osErrorISR;     // Not allowed in ISR
+  return __svcKernelGetIrqProfile(index, irq);
+}
+
 
 // ==== Thread Management ====
 
@@ -525,6 +613,7 @@ SVC_1_1(svcThreadTerminate,   osStatus,   osThreadId,                  RET_osSta
 SVC_0_1(svcThreadYield,       osStatus,                                RET_osStatus)
 SVC_2_1(svcThreadSetPriority, osStatus,   osThreadId,      osPriority, RET_osStatus)
 SVC_1_1(svcThreadGetPriority, osPriority, osThreadId,                  RET_osPriority)
+SVC_2_1(svcThreadGetCycles,   osStatus,   osThreadId,      uint64_t *, RET_osStatus)
 
 // Thread Service Calls
 extern OS_TID rt_get_TID (void);
@@ -632,6 +721,19 @@ osPriority svcThreadGetPriority (osThreadId thread_id) {
   return (osPriority)(ptcb->prio - 1 + osPriorityIdle);
 }
 
+/// Get the processor time an active thread has run
+osStatus svcThreadGetCycles (osThreadId thread_id, uint64_t *cycles) {
+  P_TCB ptcb;
+
+  ptcb = rt_tid2ptcb(thread_id);                // Get TCB pointer
+  if ((ptcb == NULL) || (cycles == NULL)) return osErrorParameter;
+
+  rt_prof_switch(os_prof.run);                  // Count up to now
+  *cycles = ptcb->cycles;
+
+  return osOK;
+}
+
 
 // Thread Public API
 
@@ -676,6 +778,12 @@ osPriority osThreadGetPriority (osThreadId thread_id) {
   return __svcThreadGetPriority(thread_id);
 }
 
+/// Get the processor time an active thread has run
+osStatus osThreadGetCycles (osThreadId thread_id, uint64_t *cycles) {
+  if (__get_IPSR() != 0) return osErrorISR;     // Not allowed in ISR
+  return __svcThreadGetCycles(thread_id, cycles);
+}
+
 /// INTERNAL - Not Public
 /// Auto Terminate Thread on exit (used implicitly when thread exists)
 __NO_RETURN void osThreadExit (void) {
@@ -755,67 +863,30 @@ os_InRegs osEvent osWait (uint32_t millisec) {
 // Timer structures
 
 typedef struct os_timer_cb_ {                   // Timer Control Block
-  struct os_timer_cb_ *next;                    // Pointer to next active Timer
+  struct OS_TOUT       tout;                    // Expiry on the Timer wheel
   uint8_t             state;                    // Timer State
   uint8_t              type;                    // Timer Type (Periodic/One-shot)
   uint16_t         reserved;                    // Reserved
-  uint16_t             tcnt;                    // Timer Delay Count
-  uint16_t             icnt;                    // Timer Initial Count
+  uint32_t             icnt;                    // Timer Initial Count
   void                 *arg;                    // Timer Function Argument
   osTimerDef_t       *timer;                    // Pointer to Timer definition
 } os_timer_cb;
 
 // Timer variables
-os_timer_cb *os_timer_head;                     // Pointer to first active Timer
+struct OS_WHEEL os_timer_wheel;                 // Active Timers by expiry
 
 
 // Timer Helper Functions
 
-// Insert Timer into the list sorted by time
+// Insert Timer into the wheel, to expire tcnt ticks from now
 static void rt_timer_insert (os_timer_cb *pt, uint32_t tcnt) {
-  os_timer_cb *p, *prev;
-
-  prev = NULL;
-  p = os_timer_head;
-  while (p != NULL) {
-    if (tcnt < p->tcnt) break;
-    tcnt -= p->tcnt;
-    prev = p;
-    p = p->next;
-  }
-  pt->next = p;
-  pt->tcnt = (uint16_t)tcnt;
-  if (p != NULL) {
-    p->tcnt -= pt->tcnt;
-  }
-  if (prev != NULL) {
-    prev->next = pt;
-  } else {
-    os_timer_head = pt;
-  }
+  rt_whl_put(&os_timer_wheel, &pt->tout, os_time + tcnt);
 }
 
-// Remove Timer from the list
+// Remove Timer from the wheel
 static int rt_timer_remove (os_timer_cb *pt) {
-  os_timer_cb *p, *prev;
-
-  prev = NULL;
-  p = os_timer_head;
-  while (p != NULL) {
-    if (p == pt) break;
-    prev = p;
-    p = p->next;
-  }
-  if (p == NULL) return -1;
-  if (prev != NULL) {
-    prev->next = pt->next;
-  } else {
-    os_timer_head = pt->next;
-  }
-  if (pt->next != NULL) {
-    pt->next->tcnt += pt->tcnt;
-  }
-
+  if (pt->tout.pp_prev == NULL) return -1;
+  rt_whl_rmv(&os_timer_wheel, &pt->tout);
   return 0;
 }
 
@@ -886,7 +957,7 @@ osStatus svcTimerStart (osTimerId timer_id, uint32_t millisec) {
       break;
     case osTimerStopped:
       pt->state = osTimerRunning;
-      pt->icnt  = (uint16_t)tcnt;
+      pt->icnt  = tcnt;
       break;
     default:
       return osErrorResource;
@@ -959,16 +1030,11 @@ static __INLINE osStatus isrMessagePut (osMessageQId queue_id, uint32_t info, ui
 
 /// Timer Tick (called each SysTick)
 void sysTimerTick (void) {
-  os_timer_cb *pt, *p;
+  os_timer_cb *pt;
 
-  p = os_timer_head;
-  if (p == NULL) return;
+  if (os_timer_wheel.count == 0) return;
 
-  p->tcnt--;
-  while ((p != NULL) && (p->tcnt == 0)) {
-    pt = p;
-    p = p->next;
-    os_timer_head = p;
+  while ((pt = (os_timer_cb *)rt_whl_get(&os_timer_wheel, os_time)) != NULL) {
     isrMessagePut(osMessageQId_osTimerMessageQ, (uint32_t)pt, 0);
     if (pt->type == osTimerPeriodic) {
       rt_timer_insert(pt, pt->icnt);
@@ -978,6 +1044,11 @@ void sysTimerTick (void) {
   }
 }
 
+/// Ticks until the first user timer expires (used by rt_suspend)
+U32 sysUserTimerWakeupTime (void) {
+  return rt_whl_next(&os_timer_wheel, os_time);
+}
+
 
 // Timer Management Public API
 
@@ -176,6 +176,11 @@ static inline U8 __clz(U32 value)
 /* Core Debug registers */
 #define DEMCR           (*((volatile U32 *)0xE000EDFC))
 
+/* DWT registers */
+#define DWT_CTRL        (*((volatile U32 *)0xE0001000))
+#define DWT_CYCCNT      (*((volatile U32 *)0xE0001004))
+#define DWT_CYCCNTENA   0x00000001
+
 /* ITM registers */
 #define ITM_CONTROL     (*((volatile U32 *)0xE0000E80))
 #define ITM_ENABLE      (*((volatile U32 *)0xE0000E00))
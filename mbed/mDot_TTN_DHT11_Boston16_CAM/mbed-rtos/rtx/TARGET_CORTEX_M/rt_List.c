@@ -44,10 +44,22 @@
  *      Global Variables
  *---------------------------------------------------------------------------*/
 
-/* List head of chained ready tasks */
+/* List head of chained ready tasks: "p_lnk" is the highest priority one */
 struct OS_XCB  os_rdy;
-/* List head of chained delay tasks */
-struct OS_XCB  os_dly;
+/* Timer wheel of delayed tasks */
+struct OS_WHEEL os_dly;
+
+/* Ready tasks are chained in a FIFO per priority level, with a bit set in  */
+/* "rdy_map" for each level that is not empty, so that putting a task and   */
+/* getting the highest priority one do not depend on how many are ready.   */
+/* Priorities 0 (idle) to 7 (osPriorityRealtime) have a level each; higher */
+/* ones, only used while the kernel starts, share the top level in order.  */
+#define RDY_LEVELS      9
+#define RDY_LEVEL(prio) ((prio) < RDY_LEVELS-1 ? (prio) : RDY_LEVELS-1)
+
+static U32   rdy_map;
+static P_TCB rdy_head[RDY_LEVELS];
+static P_TCB rdy_tail[RDY_LEVELS];
 
 
 /*----------------------------------------------------------------------------
@@ -55,6 +67,57 @@ struct OS_XCB  os_dly;
  *---------------------------------------------------------------------------*/
 
 
+/*--------------------------- rdy_top ---------------------------------------*/
+
+#if (__TARGET_ARCH_6S_M)
+static U32 rdy_top (U32 map) {
+  /* Highest level set in "map": no CLZ instruction on ARMv6-M. */
+  U32 lvl = RDY_LEVELS-1;
+
+  while ((map & (1U << lvl)) == 0) {
+    lvl--;
+  }
+  return (lvl);
+}
+#else
+#define rdy_top(map)    (31 - __clz(map))
+#endif
+
+
+/*--------------------------- rdy_update ------------------------------------*/
+
+static __inline void rdy_update (void) {
+  /* Keep "os_rdy.p_lnk" on the task with highest priority. */
+  os_rdy.p_lnk = rdy_map ? rdy_head[rdy_top (rdy_map)] : NULL;
+}
+
+
+/*--------------------------- rdy_unlink ------------------------------------*/
+
+static BOOL rdy_unlink (U32 lvl, P_TCB p_task) {
+  /* Remove "p_task" from the FIFO of level "lvl" if it is there. */
+  P_TCB *pp = &rdy_head[lvl];
+  P_TCB p_prev = NULL;
+
+  while (*pp != NULL) {
+    if (*pp == p_task) {
+      *pp = p_task->p_lnk;
+      p_task->p_lnk = NULL;
+      if (rdy_tail[lvl] == p_task) {
+        rdy_tail[lvl] = p_prev;
+      }
+      if (rdy_head[lvl] == NULL) {
+        rdy_map &= ~(1U << lvl);
+      }
+      return (__TRUE);
+    }
+    p_prev = *pp;
+    pp = &p_prev->p_lnk;
+  }
+  return (__FALSE);
+}
+
+
 /*--------------------------- rt_put_prio -----------------------------------*/
 
 void rt_put_prio (P_XCB p_CB, P_TCB p_task) {
@@ -65,6 +128,34 @@ void rt_put_prio (P_XCB p_CB, P_TCB p_task) {
   U32 prio;
   BOOL sem_mbx = __FALSE;
 
+  if (p_CB == &os_rdy) {
+    /* Ready list: at the end of its priority level */
+    U32 lvl = RDY_LEVEL(p_task->prio);
+    p_task->p_rlnk = NULL;
+    p_CB2 = rdy_tail[lvl];
+    if (p_CB2 == NULL) {
+      p_task->p_lnk = NULL;
+      rdy_head[lvl] = p_task;
+      rdy_tail[lvl] = p_task;
+      rdy_map |= 1U << lvl;
+    }
+    else if (p_CB2->prio >= p_task->prio) {
+      p_task->p_lnk = NULL;
+      p_CB2->p_lnk  = p_task;
+      rdy_tail[lvl] = p_task;
+    }
+    else {
+      /* Top level with a higher priority than its last task: search it */
+      P_TCB *pp = &rdy_head[lvl];
+      while ((*pp)->prio >= p_task->prio) {
+        pp = &(*pp)->p_lnk;
+      }
+      p_task->p_lnk = *pp;
+      *pp = p_task;
+    }
+    rdy_update ();
+    return;
+  }
   if (p_CB->cb_type == SCB || p_CB->cb_type == MCB || p_CB->cb_type == MUCB) {
     sem_mbx = __TRUE;
   }
@@ -97,6 +188,18 @@ P_TCB rt_get_first (P_XCB p_CB) {
   /* "p_CB" points to head of list. */
   P_TCB p_first;
 
+  if (p_CB == &os_rdy) {
+    U32 lvl = rdy_top (rdy_map);
+    p_first = rdy_head[lvl];
+    rdy_head[lvl] = p_first->p_lnk;
+    if (rdy_head[lvl] == NULL) {
+      rdy_tail[lvl] = NULL;
+      rdy_map &= ~(1U << lvl);
+    }
+    p_first->p_lnk = NULL;
+    rdy_update ();
+    return (p_first);
+  }
   p_first = p_CB->p_lnk;
   p_CB->p_lnk = p_first->p_lnk;
   if (p_CB->cb_type == SCB || p_CB->cb_type == MCB || p_CB->cb_type == MUCB) {
@@ -118,8 +221,15 @@ P_TCB rt_get_first (P_XCB p_CB) {
 void rt_put_rdy_first (P_TCB p_task) {
   /* Put task identified with "p_task" at the head of the ready list. The   */
   /* task must have at least a priority equal to highest priority in list.  */
-  p_task->p_lnk = os_rdy.p_lnk;
+  U32 lvl = RDY_LEVEL(p_task->prio);
+
+  p_task->p_lnk = rdy_head[lvl];
   p_task->p_rlnk = NULL;
+  if (rdy_head[lvl] == NULL) {
+    rdy_tail[lvl] = p_task;
+    rdy_map |= 1U << lvl;
+  }
+  rdy_head[lvl] = p_task;
   os_rdy.p_lnk = p_task;
 }
 
@@ -133,8 +243,7 @@ P_TCB rt_get_same_rdy_prio (void) {
 
   p_first = os_rdy.p_lnk;
   if (p_first->prio == os_tsk.run->prio) {
-    os_rdy.p_lnk = os_rdy.p_lnk->p_lnk;
-    return (p_first);
+    return (rt_get_first (&os_rdy));
   }
   return (NULL);
 }
@@ -165,58 +274,124 @@ res:rt_rmv_list (p_task);
 }
 
 
-/*--------------------------- rt_put_dly ------------------------------------*/
+/*--------------------------- rt_whl_init -----------------------------------*/
+
+void rt_whl_init (P_WHEEL p_whl) {
+  /* Initialize timer wheel "p_whl" to empty. */
+  U32 i;
 
-void rt_put_dly (P_TCB p_task, U16 delay) {
-  /* Put a task identified with "p_task" into chained delay wait list using */
-  /* a delay value of "delay".                                              */
-  P_TCB p;
-  U32 delta,idelay = delay;
-
-  p = (P_TCB)&os_dly;
-  if (p->p_dlnk == NULL) {
-    /* Delay list empty */
-    delta = 0;
-    goto last;
+  p_whl->count = 0;
+  for (i = 0; i < OS_WHEEL_SLOTS; i++) {
+    p_whl->slot[i] = NULL;
   }
-  delta = os_dly.delta_time;
-  while (delta < idelay) {
-    if (p->p_dlnk == NULL) {
-      /* End of list found */
-last: p_task->p_dlnk = NULL;
-      p->p_dlnk = p_task;
-      p_task->p_blnk = p;
-      p->delta_time = (U16)(idelay - delta);
-      p_task->delta_time = 0;
-      return;
+}
+
+
+/*--------------------------- rt_whl_put ------------------------------------*/
+
+void rt_whl_put (P_WHEEL p_whl, P_TOUT p_tout, U32 time) {
+  /* Put time-out "p_tout" expiring at os_time "time" into wheel "p_whl".   */
+  /* The wheel is hashed on the expiry: a slot holds every time-out that    */
+  /* expires at a time equal to its index modulo OS_WHEEL_SLOTS, so any     */
+  /* 32-bit delay goes in at once, and a tick only looks at one slot.       */
+  P_TOUT *pp_slot = &p_whl->slot[time & (OS_WHEEL_SLOTS-1)];
+
+  p_tout->time = time;
+  p_tout->p_next = *pp_slot;
+  p_tout->pp_prev = pp_slot;
+  if (*pp_slot != NULL) {
+    (*pp_slot)->pp_prev = &p_tout->p_next;
+  }
+  *pp_slot = p_tout;
+  p_whl->count++;
+}
+
+
+/*--------------------------- rt_whl_rmv ------------------------------------*/
+
+void rt_whl_rmv (P_WHEEL p_whl, P_TOUT p_tout) {
+  /* Remove time-out "p_tout" from wheel "p_whl" if it is in it. */
+  if (p_tout->pp_prev != NULL) {
+    *p_tout->pp_prev = p_tout->p_next;
+    if (p_tout->p_next != NULL) {
+      p_tout->p_next->pp_prev = p_tout->pp_prev;
     }
-    p = p->p_dlnk;
-    delta += p->delta_time;
+    p_tout->p_next = NULL;
+    p_tout->pp_prev = NULL;
+    p_whl->count--;
+  }
+}
+
+
+/*--------------------------- rt_whl_get ------------------------------------*/
+
+P_TOUT rt_whl_get (P_WHEEL p_whl, U32 time) {
+  /* Remove and return a time-out of wheel "p_whl" expiring at os_time      */
+  /* "time"; NULL if there is none left. The others in its slot expire      */
+  /* one or more turns of the wheel later.                                  */
+  P_TOUT p_tout;
+
+  p_tout = p_whl->slot[time & (OS_WHEEL_SLOTS-1)];
+  for ( ; p_tout != NULL; p_tout = p_tout->p_next) {
+    if (p_tout->time == time) {
+      rt_whl_rmv (p_whl, p_tout);
+      return (p_tout);
+    }
+  }
+  return (NULL);
+}
+
+
+/*--------------------------- rt_whl_next -----------------------------------*/
+
+U32 rt_whl_next (P_WHEEL p_whl, U32 time) {
+  /* Ticks from os_time "time" to the first expiry in wheel "p_whl";        */
+  /* 0xFFFFFFFF if the wheel is empty. Only used when going idle.           */
+  P_TOUT p_tout;
+  U32 i, delta, next = 0xFFFFFFFF;
+
+  if (p_whl->count == 0) {
+    return (next);
   }
-  /* Right place found */
-  p_task->p_dlnk = p->p_dlnk;
-  p->p_dlnk = p_task;
-  p_task->p_blnk = p;
-  if (p_task->p_dlnk != NULL) {
-    p_task->p_dlnk->p_blnk = p_task;
+  /* The slots for the next turn in order: the first time-out found that    */
+  /* is due within the turn is the answer.                                  */
+  for (i = 1; i <= OS_WHEEL_SLOTS; i++) {
+    p_tout = p_whl->slot[(time + i) & (OS_WHEEL_SLOTS-1)];
+    for ( ; p_tout != NULL; p_tout = p_tout->p_next) {
+      delta = p_tout->time - time;
+      if (delta == i) {
+        return (delta);
+      }
+      if (delta < next) {
+        next = delta;
+      }
+    }
   }
-  p_task->delta_time = (U16)(delta - idelay);
-  p->delta_time -= p_task->delta_time;
+  return (next);
+}
+
+
+/*--------------------------- rt_put_dly ------------------------------------*/
+
+void rt_put_dly (P_TCB p_task, U32 delay) {
+  /* Put a task identified with "p_task" into the delay wheel, to be woken  */
+  /* "delay" ticks from now.                                                */
+  rt_whl_put (&os_dly, &p_task->tout, os_time + delay);
 }
 
 
 /*--------------------------- rt_dec_dly ------------------------------------*/
 
 void rt_dec_dly (void) {
-  /* Decrement delta time of list head: remove tasks having a value of zero.*/
+  /* Wake the tasks whose delay or time-out expires at this tick. */
+  P_TOUT p_tout;
   P_TCB p_rdy;
 
-  if (os_dly.p_dlnk == NULL) {
+  if (os_dly.count == 0) {
     return;
   }
-  os_dly.delta_time--;
-  while ((os_dly.delta_time == 0) && (os_dly.p_dlnk != NULL)) {
-    p_rdy = os_dly.p_dlnk;
+  while ((p_tout = rt_whl_get (&os_dly, os_time)) != NULL) {
+    p_rdy = TOUT_TCB(p_tout);
     if (p_rdy->p_rlnk != NULL) {
       /* Task is really enqueued, remove task from semaphore/mailbox */
       /* timeout waiting list. */
@@ -228,18 +403,11 @@ void rt_dec_dly (void) {
       p_rdy->p_rlnk = NULL;
     }
     rt_put_prio (&os_rdy, p_rdy);
-    os_dly.delta_time = p_rdy->delta_time;
     if (p_rdy->state == WAIT_ITV) {
       /* Calculate the next time for interval wait. */
-      p_rdy->delta_time = p_rdy->interval_time + (U16)os_time;
+      p_rdy->tout.time += p_rdy->interval_time;
     }
     p_rdy->state   = READY;
-    os_dly.p_dlnk = p_rdy->p_dlnk;
-    if (p_rdy->p_dlnk != NULL) {
-      p_rdy->p_dlnk->p_blnk =  (P_TCB)&os_dly;
-      p_rdy->p_dlnk = NULL;
-    }
-    p_rdy->p_blnk = NULL;
   }
 }
 
@@ -249,7 +417,7 @@ void rt_dec_dly (void) {
 void rt_rmv_list (P_TCB p_task) {
   /* Remove task identified with "p_task" from ready, semaphore or mailbox  */
   /* waiting list if enqueued.                                              */
-  P_TCB p_b;
+  U32 lvl, map;
 
   if (p_task->p_rlnk != NULL) {
     /* A task is enqueued in semaphore / mailbox waiting list. */
@@ -260,40 +428,23 @@ void rt_rmv_list (P_TCB p_task) {
     return;
   }
 
-  p_b = (P_TCB)&os_rdy;
-  while (p_b != NULL) {
-    /* Search the ready list for task "p_task" */
-    if (p_b->p_lnk == p_task) {
-      p_b->p_lnk = p_task->p_lnk;
-      return;
-    }
-    p_b = p_b->p_lnk;
+  /* Search the ready list for task "p_task": its own level first, then     */
+  /* the others, as its priority may have changed since it was put there.   */
+  lvl = RDY_LEVEL(p_task->prio);
+  map = rdy_map & ~(1U << lvl);
+  while (!rdy_unlink (lvl, p_task) && map != 0) {
+    lvl = rdy_top (map);
+    map &= ~(1U << lvl);
   }
+  rdy_update ();
 }
 
 
 /*--------------------------- rt_rmv_dly ------------------------------------*/
 
 void rt_rmv_dly (P_TCB p_task) {
-  /* Remove task identified with "p_task" from delay list if enqueued.      */
-  P_TCB p_b;
-
-  p_b = p_task->p_blnk;
-  if (p_b != NULL) {
-    /* Task is really enqueued */
-    p_b->p_dlnk = p_task->p_dlnk;
-    if (p_task->p_dlnk != NULL) {
-      /* 'p_task' is in the middle of list */
-      p_b->delta_time += p_task->delta_time;
-      p_task->p_dlnk->p_blnk = p_b;
-      p_task->p_dlnk = NULL;
-    }
-    else {
-      /* 'p_task' is at the end of list */
-      p_b->delta_time = 0;
-    }
-    p_task->p_blnk = NULL;
-  }
+  /* Remove task identified with "p_task" from delay wheel if enqueued.     */
+  rt_whl_rmv (&os_dly, &p_task->tout);
 }
 
 
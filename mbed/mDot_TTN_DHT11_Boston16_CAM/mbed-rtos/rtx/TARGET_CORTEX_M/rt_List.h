@@ -43,7 +43,7 @@
 
 /* Variables */
 extern struct OS_XCB os_rdy;
-extern struct OS_XCB os_dly;
+extern struct OS_WHEEL os_dly;
 
 /* Functions */
 extern void  rt_put_prio      (P_XCB p_CB, P_TCB p_task);
@@ -51,12 +51,20 @@ extern P_TCB rt_get_first     (P_XCB p_CB);
 extern void  rt_put_rdy_first (P_TCB p_task);
 extern P_TCB rt_get_same_rdy_prio (void);
 extern void  rt_resort_prio   (P_TCB p_task);
-extern void  rt_put_dly       (P_TCB p_task, U16 delay);
+extern void  rt_whl_init      (P_WHEEL p_whl);
+extern void  rt_whl_put       (P_WHEEL p_whl, P_TOUT p_tout, U32 time);
+extern void  rt_whl_rmv       (P_WHEEL p_whl, P_TOUT p_tout);
+extern P_TOUT rt_whl_get      (P_WHEEL p_whl, U32 time);
+extern U32   rt_whl_next      (P_WHEEL p_whl, U32 time);
+extern void  rt_put_dly       (P_TCB p_task, U32 delay);
 extern void  rt_dec_dly       (void);
 extern void  rt_rmv_list      (P_TCB p_task);
 extern void  rt_rmv_dly       (P_TCB p_task);
 extern void  rt_psq_enq       (OS_ID entry, U32 arg);
 
+/* Task of a time-out on the delay wheel */
+#define TOUT_TCB(p_tout) ((P_TCB)((U8 *)(p_tout) - (U8 *)&((P_TCB)0)->tout))
+
 /* This is a fast macro generating in-line code */
 #define rt_rdy_prio(void) (os_rdy.p_lnk->prio)
 
@@ -67,7 +67,7 @@ void rt_mbx_init (OS_ID mailbox, U16 mbx_size) {
 
 /*--------------------------- rt_mbx_send -----------------------------------*/
 
-OS_RESULT rt_mbx_send (OS_ID mailbox, void *p_msg, U16 timeout) {
+OS_RESULT rt_mbx_send (OS_ID mailbox, void *p_msg, U32 timeout) {
   /* Send message to a mailbox */
   P_MCB p_MCB = mailbox;
   P_TCB p_TCB;
@@ -120,7 +120,7 @@ OS_RESULT rt_mbx_send (OS_ID mailbox, void *p_msg, U16 timeout) {
 
 /*--------------------------- rt_mbx_wait -----------------------------------*/
 
-OS_RESULT rt_mbx_wait (OS_ID mailbox, void **message, U16 timeout) {
+OS_RESULT rt_mbx_wait (OS_ID mailbox, void **message, U32 timeout) {
   /* Receive a message; possibly wait for it */
   P_MCB p_MCB = mailbox;
   P_TCB p_TCB;
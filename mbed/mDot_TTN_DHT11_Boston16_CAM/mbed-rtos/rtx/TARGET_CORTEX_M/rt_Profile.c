@@ -0,0 +1,211 @@
+/*----------------------------------------------------------------------------
+ *      RL-ARM - RTX
+ *----------------------------------------------------------------------------
+ *      Name:    RT_PROFILE.C
+ *      Purpose: Cycle count profiling of tasks and interrupts
+ *      Rev.:    V4.60
+ *----------------------------------------------------------------------------
+ *
+ * Copyright (c) 1999-2009 KEIL, 2009-2012 ARM Germany GmbH
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  - Neither the name of ARM  nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS AND CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *---------------------------------------------------------------------------*/
+
+/* OS_PROFILE is set for the whole build, as -DOS_PROFILE=1, rather than in */
+/* RTX_Conf_CM.c, so that this file sees it too. Without it, only os_prof  */
+/* is left, for osKernelGetProfile to read as zeros.                       */
+#if defined (OS_PROFILE) && OS_PROFILE
+#define __CMSIS_GENERIC
+
+#if defined (__CORTEX_M4) || defined (__CORTEX_M4F)
+  #include "core_cm4.h"
+#elif defined (__CORTEX_M3)
+  #include "core_cm3.h"
+#elif defined (__CORTEX_M0) || defined (__CORTEX_M0PLUS)
+  #error "No cycle counter on Cortex-M0: build without OS_PROFILE"
+#else
+  #error "Missing __CORTEX_Mx definition"
+#endif
+#endif
+
+#include "rt_TypeDef.h"
+#include "RTX_Conf.h"
+#include "rt_Task.h"
+#include "rt_Profile.h"
+#include "rt_HAL_CM.h"
+
+/* The DWT cycle counter is read at every task switch and the cycles since
+   the last one are charged to the task that had the processor, less the
+   time spent in interrupt handlers meanwhile. Peripheral interrupts are
+   timed by linking with --wrap NVIC_SetVector --wrap NVIC_GetVector: the
+   profiler installs its own handler, which calls the one that was set.
+   SysTick, SVC and PendSV are the kernel's and count for the task they
+   interrupt. The counter stops while the core sleeps, so the cycles of
+   the idle task are the time it was awake; wall time comes from os_time. */
+
+/*----------------------------------------------------------------------------
+ *      Global Variables
+ *---------------------------------------------------------------------------*/
+
+struct OS_PROF os_prof;
+
+#if defined (OS_PROFILE) && OS_PROFILE
+
+/*----------------------------------------------------------------------------
+ *      Local Functions
+ *---------------------------------------------------------------------------*/
+
+/*--------------------------- rt_prof_find ----------------------------------*/
+
+static P_PROF_IRQ rt_prof_find (S32 irqn) {
+  /* Find the entry of interrupt "irqn", NULL if it is not timed. */
+  U32 i;
+
+  for (i = 0; i < os_prof.irq_cnt; i++) {
+    if (os_prof.irq[i].irqn == irqn) {
+      return (&os_prof.irq[i]);
+    }
+  }
+  return (NULL);
+}
+
+/*--------------------------- rt_prof_irq -----------------------------------*/
+
+static void rt_prof_irq (void) {
+  /* Handler of every timed interrupt: call the handler that was set for  */
+  /* the active one. A nested interrupt counts in its own entry and in    */
+  /* the one it interrupted, but only once as interrupt time.             */
+  P_PROF_IRQ p_irq;
+  U32 start, stop, primask;
+
+  p_irq = rt_prof_find ((S32)(__get_IPSR () & 0x1FF) - 16);
+  if (p_irq == NULL) {
+    return;
+  }
+  primask = __get_PRIMASK ();
+  __disable_irq ();
+  start = DWT_CYCCNT;
+  if (os_prof.depth++ == 0) {
+    os_prof.isr_mark = start;
+  }
+  __set_PRIMASK (primask);
+
+  ((FUNCP)p_irq->handler) ();
+
+  __disable_irq ();
+  stop = DWT_CYCCNT;
+  p_irq->count++;
+  p_irq->cycles += stop - start;
+  if (--os_prof.depth == 0) {
+    os_prof.isr_run += stop - os_prof.isr_mark;
+    os_prof.isr     += stop - os_prof.isr_mark;
+  }
+  __set_PRIMASK (primask);
+}
+
+
+/*----------------------------------------------------------------------------
+ *      Global Functions
+ *---------------------------------------------------------------------------*/
+
+/*--------------------------- rt_prof_init ----------------------------------*/
+
+__weak void rt_prof_init (void) {
+  /* Start the cycle counter and count from here for the running task. */
+  DEMCR      |= DEMCR_TRCENA;
+  DWT_CYCCNT  = 0;
+  DWT_CTRL   |= DWT_CYCCNTENA;
+  os_prof.run  = os_tsk.run;
+  os_prof.mark = DWT_CYCCNT;
+}
+
+/*--------------------------- rt_prof_switch --------------------------------*/
+
+__weak void rt_prof_switch (P_TCB p_new) {
+  /* Charge the cycles since the last switch to the task that ran, and    */
+  /* count for "p_new" from now on; "p_new" may be the same task.         */
+  U32 now, run, primask;
+
+  primask = __get_PRIMASK ();
+  __disable_irq ();
+  now = DWT_CYCCNT;
+  run = now - os_prof.mark - os_prof.isr_run;
+  os_prof.mark    = now;
+  os_prof.isr_run = 0;
+  os_prof.run->cycles += run;
+  if (os_prof.run != &os_idle_TCB) {
+    os_prof.busy += run;
+  }
+  os_prof.run = p_new;
+  __set_PRIMASK (primask);
+}
+
+/*--------------------------- __wrap_NVIC_SetVector -------------------------*/
+
+extern void __real_NVIC_SetVector (S32 irqn, U32 vector);
+extern U32  __real_NVIC_GetVector (S32 irqn);
+
+__weak void __wrap_NVIC_SetVector (S32 irqn, U32 vector) {
+  /* Set "vector" for a peripheral interrupt behind the profiler's own    */
+  /* handler. Once the entries are used up, or for a system exception,    */
+  /* the vector is set as it is and the interrupt is not timed.           */
+  P_PROF_IRQ p_irq;
+  U32 primask;
+
+  primask = __get_PRIMASK ();
+  __disable_irq ();
+  p_irq = rt_prof_find (irqn);
+  if ((p_irq == NULL) && (irqn >= 0) && (os_prof.irq_cnt < OS_PROF_IRQS)) {
+    p_irq = &os_prof.irq[os_prof.irq_cnt++];
+    p_irq->irqn   = irqn;
+    p_irq->count  = 0;
+    p_irq->cycles = 0;
+  }
+  if (p_irq != NULL) {
+    p_irq->handler = vector;
+    vector = (U32)rt_prof_irq;
+  }
+  __real_NVIC_SetVector (irqn, vector);
+  __set_PRIMASK (primask);
+}
+
+/*--------------------------- __wrap_NVIC_GetVector -------------------------*/
+
+__weak U32 __wrap_NVIC_GetVector (S32 irqn) {
+  /* The vector as it was set, rather than the profiler's handler. */
+  P_PROF_IRQ p_irq;
+
+  p_irq = rt_prof_find (irqn);
+  if (p_irq != NULL) {
+    return (p_irq->handler);
+  }
+  return (__real_NVIC_GetVector (irqn));
+}
+
+#endif
+
+/*----------------------------------------------------------------------------
+ * end of file
+ *---------------------------------------------------------------------------*/
+
@@ -117,7 +117,7 @@ OS_RESULT rt_sem_send (OS_ID semaphore) {
 
 /*--------------------------- rt_sem_wait -----------------------------------*/
 
-OS_RESULT rt_sem_wait (OS_ID semaphore, U16 timeout) {
+OS_RESULT rt_sem_wait (OS_ID semaphore, U32 timeout) {
   /* Obtain a token; possibly wait for it */
   P_SCB p_SCB = semaphore;
 
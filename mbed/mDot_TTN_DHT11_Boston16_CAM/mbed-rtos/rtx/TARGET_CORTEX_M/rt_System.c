@@ -58,6 +58,11 @@ static volatile BIT os_lock;
 static volatile BIT os_psh_flag;
 static          U8  pend_flags;
 
+#ifdef __CMSIS_RTOS
+extern U32  sysUserTimerWakeupTime (void);
+extern void sysTimerTick (void);
+#endif
+
 /*----------------------------------------------------------------------------
  *      Global Functions
  *---------------------------------------------------------------------------*/
@@ -76,17 +81,20 @@ __RL_RTX_VER    EQU     0x450
 /*--------------------------- rt_suspend ------------------------------------*/
 U32 rt_suspend (void) {
   /* Suspend OS scheduler */
-  U32 delta = 0xFFFF;
+  U32 delta;
 
   rt_tsk_lock();
 
-  if (os_dly.p_dlnk) {
-    delta = os_dly.delta_time;
-  }
+  delta = rt_whl_next (&os_dly, os_time);
 #ifndef __CMSIS_RTOS
   if (os_tmr.next) {
     if (os_tmr.tcnt < delta) delta = os_tmr.tcnt;
   }
+#else
+  {
+    U32 sleep = sysUserTimerWakeupTime();
+    if (sleep < delta) delta = sleep;
+  }
 #endif
 
   return (delta);
@@ -97,32 +105,34 @@ U32 rt_suspend (void) {
 void rt_resume (U32 sleep_time) {
   /* Resume OS scheduler after suspend */
   P_TCB next;
-  U32   delta;
+  U32   delta, tick;
 
   os_tsk.run->state = READY;
   rt_put_rdy_first (os_tsk.run);
 
   os_robin.task = NULL;
 
-  /* Update delays. */
-  if (os_dly.p_dlnk) {
-    delta = sleep_time;
-    if (delta >= os_dly.delta_time) {
-      delta   -= os_dly.delta_time;
-      os_time += os_dly.delta_time;
-      os_dly.delta_time = 1;
-      while (os_dly.p_dlnk) {
-        rt_dec_dly();
-        if (delta == 0) break;
-        delta--;
-        os_time++;
-      }
-    } else {
-      os_time           += delta;
-      os_dly.delta_time -= delta;
+  /* Update delays and user timers: step from one expiry to the next, as    */
+  /* the wheels only fire the time-outs due at exactly the current time.    */
+  delta = sleep_time;
+  for (;;) {
+    tick = rt_whl_next (&os_dly, os_time);
+#ifdef __CMSIS_RTOS
+    {
+      U32 sleep = sysUserTimerWakeupTime();
+      if (sleep < tick) tick = sleep;
     }
-  } else {
-    os_time += sleep_time;
+#endif
+    if (tick > delta) {
+      os_time += delta;
+      break;
+    }
+    os_time += tick;
+    delta   -= tick;
+    rt_dec_dly ();
+#ifdef __CMSIS_RTOS
+    sysTimerTick ();
+#endif
   }
 
 #ifndef __CMSIS_RTOS
@@ -252,8 +262,6 @@ __weak void os_tick_irqack (void) {
 
 /*--------------------------- rt_systick ------------------------------------*/
 
-extern void sysTimerTick(void);
-
 void rt_systick (void) {
   /* Check for system clock update, suspend running task. */
   P_TCB next;
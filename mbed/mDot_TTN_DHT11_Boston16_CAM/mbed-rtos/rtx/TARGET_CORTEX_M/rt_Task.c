@@ -39,6 +39,7 @@
 #include "rt_List.h"
 #include "rt_MemBox.h"
 #include "rt_Robin.h"
+#include "rt_Profile.h"
 #include "rt_HAL_CM.h"
 
 /*----------------------------------------------------------------------------
@@ -90,13 +91,14 @@ void rt_init_context (P_TCB p_TCB, U8 priority, FUNCP task_body) {
   p_TCB->prio    = priority;
   p_TCB->p_lnk   = NULL;
   p_TCB->p_rlnk  = NULL;
-  p_TCB->p_dlnk  = NULL;
-  p_TCB->p_blnk  = NULL;
-  p_TCB->delta_time    = 0;
+  p_TCB->tout.p_next  = NULL;
+  p_TCB->tout.pp_prev = NULL;
+  p_TCB->tout.time    = 0;
   p_TCB->interval_time = 0;
   p_TCB->events  = 0;
   p_TCB->waits   = 0;
   p_TCB->stack_frame = 0;
+  p_TCB->cycles  = 0;
 
   rt_init_stack (p_TCB, task_body);
 }
@@ -106,6 +108,7 @@ void rt_init_context (P_TCB p_TCB, U8 priority, FUNCP task_body) {
 
 void rt_switch_req (P_TCB p_new) {
   /* Switch to next task (identified by "p_new"). */
+  rt_prof_switch (p_new);
   os_tsk.new_tsk   = p_new;
   p_new->state = RUNNING;
   DBG_TASK_SWITCH(p_new->task_id);
@@ -141,14 +144,14 @@ void rt_dispatch (P_TCB next_TCB) {
 
 /*--------------------------- rt_block --------------------------------------*/
 
-void rt_block (U16 timeout, U8 block_state) {
+void rt_block (U32 timeout, U8 block_state) {
   /* Block running task and choose next ready task.                         */
-  /* "timeout" sets a time-out value or is 0xffff (=no time-out).           */
+  /* "timeout" sets a time-out value or is 0xffffffff (=no time-out).       */
   /* "block_state" defines the appropriate task state */
   P_TCB next_TCB;
 
   if (timeout) {
-    if (timeout < 0xffff) {
+    if (timeout < 0xffffffff) {
       rt_put_dly (os_tsk.run, timeout);
     }
     os_tsk.run->state = block_state;
@@ -283,11 +286,8 @@ void rt_sys_init (FUNCP first_task, U32 prio_stksz, void *stk) {
   /* Set up ready list: initially empty */
   os_rdy.cb_type = HCB;
   os_rdy.p_lnk   = NULL;
-  /* Set up delay list: initially empty */
-  os_dly.cb_type = HCB;
-  os_dly.p_dlnk  = NULL;
-  os_dly.p_blnk  = NULL;
-  os_dly.delta_time = 0;
+  /* Set up delay wheel: initially empty */
+  rt_whl_init (&os_dly);
 
   /* Fix SP and systemvariables to assume idle task is running  */
   /* Transform main program into idle task by assuming idle TCB */
@@ -296,6 +296,7 @@ void rt_sys_init (FUNCP first_task, U32 prio_stksz, void *stk) {
 #endif
   os_tsk.run = &os_idle_TCB;
   os_tsk.run->state = RUNNING;
+  rt_prof_init ();
 
   /* Initialize ps queue */
   os_psq->first = 0;
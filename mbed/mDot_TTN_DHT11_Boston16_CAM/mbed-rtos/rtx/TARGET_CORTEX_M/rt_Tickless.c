@@ -0,0 +1,106 @@
+/*----------------------------------------------------------------------------
+ *      RL-ARM - RTX
+ *----------------------------------------------------------------------------
+ *      Name:    RT_TICKLESS.C
+ *      Purpose: Stretching the SysTick over idle ticks
+ *      Rev.:    V4.60
+ *
+ * Copyright (c) 1999-2009 KEIL, 2009-2012 ARM Germany GmbH
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  - Neither the name of ARM  nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL COPYRIGHT HOLDERS AND CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *---------------------------------------------------------------------------*/
+
+#include "rt_TypeDef.h"
+#include "RTX_Conf.h"
+#include "rt_Tickless.h"
+#include "cmsis.h"
+#include "sleep_api.h"
+
+/* The idle demon suspends the scheduler, stretches the SysTick period over
+   the ticks that have nothing to do and sleeps. The stretched period starts
+   at the next tick boundary, so the tick phase is kept whether the sleep
+   lasts the whole stretch or an interrupt ends it early. SysTick stops in
+   STOP mode, so this can only use sleep(), not deepsleep(). */
+
+
+/*----------------------------------------------------------------------------
+ *      Functions
+ *---------------------------------------------------------------------------*/
+
+/*--------------------------- rt_tick_sleep ---------------------------------*/
+
+U32 rt_tick_sleep (U32 ticks) {
+  /* Sleep through up to "ticks" - 1 tick periods, with the SysTick set to  */
+  /* fire at the last of them; the tick that is actually due is left to the */
+  /* normal SysTick handler. Returns the ticks that passed. Called with the  */
+  /* scheduler suspended and interrupts masked, so that a wake-up interrupt */
+  /* is only taken once the count is settled.                               */
+  U32 period = os_trv + 1;
+  U32 left, part;
+
+  /* longest stretch the 24-bit reload register holds */
+  if (ticks > 0x00FFFFFF / period) {
+    ticks = 0x00FFFFFF / period;
+  }
+  ticks--;
+
+  /* keep the phase: the first boundary is what is left of the current tick */
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk;
+  part = SysTick->VAL;
+  if (part == 0) {
+    part = period;
+  }
+  SysTick->LOAD = part + (ticks - 1) * period - 1;
+  SysTick->VAL  = 0;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk |
+                  SysTick_CTRL_ENABLE_Msk;
+  SysTick->LOAD = os_trv;                       /* used from the next reload  */
+
+  sleep ();
+
+  left = SysTick->VAL;
+  if (SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk) {
+    left = 0;                                   /* slept the whole stretch    */
+  }
+  else {
+    /* woken early: restart the counter at the next tick boundary */
+    part = left % period;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk;
+    SysTick->LOAD = (part ? part : period) - 1;
+    SysTick->VAL  = 0;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = os_trv;
+    left = (left + period - 1) / period;
+  }
+
+  /* back to the locked state left by os_suspend, without the expired tick */
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+  SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+
+  return (ticks - left);
+}
+
+/*----------------------------------------------------------------------------
+ * end of file
+ *---------------------------------------------------------------------------*/
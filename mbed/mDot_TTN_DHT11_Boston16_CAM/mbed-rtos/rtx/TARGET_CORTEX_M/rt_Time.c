@@ -60,7 +60,7 @@ U32 rt_time_get (void) {
 
 /*--------------------------- rt_dly_wait -----------------------------------*/
 
-void rt_dly_wait (U16 delay_time) {
+void rt_dly_wait (U32 delay_time) {
   /* Delay task by "delay_time" */
   rt_block (delay_time, WAIT_DLY);
 }
@@ -71,7 +71,7 @@ void rt_dly_wait (U16 delay_time) {
 void rt_itv_set (U16 interval_time) {
   /* Set interval length and define start of first interval */
   os_tsk.run->interval_time = interval_time;
-  os_tsk.run->delta_time = interval_time + (U16)os_time;
+  os_tsk.run->tout.time = os_time + interval_time;
 }
 
 
@@ -79,13 +79,16 @@ void rt_itv_set (U16 interval_time) {
 
 void rt_itv_wait (void) {
   /* Wait for interval end and define start of next one */
-  U16 delta;
+  U32 delta;
 
-  delta = os_tsk.run->delta_time - (U16)os_time;
-  os_tsk.run->delta_time += os_tsk.run->interval_time;
-  if ((delta & 0x8000) == 0) {
+  delta = os_tsk.run->tout.time - os_time;
+  if (delta != 0 && (delta & 0x80000000) == 0) {
+    /* the wake-up moves "tout.time" on to the next interval */
     rt_block (delta, WAIT_ITV);
   }
+  else {
+    os_tsk.run->tout.time += os_tsk.run->interval_time;
+  }
 }
 
 /*----------------------------------------------------------------------------
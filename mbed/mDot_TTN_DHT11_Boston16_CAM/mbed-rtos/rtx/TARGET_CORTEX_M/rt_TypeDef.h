@@ -40,8 +40,40 @@ typedef U32     OS_TID;
 typedef void    *OS_ID;
 typedef U32     OS_RESULT;
 
-#define TCB_STACKF      32        /* 'stack_frame' offset                    */
-#define TCB_TSTACK      40        /* 'tsk_stack' offset                      */
+#define TCB_STACKF      36        /* 'stack_frame' offset                    */
+#define TCB_TSTACK      44        /* 'tsk_stack' offset                      */
+
+#ifndef OS_WHEEL_SLOTS
+#define OS_WHEEL_SLOTS  64        /* Timer wheel slots, a power of 2         */
+#endif
+
+typedef struct OS_WHEEL {         /* Hashed timer wheel                      */
+  U32    count;                   /* Number of time-outs in the wheel        */
+  P_TOUT slot[OS_WHEEL_SLOTS];    /* Time-outs by expiry modulo the slots    */
+} *P_WHEEL;
+
+#ifndef OS_PROF_IRQS
+#define OS_PROF_IRQS    8         /* Interrupt vectors the profiler times    */
+#endif
+
+typedef struct OS_PROF_IRQ {      /* Interrupt vector timed by the profiler  */
+  S32    irqn;                    /* Interrupt number                        */
+  U32    handler;                 /* Handler set with NVIC_SetVector         */
+  U32    count;                   /* Number of times it was taken            */
+  U64    cycles;                  /* Cycles in it, nested interrupts incl.   */
+} *P_PROF_IRQ;
+
+typedef struct OS_PROF {          /* Cycle count profile                     */
+  P_TCB  run;                     /* Task the cycles are counted for         */
+  U32    mark;                    /* Cycle count at the last task switch     */
+  U32    isr_run;                 /* Interrupt cycles since then             */
+  U32    isr_mark;                /* Cycle count at the outermost interrupt  */
+  U32    depth;                   /* Interrupt nesting level                 */
+  U32    irq_cnt;                 /* Number of 'irq' entries in use          */
+  U64    busy;                    /* Cycles run by tasks other than idle     */
+  U64    isr;                     /* Cycles in timed interrupt handlers      */
+  struct OS_PROF_IRQ irq[OS_PROF_IRQS];
+} *P_PROF;
 
 typedef struct OS_PSFE {          /* Post Service Fifo Entry                 */
   void  *id;                      /* Object Identification                   */
@@ -71,9 +103,6 @@ typedef struct OS_XCB {
   U8     cb_type;                 /* Control Block Type                      */
   struct OS_TCB *p_lnk;           /* Link pointer for ready/sem. wait list   */
   struct OS_TCB *p_rlnk;          /* Link pointer for sem./mbx lst backwards */
-  struct OS_TCB *p_dlnk;          /* Link pointer for delay list             */
-  struct OS_TCB *p_blnk;          /* Link pointer for delay list backwards   */
-  U16    delta_time;              /* Time until time out                     */
 } *P_XCB;
 
 typedef struct OS_MCB {